@@ -0,0 +1,172 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 23:58:12
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 23:58:12
+ */
+
+#include <argp.h>
+#include <linux/if_packet.h>
+#include <string.h>
+
+#include "argparse.h"
+
+
+/**
+ * Convert name of fanout mode to PACKET_FANOUT_* value.
+ *
+ *  Returns
+ *      Fanout mode if success, -1 if unknown.
+ **/
+static int parse_fanout_mode(const char *name) {
+    if (strcmp(name, "hash") == 0) {
+        return PACKET_FANOUT_HASH;
+    }
+    if (strcmp(name, "lb") == 0) {
+        return PACKET_FANOUT_LB;
+    }
+    if (strcmp(name, "cpu") == 0) {
+        return PACKET_FANOUT_CPU;
+    }
+    if (strcmp(name, "qm") == 0) {
+        return PACKET_FANOUT_QM;
+    }
+
+    return -1;
+}
+
+
+/**
+ * opt_handler function for GNU argp.
+ **/
+static error_t opt_handler(int key, char *arg, struct argp_state *state) {
+    struct cmdline_arguments *arguments = state->input;
+
+    switch(key) {
+        case 'i':
+            arguments->iface = arg;
+            break;
+
+        case 'w':
+            arguments->output = arg;
+            break;
+
+        case 'T':
+            if (sscanf(arg, "%hx", &arguments->type) != 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'j':
+            if (sscanf(arg, "%d", &arguments->workers) != 1 || arguments->workers < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'F':
+            arguments->fanout_mode = parse_fanout_mode(arg);
+            if (arguments->fanout_mode == -1) {
+                argp_error(state, "unknown fanout mode: %s", arg);
+            }
+            break;
+
+        case 's':
+            if (sscanf(arg, "%d", &arguments->snaplen) != 1 || arguments->snaplen < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'n':
+            if (sscanf(arg, "%ld", &arguments->count) != 1 || arguments->count < 0) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'b':
+            if (sscanf(arg, "%d", &arguments->blocks) != 1 || arguments->blocks < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Parse command line arguments given by argc, argv.
+ *
+ *  Arguments
+ *      argc: the same with main function.
+ *
+ *      argv: the same with main function.
+ *
+ *  Returns
+ *      Pointer to struct arguments if success, NULL if error.
+ **/
+const struct cmdline_arguments *parse_arguments(int argc, char *argv[]) {
+    // docs for program and options
+    static char const doc[] = "capture: capture ethernet frames through mmap'd rx rings\v"
+        "Frames are spread over workers by a PACKET_FANOUT group, each "
+        "worker reading its own TPACKET_V3 ring a block at a time. Rates "
+        "and drops counted by kernel are reported every second.";
+    static char const args_doc[] = "";
+
+    // command line options
+    static struct argp_option const options[] = {
+        // Option -i --iface: name of iface to capture on
+        {"iface", 'i', "IFACE", 0, "name of iface to capture on"},
+
+        // Option -w --write: pcap file
+        {"write", 'w', "FILE", 0, "write frames to pcap FILE, count only if not given"},
+
+        // Option -T --type: ether type
+        {"type", 'T', "TYPE", 0, "capture only frames of ether TYPE, in hex"},
+
+        // Option -j --workers: worker threads
+        {"workers", 'j', "WORKERS", 0, "worker threads, each with its own ring"},
+
+        // Option -F --fanout: fanout mode
+        {"fanout", 'F', "MODE", 0, "spread frames over workers by hash, lb, cpu or qm"},
+
+        // Option -s --snaplen: bytes captured per frame
+        {"snaplen", 's', "BYTES", 0, "bytes captured per frame"},
+
+        // Option -n --count: frames to capture
+        {"count", 'n', "COUNT", 0, "stop after COUNT frames, 0 for endless"},
+
+        // Option -b --blocks: ring blocks per worker
+        {"blocks", 'b', "BLOCKS", 0, "1MB ring blocks per worker"},
+
+        { 0 }
+    };
+
+    static const struct argp argp = {
+        options,
+        opt_handler,
+        args_doc,
+        doc,
+        0,
+        0,
+        0,
+    };
+
+    // for storing results
+    static struct cmdline_arguments arguments = {
+        .iface = NULL,
+        .output = NULL,
+        .type = 0,
+        .workers = 1,
+        .fanout_mode = PACKET_FANOUT_HASH,
+        .snaplen = 65535,
+        .count = 0,
+        .blocks = 64,
+    };
+
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    return &arguments;
+}
@@ -0,0 +1,37 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 23:58:12
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 23:58:12
+ */
+
+/**
+ * struct for storing command line arguments.
+ **/
+struct cmdline_arguments {
+    // name of iface to capture on
+    const char *iface;
+
+    // pcap file to write, NULL for counting only
+    const char *output;
+
+    // ether type to capture, 0 for all
+    unsigned short type;
+
+    // worker threads, each with its own ring in a fanout group
+    int workers;
+
+    // fanout mode, see PACKET_FANOUT_*
+    int fanout_mode;
+
+    // bytes captured per frame
+    int snaplen;
+
+    // frames to capture, 0 for endless
+    long count;
+
+    // ring blocks per worker
+    int blocks;
+};
+
+const struct cmdline_arguments *parse_arguments(int argc, char *argv[]);
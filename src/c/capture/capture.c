@@ -0,0 +1,383 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 23:58:12
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 00:21:45
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/if_ether.h>
+#include <net/if.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "pcap.h"
+#include "rxring.h"
+
+#define RING_BLOCK_SIZE (1 << 20)
+#define RING_FRAME_SIZE 2048
+
+// partly filled blocks are handed over after this long
+#define RING_BLOCK_TIMEOUT 10
+
+// bytes buffered by a worker before writing
+#define WRITE_BUFFER_SIZE (4 << 20)
+
+/*
+ * Worker reading its own ring of the fanout group.
+ */
+struct worker {
+    pthread_t thread;
+    int index;
+
+    int sock;
+    struct rx_ring ring;
+    struct pcap_buffer buffer;
+
+    // progress, read by main thread while running
+    long frames;
+    long long bytes;
+
+    int error;
+};
+
+static const struct cmdline_arguments *arguments;
+
+// frames taken by all workers, for stopping at count
+static long taken = 0;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_interrupt(int signum) {
+    interrupted = 1;
+}
+
+
+/**
+ * Fetch monotonic time in seconds.
+ **/
+static double get_timestamp() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/**
+ * Open a packet socket with its own ring, bound to iface and joined to
+ * fanout group.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int open_worker(struct worker *worker, int if_index, int group) {
+    // protocol 0 receives nothing until bound
+    worker->sock = socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (worker->sock == -1) {
+        return -1;
+    }
+
+    if (rx_ring_setup(&worker->ring, worker->sock, RING_BLOCK_SIZE, arguments->blocks,
+            RING_FRAME_SIZE, RING_BLOCK_TIMEOUT) == -1) {
+        return -1;
+    }
+
+    // kernel delivers only frames of given type
+    struct sockaddr_ll sll;
+    bzero(&sll, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_ifindex = if_index;
+    sll.sll_protocol = htons(arguments->type == 0 ? ETH_P_ALL : arguments->type);
+
+    if (bind(worker->sock, (struct sockaddr *)&sll, sizeof(sll)) == -1) {
+        return -1;
+    }
+
+    int fanout = group | (arguments->fanout_mode << 16);
+    if (setsockopt(worker->sock, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Process frames of a block, writing them to pcap if any.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int process_block(struct worker *worker, const struct tpacket_block_desc *block) {
+    unsigned int num = block->hdr.bh1.num_pkts;
+
+    // take frames up to count at once for the whole block
+    if (arguments->count > 0) {
+        long first = __atomic_fetch_add(&taken, num, __ATOMIC_RELAXED);
+        if (first + num >= arguments->count) {
+            num = first >= arguments->count ? 0 : arguments->count - first;
+            interrupted = 1;
+        }
+    }
+
+    const unsigned char *p = (const unsigned char *)block + block->hdr.bh1.offset_to_first_pkt;
+    long long bytes = 0;
+
+    unsigned int i;
+    for (i = 0; i < num; i++) {
+        const struct tpacket3_hdr *hdr = (const struct tpacket3_hdr *)p;
+        bytes += hdr->tp_len;
+
+        if (arguments->output != NULL) {
+            uint32_t caplen = hdr->tp_snaplen;
+            if (caplen > (uint32_t)arguments->snaplen) {
+                caplen = arguments->snaplen;
+            }
+
+            if (pcap_append(&worker->buffer, hdr->tp_sec, hdr->tp_nsec, p + hdr->tp_mac,
+                    caplen, hdr->tp_len) == -1) {
+                return -1;
+            }
+        }
+
+        p += hdr->tp_next_offset;
+    }
+
+    __atomic_store_n(&worker->frames, worker->frames + num, __ATOMIC_RELAXED);
+    __atomic_store_n(&worker->bytes, worker->bytes + bytes, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+
+/**
+ * Worker thread: process blocks in ring order, waiting in poll when the
+ * next one is still owned by kernel.
+ **/
+static void *run_worker(void *arg) {
+    struct worker *worker = arg;
+
+    while (!interrupted) {
+        struct tpacket_block_desc *block = rx_ring_block(&worker->ring);
+        if (block == NULL) {
+            struct pollfd pfd = { worker->sock, POLLIN | POLLERR, 0 };
+            if (poll(&pfd, 1, 100) == -1 && errno != EINTR) {
+                worker->error = errno;
+                break;
+            }
+            continue;
+        }
+
+        int ret = process_block(worker, block);
+        rx_ring_release(&worker->ring, block);
+
+        if (ret == -1) {
+            worker->error = errno;
+            break;
+        }
+    }
+
+    if (arguments->output != NULL && pcap_flush(&worker->buffer) == -1 && worker->error == 0) {
+        worker->error = errno;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Read and reset drop counters of all rings.
+ *
+ *  Arguments
+ *      workers: workers of fanout group.
+ *
+ *      n: number of workers.
+ *
+ *      drops: for storing frames dropped since last call.
+ *
+ *      freezes: for storing times queues froze since last call.
+ **/
+static void collect_drops(struct worker *workers, int n, long *drops, long *freezes) {
+    *drops = 0;
+    *freezes = 0;
+
+    int i;
+    for (i = 0; i < n; i++) {
+        struct tpacket_stats_v3 stats;
+        socklen_t len = sizeof(stats);
+        if (getsockopt(workers[i].sock, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0) {
+            *drops += stats.tp_drops;
+            *freezes += stats.tp_freeze_q_cnt;
+        }
+    }
+}
+
+
+/**
+ * Sum frames and bytes processed by all workers so far.
+ **/
+static void collect_progress(struct worker *workers, int n, long *frames, long long *bytes) {
+    *frames = 0;
+    *bytes = 0;
+
+    int i;
+    for (i = 0; i < n; i++) {
+        *frames += __atomic_load_n(&workers[i].frames, __ATOMIC_RELAXED);
+        *bytes += __atomic_load_n(&workers[i].bytes, __ATOMIC_RELAXED);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    // parse command line options to struct arguments
+    arguments = parse_arguments(argc, argv);
+    if (arguments == NULL) {
+        fprintf(stderr, "Bad command line options given\n");
+        return -1;
+    }
+
+    if (arguments->iface == NULL) {
+        fprintf(stderr, "No iface given\n");
+        return -1;
+    }
+
+    int if_index = if_nametoindex(arguments->iface);
+    if (if_index == 0) {
+        perror("Fail to fetch iface index");
+        return -1;
+    }
+
+    struct pcap_file file;
+    if (arguments->output != NULL && pcap_open(&file, arguments->output, arguments->snaplen) == -1) {
+        perror("Fail to open pcap file");
+        return -1;
+    }
+
+    int n = arguments->workers;
+    struct worker *workers = calloc(n, sizeof(*workers));
+    if (workers == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+
+    // set up all rings before any worker starts, so none misses its share
+    int group = getpid() & 0xffff;
+
+    int i;
+    for (i = 0; i < n; i++) {
+        struct worker *worker = &workers[i];
+        worker->index = i;
+
+        if (open_worker(worker, if_index, group) == -1) {
+            perror("Fail to set up rx ring");
+            return -1;
+        }
+
+        if (arguments->output != NULL && pcap_buffer_init(&worker->buffer, &file, WRITE_BUFFER_SIZE) == -1) {
+            fprintf(stderr, "Out of memory\n");
+            return -1;
+        }
+    }
+
+    signal(SIGINT, handle_interrupt);
+    signal(SIGTERM, handle_interrupt);
+
+    // forget drops while rings were joining
+    long drops, freezes;
+    collect_drops(workers, n, &drops, &freezes);
+
+    for (i = 0; i < n; i++) {
+        if (pthread_create(&workers[i].thread, NULL, run_worker, &workers[i]) != 0) {
+            fprintf(stderr, "Fail to create thread\n");
+            interrupted = 1;
+            n = i;
+            break;
+        }
+    }
+
+    printf("Capturing on %s with %d workers, %d blocks of %d bytes each\n",
+        arguments->iface, n, arguments->blocks, RING_BLOCK_SIZE);
+
+    double start = get_timestamp();
+    double last_ts = start;
+    long last_frames = 0;
+    long long last_bytes = 0;
+    long total_drops = 0, total_freezes = 0;
+
+    // report every second until interrupted or count reached
+    while (!interrupted) {
+        struct timespec ts = { 0, 100000000 };
+        nanosleep(&ts, NULL);
+
+        double now = get_timestamp();
+        if (now - last_ts < 1) {
+            continue;
+        }
+
+        long frames;
+        long long bytes;
+        collect_progress(workers, n, &frames, &bytes);
+        collect_drops(workers, n, &drops, &freezes);
+        total_drops += drops;
+        total_freezes += freezes;
+
+        double elapsed = now - last_ts;
+        printf("[%7.1fs] %10.0f fps %10.1f Mbps %8ld drops %4ld freezes\n", now - start,
+            (frames - last_frames) / elapsed, (bytes - last_bytes) * 8 / elapsed / 1e6, drops, freezes);
+        fflush(stdout);
+
+        last_ts = now;
+        last_frames = frames;
+        last_bytes = bytes;
+    }
+
+    int ret = 0;
+    for (i = 0; i < n; i++) {
+        pthread_join(workers[i].thread, NULL);
+        if (workers[i].error != 0) {
+            fprintf(stderr, "Worker %d failed: %s\n", i, strerror(workers[i].error));
+            ret = -1;
+        }
+    }
+
+    double elapsed = get_timestamp() - start;
+
+    long frames;
+    long long bytes;
+    collect_progress(workers, n, &frames, &bytes);
+    collect_drops(workers, n, &drops, &freezes);
+    total_drops += drops;
+    total_freezes += freezes;
+
+    printf("--- %ld frames, %lld bytes captured in %.3fs, %.0f fps, %ld dropped by kernel, %ld freezes ---\n",
+        frames, bytes, elapsed, frames / elapsed, total_drops, total_freezes);
+
+    for (i = 0; i < n; i++) {
+        if (n > 1) {
+            printf("worker %d: %ld frames\n", i, workers[i].frames);
+        }
+
+        if (arguments->output != NULL) {
+            pcap_buffer_free(&workers[i].buffer);
+        }
+        rx_ring_close(&workers[i].ring);
+        close(workers[i].sock);
+    }
+
+    if (arguments->output != NULL && pcap_close(&file) == -1) {
+        perror("Fail to close pcap file");
+        ret = -1;
+    }
+
+    free(workers);
+
+    return ret;
+}
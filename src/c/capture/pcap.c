@@ -0,0 +1,209 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 00:14:02
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 00:14:02
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pcap.h"
+
+// nanosecond resolution pcap
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define LINKTYPE_ETHERNET 1
+
+struct pcap_file_header {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+};
+
+struct pcap_record_header {
+    uint32_t ts_sec;
+    uint32_t ts_nsec;
+    uint32_t caplen;
+    uint32_t len;
+};
+
+
+/**
+ * Write all bytes, resuming after short writes.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int write_all(int fd, const void *data, size_t size) {
+    const unsigned char *p = data;
+    while (size > 0) {
+        ssize_t bytes = write(fd, p, size);
+        if (bytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        p += bytes;
+        size -= bytes;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Create a pcap file of ethernet frames and write its header.
+ *
+ *  Arguments
+ *      file: file to open.
+ *
+ *      path: path of file, truncated if exists.
+ *
+ *      snaplen: bytes captured per frame at most.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int pcap_open(struct pcap_file *file, const char *path, int snaplen) {
+    file->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (file->fd == -1) {
+        return -1;
+    }
+
+    struct pcap_file_header header = {
+        .magic = PCAP_MAGIC_NSEC,
+        .version_major = 2,
+        .version_minor = 4,
+        .thiszone = 0,
+        .sigfigs = 0,
+        .snaplen = snaplen,
+        .linktype = LINKTYPE_ETHERNET,
+    };
+
+    if (write_all(file->fd, &header, sizeof(header)) == -1) {
+        close(file->fd);
+        return -1;
+    }
+
+    pthread_mutex_init(&file->lock, NULL);
+
+    return 0;
+}
+
+
+/**
+ * Close a pcap file, all buffers should be flushed before.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int pcap_close(struct pcap_file *file) {
+    pthread_mutex_destroy(&file->lock);
+    return close(file->fd);
+}
+
+
+/**
+ * Allocate a buffer for records to be written to file.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int pcap_buffer_init(struct pcap_buffer *buffer, struct pcap_file *file, size_t capacity) {
+    buffer->file = file;
+    buffer->size = 0;
+    buffer->capacity = capacity;
+
+    buffer->data = malloc(capacity);
+    if (buffer->data == NULL) {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Append a record to buffer, writing buffer out first if it is full.
+ *
+ *  Arguments
+ *      buffer: buffer of a writer.
+ *
+ *      sec, nsec: capture time.
+ *
+ *      frame: captured bytes.
+ *
+ *      caplen: bytes captured.
+ *
+ *      len: original frame length.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int pcap_append(struct pcap_buffer *buffer, uint32_t sec, uint32_t nsec,
+        const void *frame, uint32_t caplen, uint32_t len) {
+    size_t size = sizeof(struct pcap_record_header) + caplen;
+    if (buffer->capacity - buffer->size < size) {
+        if (pcap_flush(buffer) == -1) {
+            return -1;
+        }
+
+        if (buffer->capacity < size) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+    }
+
+    struct pcap_record_header header = {
+        .ts_sec = sec,
+        .ts_nsec = nsec,
+        .caplen = caplen,
+        .len = len,
+    };
+
+    memcpy(buffer->data + buffer->size, &header, sizeof(header));
+    memcpy(buffer->data + buffer->size + sizeof(header), frame, caplen);
+    buffer->size += size;
+
+    return 0;
+}
+
+
+/**
+ * Write buffered records out in one go. Records of a buffer stay
+ * together, those of different writers interleave buffer by buffer.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int pcap_flush(struct pcap_buffer *buffer) {
+    if (buffer->size == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&buffer->file->lock);
+    int ret = write_all(buffer->file->fd, buffer->data, buffer->size);
+    pthread_mutex_unlock(&buffer->file->lock);
+
+    buffer->size = 0;
+
+    return ret;
+}
+
+
+/**
+ * Free buffer, records not flushed are lost.
+ **/
+void pcap_buffer_free(struct pcap_buffer *buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+}
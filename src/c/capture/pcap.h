@@ -0,0 +1,37 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 00:14:02
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 00:14:02
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * struct for a pcap file shared by several writers.
+ **/
+struct pcap_file {
+    int fd;
+    pthread_mutex_t lock;
+};
+
+/**
+ * struct for records buffered by a writer, written out as a whole.
+ **/
+struct pcap_buffer {
+    struct pcap_file *file;
+
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+};
+
+int pcap_open(struct pcap_file *file, const char *path, int snaplen);
+int pcap_close(struct pcap_file *file);
+int pcap_buffer_init(struct pcap_buffer *buffer, struct pcap_file *file, size_t capacity);
+int pcap_append(struct pcap_buffer *buffer, uint32_t sec, uint32_t nsec,
+        const void *frame, uint32_t caplen, uint32_t len);
+int pcap_flush(struct pcap_buffer *buffer);
+void pcap_buffer_free(struct pcap_buffer *buffer);
@@ -0,0 +1,114 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 00:06:31
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 00:06:31
+ */
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "rxring.h"
+
+
+/**
+ * Set up a TPACKET_V3 receive ring on a packet socket and map it.
+ *
+ * Kernel fills a block with as many frames as fit, then hands it over as
+ * a whole, or when it has been open for timeout_ms.
+ *
+ *  Arguments
+ *      ring: ring to set up.
+ *
+ *      sock: packet socket.
+ *
+ *      block_size: bytes per block, multiple of page size.
+ *
+ *      block_nr: number of blocks.
+ *
+ *      frame_size: nominal frame size, kernel packs frames tighter.
+ *
+ *      timeout_ms: time after which a partly filled block is retired.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int rx_ring_setup(struct rx_ring *ring, int sock, unsigned int block_size, unsigned int block_nr,
+        unsigned int frame_size, unsigned int timeout_ms) {
+    bzero(ring, sizeof(*ring));
+    ring->sock = sock;
+
+    int version = TPACKET_V3;
+    if (setsockopt(sock, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) == -1) {
+        return -1;
+    }
+
+    struct tpacket_req3 req = {
+        .tp_block_size = block_size,
+        .tp_block_nr = block_nr,
+        .tp_frame_size = frame_size,
+        .tp_frame_nr = block_size / frame_size * block_nr,
+        .tp_retire_blk_tov = timeout_ms,
+        .tp_feature_req_word = 0,
+    };
+
+    if (setsockopt(sock, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) == -1) {
+        return -1;
+    }
+
+    ring->map_size = (size_t)block_size * block_nr;
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, sock, 0);
+    if (ring->map == MAP_FAILED) {
+        // locking may exceed RLIMIT_MEMLOCK, go without it
+        ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, sock, 0);
+    }
+    if (ring->map == MAP_FAILED) {
+        ring->map = NULL;
+        return -1;
+    }
+
+    ring->block_size = block_size;
+    ring->block_nr = block_nr;
+
+    return 0;
+}
+
+
+/**
+ * Fetch next block handed over by kernel, in ring order.
+ *
+ *  Returns
+ *      Block if one is ready, NULL if not.
+ **/
+struct tpacket_block_desc *rx_ring_block(struct rx_ring *ring) {
+    struct tpacket_block_desc *block =
+        (struct tpacket_block_desc *)(ring->map + (size_t)ring->head * ring->block_size);
+
+    if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+        return NULL;
+    }
+
+    return block;
+}
+
+
+/**
+ * Give a block fetched by rx_ring_block back to kernel and move to the
+ * next one.
+ **/
+void rx_ring_release(struct rx_ring *ring, struct tpacket_block_desc *block) {
+    __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    ring->head = (ring->head + 1) % ring->block_nr;
+}
+
+
+/**
+ * Unmap ring, socket is left open.
+ **/
+void rx_ring_close(struct rx_ring *ring) {
+    if (ring->map != NULL) {
+        munmap(ring->map, ring->map_size);
+        ring->map = NULL;
+    }
+}
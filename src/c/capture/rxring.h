@@ -0,0 +1,31 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 00:06:31
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 00:06:31
+ */
+
+#include <linux/if_packet.h>
+#include <stddef.h>
+
+/**
+ * struct for a TPACKET_V3 PACKET_RX_RING mapped into user space.
+ **/
+struct rx_ring {
+    int sock;
+
+    // mapped area, block_nr blocks of block_size bytes
+    unsigned char *map;
+    size_t map_size;
+    unsigned int block_size;
+    unsigned int block_nr;
+
+    // next block to read
+    unsigned int head;
+};
+
+int rx_ring_setup(struct rx_ring *ring, int sock, unsigned int block_size, unsigned int block_nr,
+        unsigned int frame_size, unsigned int timeout_ms);
+struct tpacket_block_desc *rx_ring_block(struct rx_ring *ring);
+void rx_ring_release(struct rx_ring *ring, struct tpacket_block_desc *block);
+void rx_ring_close(struct rx_ring *ring);
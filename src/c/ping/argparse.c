@@ -0,0 +1,187 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 13:10:45
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:44:52
+ */
+
+#include <argp.h>
+
+#include "argparse.h"
+
+
+/**
+ * opt_handler function for GNU argp.
+ **/
+static error_t opt_handler(int key, char *arg, struct argp_state *state) {
+    struct cmdline_arguments *arguments = state->input;
+
+    switch(key) {
+        case 'f':
+            arguments->file = arg;
+            break;
+
+        case 'c':
+            if (sscanf(arg, "%d", &arguments->count) != 1 || arguments->count < 0) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'r':
+            if (sscanf(arg, "%d", &arguments->rate) != 1 || arguments->rate < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'F':
+            arguments->flood = 1;
+            break;
+
+        case 'I':
+            if (sscanf(arg, "%d", &arguments->report_interval) != 1 || arguments->report_interval < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'i':
+            if (sscanf(arg, "%lf", &arguments->interval) != 1 || arguments->interval < 0) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 't':
+            if (sscanf(arg, "%d", &arguments->timeout) != 1 || arguments->timeout < 0) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'T':
+            arguments->traceroute = 1;
+            break;
+
+        case 'm':
+            if (sscanf(arg, "%d", &arguments->max_ttl) != 1 || arguments->max_ttl < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'M':
+            arguments->pmtu = 1;
+            break;
+
+        case ARGP_KEY_ARGS:
+            // take all the rest as hosts
+            arguments->hosts = state->argv + state->next;
+            arguments->nhosts = state->argc - state->next;
+            state->next = state->argc;
+            break;
+
+        case ARGP_KEY_END:
+            if (arguments->nhosts == 0 && arguments->file == NULL) {
+                argp_error(state, "no host specified");
+            }
+            break;
+
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Parse command line arguments given by argc, argv.
+ *
+ *  Arguments
+ *      argc: the same with main function.
+ *
+ *      argv: the same with main function.
+ *
+ *  Returns
+ *      Pointer to struct arguments if success, NULL if error.
+ **/
+const struct cmdline_arguments *parse_arguments(int argc, char *argv[]) {
+    // docs for program and options
+    static char const doc[] = "ping: send icmp echo requests to hosts\v"
+        "A single ip address is pinged once a second until interrupted. "
+        "Several hosts, CIDR blocks or a host file are probed together, "
+        "interleaved through one socket, and summarized per target. "
+        "Load mode (-r or -F with a single host) paces probes with a token "
+        "bucket and reports latency percentiles. Traceroute mode (-T) "
+        "probes all hops to a single host at once. Path mtu mode (-M) "
+        "probes several sizes with DF set to each host at once.\n\n"
+        "Without -c, a single ip address is pinged until interrupted, several "
+        "targets are probed once each, load mode runs until interrupted and "
+        "traceroute sends one probe per hop. -c 0 probes endlessly, except in "
+        "traceroute mode, which takes at least one probe per hop. Path mtu "
+        "mode ignores -c.";
+    static char const args_doc[] = "HOST...";
+
+    // command line options
+    static struct argp_option const options[] = {
+        // Option -f --file: file listing target hosts
+        {"file", 'f', "FILE", 0, "read target hosts or CIDR blocks from file, one per line"},
+
+        // Option -c --count: probes per target
+        {"count", 'c', "COUNT", 0, "probes per target, or per hop in traceroute mode; "
+            "0 for endless, see below for defaults"},
+
+        // Option -r --rate: probes per second
+        {"rate", 'r', "PPS", 0, "probes per second, for all targets together; "
+            "for a single host, switches to load mode"},
+
+        // Option -F --flood: send as fast as possible
+        {"flood", 'F', 0, 0, "load mode without rate limit, single host"},
+
+        // Option -I --report-interval: interval between reports of load mode
+        {"report-interval", 'I', "MSEC", 0, "interval between reports of load mode"},
+
+        // Option -i --interval: interval between probes to the same target
+        {"interval", 'i', "MSEC", 0, "interval between probes to the same target, fractions allowed"},
+
+        // Option -t --timeout: wait for replies after the last probe
+        {"timeout", 't', "MSEC", 0, "wait for replies after the last probe"},
+
+        // Option -T --traceroute: trace path to host
+        {"traceroute", 'T', 0, 0, "trace path to a single host, probes per hop given by -c"},
+
+        // Option -m --max-ttl: hops to probe in traceroute mode
+        {"max-ttl", 'm', "TTL", 0, "hops to probe in traceroute mode"},
+
+        // Option -M --pmtu: discover path mtu to hosts
+        {"pmtu", 'M', 0, 0, "discover path mtu to hosts, -t is timeout of each round"},
+
+        { 0 }
+    };
+
+    static const struct argp argp = {
+        options,
+        opt_handler,
+        args_doc,
+        doc,
+        0,
+        0,
+        0,
+    };
+
+    // for storing results
+    static struct cmdline_arguments arguments = {
+        .hosts = NULL,
+        .nhosts = 0,
+        .file = NULL,
+        .count = -1,
+        .rate = 0,
+        .flood = 0,
+        .report_interval = 1000,
+        .interval = 1000,
+        .timeout = 1000,
+        .traceroute = 0,
+        .max_ttl = 30,
+        .pmtu = 0,
+    };
+
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    return &arguments;
+}
@@ -0,0 +1,47 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 13:10:45
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 21:20:37
+ */
+
+/**
+ * struct for storing command line arguments.
+ **/
+struct cmdline_arguments {
+    // hosts given as ip addresses or CIDR blocks
+    char **hosts;
+    int nhosts;
+
+    // file listing target hosts, one per line
+    const char *file;
+
+    // probes per target, 0 for endless
+    int count;
+
+    // probes per second, for all targets, 0 for mode default
+    int rate;
+
+    // send as fast as possible, single target
+    int flood;
+
+    // interval between reports of load mode, in milliseconds
+    int report_interval;
+
+    // interval between probes to the same target, in milliseconds
+    double interval;
+
+    // wait for replies after the last probe, in milliseconds
+    int timeout;
+
+    // trace path to host
+    int traceroute;
+
+    // hops to probe in traceroute mode
+    int max_ttl;
+
+    // discover path mtu to hosts
+    int pmtu;
+};
+
+const struct cmdline_arguments *parse_arguments(int argc, char *argv[]);
@@ -0,0 +1,192 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 17:25:14
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 17:25:14
+ */
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "checksum.h"
+
+#define MAX_BUFFER_SIZE 65536
+#define BENCH_BYTES (1ULL << 30)
+
+
+/**
+ * The original checksum of ping, 16 bits words one by one, kept as
+ * reference. Result is in host byte order.
+ **/
+uint16_t calculate_checksum(unsigned char* buffer, int bytes) {
+    uint32_t checksum = 0;
+    unsigned char* end = buffer + bytes;
+
+    // odd bytes add last byte and reset end
+    if (bytes % 2 == 1) {
+        end = buffer + bytes - 1;
+        checksum += (*end) << 8;
+    }
+
+    // add words of two bytes, one by one
+    while (buffer < end) {
+        checksum += (buffer[0] << 8) + buffer[1];
+
+        // add carry if any
+        uint32_t carray = checksum >> 16;
+        if (carray != 0) {
+            checksum = (checksum & 0xffff) + carray;
+        }
+
+        buffer += 2;
+    }
+
+    // negate it
+    checksum = ~checksum;
+
+    return checksum & 0xffff;
+}
+
+
+double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/**
+ * Compare with reference for every size up to 4KB at every alignment, and
+ * a few large buffers full of 0xff to stress carries.
+ **/
+int verify_full(unsigned char *buffer) {
+    int size, offset;
+    for (size = 0; size <= 4096; size++) {
+        for (offset = 0; offset < 8; offset++) {
+            unsigned char *p = buffer + offset;
+            uint16_t expected = htons(calculate_checksum(p, size));
+            uint16_t result = inet_checksum(p, size);
+            if (expected != result) {
+                fprintf(stderr, "Mismatch: size=%d offset=%d expected=%04x got=%04x\n",
+                    size, offset, expected, result);
+                return -1;
+            }
+        }
+    }
+
+    unsigned char *ones = malloc(MAX_BUFFER_SIZE);
+    memset(ones, 0xff, MAX_BUFFER_SIZE);
+    for (size = MAX_BUFFER_SIZE - 7; size <= MAX_BUFFER_SIZE; size++) {
+        if (htons(calculate_checksum(ones, size)) != inet_checksum(ones, size)) {
+            fprintf(stderr, "Mismatch: size=%d of 0xff\n", size);
+            free(ones);
+            return -1;
+        }
+    }
+    free(ones);
+
+    return 0;
+}
+
+
+/**
+ * Change random words and check incremental update against full sums.
+ **/
+int verify_incremental(unsigned char *buffer) {
+    int i;
+    for (i = 0; i < 100000; i++) {
+        int size = 8 + (rand() % 1500) * 2;
+        uint16_t checksum = inet_checksum(buffer, size);
+
+        // 16 bits word at an even offset
+        uint16_t *word = (uint16_t *)(buffer + (rand() % (size / 2)) * 2);
+        uint16_t old_word = *word;
+        *word = i % 7 == 0 ? 0xffff : rand();
+
+        uint16_t expected = inet_checksum(buffer, size);
+        uint16_t result = checksum_update16(checksum, old_word, *word);
+
+        // 0x0000 and 0xffff are both zero in one's complement
+        if (expected != result && !((expected == 0 || expected == 0xffff) && (result == 0 || result == 0xffff))) {
+            fprintf(stderr, "Incremental mismatch: size=%d expected=%04x got=%04x\n", size, expected, result);
+            return -1;
+        }
+
+        // 32 bits word at a multiple of 4 offset
+        checksum = expected;
+        uint32_t *dword = (uint32_t *)(buffer + (rand() % (size / 4)) * 4);
+        uint32_t old_dword = *dword;
+        *dword = ((uint32_t)rand() << 16) ^ rand();
+
+        expected = inet_checksum(buffer, size);
+        result = checksum_update32(checksum, old_dword, *dword);
+        if (expected != result && !((expected == 0 || expected == 0xffff) && (result == 0 || result == 0xffff))) {
+            fprintf(stderr, "Incremental mismatch: size=%d expected=%04x got=%04x\n", size, expected, result);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[]) {
+    unsigned char *buffer = malloc(MAX_BUFFER_SIZE + 8);
+    srand(1);
+
+    int i;
+    for (i = 0; i < MAX_BUFFER_SIZE + 8; i++) {
+        buffer[i] = rand();
+    }
+
+    if (verify_full(buffer) == -1 || verify_incremental(buffer) == -1) {
+        return -1;
+    }
+    printf("checksums match reference\n");
+
+    static const int sizes[] = { 20, 64, 576, 1500, 9000, 65536, 0 };
+
+    printf("%8s %14s %14s %8s\n", "bytes", "reference", "optimized", "speedup");
+
+    const int *size;
+    for (size = sizes; *size != 0; size++) {
+        long long rounds = BENCH_BYTES / *size;
+        volatile uint16_t sink = 0;
+
+        double start = monotonic_seconds();
+        long long j;
+        for (j = 0; j < rounds; j++) {
+            sink += calculate_checksum(buffer, *size);
+        }
+        double reference = BENCH_BYTES / (monotonic_seconds() - start) / 1e9;
+
+        start = monotonic_seconds();
+        for (j = 0; j < rounds; j++) {
+            sink += inet_checksum(buffer, *size);
+        }
+        double optimized = BENCH_BYTES / (monotonic_seconds() - start) / 1e9;
+
+        printf("%8d %11.2fGB/s %11.2fGB/s %7.2fx\n", *size, reference, optimized, optimized / reference);
+    }
+
+    // rewriting sequence number of an echo request
+    long long rounds = 100000000;
+    uint16_t checksum = inet_checksum(buffer, 64);
+    uint16_t seq = 0;
+    double start = monotonic_seconds();
+    long long j;
+    for (j = 0; j < rounds; j++) {
+        uint16_t new_seq = j;
+        checksum = checksum_update16(checksum, seq, new_seq);
+        seq = new_seq;
+    }
+    double elapsed = monotonic_seconds() - start;
+    printf("incremental update: %.2fns per update, checksum %04x\n", elapsed * 1e9 / rounds, checksum);
+
+    free(buffer);
+
+    return 0;
+}
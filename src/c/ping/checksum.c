@@ -0,0 +1,223 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 16:48:55
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 16:48:55
+ */
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#include "checksum.h"
+
+// buffers at least this large are summed with SIMD instructions
+#define SIMD_THRESHOLD 256
+
+
+/**
+ * Fold a 64 bits sum to 16 bits, with end-around carries.
+ **/
+static inline uint32_t fold64(uint64_t sum) {
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return sum;
+}
+
+
+/**
+ * Sum buffer as 32 bits words into a 64 bits accumulator, which cannot
+ * overflow for any buffer below 16GB, so carries are folded only once.
+ **/
+static uint64_t sum_generic(const unsigned char *p, size_t bytes, uint64_t sum) {
+    uint64_t sum2 = 0;
+
+    // two independent accumulators, 16 bytes per round
+    while (bytes >= 16) {
+        uint32_t w[4];
+        memcpy(w, p, sizeof(w));
+        sum += (uint64_t)w[0] + w[1];
+        sum2 += (uint64_t)w[2] + w[3];
+        p += 16;
+        bytes -= 16;
+    }
+
+    while (bytes >= 4) {
+        uint32_t w;
+        memcpy(&w, p, sizeof(w));
+        sum += w;
+        p += 4;
+        bytes -= 4;
+    }
+
+    // tail in memory order, padded with zero
+    if (bytes > 0) {
+        uint32_t w = 0;
+        memcpy(&w, p, bytes);
+        sum += w;
+    }
+
+    return sum + sum2;
+}
+
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * Sum buffer with SSE2, widening 32 bits lanes into 64 bits accumulators.
+ **/
+__attribute__((target("sse2")))
+static uint64_t sum_sse2(const unsigned char *p, size_t bytes, uint64_t sum) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+
+    while (bytes >= 32) {
+        __m128i a = _mm_loadu_si128((const __m128i *)p);
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + 16));
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(a, zero));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(a, zero));
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(b, zero));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(b, zero));
+        p += 32;
+        bytes -= 32;
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(acc0, acc1));
+
+    return sum_generic(p, bytes, sum + lanes[0] + lanes[1]);
+}
+
+
+/**
+ * Sum buffer with AVX2, widening 32 bits lanes into 64 bits accumulators.
+ **/
+__attribute__((target("avx2")))
+static uint64_t sum_avx2(const unsigned char *p, size_t bytes, uint64_t sum) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+
+    while (bytes >= 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)p);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + 32));
+        acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(a, zero));
+        acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(a, zero));
+        acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(b, zero));
+        acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(b, zero));
+        p += 64;
+        bytes -= 64;
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+
+    return sum_generic(p, bytes, sum + lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+
+/**
+ * Pick the widest SIMD implementation supported by cpu.
+ **/
+static uint64_t (*select_simd())(const unsigned char *, size_t, uint64_t) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return sum_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return sum_sse2;
+    }
+    return sum_generic;
+}
+
+#endif
+
+
+/**
+ * Add buffer to a one's complement sum.
+ *
+ *  Arguments
+ *      buffer: data to sum, no alignment required.
+ *
+ *      bytes: size of data; an odd tail byte is padded with zero, so only
+ *          the last buffer of a chain may have odd size.
+ *
+ *      sum: sum of previous buffers, 0 for the first one.
+ *
+ *  Returns
+ *      Folded 16 bits sum, not negated.
+ **/
+uint32_t checksum_partial(const void *buffer, size_t bytes, uint32_t sum) {
+    const unsigned char *p = buffer;
+
+#ifdef HAVE_X86_SIMD
+    if (bytes >= SIMD_THRESHOLD) {
+        static uint64_t (*sum_simd)(const unsigned char *, size_t, uint64_t) = NULL;
+        if (sum_simd == NULL) {
+            sum_simd = select_simd();
+        }
+
+        return fold64(sum_simd(p, bytes, sum));
+    }
+#endif
+
+    return fold64(sum_generic(p, bytes, sum));
+}
+
+
+/**
+ * Turn a partial sum into a checksum.
+ **/
+uint16_t checksum_fold(uint32_t sum) {
+    return ~fold64(sum) & 0xffff;
+}
+
+
+/**
+ * Calculate internet checksum of buffer.
+ *
+ *  Returns
+ *      Checksum in memory order, to be stored into header as is.
+ **/
+uint16_t inet_checksum(const void *buffer, size_t bytes) {
+    return checksum_fold(checksum_partial(buffer, bytes, 0));
+}
+
+
+/**
+ * Update checksum after a 16 bits word of the packet is changed, without
+ * summing the packet again (RFC 1624, eqn. 3).
+ *
+ *  Arguments
+ *      checksum: old checksum, as stored in header.
+ *
+ *      old_word: old value of changed word, as stored in packet.
+ *
+ *      new_word: new value of changed word, as stored in packet.
+ *
+ *  Returns
+ *      New checksum, to be stored into header as is.
+ **/
+uint16_t checksum_update16(uint16_t checksum, uint16_t old_word, uint16_t new_word) {
+    // HC' = ~(~HC + ~m + m')
+    uint32_t sum = (uint16_t)~checksum + (uint16_t)~old_word + new_word;
+    return checksum_fold(sum);
+}
+
+
+/**
+ * Update checksum after a 32 bits word of the packet is changed, like an
+ * ip address, see checksum_update16.
+ **/
+uint16_t checksum_update32(uint16_t checksum, uint32_t old_word, uint32_t new_word) {
+    uint32_t sum = (uint16_t)~checksum
+        + (uint16_t)~old_word + (uint16_t)~(old_word >> 16)
+        + (new_word & 0xffff) + (new_word >> 16);
+    return checksum_fold(sum);
+}
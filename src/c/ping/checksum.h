@@ -0,0 +1,21 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 16:48:55
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 16:48:55
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Internet checksum (RFC 1071). Sums and checksums are kept in memory
+ * order, so a checksum can be stored into a packet header as is, and a
+ * word can be taken from a packet as is.
+ */
+
+uint32_t checksum_partial(const void *buffer, size_t bytes, uint32_t sum);
+uint16_t checksum_fold(uint32_t sum);
+uint16_t inet_checksum(const void *buffer, size_t bytes);
+uint16_t checksum_update16(uint16_t checksum, uint16_t old_word, uint16_t new_word);
+uint16_t checksum_update32(uint16_t checksum, uint32_t old_word, uint32_t new_word);
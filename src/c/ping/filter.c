@@ -0,0 +1,116 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 17:52:33
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 19:02:18
+ */
+
+#include <linux/filter.h>
+#include <sys/socket.h>
+
+#include "filter.h"
+
+
+/**
+ * Attach a classic BPF program to raw icmp socket, accepting only echo
+ * replies carrying given identifier. Everything else is dropped by kernel
+ * before being queued, so concurrent pings do not wake each other up.
+ *
+ * Packets seen by the program start with ip header.
+ *
+ *  Arguments
+ *      sock: raw icmp socket.
+ *
+ *      ident: identifier of our echo requests.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int attach_echo_filter(int sock, int ident) {
+    struct sock_filter code[] = {
+        // x = ip header length
+        BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),
+
+        // icmp type must be echo reply
+        BPF_STMT(BPF_LD | BPF_B | BPF_IND, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 3),
+
+        // icmp identifier must be ours
+        BPF_STMT(BPF_LD | BPF_H | BPF_IND, 4),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ident & 0xffff, 0, 1),
+
+        // accept whole packet
+        BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+
+        // drop
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+
+    struct sock_fprog program = {
+        .len = sizeof(code) / sizeof(code[0]),
+        .filter = code,
+    };
+
+    return setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program));
+}
+
+
+/**
+ * Attach a classic BPF program to raw icmp socket, accepting echo replies
+ * carrying given identifier, and time exceeded or destination unreachable
+ * errors quoting one of our echo requests.
+ *
+ *  Arguments
+ *      sock: raw icmp socket.
+ *
+ *      ident: identifier of our echo requests.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int attach_trace_filter(int sock, int ident) {
+    struct sock_filter code[] = {
+        // x = ip header length
+        BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),
+
+        // echo reply carrying our identifier
+        BPF_STMT(BPF_LD | BPF_B | BPF_IND, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 2),
+        BPF_STMT(BPF_LD | BPF_H | BPF_IND, 4),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ident & 0xffff, 13, 14),
+
+        // otherwise time exceeded or destination unreachable
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 11, 1, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 3, 0, 12),
+
+        // quoted packet must be icmp
+        BPF_STMT(BPF_LD | BPF_B | BPF_IND, 8 + 9),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 1, 0, 10),
+
+        // x = ip header length + 8 + quoted ip header length
+        BPF_STMT(BPF_LD | BPF_B | BPF_IND, 8),
+        BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf),
+        BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 2),
+        BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+
+        // quoted echo request carrying our identifier
+        BPF_STMT(BPF_LD | BPF_B | BPF_IND, 8),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 8, 0, 3),
+        BPF_STMT(BPF_LD | BPF_H | BPF_IND, 8 + 4),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ident & 0xffff, 0, 1),
+
+        // accept whole packet
+        BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+
+        // drop
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+
+    struct sock_fprog program = {
+        .len = sizeof(code) / sizeof(code[0]),
+        .filter = code,
+    };
+
+    return setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program));
+}
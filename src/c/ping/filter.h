@@ -0,0 +1,9 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 17:52:33
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 19:02:18
+ */
+
+int attach_echo_filter(int sock, int ident);
+int attach_trace_filter(int sock, int ident);
@@ -0,0 +1,443 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 15:52:18
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:41:09
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "filter.h"
+#include "flood.h"
+#include "hdr.h"
+#include "icmp.h"
+#include "rxbatch.h"
+#include "scheduler.h"
+#include "timestamp.h"
+
+// probes tracked by sequence, the whole 16 bits sequence space
+#define SEQ_SPACE 65536
+
+// highest rtt tracked by histograms, 60 seconds
+#define MAX_TRACKED_RTT (60 * NSEC_PER_SEC)
+
+// token bucket holds 10ms worth of tokens, to ride over wakeup delays
+#define BURST_DIVISOR 100
+
+// flood mode keeps at most this many probes in flight, sending in batches
+// and draining replies in between, so the receive buffer never overflows
+#define FLOOD_WINDOW 1024
+#define FLOOD_BATCH 64
+
+// receive buffer of raw socket
+#define LOAD_RCVBUF_SIZE (4 * 1024 * 1024)
+
+/*
+ * state of a sequence slot.
+ */
+enum slot_state {
+    SLOT_FREE,
+    SLOT_OUTSTANDING,
+    SLOT_ANSWERED,
+};
+
+/*
+ * probe occupying a sequence slot.
+ */
+struct probe_slot {
+    // unwrapped sequence number
+    int64_t seq;
+
+    // monotonic sending time, in nanoseconds
+    int64_t sending_ts;
+
+    // see enum slot_state
+    int state;
+};
+
+/*
+ * counters of load mode.
+ */
+struct load_counters {
+    int64_t sent;
+    int64_t received;
+    int64_t lost;
+    int64_t duplicates;
+    int64_t reordered;
+};
+
+/*
+ * state of load mode.
+ */
+struct load_state {
+    int sock;
+    int ident;
+
+    // buffers for receiving replies
+    struct rx_batch *batch;
+
+    // echo request template, only sequence changes between probes
+    struct icmp_echo request;
+
+    struct probe_slot *slots;
+
+    // next sequence to send, and oldest one not expired yet
+    int64_t next_seq;
+    int64_t expire_seq;
+
+    // highest sequence answered, for detecting reordering
+    int64_t highest_answered;
+
+    // cumulative and current interval statistics
+    struct load_counters total;
+    struct load_counters interval;
+    struct hdr_histogram total_rtt;
+    struct hdr_histogram interval_rtt;
+};
+
+// set by SIGINT handler
+static volatile sig_atomic_t interrupted = 0;
+
+
+static void handle_interrupt(int signum) {
+    interrupted = 1;
+}
+
+
+/**
+ * Receive and account all pending echo replies, a batch at a time.
+ **/
+static void drain_replies(struct load_state *state) {
+    int n;
+    do {
+        n = rx_batch_recv(state->batch, state->sock);
+        if (n == -1) {
+            perror("Receive failed");
+            return;
+        }
+
+        int i;
+        for (i = 0; i < n; i++) {
+            int bytes;
+            const unsigned char *packet = rx_batch_packet(state->batch, i, &bytes);
+
+            const struct icmp_echo *icmp = find_echo_reply(packet, bytes, state->ident);
+            if (icmp == NULL) {
+                continue;
+            }
+
+            struct probe_slot *slot = &state->slots[ntohs(icmp->seq)];
+
+            if (slot->state == SLOT_ANSWERED) {
+                state->total.duplicates++;
+                state->interval.duplicates++;
+                continue;
+            }
+
+            // expired already, or never sent
+            if (slot->state != SLOT_OUTSTANDING) {
+                continue;
+            }
+
+            slot->state = SLOT_ANSWERED;
+
+            if (slot->seq < state->highest_answered) {
+                state->total.reordered++;
+                state->interval.reordered++;
+            } else {
+                state->highest_answered = slot->seq;
+            }
+
+            int64_t rtt = rx_batch_timestamp(state->batch, i) - slot->sending_ts;
+            hdr_record(&state->total_rtt, rtt);
+            hdr_record(&state->interval_rtt, rtt);
+
+            state->total.received++;
+            state->interval.received++;
+        }
+    } while (n == RX_BATCH_SIZE);
+}
+
+
+/**
+ * Expire probes sent before given time. Answered probes at the head are
+ * released early, so sequence space is not held by them at high rates.
+ **/
+static void expire_probes(struct load_state *state, int64_t deadline) {
+    while (state->expire_seq < state->next_seq) {
+        struct probe_slot *slot = &state->slots[state->expire_seq & (SEQ_SPACE - 1)];
+        if (slot->state != SLOT_ANSWERED && slot->sending_ts > deadline) {
+            break;
+        }
+
+        if (slot->state == SLOT_OUTSTANDING) {
+            state->total.lost++;
+            state->interval.lost++;
+        }
+
+        slot->state = SLOT_FREE;
+        state->expire_seq++;
+    }
+}
+
+
+/**
+ * Print a statistics line.
+ **/
+static void print_stats(const char *label, const struct load_counters *counters,
+        const struct hdr_histogram *rtt) {
+    int64_t resolved = counters->received + counters->lost;
+    double loss = resolved == 0 ? 0 : counters->lost * 100.0 / resolved;
+
+    printf("%s sent=%-8lld recv=%-8lld loss=%6.2f%% dup=%lld reorder=%lld",
+        label, (long long)counters->sent, (long long)counters->received, loss,
+        (long long)counters->duplicates, (long long)counters->reordered);
+
+    if (rtt->total_count > 0) {
+        printf(" rtt min/avg/p50/p99/p99.9/max = %.3f/%.3f/%.3f/%.3f/%.3f/%.3f ms",
+            rtt->min / 1e6, hdr_mean(rtt) / 1e6,
+            hdr_percentile(rtt, 50) / 1e6, hdr_percentile(rtt, 99) / 1e6,
+            hdr_percentile(rtt, 99.9) / 1e6, rtt->max / 1e6);
+    }
+
+    printf("\n");
+    fflush(stdout);
+}
+
+
+/**
+ * Load a single host with echo requests, paced by a token bucket at given
+ * rate or as fast as possible in flood mode, and report rtt percentiles
+ * every report interval.
+ *
+ *  Arguments
+ *      arguments: parsed command line arguments.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int flood_ping(const struct cmdline_arguments *arguments) {
+    if (arguments->nhosts != 1 || arguments->file != NULL || strchr(arguments->hosts[0], '/') != NULL) {
+        fprintf(stderr, "load mode takes a single host\n");
+        return -1;
+    }
+
+    const char *ip = arguments->hosts[0];
+
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    if (inet_aton(ip, &addr.sin_addr) == 0) {
+        fprintf(stderr, "bad ip address: %s\n", ip);
+        return -1;
+    }
+
+    int ret = -1;
+    struct scheduler sched = { -1, -1 };
+    struct load_state state;
+    bzero(&state, sizeof(state));
+    state.ident = getpid() & 0xffff;
+    state.highest_answered = -1;
+    build_echo_request(&state.request, state.ident, 0);
+
+    // create non-blocking raw socket for icmp protocol
+    state.sock = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK, IPPROTO_ICMP);
+    if (state.sock == -1) {
+        perror("create raw socket");
+        return -1;
+    }
+
+    if (enable_rx_timestamps(state.sock) == -1) {
+        perror("enable receive timestamps");
+    }
+
+    // let kernel drop packets not for us
+    if (attach_echo_filter(state.sock, state.ident) == -1) {
+        perror("attach socket filter");
+    }
+
+    int rcvbuf = LOAD_RCVBUF_SIZE;
+    if (setsockopt(state.sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) == -1) {
+        perror("set socket option");
+    }
+
+    state.slots = calloc(SEQ_SPACE, sizeof(*state.slots));
+    state.batch = rx_batch_new();
+    if (state.slots == NULL || state.batch == NULL || hdr_init(&state.total_rtt, MAX_TRACKED_RTT) == -1
+            || hdr_init(&state.interval_rtt, MAX_TRACKED_RTT) == -1) {
+        fprintf(stderr, "out of memory\n");
+        goto out;
+    }
+
+    // waits for replies, token refills, reports and expiries alike
+    if (scheduler_init(&sched, state.sock) == -1) {
+        perror("create scheduler");
+        // closed by scheduler_init already
+        sched.epoll_fd = sched.timer_fd = -1;
+        goto out;
+    }
+
+    signal(SIGINT, handle_interrupt);
+
+    int64_t count = arguments->count == -1 ? 0 : arguments->count;
+    int64_t timeout = arguments->timeout * (NSEC_PER_SEC / 1000);
+    int64_t report_interval = arguments->report_interval * (NSEC_PER_SEC / 1000);
+
+    // token bucket
+    double rate = arguments->rate;
+    double burst = rate / BURST_DIVISOR < 1 ? 1 : rate / BURST_DIVISOR;
+    double tokens = 1;
+
+    if (arguments->flood) {
+        printf("FLOOD %s\n", ip);
+    } else {
+        printf("LOAD %s at %.0f pps\n", ip, rate);
+    }
+
+    int64_t start_ts = monotonic_ns();
+    int64_t last_refill_ts = start_ts;
+    int64_t next_report_ts = start_ts + report_interval;
+
+    while (!interrupted) {
+        int64_t current_ts = monotonic_ns();
+
+        // refill token bucket
+        if (!arguments->flood) {
+            tokens += (current_ts - last_refill_ts) * rate / NSEC_PER_SEC;
+            if (tokens > burst) {
+                tokens = burst;
+            }
+            last_refill_ts = current_ts;
+        }
+
+        // send while tokens last, the whole sequence space may be in flight
+        int window_full = 0;
+        int batch = 0;
+        while ((count == 0 || state.total.sent < count) && (arguments->flood || tokens >= 1)) {
+            if (state.next_seq - state.expire_seq >= SEQ_SPACE) {
+                window_full = 1;
+                break;
+            }
+
+            if (arguments->flood) {
+                int64_t in_flight = state.total.sent - state.total.received - state.total.lost;
+                if (in_flight >= FLOOD_WINDOW) {
+                    window_full = 1;
+                    break;
+                }
+
+                if (batch++ == FLOOD_BATCH) {
+                    break;
+                }
+            }
+
+            struct probe_slot *slot = &state.slots[state.next_seq & (SEQ_SPACE - 1)];
+
+            int64_t sending_ts;
+            update_echo_seq(&state.request, state.next_seq & 0xffff);
+            if (send_echo_packet(state.sock, &addr, &state.request, &sending_ts) == -1) {
+                // socket buffer is full, try again later
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                    window_full = 1;
+                    break;
+                }
+
+                perror("Send failed");
+            }
+
+            slot->seq = state.next_seq;
+            slot->sending_ts = sending_ts;
+            slot->state = SLOT_OUTSTANDING;
+
+            state.next_seq++;
+            state.total.sent++;
+            state.interval.sent++;
+            tokens -= 1;
+        }
+
+        drain_replies(&state);
+        expire_probes(&state, current_ts - timeout);
+
+        // report interval statistics
+        if (current_ts >= next_report_ts) {
+            char label[32];
+            snprintf(label, sizeof(label), "[%7.1fs]", (current_ts - start_ts) / 1e9);
+            print_stats(label, &state.interval, &state.interval_rtt);
+
+            bzero(&state.interval, sizeof(state.interval));
+            hdr_reset(&state.interval_rtt);
+            next_report_ts += report_interval;
+        }
+
+        // all probes are sent and answered or expired
+        if (count != 0 && state.total.sent == count
+                && state.total.received + state.total.lost >= count) {
+            break;
+        }
+
+        // wait for replies until a token is available, or report is due
+        int64_t wait = next_report_ts - current_ts;
+        if (arguments->flood) {
+            if (!window_full && (count == 0 || state.total.sent < count)) {
+                wait = 0;
+            }
+        } else if (tokens < 1 && (count == 0 || state.total.sent < count)) {
+            int64_t refill = (1 - tokens) * NSEC_PER_SEC / rate;
+            if (refill < wait) {
+                wait = refill;
+            }
+        }
+
+        // oldest probe expires
+        if (state.expire_seq < state.next_seq) {
+            int64_t expire = state.slots[state.expire_seq & (SEQ_SPACE - 1)].sending_ts + timeout - current_ts;
+            if (expire < wait) {
+                wait = expire;
+            }
+        }
+
+        // something is due already, go on without sleeping
+        if (wait <= 0) {
+            continue;
+        }
+
+        if (scheduler_arm(&sched, current_ts + wait) == -1) {
+            perror("Arm timer failed");
+            break;
+        }
+
+        if (scheduler_wait(&sched) == -1) {
+            perror("Wait failed");
+            break;
+        }
+    }
+
+    // account probes still in flight as lost
+    drain_replies(&state);
+    expire_probes(&state, INT64_MAX);
+
+    printf("--- %s load statistics, %.2fs ---\n", ip, (monotonic_ns() - start_ts) / 1e9);
+    print_stats("total", &state.total, &state.total_rtt);
+    ret = 0;
+
+out:
+    hdr_free(&state.total_rtt);
+    hdr_free(&state.interval_rtt);
+    free(state.slots);
+    rx_batch_free(state.batch);
+    if (sched.epoll_fd != -1) {
+        scheduler_close(&sched);
+    }
+    close(state.sock);
+
+    return ret;
+}
@@ -0,0 +1,10 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 15:52:18
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 15:52:18
+ */
+
+struct cmdline_arguments;
+
+int flood_ping(const struct cmdline_arguments *arguments);
@@ -0,0 +1,197 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 15:30:27
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 03:12:40
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hdr.h"
+
+// 2048 sub buckets give 3 significant digits
+#define SUB_BUCKET_HALF_COUNT_MAGNITUDE 10
+#define SUB_BUCKET_HALF_COUNT (1 << SUB_BUCKET_HALF_COUNT_MAGNITUDE)
+#define SUB_BUCKET_COUNT (SUB_BUCKET_HALF_COUNT * 2)
+#define SUB_BUCKET_MASK ((int64_t)SUB_BUCKET_COUNT - 1)
+
+
+/**
+ * Index of bucket given value falls in.
+ **/
+static inline int bucket_index(int64_t value) {
+    int pow2ceiling = 64 - __builtin_clzll(value | SUB_BUCKET_MASK);
+    return pow2ceiling - (SUB_BUCKET_HALF_COUNT_MAGNITUDE + 1);
+}
+
+
+/**
+ * Index of counts slot given value falls in.
+ **/
+static inline int counts_index(int64_t value) {
+    int bucket = bucket_index(value);
+    int sub_bucket = value >> bucket;
+
+    // bucket 0 uses all sub buckets, others only the upper half
+    return ((bucket + 1) << SUB_BUCKET_HALF_COUNT_MAGNITUDE) + sub_bucket - SUB_BUCKET_HALF_COUNT;
+}
+
+
+/**
+ * Highest value falling in given counts slot.
+ **/
+static inline int64_t highest_value_of_index(int index) {
+    int bucket = (index >> SUB_BUCKET_HALF_COUNT_MAGNITUDE) - 1;
+    int sub_bucket = (index & (SUB_BUCKET_HALF_COUNT - 1)) + SUB_BUCKET_HALF_COUNT;
+    if (bucket < 0) {
+        sub_bucket -= SUB_BUCKET_HALF_COUNT;
+        bucket = 0;
+    }
+
+    return ((int64_t)(sub_bucket + 1) << bucket) - 1;
+}
+
+
+/**
+ * Initialize histogram.
+ *
+ *  Arguments
+ *      h: histogram to initialize.
+ *
+ *      highest_value: highest value to track, larger ones are clamped.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+int hdr_init(struct hdr_histogram *h, int64_t highest_value) {
+    // buckets needed to cover highest value
+    int bucket_count = 1;
+    int64_t range = SUB_BUCKET_COUNT;
+    while (range <= highest_value) {
+        range <<= 1;
+        bucket_count++;
+    }
+
+    h->highest_value = highest_value;
+    h->bucket_count = bucket_count;
+    h->counts_len = (bucket_count + 1) * SUB_BUCKET_HALF_COUNT;
+    h->counts = malloc(h->counts_len * sizeof(*h->counts));
+    if (h->counts == NULL) {
+        return -1;
+    }
+
+    hdr_reset(h);
+
+    return 0;
+}
+
+
+/**
+ * Release memory of histogram.
+ **/
+void hdr_free(struct hdr_histogram *h) {
+    free(h->counts);
+    h->counts = NULL;
+}
+
+
+/**
+ * Forget all recorded values.
+ **/
+void hdr_reset(struct hdr_histogram *h) {
+    memset(h->counts, 0, h->counts_len * sizeof(*h->counts));
+    h->total_count = 0;
+    h->min = 0;
+    h->max = 0;
+    h->sum = 0;
+}
+
+
+/**
+ * Record a value, negative ones are recorded as 0.
+ **/
+void hdr_record(struct hdr_histogram *h, int64_t value) {
+    if (value < 0) {
+        value = 0;
+    }
+    if (value > h->highest_value) {
+        value = h->highest_value;
+    }
+
+    h->counts[counts_index(value)]++;
+
+    if (h->total_count == 0 || value < h->min) {
+        h->min = value;
+    }
+    if (h->total_count == 0 || value > h->max) {
+        h->max = value;
+    }
+
+    h->total_count++;
+    h->sum += value;
+}
+
+
+/**
+ * Fetch value at given percentile.
+ *
+ *  Arguments
+ *      percentile: between 0 and 100.
+ *
+ *  Returns
+ *      Highest value equivalent to the one at percentile, 0 if empty.
+ **/
+int64_t hdr_percentile(const struct hdr_histogram *h, double percentile) {
+    if (h->total_count == 0) {
+        return 0;
+    }
+
+    // rank of wanted value, 1 based
+    int64_t rank = (int64_t)(percentile / 100 * h->total_count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    int64_t seen = 0;
+    int i;
+    for (i = 0; i < h->counts_len; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            int64_t value = highest_value_of_index(i);
+            return value < h->max ? value : h->max;
+        }
+    }
+
+    return h->max;
+}
+
+
+/**
+ * Fetch mean of recorded values, 0 if empty.
+ **/
+double hdr_mean(const struct hdr_histogram *h) {
+    return h->total_count == 0 ? 0 : h->sum / h->total_count;
+}
+
+
+/**
+ * Count recorded values from low up to high, excluded, at the precision
+ * of histogram.
+ **/
+int64_t hdr_count_between(const struct hdr_histogram *h, int64_t low, int64_t high) {
+    if (low < 0) {
+        low = 0;
+    }
+    if (high > h->highest_value) {
+        high = h->highest_value + 1;
+    }
+
+    int64_t count = 0;
+    int i;
+    for (i = counts_index(low); i < h->counts_len && highest_value_of_index(i) < high; i++) {
+        count += h->counts[i];
+    }
+
+    return count;
+}
@@ -0,0 +1,38 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 15:30:27
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 03:12:40
+ */
+
+#include <stdint.h>
+
+/*
+ * HDR histogram with 3 significant digits, for non-negative values up to
+ * a given highest value. Memory is fixed at init, recording is O(1).
+ */
+struct hdr_histogram {
+    // value range
+    int64_t highest_value;
+
+    // number of buckets, each doubling range of previous one
+    int bucket_count;
+
+    // counts for each sub bucket
+    int counts_len;
+    int64_t *counts;
+
+    // recorded values
+    int64_t total_count;
+    int64_t min;
+    int64_t max;
+    double sum;
+};
+
+int hdr_init(struct hdr_histogram *h, int64_t highest_value);
+void hdr_free(struct hdr_histogram *h);
+void hdr_reset(struct hdr_histogram *h);
+void hdr_record(struct hdr_histogram *h, int64_t value);
+int64_t hdr_percentile(const struct hdr_histogram *h, double percentile);
+double hdr_mean(const struct hdr_histogram *h);
+int64_t hdr_count_between(const struct hdr_histogram *h, int64_t low, int64_t high);
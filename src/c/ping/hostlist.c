@@ -0,0 +1,176 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 20:41:26
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 20:41:26
+ */
+
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "argparse.h"
+#include "hostlist.h"
+
+// smallest CIDR prefix accepted, /12 expands to about a million hosts
+#define MIN_PREFIX_LEN 12
+
+
+/**
+ * Append a host to list.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int append_host(struct host_list *list, struct in_addr addr) {
+    if (list->size == list->capacity) {
+        int capacity = list->capacity == 0 ? 256 : list->capacity * 2;
+        struct in_addr *addrs = realloc(list->addrs, capacity * sizeof(*addrs));
+        if (addrs == NULL) {
+            return -1;
+        }
+
+        list->addrs = addrs;
+        list->capacity = capacity;
+    }
+
+    list->addrs[list->size++] = addr;
+
+    return 0;
+}
+
+
+/**
+ * Append hosts given by an ip address or a CIDR block, like 10.0.0.0/16.
+ *
+ * Network and broadcast addresses are skipped for blocks larger than /31.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int append_hosts(struct host_list *list, const char *spec) {
+    char ip[INET_ADDRSTRLEN];
+    int prefix_len = 32;
+
+    // split address and prefix length
+    const char *slash = strchr(spec, '/');
+    if (slash == NULL) {
+        snprintf(ip, sizeof(ip), "%s", spec);
+    } else {
+        if (slash - spec >= (int)sizeof(ip)) {
+            fprintf(stderr, "bad ip address: %s\n", spec);
+            return -1;
+        }
+        memcpy(ip, spec, slash - spec);
+        ip[slash - spec] = '\0';
+
+        char tail;
+        if (sscanf(slash + 1, "%d%c", &prefix_len, &tail) != 1
+                || prefix_len < MIN_PREFIX_LEN || prefix_len > 32) {
+            fprintf(stderr, "bad prefix length: %s\n", spec);
+            return -1;
+        }
+    }
+
+    struct in_addr addr;
+    if (inet_aton(ip, &addr) == 0) {
+        fprintf(stderr, "bad ip address: %s\n", spec);
+        return -1;
+    }
+
+    // range of host addresses
+    uint32_t mask = prefix_len == 0 ? 0 : 0xffffffff << (32 - prefix_len);
+    uint32_t first = ntohl(addr.s_addr) & mask;
+    uint32_t last = first | ~mask;
+    if (prefix_len < 31) {
+        first++;
+        last--;
+    }
+    if (prefix_len == 32) {
+        first = last = ntohl(addr.s_addr);
+    }
+
+    uint32_t host;
+    for (host = first; ; host++) {
+        addr.s_addr = htonl(host);
+        if (append_host(list, addr) == -1) {
+            fprintf(stderr, "out of memory\n");
+            return -1;
+        }
+
+        if (host == last) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Append hosts listed in a file, one ip address or CIDR block per line.
+ * Empty lines and lines starting with '#' are ignored.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int load_hosts(struct host_list *list, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("open target file");
+        return -1;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        // strip blanks and comments
+        char spec[sizeof(line)];
+        if (sscanf(line, " %255[^# \t\r\n]", spec) != 1) {
+            continue;
+        }
+
+        if (append_hosts(list, spec) == -1) {
+            fclose(file);
+            return -1;
+        }
+    }
+
+    fclose(file);
+
+    return 0;
+}
+
+
+/**
+ * Collect hosts given on command line and in host file, in order.
+ *
+ *  Arguments
+ *      list: empty list for storing hosts, addrs is to be freed by caller
+ *          even if error.
+ *
+ *      arguments: command line arguments, see argparse.h.
+ *
+ *  Returns
+ *      0 if success, -1 if error or no host is given.
+ **/
+int collect_hosts(struct host_list *list, const struct cmdline_arguments *arguments) {
+    int i;
+    for (i = 0; i < arguments->nhosts; i++) {
+        if (append_hosts(list, arguments->hosts[i]) == -1) {
+            return -1;
+        }
+    }
+
+    if (arguments->file != NULL && load_hosts(list, arguments->file) == -1) {
+        return -1;
+    }
+
+    if (list->size == 0) {
+        fprintf(stderr, "no host specified\n");
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 20:41:26
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 20:41:26
+ */
+
+#include <netinet/in.h>
+
+struct cmdline_arguments;
+
+/*
+ * struct for a growable host list.
+ */
+struct host_list {
+    struct in_addr *addrs;
+    int size;
+    int capacity;
+};
+
+int collect_hosts(struct host_list *list, const struct cmdline_arguments *arguments);
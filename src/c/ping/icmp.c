@@ -0,0 +1,133 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 13:02:16
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 17:12:30
+ */
+
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "checksum.h"
+#include "icmp.h"
+#include "timestamp.h"
+
+/**
+ * Build an echo request, checksum included.
+ **/
+void build_echo_request(struct icmp_echo *icmp, int ident, int seq) {
+    bzero(icmp, sizeof(*icmp));
+
+    // fill header files
+    icmp->type = 8;
+    icmp->code = 0;
+    icmp->ident = htons(ident);
+    icmp->seq = htons(seq);
+
+    // fill magic string
+    strncpy(icmp->magic, MAGIC, MAGIC_LEN);
+
+    // calculate and fill checksum
+    icmp->checksum = inet_checksum(icmp, sizeof(*icmp));
+}
+
+/**
+ * Change sequence number of a built echo request, updating checksum
+ * incrementally instead of summing the packet again.
+ **/
+void update_echo_seq(struct icmp_echo *icmp, int seq) {
+    uint16_t new_seq = htons(seq);
+    icmp->checksum = checksum_update16(icmp->checksum, icmp->seq, new_seq);
+    icmp->seq = new_seq;
+}
+
+/**
+ * Send a built echo request.
+ *
+ *  Arguments
+ *      sock: raw icmp socket.
+ *
+ *      addr: destination address.
+ *
+ *      icmp: echo request, see build_echo_request.
+ *
+ *      sending_ts: for storing monotonic sending time in nanoseconds,
+ *          taken right before the packet is handed to kernel.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int send_echo_packet(int sock, struct sockaddr_in* addr, const struct icmp_echo *icmp, int64_t *sending_ts) {
+    *sending_ts = monotonic_ns();
+    int bytes = sendto(sock, icmp, sizeof(*icmp), 0,
+        (struct sockaddr*)addr, sizeof(*addr));
+    if (bytes == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Send an echo request.
+ *
+ *  Arguments
+ *      sock: raw icmp socket.
+ *
+ *      addr: destination address.
+ *
+ *      ident: identifier of our echo requests.
+ *
+ *      seq: sequence number.
+ *
+ *      sending_ts: for storing monotonic sending time in nanoseconds,
+ *          taken right before the packet is handed to kernel.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int send_echo_request(int sock, struct sockaddr_in* addr, int ident, int seq, int64_t *sending_ts) {
+    // allocate memory for icmp packet and build it
+    struct icmp_echo icmp;
+    build_echo_request(&icmp, ident, seq);
+
+    // send it
+    return send_echo_packet(sock, addr, &icmp, sending_ts);
+}
+
+/**
+ * Find echo reply with given identifier in a received ip packet.
+ *
+ *  Arguments
+ *      buffer: received ip packet.
+ *
+ *      bytes: size of ip packet.
+ *
+ *      ident: identifier of our echo requests.
+ *
+ *  Returns
+ *      Pointer to icmp echo reply if matched, NULL if not.
+ **/
+const struct icmp_echo *find_echo_reply(const unsigned char *buffer, int bytes, int ident) {
+    // find icmp packet in ip packet
+    int ip_header_len = (buffer[0] & 0xf) << 2;
+    if (bytes < ip_header_len + (int)sizeof(struct icmp_echo)) {
+        return NULL;
+    }
+
+    const struct icmp_echo* icmp = (const struct icmp_echo*)(buffer + ip_header_len);
+
+    // check type
+    if (icmp->type != 0 || icmp->code != 0) {
+        return NULL;
+    }
+
+    // match identifier
+    if (ntohs(icmp->ident) != ident) {
+        return NULL;
+    }
+
+    return icmp;
+}
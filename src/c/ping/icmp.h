@@ -0,0 +1,31 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 13:02:16
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 20:26:48
+ */
+
+#include <netinet/in.h>
+#include <stdint.h>
+
+#define MAGIC "1234567890"
+#define MAGIC_LEN 11
+
+struct __attribute__((__packed__)) icmp_echo {
+    // header
+    uint8_t type;
+    uint8_t code;
+    uint16_t checksum;
+
+    uint16_t ident;
+    uint16_t seq;
+
+    // data, sending time is kept locally instead
+    char magic[MAGIC_LEN];
+};
+
+void build_echo_request(struct icmp_echo *icmp, int ident, int seq);
+void update_echo_seq(struct icmp_echo *icmp, int seq);
+int send_echo_packet(int sock, struct sockaddr_in* addr, const struct icmp_echo *icmp, int64_t *sending_ts);
+int send_echo_request(int sock, struct sockaddr_in* addr, int ident, int seq, int64_t *sending_ts);
+const struct icmp_echo *find_echo_reply(const unsigned char *buffer, int bytes, int ident);
@@ -0,0 +1,514 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 13:25:31
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 09:26:58
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "filter.h"
+#include "hostlist.h"
+#include "icmp.h"
+#include "multiping.h"
+#include "rxbatch.h"
+#include "scheduler.h"
+#include "timestamp.h"
+
+// probes per second if not given
+#define DEFAULT_SWEEP_RATE 10000
+
+// receive buffer of raw socket, big enough to absorb reply bursts of sweeps
+#define SWEEP_RCVBUF_SIZE (4 * 1024 * 1024)
+
+// pause before retrying when socket send buffer is full, in seconds
+#define SEND_BLOCKED_DELAY 0.001
+
+/*
+ * struct for a probed target and its statistics.
+ */
+struct ping_target {
+    struct in_addr addr;
+
+    int sent;
+    int received;
+
+    // round trip time statistics, in milliseconds
+    double min_rtt;
+    double max_rtt;
+    double sum_rtt;
+};
+
+/*
+ * struct for a target list.
+ */
+struct target_list {
+    struct ping_target *targets;
+    int size;
+};
+
+/*
+ * outstanding probe, keyed by target address and sequence.
+ */
+struct probe_entry {
+    // target address in network byte order
+    uint32_t addr;
+    uint16_t seq;
+
+    // index of target, -1 for empty slot
+    int target;
+
+    // monotonic sending time, in nanoseconds
+    int64_t sending_ts;
+};
+
+/*
+ * open addressing hash table of outstanding probes, linear probing.
+ */
+struct probe_table {
+    uint32_t mask;
+    uint32_t size;
+    struct probe_entry *entries;
+};
+
+/*
+ * probes in sending order, for expiring them after timeout.
+ */
+struct probe_fifo {
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+
+    struct probe_deadline {
+        uint32_t addr;
+        uint16_t seq;
+        double deadline;
+    } *items;
+};
+
+// set by SIGINT handler
+static volatile sig_atomic_t interrupted = 0;
+
+
+static void handle_interrupt(int signum) {
+    interrupted = 1;
+}
+
+
+/**
+ * Round up to a power of 2.
+ **/
+static uint32_t round_up_pow2(uint32_t n) {
+    uint32_t result = 1;
+    while (result < n) {
+        result <<= 1;
+    }
+    return result;
+}
+
+
+/**
+ * Hash of probe key.
+ **/
+static inline uint32_t probe_hash(uint32_t addr, uint16_t seq) {
+    uint64_t key = ((uint64_t)addr << 16) | seq;
+    return (key * 0x9e3779b97f4a7c15ULL) >> 32;
+}
+
+
+/**
+ * Insert a probe into table, which is never full.
+ **/
+static void probe_table_insert(struct probe_table *table, uint32_t addr, uint16_t seq,
+        int target, int64_t sending_ts) {
+    uint32_t i = probe_hash(addr, seq) & table->mask;
+    for (;;) {
+        struct probe_entry *entry = &table->entries[i];
+        if (entry->target == -1 || (entry->addr == addr && entry->seq == seq)) {
+            if (entry->target == -1) {
+                table->size++;
+            }
+
+            entry->addr = addr;
+            entry->seq = seq;
+            entry->target = target;
+            entry->sending_ts = sending_ts;
+            return;
+        }
+
+        i = (i + 1) & table->mask;
+    }
+}
+
+
+/**
+ * Remove a probe from table.
+ *
+ *  Arguments
+ *      removed: for storing removed entry, optional.
+ *
+ *  Returns
+ *      0 if found and removed, -1 if not found.
+ **/
+static int probe_table_remove(struct probe_table *table, uint32_t addr, uint16_t seq,
+        struct probe_entry *removed) {
+    // look for probe
+    uint32_t i = probe_hash(addr, seq) & table->mask;
+    for (;;) {
+        struct probe_entry *entry = &table->entries[i];
+        if (entry->target == -1) {
+            return -1;
+        }
+        if (entry->addr == addr && entry->seq == seq) {
+            break;
+        }
+
+        i = (i + 1) & table->mask;
+    }
+
+    if (removed != NULL) {
+        *removed = table->entries[i];
+    }
+
+    // backward shift following entries to fill the hole, no tombstones
+    uint32_t hole = i;
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & table->mask;
+
+        struct probe_entry *entry = &table->entries[j];
+        if (entry->target == -1) {
+            break;
+        }
+
+        // entry may move to hole only if its home slot is not in (hole, j]
+        uint32_t home = probe_hash(entry->addr, entry->seq) & table->mask;
+        if (((j - home) & table->mask) >= ((j - hole) & table->mask)) {
+            table->entries[hole] = *entry;
+            hole = j;
+        }
+    }
+
+    table->entries[hole].target = -1;
+    table->size--;
+
+    return 0;
+}
+
+
+/**
+ * Print per target statistics, fping style.
+ **/
+static void print_summary(const struct target_list *list, int send_errors, double elapsed) {
+    int alive = 0;
+    int sent = 0;
+
+    int i;
+    for (i = 0; i < list->size; i++) {
+        const struct ping_target *target = &list->targets[i];
+        sent += target->sent;
+
+        if (target->sent == 0) {
+            continue;
+        }
+
+        int loss = (target->sent - target->received) * 100 / target->sent;
+        printf("%-15s : xmt/rcv/%%loss = %d/%d/%d%%", inet_ntoa(target->addr),
+            target->sent, target->received, loss);
+
+        if (target->received > 0) {
+            alive++;
+            printf(", min/avg/max = %.3f/%.3f/%.3f", target->min_rtt,
+                target->sum_rtt / target->received, target->max_rtt);
+        }
+
+        printf("\n");
+    }
+
+    printf("%d/%d targets alive, %d probes sent in %.2fs", alive, list->size, sent, elapsed);
+    if (send_errors > 0) {
+        printf(", %d send errors", send_errors);
+    }
+    printf("\n");
+}
+
+
+/**
+ * Receive and account all pending echo replies, a batch at a time.
+ **/
+static void drain_replies(int sock, struct rx_batch *batch, int ident, struct probe_table *table, struct target_list *list) {
+    int n;
+    do {
+        n = rx_batch_recv(batch, sock);
+        if (n == -1) {
+            perror("Receive failed");
+            return;
+        }
+
+        int i;
+        for (i = 0; i < n; i++) {
+            int bytes;
+            const unsigned char *packet = rx_batch_packet(batch, i, &bytes);
+
+            const struct icmp_echo *icmp = find_echo_reply(packet, bytes, ident);
+            if (icmp == NULL) {
+                continue;
+            }
+
+            // match outstanding probe, late or duplicated replies are ignored
+            struct probe_entry probe;
+            if (probe_table_remove(table, rx_batch_peer(batch, i)->sin_addr.s_addr, ntohs(icmp->seq), &probe) == -1) {
+                continue;
+            }
+
+            // rtt from kernel receive time, both sides on monotonic clock
+            double rtt = (rx_batch_timestamp(batch, i) - probe.sending_ts) / 1e6;
+
+            struct ping_target *target = &list->targets[probe.target];
+            if (target->received == 0 || rtt < target->min_rtt) {
+                target->min_rtt = rtt;
+            }
+            if (target->received == 0 || rtt > target->max_rtt) {
+                target->max_rtt = rtt;
+            }
+            target->sum_rtt += rtt;
+            target->received++;
+        }
+    } while (n == RX_BATCH_SIZE);
+}
+
+
+/**
+ * Probe all targets given by arguments through one raw socket.
+ *
+ * Probes are interleaved across targets and paced at the given rate; a
+ * target is not probed again before the given interval has passed.
+ *
+ *  Arguments
+ *      arguments: parsed command line arguments.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int multiping(const struct cmdline_arguments *arguments) {
+    struct host_list hosts = { NULL, 0, 0 };
+    if (collect_hosts(&hosts, arguments) == -1) {
+        free(hosts.addrs);
+        return -1;
+    }
+
+    // released at out, whichever step fails
+    int ret = -1;
+    int sock = -1;
+    struct scheduler sched = { -1, -1 };
+    struct rx_batch *batch = NULL;
+    struct probe_fifo fifo = { 0, 0, 0, NULL };
+    struct probe_table table = { 0, 0, NULL };
+
+    struct target_list list;
+    list.size = hosts.size;
+    list.targets = calloc(list.size, sizeof(*list.targets));
+    if (list.targets == NULL) {
+        fprintf(stderr, "out of memory\n");
+        free(hosts.addrs);
+        goto out;
+    }
+
+    int i;
+    for (i = 0; i < list.size; i++) {
+        list.targets[i].addr = hosts.addrs[i];
+    }
+    free(hosts.addrs);
+
+    // create non-blocking raw socket for icmp protocol
+    sock = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK, IPPROTO_ICMP);
+    if (sock == -1) {
+        perror("create raw socket");
+        goto out;
+    }
+
+    // kernel receive timestamps, for rtt without wakeup latency
+    if (enable_rx_timestamps(sock) == -1) {
+        perror("enable receive timestamps");
+    }
+
+    int rcvbuf = SWEEP_RCVBUF_SIZE;
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) == -1) {
+        perror("set socket option");
+    }
+
+    // probes outstanding at the same time, bounded by rate and timeout
+    int rate = arguments->rate == 0 ? DEFAULT_SWEEP_RATE : arguments->rate;
+    double timeout = arguments->timeout / 1000.0;
+    uint32_t max_outstanding = rate * timeout + 64;
+
+    fifo.mask = round_up_pow2(max_outstanding) - 1;
+    fifo.head = fifo.tail = 0;
+    fifo.items = malloc((fifo.mask + 1) * sizeof(*fifo.items));
+
+    // keep table at most half full
+    table.mask = (fifo.mask + 1) * 2 - 1;
+    table.size = 0;
+    table.entries = malloc((table.mask + 1) * sizeof(*table.entries));
+
+    if (fifo.items == NULL || table.entries == NULL) {
+        fprintf(stderr, "out of memory\n");
+        goto out;
+    }
+
+    // sending is driven by timer, receiving by socket readability
+    if (scheduler_init(&sched, sock) == -1) {
+        perror("create scheduler");
+        // closed by scheduler_init already
+        sched.epoll_fd = sched.timer_fd = -1;
+        goto out;
+    }
+
+    batch = rx_batch_new();
+    if (batch == NULL) {
+        fprintf(stderr, "out of memory\n");
+        goto out;
+    }
+
+    uint32_t j;
+    for (j = 0; j <= table.mask; j++) {
+        table.entries[j].target = -1;
+    }
+
+    signal(SIGINT, handle_interrupt);
+
+    // probes to send, endless if count is 0
+    int count = arguments->count == -1 ? 1 : arguments->count;
+    int64_t total = (int64_t)count * list.size;
+
+    int ident = getpid() & 0xffff;
+    uint16_t seq = 0;
+
+    // let kernel drop packets not for us
+    if (attach_echo_filter(sock, ident) == -1) {
+        perror("attach socket filter");
+    }
+
+    // echo request template, only sequence changes between probes
+    struct icmp_echo request;
+    build_echo_request(&request, ident, seq);
+    int send_errors = 0;
+
+    double interval = arguments->interval / 1000.0;
+    double start_ts = get_timestamp();
+    int64_t k = 0;
+
+    while (!interrupted) {
+        double current_ts = get_timestamp();
+        int send_blocked = 0;
+
+        // send all probes due, probe k goes to target k % size in round k / size
+        while ((count == 0 || k < total) && fifo.tail - fifo.head <= fifo.mask) {
+            double due_ts = start_ts + fmax((double)k / rate, (k / list.size) * interval);
+            if (due_ts > current_ts) {
+                break;
+            }
+
+            struct ping_target *target = &list.targets[k % list.size];
+
+            struct sockaddr_in addr;
+            bzero(&addr, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr = target->addr;
+
+            int64_t sending_ts;
+            update_echo_seq(&request, seq);
+            if (send_echo_packet(sock, &addr, &request, &sending_ts) == -1) {
+                // socket buffer is full, try again later
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                    send_blocked = 1;
+                    break;
+                }
+
+                send_errors++;
+            }
+
+            probe_table_insert(&table, addr.sin_addr.s_addr, seq, k % list.size, sending_ts);
+
+            struct probe_deadline *item = &fifo.items[fifo.tail++ & fifo.mask];
+            item->addr = addr.sin_addr.s_addr;
+            item->seq = seq;
+            item->deadline = current_ts + timeout;
+
+            target->sent++;
+            seq++;
+            k++;
+        }
+
+        // expire probes without reply
+        while (fifo.head != fifo.tail && fifo.items[fifo.head & fifo.mask].deadline <= current_ts) {
+            struct probe_deadline *item = &fifo.items[fifo.head++ & fifo.mask];
+            probe_table_remove(&table, item->addr, item->seq, NULL);
+        }
+
+        // all probes are sent and answered or expired
+        if (count != 0 && k == total && (table.size == 0 || fifo.head == fifo.tail)) {
+            break;
+        }
+
+        // wait for replies until next probe is due or oldest probe expires
+        double wait_ts = fifo.head == fifo.tail ? current_ts + timeout : fifo.items[fifo.head & fifo.mask].deadline;
+        if (count == 0 || k < total) {
+            double due_ts = start_ts + fmax((double)k / rate, (k / list.size) * interval);
+            wait_ts = fmin(wait_ts, due_ts);
+        }
+
+        // give socket buffer a moment to drain
+        if (send_blocked && wait_ts < current_ts + SEND_BLOCKED_DELAY) {
+            wait_ts = current_ts + SEND_BLOCKED_DELAY;
+        }
+
+        // something is due already, go on without sleeping
+        if (wait_ts <= get_timestamp()) {
+            drain_replies(sock, batch, ident, &table, &list);
+            continue;
+        }
+
+        if (scheduler_arm(&sched, (int64_t)(wait_ts * NSEC_PER_SEC)) == -1) {
+            perror("Arm timer failed");
+            break;
+        }
+
+        int events = scheduler_wait(&sched);
+        if (events == -1) {
+            perror("Wait failed");
+            break;
+        }
+
+        if (events & SCHED_READABLE) {
+            drain_replies(sock, batch, ident, &table, &list);
+        }
+    }
+
+    print_summary(&list, send_errors, get_timestamp() - start_ts);
+    ret = 0;
+
+out:
+    free(fifo.items);
+    free(table.entries);
+    free(list.targets);
+    rx_batch_free(batch);
+    if (sched.epoll_fd != -1) {
+        scheduler_close(&sched);
+    }
+    if (sock != -1) {
+        close(sock);
+    }
+
+    return ret;
+}
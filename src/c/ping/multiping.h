@@ -0,0 +1,10 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 13:25:31
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 13:25:31
+ */
+
+struct cmdline_arguments;
+
+int multiping(const struct cmdline_arguments *arguments);
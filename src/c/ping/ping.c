@@ -2,146 +2,65 @@
  * Author: fasion
  * Created time: 2021-02-01 14:30:04
  * Last Modified by: fasion
- * Last Modified time: 2021-03-26 15:37:56
+ * Last Modified time: 2026-10-19 21:21:15
  */
 
 #include <arpa/inet.h>
-#include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/time.h>
 #include <unistd.h>
 
-#define MAGIC "1234567890"
-#define MAGIC_LEN 11
-#define IP_BUFFER_SIZE 65536
-#define RECV_TIMEOUT_USEC 100000
-
-struct __attribute__((__packed__)) icmp_echo {
-    // header
-    uint8_t type;
-    uint8_t code;
-    uint16_t checksum;
-
-    uint16_t ident;
-    uint16_t seq;
-
-    // data
-    double sending_ts;
-    char magic[MAGIC_LEN];
-};
-
-double get_timestamp() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec + ((double)tv.tv_usec) / 1000000;
-}
-
-uint16_t calculate_checksum(unsigned char* buffer, int bytes) {
-    uint32_t checksum = 0;
-    unsigned char* end = buffer + bytes;
-
-    // odd bytes add last byte and reset end
-    if (bytes % 2 == 1) {
-        end = buffer + bytes - 1;
-        checksum += (*end) << 8;
-    }
-
-    // add words of two bytes, one by one
-    while (buffer < end) {
-        checksum += (buffer[0] << 8) + buffer[1];
-
-        // add carry if any
-        uint32_t carray = checksum >> 16;
-        if (carray != 0) {
-            checksum = (checksum & 0xffff) + carray;
+#include "argparse.h"
+#include "filter.h"
+#include "flood.h"
+#include "icmp.h"
+#include "multiping.h"
+#include "pmtu.h"
+#include "rxbatch.h"
+#include "scheduler.h"
+#include "timestamp.h"
+#include "traceroute.h"
+
+// sending times kept for the latest probes, power of 2
+#define SEND_HISTORY_SIZE 1024
+
+/**
+ * Print replies to our probes found in a received batch.
+ **/
+void print_echo_replies(const struct rx_batch *batch, int count, int ident, int64_t *sending_history) {
+    int i;
+    for (i = 0; i < count; i++) {
+        int bytes;
+        const unsigned char *packet = rx_batch_packet(batch, i, &bytes);
+
+        // find echo reply matching our identifier
+        const struct icmp_echo* icmp = find_echo_reply(packet, bytes, ident);
+        if (icmp == NULL) {
+            continue;
         }
 
-        buffer += 2;
-    }
-
-    // negate it
-    checksum = ~checksum;
-
-    return checksum & 0xffff;
-}
-
-int send_echo_request(int sock, struct sockaddr_in* addr, int ident, int seq) {
-    // allocate memory for icmp packet
-    struct icmp_echo icmp;
-    bzero(&icmp, sizeof(icmp));
-
-    // fill header files
-    icmp.type = 8;
-    icmp.code = 0;
-    icmp.ident = htons(ident);
-    icmp.seq = htons(seq);
-
-    // fill magic string
-    strncpy(icmp.magic, MAGIC, MAGIC_LEN);
-
-    // fill sending timestamp
-    icmp.sending_ts = get_timestamp();
-
-    // calculate and fill checksum
-    icmp.checksum = htons(
-        calculate_checksum((unsigned char*)&icmp, sizeof(icmp))
-    );
-
-    // send it
-    int bytes = sendto(sock, &icmp, sizeof(icmp), 0,
-        (struct sockaddr*)addr, sizeof(*addr));
-    if (bytes == -1) {
-        return -1;
-    }
-
-    return 0;
-}
-
-int recv_echo_reply(int sock, int ident) {
-    // allocate buffer
-    unsigned char buffer[IP_BUFFER_SIZE];
-    struct sockaddr_in peer_addr;
-
-    // receive another packet
-    int addr_len = sizeof(peer_addr);
-    int bytes = recvfrom(sock, buffer, sizeof(buffer), 0,
-        (struct sockaddr*)&peer_addr, &addr_len);
-    if (bytes == -1) {
-        // normal return when timeout
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            return 0;
+        // look up sending time, skip replies too old or duplicated
+        int seq = ntohs(icmp->seq);
+        int64_t *sending_ts = &sending_history[seq & (SEND_HISTORY_SIZE - 1)];
+        if (*sending_ts == 0) {
+            continue;
         }
 
-        return -1;
-    }
-
-    int ip_header_len = (buffer[0] & 0xf) << 2;
-    // find icmp packet in ip packet
-    struct icmp_echo* icmp = (struct icmp_echo*)(buffer + ip_header_len);
+        // rtt from kernel receive time, both sides on monotonic clock
+        int64_t rtt = rx_batch_timestamp(batch, i) - *sending_ts;
+        *sending_ts = 0;
 
-    // check type
-    if (icmp->type != 0 || icmp->code != 0) {
-        return 0;
+        // print info
+        printf("%s seq=%-5d %8.3fms\n",
+            inet_ntoa(rx_batch_peer(batch, i)->sin_addr),
+            seq,
+            rtt / 1e6
+        );
     }
-
-    // match identifier
-    if (ntohs(icmp->ident) != ident) {
-        return 0;
-    }
-
-    // print info
-    printf("%s seq=%-5d %8.2fms\n",
-        inet_ntoa(peer_addr.sin_addr),
-        ntohs(icmp->seq),
-        (get_timestamp() - icmp->sending_ts) * 1000
-    );
-
-    return 0;
 }
 
-int ping(const char *ip) {
+int ping(const char *ip, double interval_ms) {
     // for store destination address
     struct sockaddr_in addr;
     bzero(&addr, sizeof(addr));
@@ -154,60 +73,130 @@ int ping(const char *ip) {
         return -1;
     };
 
-    // create raw socket for icmp protocol
-    int sock = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    // create non-blocking raw socket for icmp protocol, read only when readable
+    int sock = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK, IPPROTO_ICMP);
     if (sock == -1) {
         perror("create raw socket");
         return -1;
     }
 
-    // set socket timeout option
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = RECV_TIMEOUT_USEC;
-    int ret = setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    if (ret == -1) {
-        perror("set socket option");
+    // kernel receive timestamps, for rtt without wakeup latency
+    if (enable_rx_timestamps(sock) == -1) {
+        perror("enable receive timestamps");
+    }
+
+    // sending is driven by timer, receiving by socket readability
+    struct scheduler sched;
+    if (scheduler_init(&sched, sock) == -1) {
+        perror("create scheduler");
+        close(sock);
+        return -1;
+    }
+
+    struct rx_batch *batch = rx_batch_new();
+    if (batch == NULL) {
+        fprintf(stderr, "out of memory\n");
+        scheduler_close(&sched);
         close(sock);
         return -1;
     }
 
-    double next_ts = get_timestamp();
-    int ident = getpid();
+    // monotonic sending times of the latest probes, indexed by sequence
+    int64_t sending_history[SEND_HISTORY_SIZE] = { 0 };
+
+    int ident = getpid() & 0xffff;
     int seq = 1;
 
+    // let kernel drop packets not for us
+    if (attach_echo_filter(sock, ident) == -1) {
+        perror("attach socket filter");
+    }
+
+    // probes are due at fixed points from start, so errors do not accumulate
+    int64_t interval = interval_ms * (NSEC_PER_SEC / 1000);
+    int64_t next_ts = monotonic_ns();
+
     for (;;) {
         // time to send another packet
-        double current_ts = get_timestamp();
+        int64_t current_ts = monotonic_ns();
         if (current_ts >= next_ts) {
             // send it
-            ret = send_echo_request(sock, &addr, ident, seq);
+            int64_t *sending_ts = &sending_history[seq & (SEND_HISTORY_SIZE - 1)];
+            int ret = send_echo_request(sock, &addr, ident, seq & 0xffff, sending_ts);
             if (ret == -1) {
                 perror("Send failed");
             }
 
-            // update next sendint timestamp to one second later
-            next_ts = current_ts + 1;
+            // update next sending timestamp, skip ticks missed while stalled
+            next_ts += interval;
+            if (next_ts < current_ts) {
+                next_ts = current_ts + interval;
+            }
+
             // increase sequence number
             seq += 1;
+
+            if (scheduler_arm(&sched, next_ts) == -1) {
+                perror("Arm timer failed");
+                break;
+            }
+        }
+
+        // sleep until next probe is due or replies arrive
+        int events = scheduler_wait(&sched);
+        if (events == -1) {
+            perror("Wait failed");
+            break;
         }
 
-        // try to receive and print reply
-        ret = recv_echo_reply(sock, ident);
-        if (ret == -1) {
-            perror("Receive failed");
+        // drain and print replies, a short batch means queue is empty
+        if (events & SCHED_READABLE) {
+            int n;
+            do {
+                n = rx_batch_recv(batch, sock);
+                if (n == -1) {
+                    perror("Receive failed");
+                }
+
+                print_echo_replies(batch, n, ident, sending_history);
+            } while (n == RX_BATCH_SIZE);
         }
     }
 
+    rx_batch_free(batch);
+    scheduler_close(&sched);
     close(sock);
 
     return 0;
 }
 
-int main(int argc, const char* argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "no host specified");
+int main(int argc, char* argv[]) {
+    // parse command line options to struct arguments
+    const struct cmdline_arguments *arguments = parse_arguments(argc, argv);
+    if (arguments == NULL) {
+        fprintf(stderr, "Bad command line options given\n");
         return -1;
     }
-    return ping(argv[1]);
+
+    if (arguments->traceroute) {
+        return traceroute(arguments);
+    }
+
+    if (arguments->pmtu) {
+        return pmtu_discover(arguments);
+    }
+
+    // load mode, paced or flood
+    if (arguments->flood || (arguments->rate != 0 && arguments->nhosts == 1 && arguments->file == NULL
+            && strchr(arguments->hosts[0], '/') == NULL)) {
+        return flood_ping(arguments);
+    }
+
+    // classic endless ping for a single ip address
+    if (arguments->nhosts == 1 && arguments->file == NULL && arguments->count == -1
+            && strchr(arguments->hosts[0], '/') == NULL) {
+        return ping(arguments->hosts[0], arguments->interval);
+    }
+
+    return multiping(arguments);
 }
@@ -0,0 +1,578 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 20:55:03
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 09:14:45
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "checksum.h"
+#include "filter.h"
+#include "hostlist.h"
+#include "icmp.h"
+#include "pmtu.h"
+#include "rxbatch.h"
+#include "scheduler.h"
+#include "timestamp.h"
+
+// sizes are ip packet sizes, kernel adds ip header to what we send
+#define IP_HEADER_SIZE 20
+#define ICMP_HEADER_SIZE 8
+#define MIN_PACKET_SIZE (IP_HEADER_SIZE + ICMP_HEADER_SIZE)
+#define MAX_PACKET_SIZE 65535
+
+// sizes probed at once per host after the first round
+#define SEARCH_PROBES 8
+
+// mtus commonly seen, probed in the first round
+static const int common_mtus[] = {
+    576, 1280, 1400, 1420, 1450, 1480, 1492, 1500, 4352, 9000, MAX_PACKET_SIZE,
+};
+
+#define COMMON_MTUS (int)(sizeof(common_mtus) / sizeof(common_mtus[0]))
+
+// sizes probed in a round, at most, for a single host
+#define MAX_HOST_PROBES (COMMON_MTUS > SEARCH_PROBES + 1 ? COMMON_MTUS : SEARCH_PROBES + 1)
+
+// a round is identified by sequence numbers of its probes
+#define MAX_ROUND_PROBES 65536
+
+enum probe_state {
+    PROBE_PENDING,
+    PROBE_FITS,
+    PROBE_TOO_BIG,
+};
+
+/*
+ * struct for a host and what is known about path to it.
+ */
+struct pmtu_host {
+    struct in_addr addr;
+
+    // largest size answered, 0 if none yet, searching starts from it
+    int fits;
+
+    // smallest size known not to pass
+    int too_big;
+
+    // next hop mtu reported by the latest fragmentation needed, 0 if none
+    int hint;
+
+    // router reporting fragmentation needed, or local interface
+    struct in_addr reporter;
+    int frag_needed;
+    int local;
+
+    // a size vanished without any error, after a smaller one passed
+    int silent;
+
+    int rounds;
+    int done;
+};
+
+/*
+ * struct for a probe of the current round.
+ */
+struct pmtu_probe {
+    int host;
+    int size;
+    enum probe_state state;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_interrupt(int signo) {
+    interrupted = 1;
+}
+
+
+/**
+ * Send an echo request of given ip packet size, with DF set by socket.
+ *
+ *  Returns
+ *      0 if success, -1 if error, errno is EMSGSIZE if size exceeds mtu of
+ *      local interface.
+ **/
+static int send_sized_probe(int sock, struct in_addr dst, unsigned char *packet, int size, int ident, int seq) {
+    int bytes = size - IP_HEADER_SIZE;
+
+    struct icmp_echo *icmp = (struct icmp_echo *)packet;
+    icmp->type = 8;
+    icmp->code = 0;
+    icmp->checksum = 0;
+    icmp->ident = htons(ident);
+    icmp->seq = htons(seq);
+    icmp->checksum = inet_checksum(packet, bytes);
+
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr = dst;
+
+    if (sendto(sock, packet, bytes, 0, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Look up mtu of route to a host, as kernel knows it.
+ *
+ *  Returns
+ *      Mtu if success, -1 if error.
+ **/
+static int route_mtu(struct in_addr dst) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock == -1) {
+        return -1;
+    }
+
+    // connecting a udp socket only looks up route, nothing is sent
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(9);
+    addr.sin_addr = dst;
+
+    int mtu = -1;
+    socklen_t len = sizeof(mtu);
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1
+            || getsockopt(sock, IPPROTO_IP, IP_MTU, &mtu, &len) == -1) {
+        mtu = -1;
+    }
+
+    close(sock);
+
+    return mtu;
+}
+
+
+/**
+ * Pick sizes to probe for a host, all between the largest size passed and
+ * the smallest one known too big.
+ *
+ * The first round tries common mtus; later rounds split the remaining
+ * range evenly, plus the next hop mtu reported by a router.
+ *
+ *  Returns
+ *      Number of sizes picked.
+ **/
+static int pick_sizes(const struct pmtu_host *host, int *sizes) {
+    // nothing passed yet, smaller sizes than headers are no probes
+    int low = host->fits > 0 ? host->fits : MIN_PACKET_SIZE - 1;
+    int high = host->too_big;
+    int n = 0;
+
+    if (host->rounds == 0) {
+        int i;
+        for (i = 0; i < COMMON_MTUS; i++) {
+            if (common_mtus[i] > low && common_mtus[i] < high) {
+                sizes[n++] = common_mtus[i];
+            }
+        }
+
+        return n;
+    }
+
+    if (host->hint > low && host->hint < high) {
+        sizes[n++] = host->hint;
+    }
+
+    int j;
+    for (j = 1; j <= SEARCH_PROBES; j++) {
+        int size = low + (int64_t)(high - low) * j / (SEARCH_PROBES + 1);
+        if (size <= low || size >= high || (n > 0 && sizes[n - 1] == size) || size == host->hint) {
+            continue;
+        }
+
+        sizes[n++] = size;
+    }
+
+    // range is narrower than probes, finish it in this round
+    if (n == 0 && high - low > 1) {
+        sizes[n++] = low + 1;
+    }
+
+    return n;
+}
+
+
+/**
+ * Account an answer to a probe of the current round.
+ *
+ *  Arguments
+ *      packet: received ip packet.
+ *
+ *      bytes: size of packet.
+ *
+ *      peer: source of packet.
+ *
+ *      ident: identifier of our probes.
+ *
+ *      base: sequence number of the first probe of the round.
+ **/
+static void handle_answer(const unsigned char *packet, int bytes, struct in_addr peer, int ident,
+        uint16_t base, struct pmtu_probe *probes, int nprobes, struct pmtu_host *hosts) {
+    int ip_header_len = (packet[0] & 0xf) << 2;
+    if (bytes < ip_header_len + ICMP_HEADER_SIZE) {
+        return;
+    }
+
+    const unsigned char *icmp = packet + ip_header_len;
+
+    // echo reply, the probe made it there and back
+    if (icmp[0] == 0) {
+        const struct icmp_echo *echo = find_echo_reply(packet, bytes, ident);
+        if (echo == NULL) {
+            return;
+        }
+
+        int index = (uint16_t)(ntohs(echo->seq) - base);
+        if (index >= nprobes || probes[index].state != PROBE_PENDING
+                || hosts[probes[index].host].addr.s_addr != peer.s_addr) {
+            return;
+        }
+
+        probes[index].state = PROBE_FITS;
+        return;
+    }
+
+    // only fragmentation needed is of interest, it quotes ip header and
+    // the first 8 bytes of our probe
+    if (icmp[0] != 3 || icmp[1] != 4 || bytes < ip_header_len + ICMP_HEADER_SIZE + 20) {
+        return;
+    }
+
+    const unsigned char *quoted = icmp + ICMP_HEADER_SIZE;
+    int quoted_header_len = (quoted[0] & 0xf) << 2;
+    if (bytes < ip_header_len + ICMP_HEADER_SIZE + quoted_header_len + ICMP_HEADER_SIZE) {
+        return;
+    }
+
+    const unsigned char *quoted_icmp = quoted + quoted_header_len;
+    if (quoted[9] != IPPROTO_ICMP || quoted_icmp[0] != 8 || ((quoted_icmp[4] << 8) | quoted_icmp[5]) != ident) {
+        return;
+    }
+
+    int index = (uint16_t)(((quoted_icmp[6] << 8) | quoted_icmp[7]) - base);
+    if (index >= nprobes || probes[index].state != PROBE_PENDING) {
+        return;
+    }
+
+    struct pmtu_host *host = &hosts[probes[index].host];
+    if (memcmp(quoted + 16, &host->addr, 4) != 0) {
+        return;
+    }
+
+    probes[index].state = PROBE_TOO_BIG;
+
+    // next hop mtu, zero from routers predating RFC 1191
+    int mtu = (icmp[6] << 8) | icmp[7];
+    if (mtu >= MIN_PACKET_SIZE && mtu < probes[index].size) {
+        host->hint = mtu;
+    }
+
+    host->frag_needed = 1;
+    host->reporter = peer;
+}
+
+
+/**
+ * Fold results of a round into hosts, and print hosts done.
+ **/
+static void finish_round(struct pmtu_probe *probes, int nprobes, struct pmtu_host *hosts, int nhosts) {
+    int i;
+    for (i = 0; i < nprobes; i++) {
+        struct pmtu_probe *probe = &probes[i];
+        struct pmtu_host *host = &hosts[probe->host];
+
+        if (probe->state == PROBE_FITS) {
+            if (probe->size > host->fits) {
+                host->fits = probe->size;
+            }
+            continue;
+        }
+
+        // vanished probes are taken as too big, black hole if no error ever came
+        if (probe->size < host->too_big) {
+            host->too_big = probe->size;
+        }
+    }
+
+    // every size above next hop mtu fails at the reporting router, unless
+    // a larger size passed already and the report is stale
+    for (i = 0; i < nhosts; i++) {
+        struct pmtu_host *host = &hosts[i];
+        if (host->hint > 0 && host->hint >= host->fits && host->hint + 1 < host->too_big) {
+            host->too_big = host->hint + 1;
+        }
+    }
+
+    for (i = 0; i < nprobes; i++) {
+        struct pmtu_host *host = &hosts[probes[i].host];
+        if (probes[i].state == PROBE_PENDING && probes[i].size > host->fits && host->fits > 0) {
+            host->silent = 1;
+        }
+    }
+
+    for (i = 0; i < nhosts; i++) {
+        struct pmtu_host *host = &hosts[i];
+        if (host->done) {
+            continue;
+        }
+
+        host->rounds++;
+
+        // even the smallest sizes got no echo reply: searched again below
+        // next hop mtu reported, unless it was refused too, when there is
+        // nothing to search
+        if (host->fits == 0 && host->hint > 0 && host->hint < host->too_big) {
+            continue;
+        }
+
+        if (host->fits == 0) {
+            host->done = 1;
+            printf("%-15s no reply", inet_ntoa(host->addr));
+            if (host->frag_needed) {
+                printf(", fragmentation needed from %s", inet_ntoa(host->reporter));
+            }
+            printf("\n");
+            continue;
+        }
+
+        if (host->too_big - host->fits > 1) {
+            continue;
+        }
+
+        host->done = 1;
+
+        printf("%-15s pmtu %5d, %d rounds", inet_ntoa(host->addr), host->fits, host->rounds);
+
+        if (host->frag_needed) {
+            printf(", fragmentation needed from %s", inet_ntoa(host->reporter));
+        } else if (host->local) {
+            printf(", local interface");
+        }
+
+        if (host->silent && !host->frag_needed && !host->local) {
+            printf(", larger probes vanished without error, black hole suspected");
+        }
+
+        printf("\n");
+    }
+
+    fflush(stdout);
+}
+
+
+/**
+ * Discover path mtu to hosts, probing several sizes at once.
+ *
+ * Probes are echo requests with DF set. Each round sends a set of sizes to
+ * every host still searching, and narrows the range between the largest
+ * size answered and the smallest one refused by fragmentation needed, by
+ * local interface, or vanishing within timeout.
+ *
+ *  Arguments
+ *      arguments: command line arguments, see argparse.h.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int pmtu_discover(const struct cmdline_arguments *arguments) {
+    struct host_list list = { NULL, 0, 0 };
+    if (collect_hosts(&list, arguments) == -1) {
+        free(list.addrs);
+        return -1;
+    }
+
+    if ((int64_t)list.size * MAX_HOST_PROBES > MAX_ROUND_PROBES) {
+        fprintf(stderr, "too many hosts, at most %d\n", MAX_ROUND_PROBES / MAX_HOST_PROBES);
+        free(list.addrs);
+        return -1;
+    }
+
+    int nhosts = list.size;
+    struct pmtu_host *hosts = calloc(nhosts, sizeof(*hosts));
+    struct pmtu_probe *probes = malloc(nhosts * MAX_HOST_PROBES * sizeof(*probes));
+    unsigned char *packet = calloc(1, MAX_PACKET_SIZE);
+    struct rx_batch *batch = rx_batch_new();
+    if (hosts == NULL || probes == NULL || packet == NULL || batch == NULL) {
+        fprintf(stderr, "out of memory\n");
+        free(list.addrs);
+        free(hosts);
+        free(probes);
+        free(packet);
+        rx_batch_free(batch);
+        return -1;
+    }
+
+    int i;
+    for (i = 0; i < nhosts; i++) {
+        hosts[i].addr = list.addrs[i];
+        hosts[i].too_big = MAX_PACKET_SIZE + 1;
+    }
+    free(list.addrs);
+
+    int ret = -1;
+
+    // sends block, receives do not, see rx_batch_recv
+    int sock = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    if (sock == -1) {
+        perror("create raw socket");
+        goto out;
+    }
+
+    // set DF, and send sizes beyond cached path mtu instead of refusing them
+    int discover = IP_PMTUDISC_PROBE;
+    if (setsockopt(sock, IPPROTO_IP, IP_MTU_DISCOVER, &discover, sizeof(discover)) == -1) {
+        perror("set path mtu discovery");
+        goto out_sock;
+    }
+
+    int ident = getpid() & 0xffff;
+
+    // echo replies and fragmentation needed quoting our probes
+    if (attach_trace_filter(sock, ident) == -1) {
+        perror("attach socket filter");
+    }
+
+    struct scheduler sched;
+    if (scheduler_init(&sched, sock) == -1) {
+        perror("create scheduler");
+        goto out_sock;
+    }
+
+    signal(SIGINT, handle_interrupt);
+
+    int64_t start_ts = monotonic_ns();
+    uint16_t seq = 0;
+    int remaining = nhosts;
+    int rounds = 0;
+
+    while (remaining > 0 && !interrupted) {
+        rounds++;
+
+        // send all probes of this round at once
+        uint16_t base = seq;
+        int nprobes = 0;
+        int pending = 0;
+
+        for (i = 0; i < nhosts; i++) {
+            struct pmtu_host *host = &hosts[i];
+            if (host->done) {
+                continue;
+            }
+
+            int sizes[MAX_HOST_PROBES];
+            int n = pick_sizes(host, sizes);
+
+            int j;
+            for (j = 0; j < n; j++) {
+                struct pmtu_probe *probe = &probes[nprobes++];
+                probe->host = i;
+                probe->size = sizes[j];
+                probe->state = PROBE_PENDING;
+
+                if (send_sized_probe(sock, host->addr, packet, sizes[j], ident, seq++) == -1) {
+                    // larger than mtu of outgoing interface
+                    if (errno == EMSGSIZE) {
+                        probe->state = PROBE_TOO_BIG;
+                        host->local = 1;
+
+                        int mtu = route_mtu(host->addr);
+                        if (mtu >= MIN_PACKET_SIZE && mtu < sizes[j] && (host->hint == 0 || mtu < host->hint)) {
+                            host->hint = mtu;
+                        }
+                        continue;
+                    }
+
+                    perror("Send failed");
+                    probe->state = PROBE_TOO_BIG;
+                    continue;
+                }
+
+                pending++;
+            }
+        }
+
+        // wait for answers until all are in or timeout
+        int64_t deadline = monotonic_ns() + arguments->timeout * (NSEC_PER_SEC / 1000);
+        if (scheduler_arm(&sched, deadline) == -1) {
+            perror("Arm timer failed");
+            goto out_sched;
+        }
+
+        while (pending > 0 && !interrupted && monotonic_ns() < deadline) {
+            int events = scheduler_wait(&sched);
+            if (events == -1) {
+                perror("Wait failed");
+                goto out_sched;
+            }
+
+            if (!(events & SCHED_READABLE)) {
+                continue;
+            }
+
+            int n;
+            do {
+                n = rx_batch_recv(batch, sock);
+                if (n == -1) {
+                    perror("Receive failed");
+                    break;
+                }
+
+                int k;
+                for (k = 0; k < n; k++) {
+                    int bytes;
+                    const unsigned char *data = rx_batch_packet(batch, k, &bytes);
+                    handle_answer(data, bytes, rx_batch_peer(batch, k)->sin_addr, ident,
+                        base, probes, nprobes, hosts);
+                }
+            } while (n == RX_BATCH_SIZE);
+
+            pending = 0;
+            for (i = 0; i < nprobes; i++) {
+                pending += probes[i].state == PROBE_PENDING;
+            }
+        }
+
+        if (interrupted) {
+            break;
+        }
+
+        finish_round(probes, nprobes, hosts, nhosts);
+
+        remaining = 0;
+        for (i = 0; i < nhosts; i++) {
+            remaining += !hosts[i].done;
+        }
+    }
+
+    printf("--- %d hosts, %d rounds in %.2fs ---\n", nhosts, rounds, (monotonic_ns() - start_ts) / 1e9);
+    ret = 0;
+
+out_sched:
+    scheduler_close(&sched);
+out_sock:
+    close(sock);
+out:
+    free(hosts);
+    free(probes);
+    free(packet);
+    rx_batch_free(batch);
+
+    return ret;
+}
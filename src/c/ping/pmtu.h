@@ -0,0 +1,10 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 20:55:03
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 20:55:03
+ */
+
+struct cmdline_arguments;
+
+int pmtu_discover(const struct cmdline_arguments *arguments);
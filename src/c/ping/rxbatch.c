@@ -0,0 +1,156 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 19:58:31
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 19:58:31
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "rxbatch.h"
+#include "timestamp.h"
+
+/*
+ * Pool of packet buffers received with a single recvmmsg call.
+ */
+struct rx_batch {
+    // packets received by the last call
+    int count;
+
+    // clocks read right after the last call, shared by the whole batch
+    struct clock_pair now;
+
+    // wall clock receive timestamps
+    int64_t timestamps[RX_BATCH_SIZE];
+
+    struct mmsghdr msgs[RX_BATCH_SIZE];
+    struct iovec iovs[RX_BATCH_SIZE];
+    struct sockaddr_in peers[RX_BATCH_SIZE];
+    char controls[RX_BATCH_SIZE][RX_CONTROL_SIZE];
+
+    // packet buffers, contiguous
+    unsigned char buffers[RX_BATCH_SIZE][RX_BUFFER_SIZE];
+};
+
+
+/**
+ * Allocate a batch and point message headers at its buffers.
+ *
+ *  Returns
+ *      Pointer to batch if success, NULL if out of memory.
+ **/
+struct rx_batch *rx_batch_new() {
+    struct rx_batch *batch = aligned_alloc(64, sizeof(struct rx_batch));
+    if (batch == NULL) {
+        return NULL;
+    }
+
+    bzero(batch, sizeof(*batch));
+
+    int i;
+    for (i = 0; i < RX_BATCH_SIZE; i++) {
+        batch->iovs[i].iov_base = batch->buffers[i];
+        batch->iovs[i].iov_len = RX_BUFFER_SIZE;
+
+        struct msghdr *hdr = &batch->msgs[i].msg_hdr;
+        hdr->msg_name = &batch->peers[i];
+        hdr->msg_iov = &batch->iovs[i];
+        hdr->msg_iovlen = 1;
+        hdr->msg_control = batch->controls[i];
+    }
+
+    return batch;
+}
+
+
+void rx_batch_free(struct rx_batch *batch) {
+    free(batch);
+}
+
+
+/**
+ * Receive packets queued on a non-blocking socket, up to RX_BATCH_SIZE.
+ *
+ *  Arguments
+ *      batch: batch to fill, packets of the previous call are dropped.
+ *
+ *      sock: non-blocking socket, see enable_rx_timestamps.
+ *
+ *  Returns
+ *      Number of packets received, 0 if none is queued, -1 if error.
+ **/
+int rx_batch_recv(struct rx_batch *batch, int sock) {
+    // kernel overwrites lengths, restore them
+    int i;
+    for (i = 0; i < RX_BATCH_SIZE; i++) {
+        struct msghdr *hdr = &batch->msgs[i].msg_hdr;
+        hdr->msg_namelen = sizeof(batch->peers[i]);
+        hdr->msg_controllen = RX_CONTROL_SIZE;
+    }
+
+    int n = recvmmsg(sock, batch->msgs, RX_BATCH_SIZE, MSG_DONTWAIT, NULL);
+    if (n == -1) {
+        batch->count = 0;
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return 0;
+        }
+
+        return -1;
+    }
+
+    read_clock_pair(&batch->now);
+
+    for (i = 0; i < n; i++) {
+        batch->timestamps[i] = parse_rx_timestamp(&batch->msgs[i].msg_hdr);
+    }
+
+    batch->count = n;
+
+    return n;
+}
+
+
+/**
+ * Fetch the i-th packet of the last call.
+ *
+ *  Arguments
+ *      batch: received batch.
+ *
+ *      i: index of packet, less than the number received.
+ *
+ *      bytes: for storing size of packet.
+ *
+ *  Returns
+ *      Pointer to packet data.
+ **/
+const unsigned char *rx_batch_packet(const struct rx_batch *batch, int i, int *bytes) {
+    *bytes = batch->msgs[i].msg_len;
+    return batch->buffers[i];
+}
+
+
+/**
+ * Fetch source address of the i-th packet of the last call.
+ **/
+const struct sockaddr_in *rx_batch_peer(const struct rx_batch *batch, int i) {
+    return &batch->peers[i];
+}
+
+
+/**
+ * Fetch receive time of the i-th packet of the last call, in monotonic
+ * nanoseconds. Packets without kernel timestamp take the time of the call.
+ **/
+int64_t rx_batch_timestamp(const struct rx_batch *batch, int i) {
+    if (batch->timestamps[i] == 0) {
+        return batch->now.mono;
+    }
+
+    return rx_to_monotonic(batch->timestamps[i], &batch->now);
+}
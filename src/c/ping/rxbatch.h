@@ -0,0 +1,24 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 19:58:31
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 19:58:31
+ */
+
+#include <netinet/in.h>
+#include <stdint.h>
+
+// packets received per syscall
+#define RX_BATCH_SIZE 64
+
+// room for a packet of ethernet mtu, larger ones are truncated
+#define RX_BUFFER_SIZE 2048
+
+struct rx_batch;
+
+struct rx_batch *rx_batch_new();
+void rx_batch_free(struct rx_batch *batch);
+int rx_batch_recv(struct rx_batch *batch, int sock);
+const unsigned char *rx_batch_packet(const struct rx_batch *batch, int i, int *bytes);
+const struct sockaddr_in *rx_batch_peer(const struct rx_batch *batch, int i);
+int64_t rx_batch_timestamp(const struct rx_batch *batch, int i);
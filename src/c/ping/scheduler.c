@@ -0,0 +1,129 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 18:20:46
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 18:20:46
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "scheduler.h"
+#include "timestamp.h"
+
+
+/**
+ * Initialize scheduler for given socket.
+ *
+ *  Arguments
+ *      sched: scheduler to initialize.
+ *
+ *      sock: socket to watch for readability.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int scheduler_init(struct scheduler *sched, int sock) {
+    sched->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (sched->epoll_fd == -1) {
+        return -1;
+    }
+
+    sched->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (sched->timer_fd == -1) {
+        close(sched->epoll_fd);
+        return -1;
+    }
+
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = SCHED_READABLE };
+    if (epoll_ctl(sched->epoll_fd, EPOLL_CTL_ADD, sock, &event) == -1) {
+        scheduler_close(sched);
+        return -1;
+    }
+
+    event.data.u32 = SCHED_TIMER;
+    if (epoll_ctl(sched->epoll_fd, EPOLL_CTL_ADD, sched->timer_fd, &event) == -1) {
+        scheduler_close(sched);
+        return -1;
+    }
+
+    // default timer slack of 50us is too coarse for sub-millisecond intervals
+    prctl(PR_SET_TIMERSLACK, 1);
+
+    return 0;
+}
+
+
+/**
+ * Arm timer to fire once at an absolute time.
+ *
+ *  Arguments
+ *      sched: scheduler.
+ *
+ *      deadline: monotonic time in nanoseconds, fires at once if passed.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int scheduler_arm(struct scheduler *sched, int64_t deadline) {
+    // zero value disarms timer, the earliest time possible is 1ns
+    if (deadline < 1) {
+        deadline = 1;
+    }
+
+    struct itimerspec spec = {
+        .it_value = {
+            .tv_sec = deadline / NSEC_PER_SEC,
+            .tv_nsec = deadline % NSEC_PER_SEC,
+        },
+    };
+
+    return timerfd_settime(sched->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+
+/**
+ * Block until socket is readable or timer fires.
+ *
+ *  Returns
+ *      Mask of SCHED_READABLE and SCHED_TIMER, 0 if interrupted by signal,
+ *      -1 if error.
+ **/
+int scheduler_wait(struct scheduler *sched) {
+    struct epoll_event events[2];
+
+    int n = epoll_wait(sched->epoll_fd, events, 2, -1);
+    if (n == -1) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int mask = 0;
+
+    int i;
+    for (i = 0; i < n; i++) {
+        mask |= events[i].data.u32;
+    }
+
+    // consume expiration, timer is one shot
+    if (mask & SCHED_TIMER) {
+        uint64_t expirations;
+        if (read(sched->timer_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+            return -1;
+        }
+    }
+
+    return mask;
+}
+
+
+/**
+ * Release file descriptors of scheduler, not including watched socket.
+ **/
+void scheduler_close(struct scheduler *sched) {
+    close(sched->timer_fd);
+    close(sched->epoll_fd);
+}
@@ -0,0 +1,25 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 18:20:46
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 18:20:46
+ */
+
+#include <stdint.h>
+
+// events returned by scheduler_wait
+#define SCHED_READABLE 1
+#define SCHED_TIMER 2
+
+/**
+ * Event loop core: a socket and a timer, waited together with epoll.
+ **/
+struct scheduler {
+    int epoll_fd;
+    int timer_fd;
+};
+
+int scheduler_init(struct scheduler *sched, int sock);
+int scheduler_arm(struct scheduler *sched, int64_t deadline);
+int scheduler_wait(struct scheduler *sched);
+void scheduler_close(struct scheduler *sched);
@@ -0,0 +1,153 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 14:40:12
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 19:52:06
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+// after time.h, for struct timespec
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+#include "timestamp.h"
+
+_Static_assert(CMSG_SPACE(sizeof(struct scm_timestamping)) <= RX_CONTROL_SIZE,
+    "RX_CONTROL_SIZE too small for struct scm_timestamping");
+
+
+/**
+ * Fetch current monotonic time, immune to wall clock steps.
+ *
+ *  Returns
+ *      Seconds since an arbitrary point.
+ **/
+double get_timestamp() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ((double)ts.tv_nsec) / NSEC_PER_SEC;
+}
+
+
+/**
+ * Fetch current monotonic time in nanoseconds.
+ **/
+int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+
+/**
+ * Fetch current wall clock time in nanoseconds since the epoch.
+ **/
+int64_t realtime_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+
+/**
+ * Read wall clock and monotonic clock back to back.
+ **/
+void read_clock_pair(struct clock_pair *now) {
+    now->real = realtime_ns();
+    now->mono = monotonic_ns();
+}
+
+
+/**
+ * Convert a kernel receive timestamp, which is wall clock time, to
+ * monotonic clock.
+ *
+ * The receive timestamp is shifted by how long ago it was taken. Only a
+ * clock step happening between receiving and reading the clock pair can
+ * disturb the result, in which case monotonic time of the pair is used
+ * instead.
+ *
+ *  Arguments
+ *      rx_ts: kernel receive timestamp, see parse_rx_timestamp.
+ *
+ *      now: clocks read after receiving, see read_clock_pair.
+ *
+ *  Returns
+ *      Receive time in monotonic nanoseconds.
+ **/
+int64_t rx_to_monotonic(int64_t rx_ts, const struct clock_pair *now) {
+    int64_t age = now->real - rx_ts;
+    if (age < 0 || age > NSEC_PER_SEC) {
+        return now->mono;
+    }
+
+    return now->mono - age;
+}
+
+
+/**
+ * Ask kernel to stamp every received packet with its arrival time.
+ *
+ * SO_TIMESTAMPING is preferred, SO_TIMESTAMPNS is used as a fallback for
+ * kernels or sockets refusing the former.
+ *
+ *  Arguments
+ *      s: given socket.
+ *
+ *  Returns
+ *      0 if success, -1 if neither option is supported.
+ **/
+int enable_rx_timestamps(int s) {
+    // software receive timestamps, reported through SCM_TIMESTAMPING
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        return 0;
+    }
+
+    // nanosecond timestamps, reported through SCM_TIMESTAMPNS
+    int on = 1;
+    if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0) {
+        return 0;
+    }
+
+    return -1;
+}
+
+
+/**
+ * Find kernel receive timestamp in control messages of a received packet.
+ *
+ *  Arguments
+ *      msg: message header filled by recvmsg or recvmmsg, with a control
+ *          buffer of RX_CONTROL_SIZE bytes.
+ *
+ *  Returns
+ *      Receive timestamp in wall clock nanoseconds, 0 if none is given.
+ **/
+int64_t parse_rx_timestamp(struct msghdr *msg) {
+    int64_t ts = 0;
+
+    struct cmsghdr *cmsg;
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+
+        // software timestamp lives in the first slot
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            struct scm_timestamping tss;
+            memcpy(&tss, CMSG_DATA(cmsg), sizeof(tss));
+            ts = tss.ts[0].tv_sec * NSEC_PER_SEC + tss.ts[0].tv_nsec;
+        } else if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec tv;
+            memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+            ts = tv.tv_sec * NSEC_PER_SEC + tv.tv_nsec;
+        }
+    }
+
+    return ts;
+}
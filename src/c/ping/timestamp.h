@@ -0,0 +1,30 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 14:40:12
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 19:52:06
+ */
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+#define NSEC_PER_SEC 1000000000LL
+
+// control buffer size for receiving a timestamp, see parse_rx_timestamp
+#define RX_CONTROL_SIZE 64
+
+/**
+ * Wall clock and monotonic clock, read at the same moment.
+ **/
+struct clock_pair {
+    int64_t real;
+    int64_t mono;
+};
+
+double get_timestamp();
+int64_t monotonic_ns();
+int64_t realtime_ns();
+void read_clock_pair(struct clock_pair *now);
+int64_t rx_to_monotonic(int64_t rx_ts, const struct clock_pair *now);
+int enable_rx_timestamps(int s);
+int64_t parse_rx_timestamp(struct msghdr *msg);
@@ -0,0 +1,441 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 19:05:40
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:44:52
+ */
+
+#include <arpa/inet.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "checksum.h"
+#include "filter.h"
+#include "icmp.h"
+#include "rxbatch.h"
+#include "scheduler.h"
+#include "timestamp.h"
+#include "traceroute.h"
+
+// ttl is kept in the low byte of sequence number, probe round in the high
+#define MAX_TTL 255
+#define MAX_ROUNDS 256
+
+/*
+ * Echo request used as traceroute probe.
+ *
+ * Load balancers pick a path from header fields, checksum included, so
+ * every probe of a trace must look the same to them. Sequence number
+ * changes from probe to probe, balance is its one's complement and keeps
+ * checksum unchanged, as paris-traceroute does.
+ */
+struct __attribute__((__packed__)) trace_probe {
+    uint8_t type;
+    uint8_t code;
+    uint16_t checksum;
+
+    uint16_t ident;
+    uint16_t seq;
+
+    uint16_t balance;
+    char magic[MAGIC_LEN];
+};
+
+/*
+ * struct for a probe sent and its answer.
+ */
+struct trace_result {
+    // monotonic sending time in nanoseconds, 0 if not sent
+    int64_t sending_ts;
+
+    // rtt in nanoseconds, -1 if not answered
+    int64_t rtt;
+
+    // router or destination answered
+    struct in_addr responder;
+
+    // icmp type and code of answer
+    uint8_t type;
+    uint8_t code;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_interrupt(int signo) {
+    interrupted = 1;
+}
+
+
+/**
+ * Build a traceroute probe with given sequence number.
+ **/
+static void build_trace_probe(struct trace_probe *probe, int ident, int seq) {
+    bzero(probe, sizeof(*probe));
+
+    probe->type = 8;
+    probe->code = 0;
+    probe->ident = htons(ident);
+    probe->seq = htons(seq);
+    probe->balance = ~probe->seq;
+
+    strncpy(probe->magic, MAGIC, MAGIC_LEN);
+
+    probe->checksum = inet_checksum(probe, sizeof(*probe));
+}
+
+
+/**
+ * Find answer to one of our probes in a received ip packet.
+ *
+ * Destination answers with an echo reply, routers with a time exceeded
+ * or destination unreachable error which quotes ip header and the first
+ * 8 bytes of our probe.
+ *
+ *  Arguments
+ *      buffer: received ip packet.
+ *
+ *      bytes: size of ip packet.
+ *
+ *      ident: identifier of our probes.
+ *
+ *      target: destination of our probes.
+ *
+ *      type: for storing icmp type of answer.
+ *
+ *      code: for storing icmp code of answer.
+ *
+ *  Returns
+ *      Sequence number of answered probe, -1 if not an answer.
+ **/
+static int parse_trace_reply(const unsigned char *buffer, int bytes, int ident,
+        struct in_addr target, int *type, int *code) {
+    int ip_header_len = (buffer[0] & 0xf) << 2;
+    if (bytes < ip_header_len + 8) {
+        return -1;
+    }
+
+    const unsigned char *icmp = buffer + ip_header_len;
+    *type = icmp[0];
+    *code = icmp[1];
+
+    // echo reply from destination
+    if (*type == 0) {
+        const struct icmp_echo *echo = find_echo_reply(buffer, bytes, ident);
+        return echo == NULL ? -1 : ntohs(echo->seq);
+    }
+
+    if (*type != 11 && *type != 3) {
+        return -1;
+    }
+
+    // quoted ip header of our probe
+    const unsigned char *quoted = icmp + 8;
+    int quoted_len = bytes - ip_header_len - 8;
+    if (quoted_len < 20) {
+        return -1;
+    }
+
+    int quoted_header_len = (quoted[0] & 0xf) << 2;
+    if (quoted_len < quoted_header_len + 8 || quoted[9] != IPPROTO_ICMP
+            || memcmp(quoted + 16, &target, 4) != 0) {
+        return -1;
+    }
+
+    // quoted icmp header, type, code, checksum, identifier and sequence
+    const unsigned char *quoted_icmp = quoted + quoted_header_len;
+    if (quoted_icmp[0] != 8 || ((quoted_icmp[4] << 8) | quoted_icmp[5]) != ident) {
+        return -1;
+    }
+
+    return (quoted_icmp[6] << 8) | quoted_icmp[7];
+}
+
+
+/**
+ * Annotation for an answer, following traditional traceroute.
+ **/
+static const char *answer_mark(const struct trace_result *result) {
+    if (result->type != 3) {
+        return "";
+    }
+
+    switch (result->code) {
+        case 0:
+            return " !N";
+        case 1:
+            return " !H";
+        case 2:
+            return " !P";
+        case 4:
+            return " !F";
+        case 9:
+        case 10:
+        case 13:
+            return " !X";
+        default:
+            return " !";
+    }
+}
+
+
+/**
+ * Print path in ttl order, up to destination or the last hop answered.
+ **/
+static void print_path(const char *ip, const struct trace_result *results, int max_ttl, int rounds, int last_ttl) {
+    printf("--- path to %s, %d hops ---\n", ip, last_ttl);
+
+    int ttl;
+    for (ttl = 1; ttl <= last_ttl; ttl++) {
+        printf("%2d ", ttl);
+
+        struct in_addr shown = { 0 };
+
+        int round;
+        for (round = 0; round < rounds; round++) {
+            const struct trace_result *result = &results[round * max_ttl + ttl - 1];
+            if (result->rtt == -1) {
+                printf(" *");
+                continue;
+            }
+
+            // show responder once, unless another one answers the same hop
+            if (result->responder.s_addr != shown.s_addr) {
+                printf(" %-15s", inet_ntoa(result->responder));
+                shown = result->responder;
+            }
+
+            printf(" %8.3fms%s", result->rtt / 1e6, answer_mark(result));
+        }
+
+        printf("\n");
+    }
+}
+
+
+/**
+ * Trace path to a single host, sending probes for all ttls at once.
+ *
+ * Answers are printed as soon as they arrive, so the whole trace takes
+ * about one rtt to the farthest hop, followed by the path in ttl order.
+ *
+ *  Arguments
+ *      arguments: command line arguments, see argparse.h.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int traceroute(const struct cmdline_arguments *arguments) {
+    if (arguments->nhosts != 1 || arguments->file != NULL) {
+        fprintf(stderr, "traceroute takes a single host\n");
+        return -1;
+    }
+
+    const char *ip = arguments->hosts[0];
+
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    if (inet_aton(ip, &addr.sin_addr) == 0) {
+        fprintf(stderr, "bad ip address: %s\n", ip);
+        return -1;
+    }
+
+    int max_ttl = arguments->max_ttl;
+    // one probe per hop unless given, endless makes no sense here
+    if (arguments->count == 0) {
+        fprintf(stderr, "traceroute takes at least one probe per hop\n");
+        return -1;
+    }
+
+    int rounds = arguments->count == -1 ? 1 : arguments->count;
+    if (max_ttl > MAX_TTL || rounds > MAX_ROUNDS) {
+        fprintf(stderr, "too many probes, at most %d hops and %d per hop\n", MAX_TTL, MAX_ROUNDS);
+        return -1;
+    }
+
+    int sock = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK, IPPROTO_ICMP);
+    if (sock == -1) {
+        perror("create raw socket");
+        return -1;
+    }
+
+    if (enable_rx_timestamps(sock) == -1) {
+        perror("enable receive timestamps");
+    }
+
+    int ident = getpid() & 0xffff;
+
+    // let kernel drop packets not answering our probes
+    if (attach_trace_filter(sock, ident) == -1) {
+        perror("attach socket filter");
+    }
+
+    struct scheduler sched;
+    if (scheduler_init(&sched, sock) == -1) {
+        perror("create scheduler");
+        close(sock);
+        return -1;
+    }
+
+    struct trace_result *results = calloc(rounds * max_ttl, sizeof(*results));
+    struct rx_batch *batch = rx_batch_new();
+    if (results == NULL || batch == NULL) {
+        fprintf(stderr, "out of memory\n");
+        free(results);
+        rx_batch_free(batch);
+        scheduler_close(&sched);
+        close(sock);
+        return -1;
+    }
+
+    signal(SIGINT, handle_interrupt);
+
+    printf("TRACE %s, %d hops max\n", ip, max_ttl);
+
+    // send probes of all ttls at once, one round after another
+    int sent = 0;
+    int round;
+    for (round = 0; round < rounds; round++) {
+        int ttl;
+        for (ttl = 1; ttl <= max_ttl; ttl++) {
+            // unanswered before anything may fail, so an unsent probe shows as *
+            struct trace_result *result = &results[round * max_ttl + ttl - 1];
+            result->rtt = -1;
+
+            if (setsockopt(sock, IPPROTO_IP, IP_TTL, &ttl, sizeof(ttl)) == -1) {
+                perror("set ttl");
+                continue;
+            }
+
+            struct trace_probe probe;
+            build_trace_probe(&probe, ident, (round << 8) | ttl);
+
+            result->sending_ts = monotonic_ns();
+            if (sendto(sock, &probe, sizeof(probe), 0, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+                perror("Send failed");
+                result->sending_ts = 0;
+                continue;
+            }
+
+            sent++;
+        }
+    }
+
+    // lowest ttl reaching destination, or giving up with unreachable
+    int last_ttl = max_ttl + 1;
+
+    int64_t deadline = monotonic_ns() + arguments->timeout * (NSEC_PER_SEC / 1000);
+    if (scheduler_arm(&sched, deadline) == -1) {
+        perror("Arm timer failed");
+    }
+
+    while (!interrupted && monotonic_ns() < deadline) {
+        int events = scheduler_wait(&sched);
+        if (events == -1) {
+            perror("Wait failed");
+            break;
+        }
+
+        if (!(events & SCHED_READABLE)) {
+            continue;
+        }
+
+        // a short batch means queue is empty
+        int n;
+        do {
+            n = rx_batch_recv(batch, sock);
+            if (n == -1) {
+                perror("Receive failed");
+                break;
+            }
+
+            int i;
+            for (i = 0; i < n; i++) {
+                int bytes;
+                const unsigned char *packet = rx_batch_packet(batch, i, &bytes);
+
+                int type, code;
+                int seq = parse_trace_reply(packet, bytes, ident, addr.sin_addr, &type, &code);
+                if (seq == -1) {
+                    continue;
+                }
+
+                int ttl = seq & 0xff;
+                int probe_round = seq >> 8;
+                if (ttl < 1 || ttl > max_ttl || probe_round >= rounds) {
+                    continue;
+                }
+
+                // skip duplicates, and probes which never left
+                struct trace_result *result = &results[probe_round * max_ttl + ttl - 1];
+                if (result->sending_ts == 0 || result->rtt != -1) {
+                    continue;
+                }
+
+                result->rtt = rx_batch_timestamp(batch, i) - result->sending_ts;
+                result->responder = rx_batch_peer(batch, i)->sin_addr;
+                result->type = type;
+                result->code = code;
+
+                // probes beyond destination are answered by destination as well
+                if (ttl > last_ttl) {
+                    continue;
+                }
+
+                if (type != 11 && ttl < last_ttl) {
+                    last_ttl = ttl;
+                }
+
+                printf("%2d  %-15s %8.3fms%s\n", ttl, inet_ntoa(result->responder),
+                    result->rtt / 1e6, answer_mark(result));
+                fflush(stdout);
+            }
+        } while (n == RX_BATCH_SIZE);
+
+        // done when every probe up to destination is answered
+        if (last_ttl <= max_ttl) {
+            int pending = 0;
+            for (round = 0; round < rounds && !pending; round++) {
+                int ttl;
+                for (ttl = 1; ttl <= last_ttl; ttl++) {
+                    const struct trace_result *result = &results[round * max_ttl + ttl - 1];
+                    if (result->sending_ts != 0 && result->rtt == -1) {
+                        pending = 1;
+                        break;
+                    }
+                }
+            }
+
+            if (!pending) {
+                break;
+            }
+        }
+    }
+
+    // destination not reached, show up to the farthest hop answered
+    if (last_ttl > max_ttl) {
+        last_ttl = 0;
+
+        int i;
+        for (i = 0; i < rounds * max_ttl; i++) {
+            if (results[i].rtt != -1 && i % max_ttl + 1 > last_ttl) {
+                last_ttl = i % max_ttl + 1;
+            }
+        }
+    }
+
+    print_path(ip, results, max_ttl, rounds, last_ttl);
+
+    free(results);
+    rx_batch_free(batch);
+    scheduler_close(&sched);
+    close(sock);
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 19:05:40
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 19:05:40
+ */
+
+struct cmdline_arguments;
+
+int traceroute(const struct cmdline_arguments *arguments);
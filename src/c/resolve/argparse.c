@@ -0,0 +1,295 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 05:31:27
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:55:37
+ */
+
+#include <argp.h>
+#include <stdio.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "cache.h"
+#include "dns.h"
+
+
+/**
+ * opt_handler function for GNU argp.
+ **/
+static error_t opt_handler(int key, char *arg, struct argp_state *state) {
+    struct cmdline_arguments *arguments = state->input;
+
+    switch(key) {
+        case 'f':
+            arguments->file = arg;
+            break;
+
+        case 's':
+            arguments->server = arg;
+            break;
+
+        case 'T':
+            if (strcasecmp(arg, "A") == 0) {
+                arguments->type = DNS_TYPE_A;
+            } else if (strcasecmp(arg, "AAAA") == 0) {
+                arguments->type = DNS_TYPE_AAAA;
+            } else {
+                argp_error(state, "unsupported record type: %s", arg);
+            }
+            break;
+
+        case 'j':
+            if (sscanf(arg, "%d", &arguments->inflight) != 1 || arguments->inflight < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'S':
+            if (sscanf(arg, "%d", &arguments->sockets) != 1 || arguments->sockets < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 't':
+            if (sscanf(arg, "%d", &arguments->timeout) != 1 || arguments->timeout < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'r':
+            if (sscanf(arg, "%d", &arguments->retries) != 1 || arguments->retries < 0) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'C':
+            arguments->cache = arg;
+            break;
+
+        case 'N':
+            arguments->cache = NULL;
+            break;
+
+        case 'X':
+            arguments->cache_stats = 1;
+            break;
+
+        case ARGP_KEY_ARG:
+            if (arguments->name != NULL) {
+                argp_error(state, "a single name at a time, use --file for more");
+            }
+            arguments->name = arg;
+            break;
+
+        case ARGP_KEY_END:
+            if (arguments->name == NULL && arguments->file == NULL && !arguments->cache_stats) {
+                argp_error(state, "no name given");
+            }
+            break;
+
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Parse command line arguments given by argc, argv.
+ *
+ *  Arguments
+ *      argc: the same with main function.
+ *
+ *      argv: the same with main function.
+ *
+ *  Returns
+ *      Pointer to struct arguments if success, NULL if error.
+ **/
+const struct cmdline_arguments *parse_arguments(int argc, char *argv[]) {
+    // docs for program and options
+    static char const doc[] = "resolve: resolve domain names\v"
+        "A single name, or names listed in a file in batch, are resolved "
+        "speaking dns over udp to the server with many queries in flight "
+        "over a few sockets, each with a random port, and random query ids. "
+        "A line is printed per name as soon as it is resolved: name, rcode "
+        "or TIMEOUT, ttl and addresses. A single name not answered fails.\n\n"
+        "Answers are cached in a file mapped by every process using it, for "
+        "as long as their ttl says, NXDOMAIN and NODATA included.";
+    static char const args_doc[] = "[NAME]";
+
+    // command line options
+    static struct argp_option const options[] = {
+        // Option -f --file: names to resolve in batch
+        {"file", 'f', "FILE", 0, "resolve names listed in FILE in batch, - for stdin"},
+
+        // Option -s --server: dns server
+        {"server", 's', "IP[:PORT]", 0, "dns server, first of /etc/resolv.conf by default"},
+
+        // Option -T --type: record type
+        {"type", 'T', "TYPE", 0, "record type, A or AAAA"},
+
+        // Option -j --inflight: queries in flight
+        {"inflight", 'j', "QUERIES", 0, "queries in flight at most"},
+
+        // Option -S --sockets: udp sockets
+        {"sockets", 'S', "SOCKETS", 0, "udp sockets queries are spread over"},
+
+        // Option -t --timeout: time to wait for a reply
+        {"timeout", 't', "MS", 0, "milliseconds to wait for a reply before retrying"},
+
+        // Option -r --retries: retries per name
+        {"retries", 'r', "RETRIES", 0, "retries per name after the first query"},
+
+        // Option -C --cache: cache file
+        {"cache", 'C', "FILE", 0, "cache shared by processes of user, /dev/shm/resolve-cache-UID by default"},
+
+        // Option -N --no-cache: no cache
+        {"no-cache", 'N', 0, 0, "neither look answers up in cache nor store them"},
+
+        // Option -X --cache-stats: statistics of cache
+        {"cache-stats", 'X', 0, 0, "print hit ratio and other statistics of cache, then exit"},
+
+        { 0 }
+    };
+
+    static const struct argp argp = {
+        options,
+        opt_handler,
+        args_doc,
+        doc,
+        0,
+        0,
+        0,
+    };
+
+    // for storing results
+    static struct cmdline_arguments arguments = {
+        .name = NULL,
+        .file = NULL,
+        .server = NULL,
+        .type = DNS_TYPE_A,
+        .inflight = 256,
+        .sockets = 4,
+        .timeout = 1000,
+        .retries = 2,
+        .cache = NULL,
+        .cache_stats = 0,
+    };
+
+    // one cache per user, none trusting files of others
+    static char default_cache[64];
+    snprintf(default_cache, sizeof(default_cache), CACHE_DEFAULT_PATH, (unsigned)geteuid());
+    arguments.cache = default_cache;
+
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    return &arguments;
+}
+
+
+/**
+ * opt_handler function for GNU argp, of responder.
+ **/
+static error_t responder_opt_handler(int key, char *arg, struct argp_state *state) {
+    struct responder_arguments *arguments = state->input;
+
+    switch(key) {
+        case 'l':
+            arguments->listen = arg;
+            break;
+
+        case 'j':
+            if (sscanf(arg, "%d", &arguments->workers) != 1 || arguments->workers < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'q':
+            arguments->quiet = 1;
+            break;
+
+        case ARGP_KEY_ARG:
+            if (arguments->zone != NULL) {
+                argp_error(state, "a single zone at a time");
+            }
+            arguments->zone = arg;
+            break;
+
+        case ARGP_KEY_END:
+            if (arguments->zone == NULL) {
+                argp_usage(state);
+            }
+            break;
+
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Parse command line arguments of responder given by argc, argv.
+ *
+ *  Arguments
+ *      argc: the same with main function.
+ *
+ *      argv: the same with main function.
+ *
+ *  Returns
+ *      Pointer to struct arguments if success, NULL if error.
+ **/
+const struct responder_arguments *parse_responder_arguments(int argc, char *argv[]) {
+    static char const doc[] = "responder: authoritative dns server of a zone file, for benchmarks\v"
+        "Every answer is precomputed in wire form as zone is loaded, and names "
+        "are found by a perfect hash, so a query costs a lookup and a copy. "
+        "Workers take and send batches of datagrams, each on a socket of its "
+        "own, kernel spreading queries among them by SO_REUSEPORT. Zone file "
+        "is in master file format, with A, AAAA, CNAME, NS, MX, TXT and SOA "
+        "records. Names out of zone are refused. A zone for resolve to "
+        "query, like: (echo '@ SOA ns admin 1 2 3 4 60'; seq -f 'h%g A 10.0.0.1' "
+        "100000) | sed '1i $ORIGIN test.' > test.zone";
+    static char const args_doc[] = "ZONE";
+
+    static struct argp_option const options[] = {
+        // Option -l --listen: address to listen at
+        {"listen", 'l', "IP[:PORT]", 0, "address to listen at, 127.0.0.1:5353 by default"},
+
+        // Option -j --workers: threads
+        {"workers", 'j', "WORKERS", 0, "threads answering, one per cpu by default"},
+
+        // Option -q --quiet: no report per second
+        {"quiet", 'q', 0, 0, "no report per second"},
+
+        { 0 }
+    };
+
+    static const struct argp argp = {
+        options,
+        responder_opt_handler,
+        args_doc,
+        doc,
+        0,
+        0,
+        0,
+    };
+
+    static struct responder_arguments arguments = {
+        .zone = NULL,
+        .listen = "127.0.0.1:5353",
+        .workers = 0,
+        .quiet = 0,
+    };
+
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    if (arguments.workers == 0) {
+        arguments.workers = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    return &arguments;
+}
@@ -0,0 +1,61 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 05:31:27
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:55:37
+ */
+
+/**
+ * struct for storing command line arguments.
+ **/
+struct cmdline_arguments {
+    // single name to resolve, without a file
+    const char *name;
+
+    // file listing names to resolve in batch, one per line, "-" for stdin
+    const char *file;
+
+    // dns server, ip with optional port, from resolv.conf if not given
+    const char *server;
+
+    // record type asked for, DNS_TYPE_*
+    int type;
+
+    // queries in flight at most
+    int inflight;
+
+    // udp sockets queries are spread over
+    int sockets;
+
+    // time to wait for a reply before retrying, in milliseconds
+    int timeout;
+
+    // retries after the first query
+    int retries;
+
+    // file of cache shared by processes, NULL for no cache
+    const char *cache;
+
+    // print statistics of cache and exit
+    int cache_stats;
+};
+
+/**
+ * struct for storing command line arguments of responder.
+ **/
+struct responder_arguments {
+    // zone file to serve
+    const char *zone;
+
+    // address to listen at
+    const char *listen;
+
+    // threads, each with a socket of its own
+    int workers;
+
+    // no report per second
+    int quiet;
+};
+
+const struct cmdline_arguments *parse_arguments(int argc, char *argv[]);
+const struct responder_arguments *parse_responder_arguments(int argc, char *argv[]);
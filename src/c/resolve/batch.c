@@ -0,0 +1,600 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 05:31:27
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:55:37
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "batch.h"
+#include "cache.h"
+#include "dns.h"
+
+#define NSEC_PER_MSEC 1000000LL
+
+// replies received per system call
+#define RECV_BATCH_SIZE 64
+
+// socket buffer, so that bursts of replies are not dropped
+#define SOCKET_RCVBUF_SIZE (1 << 20)
+
+// query ids per socket
+#define QUERY_IDS 65536
+
+/*
+ * A name being resolved.
+ */
+struct query {
+    char name[DNS_NAME_SIZE];
+    int active;
+
+    // queries sent for name so far
+    int tries;
+
+    // socket and id of the last query, a reply to an earlier one is late
+    int sock;
+    uint16_t id;
+
+    // monotonic time to give up waiting, in nanoseconds
+    int64_t deadline;
+};
+
+/*
+ * Batch resolver state.
+ */
+struct resolver {
+    const struct cmdline_arguments *arguments;
+    struct sockaddr_in server;
+
+    int *socks;
+    int nsocks;
+    int epoll_fd;
+
+    // slots of names in flight and stack of free ones
+    struct query *queries;
+    int *free_slots;
+    int nfree;
+
+    // slot + 1 of query waiting for each id of each socket, 0 if none
+    int *pending;
+
+    // input of names
+    FILE *input;
+    int eof;
+
+    // earliest deadline of queries in flight
+    int64_t next_deadline;
+
+    uint64_t random_state;
+
+    // answers shared with other processes, unmapped if disabled
+    struct dns_cache cache;
+
+    // statistics
+    long names;
+    long answered;
+    long nxdomain;
+    long failed;
+    long timed_out;
+    long retries;
+    long mismatched;
+    long cached;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_interrupt(int signum) {
+    interrupted = 1;
+}
+
+
+/**
+ * Monotonic time in nanoseconds.
+ **/
+static int64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/**
+ * Next pseudo random number, xorshift64* seeded from kernel, so that ids
+ * can not be guessed from earlier ones by an off-path attacker easily.
+ **/
+static uint64_t next_random(struct resolver *r) {
+    r->random_state ^= r->random_state >> 12;
+    r->random_state ^= r->random_state << 25;
+    r->random_state ^= r->random_state >> 27;
+    return r->random_state * 2685821657736338717ULL;
+}
+
+
+/**
+ * Find the first ipv4 nameserver of /etc/resolv.conf.
+ *
+ *  Returns
+ *      0 if success, -1 if none.
+ **/
+static int find_system_server(struct sockaddr_in *addr) {
+    FILE *file = fopen("/etc/resolv.conf", "re");
+    if (file == NULL) {
+        return -1;
+    }
+
+    int ret = -1;
+    char line[256];
+    while (ret == -1 && fgets(line, sizeof(line), file) != NULL) {
+        char ip[INET_ADDRSTRLEN];
+        if (sscanf(line, " nameserver %15s", ip) == 1) {
+            ret = dns_parse_server(ip, addr);
+        }
+    }
+
+    fclose(file);
+
+    return ret;
+}
+
+
+/**
+ * Open udp sockets connected to server, each on a random port picked by
+ * kernel. Being connected, a socket takes replies from server only.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int open_sockets(struct resolver *r) {
+    r->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (r->epoll_fd == -1) {
+        return -1;
+    }
+
+    int i;
+    for (i = 0; i < r->nsocks; i++) {
+        int s = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (s == -1) {
+            return -1;
+        }
+        r->socks[i] = s;
+
+        int size = SOCKET_RCVBUF_SIZE;
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+        if (connect(s, (struct sockaddr *)&r->server, sizeof(r->server)) == -1) {
+            return -1;
+        }
+
+        struct epoll_event event = { .events = EPOLLIN, .data.u32 = i };
+        if (epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, s, &event) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Send a query for name of slot, from a random socket with a random id
+ * not waited for yet on that socket.
+ **/
+static void send_query(struct resolver *r, int slot, int64_t now) {
+    struct query *q = &r->queries[slot];
+
+    int sock;
+    uint16_t id;
+    do {
+        uint64_t random = next_random(r);
+        sock = (random >> 16) % r->nsocks;
+        id = random;
+    } while (r->pending[sock * QUERY_IDS + id] != 0);
+
+    unsigned char buffer[DNS_HEADER_SIZE + DNS_NAME_SIZE + 32];
+    int length = dns_build_query(buffer, sizeof(buffer), id, q->name, r->arguments->type);
+
+    q->sock = sock;
+    q->id = id;
+    q->tries++;
+    q->deadline = now + r->arguments->timeout * NSEC_PER_MSEC;
+    r->pending[sock * QUERY_IDS + id] = slot + 1;
+
+    // a query not sent is retried at deadline like a lost one
+    send(r->socks[sock], buffer, length, 0);
+
+    if (q->deadline < r->next_deadline) {
+        r->next_deadline = q->deadline;
+    }
+}
+
+
+/**
+ * Forget query of slot, making slot free.
+ **/
+static void release_query(struct resolver *r, int slot) {
+    struct query *q = &r->queries[slot];
+    r->pending[q->sock * QUERY_IDS + q->id] = 0;
+    q->active = 0;
+    r->free_slots[r->nfree++] = slot;
+}
+
+
+/**
+ * Print result of a name as a line: name, rcode, ttl and addresses.
+ **/
+static void print_answer(const char *name, const struct dns_answer *answer, int type) {
+    printf("%s %s %u", name, dns_rcode_name(answer->rcode), answer->ttl);
+
+    int i;
+    for (i = 0; i < answer->count; i++) {
+        char text[INET6_ADDRSTRLEN];
+        inet_ntop(type == DNS_TYPE_AAAA ? AF_INET6 : AF_INET, answer->addrs[i], text, sizeof(text));
+        printf(" %s", text);
+    }
+
+    if (answer->truncated) {
+        printf(" truncated");
+    }
+
+    printf("\n");
+}
+
+
+/**
+ * Count answer by rcode.
+ **/
+static void count_answer(struct resolver *r, const struct dns_answer *answer) {
+    if (answer->rcode == DNS_RCODE_NOERROR) {
+        r->answered++;
+    } else if (answer->rcode == DNS_RCODE_NXDOMAIN) {
+        r->nxdomain++;
+    } else {
+        r->failed++;
+    }
+}
+
+
+/**
+ * Take a name from input into slot and query it, unless answered from
+ * cache right away.
+ *
+ *  Returns
+ *      1 if a name is taken, 0 if none is left.
+ **/
+static int start_next_name(struct resolver *r, int64_t now) {
+    char line[1024];
+    while (fgets(line, sizeof(line), r->input) != NULL) {
+        // trim spaces, skip empty lines and comments
+        char *name = line;
+        while (isspace((unsigned char)*name)) {
+            name++;
+        }
+        size_t length = strlen(name);
+        while (length > 0 && isspace((unsigned char)name[length - 1])) {
+            name[--length] = '\0';
+        }
+        if (length == 0 || name[0] == '#') {
+            continue;
+        }
+
+        r->names++;
+
+        unsigned char probe[DNS_HEADER_SIZE + DNS_NAME_SIZE + 32];
+        if (dns_build_query(probe, sizeof(probe), 0, name, r->arguments->type) == -1) {
+            printf("%s BADNAME\n", name);
+            r->failed++;
+            continue;
+        }
+
+        struct dns_answer answer;
+        if (r->cache.header != NULL && cache_lookup(&r->cache, name, r->arguments->type, &answer)) {
+            print_answer(name, &answer, r->arguments->type);
+            count_answer(r, &answer);
+            r->cached++;
+            continue;
+        }
+
+        int slot = r->free_slots[--r->nfree];
+        struct query *q = &r->queries[slot];
+        strcpy(q->name, name);
+        q->active = 1;
+        q->tries = 0;
+        send_query(r, slot, now);
+
+        return 1;
+    }
+
+    r->eof = 1;
+
+    return 0;
+}
+
+
+/**
+ * Receive replies of a socket and finish names answered.
+ **/
+static void receive_replies(struct resolver *r, int sock) {
+    static unsigned char buffers[RECV_BATCH_SIZE][DNS_MESSAGE_SIZE];
+    struct iovec iovs[RECV_BATCH_SIZE];
+    struct mmsghdr msgs[RECV_BATCH_SIZE];
+
+    for (;;) {
+        int i;
+        for (i = 0; i < RECV_BATCH_SIZE; i++) {
+            iovs[i].iov_base = buffers[i];
+            iovs[i].iov_len = DNS_MESSAGE_SIZE;
+
+            bzero(&msgs[i], sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        // port unreachable of an earlier query is reported by next call
+        int n = recvmmsg(r->socks[sock], msgs, RECV_BATCH_SIZE, MSG_DONTWAIT, NULL);
+        if (n == -1) {
+            if (errno == ECONNREFUSED || errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        for (i = 0; i < n; i++) {
+            if (msgs[i].msg_len < DNS_HEADER_SIZE) {
+                r->mismatched++;
+                continue;
+            }
+
+            uint16_t id = buffers[i][0] << 8 | buffers[i][1];
+            int slot = r->pending[sock * QUERY_IDS + id] - 1;
+
+            struct dns_answer answer;
+            if (slot == -1 || dns_parse_answer(buffers[i], msgs[i].msg_len, r->queries[slot].name,
+                    r->arguments->type, &answer) == -1) {
+                r->mismatched++;
+                continue;
+            }
+
+            print_answer(r->queries[slot].name, &answer, r->arguments->type);
+            count_answer(r, &answer);
+
+            if (r->cache.header != NULL) {
+                cache_store(&r->cache, r->queries[slot].name, r->arguments->type, &answer);
+            }
+
+            release_query(r, slot);
+        }
+
+        if (n < RECV_BATCH_SIZE) {
+            return;
+        }
+    }
+}
+
+
+/**
+ * Retry queries past deadline, or give names up after all retries, and
+ * find the next deadline.
+ **/
+static void expire_queries(struct resolver *r, int64_t now) {
+    r->next_deadline = INT64_MAX;
+
+    int slot;
+    for (slot = 0; slot < r->arguments->inflight; slot++) {
+        struct query *q = &r->queries[slot];
+        if (!q->active) {
+            continue;
+        }
+
+        if (q->deadline <= now) {
+            if (q->tries > r->arguments->retries) {
+                printf("%s TIMEOUT\n", q->name);
+                r->timed_out++;
+                release_query(r, slot);
+                continue;
+            }
+
+            // a late reply to the earlier query is dropped as its id is gone
+            r->pending[q->sock * QUERY_IDS + q->id] = 0;
+            r->retries++;
+            send_query(r, slot, now);
+        }
+
+        if (q->deadline < r->next_deadline) {
+            r->next_deadline = q->deadline;
+        }
+    }
+}
+
+
+/**
+ * Set resolver up.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int resolver_init(struct resolver *r, const struct cmdline_arguments *arguments) {
+    bzero(r, sizeof(*r));
+    r->arguments = arguments;
+    r->epoll_fd = -1;
+    r->next_deadline = INT64_MAX;
+
+    if (arguments->server != NULL ? dns_parse_server(arguments->server, &r->server) == -1
+            : find_system_server(&r->server) == -1) {
+        fprintf(stderr, "Bad dns server or none in /etc/resolv.conf\n");
+        return -1;
+    }
+
+    // resolving goes on without cache if it can not be opened
+    if (arguments->cache != NULL && cache_open(&r->cache, arguments->cache) == -1) {
+        fprintf(stderr, "Fail to open cache %s: %s, going on without\n", arguments->cache, strerror(errno));
+    }
+
+    if (getrandom(&r->random_state, sizeof(r->random_state), 0) != sizeof(r->random_state)) {
+        r->random_state = now_ns();
+    }
+    r->random_state |= 1;
+
+    // a single name is read just like a file listing it
+    if (arguments->file == NULL) {
+        r->input = fmemopen((void *)arguments->name, strlen(arguments->name), "r");
+        if (r->input == NULL) {
+            perror("Fail to read name");
+            return -1;
+        }
+    } else if (strcmp(arguments->file, "-") == 0) {
+        r->input = stdin;
+    } else {
+        r->input = fopen(arguments->file, "re");
+        if (r->input == NULL) {
+            perror("Fail to open file of names");
+            return -1;
+        }
+    }
+
+    r->nsocks = arguments->sockets;
+    r->socks = malloc(r->nsocks * sizeof(*r->socks));
+    r->queries = calloc(arguments->inflight, sizeof(*r->queries));
+    r->free_slots = malloc(arguments->inflight * sizeof(*r->free_slots));
+    r->pending = calloc((size_t)r->nsocks * QUERY_IDS, sizeof(*r->pending));
+    if (r->socks == NULL || r->queries == NULL || r->free_slots == NULL || r->pending == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+
+    int i;
+    for (i = 0; i < r->nsocks; i++) {
+        r->socks[i] = -1;
+    }
+
+    for (i = 0; i < arguments->inflight; i++) {
+        r->free_slots[r->nfree++] = arguments->inflight - 1 - i;
+    }
+
+    if (open_sockets(r) == -1) {
+        perror("Fail to open sockets");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Release resources of resolver.
+ **/
+static void resolver_close(struct resolver *r) {
+    int i;
+    for (i = 0; r->socks != NULL && i < r->nsocks; i++) {
+        if (r->socks[i] != -1) {
+            close(r->socks[i]);
+        }
+    }
+
+    if (r->epoll_fd != -1) {
+        close(r->epoll_fd);
+    }
+
+    if (r->input != NULL && r->input != stdin) {
+        fclose(r->input);
+    }
+
+    cache_close(&r->cache);
+
+    free(r->socks);
+    free(r->queries);
+    free(r->free_slots);
+    free(r->pending);
+}
+
+
+/**
+ * Resolve names listed in a file, or a single name, speaking dns over
+ * udp to server with up to --inflight queries in flight over --sockets
+ * sockets. Names are read as slots get free, and a line is printed for
+ * every name as soon as it is answered or given up.
+ *
+ *  Arguments
+ *      arguments: command line arguments, see argparse.h.
+ *
+ *  Returns
+ *      0 if success, -1 if error, or if a single name is not answered.
+ **/
+int resolve_batch(const struct cmdline_arguments *arguments) {
+    struct resolver r;
+    if (resolver_init(&r, arguments) == -1) {
+        resolver_close(&r);
+        return -1;
+    }
+
+    signal(SIGINT, handle_interrupt);
+    signal(SIGTERM, handle_interrupt);
+
+    int64_t start = now_ns();
+    struct epoll_event events[64];
+
+    while (!interrupted) {
+        int64_t now = now_ns();
+        while (r.nfree > 0 && !r.eof) {
+            start_next_name(&r, now);
+        }
+
+        if (r.eof && r.nfree == arguments->inflight) {
+            break;
+        }
+
+        // sleep until a reply or the earliest deadline
+        int timeout = -1;
+        if (r.next_deadline != INT64_MAX) {
+            timeout = r.next_deadline <= now ? 0 : (r.next_deadline - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC;
+        }
+
+        int n = epoll_wait(r.epoll_fd, events, sizeof(events) / sizeof(events[0]), timeout);
+        if (n == -1 && errno != EINTR) {
+            perror("Fail to wait for replies");
+            break;
+        }
+
+        int i;
+        for (i = 0; i < n; i++) {
+            receive_replies(&r, events[i].data.u32);
+        }
+
+        now = now_ns();
+        if (now >= r.next_deadline) {
+            expire_queries(&r, now);
+        }
+
+        fflush(stdout);
+    }
+
+    double elapsed = (now_ns() - start) / 1e9;
+    fflush(stdout);
+    fprintf(stderr, "--- %ld names in %.3fs, %.0f names/s: %ld answered, %ld nxdomain, %ld failed, "
+        "%ld timed out, %ld from cache, %ld retries, %ld replies dropped ---\n", r.names, elapsed,
+        r.names / elapsed, r.answered, r.nxdomain, r.failed, r.timed_out, r.cached, r.retries, r.mismatched);
+
+    resolver_close(&r);
+
+    // a single name fails like gethostbyname did, without an answer
+    if (arguments->file == NULL && r.answered == 0) {
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 05:31:27
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 05:31:27
+ */
+
+struct cmdline_arguments;
+
+int resolve_batch(const struct cmdline_arguments *arguments);
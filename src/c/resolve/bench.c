@@ -0,0 +1,333 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:24:10
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 06:24:10
+ */
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dns.h"
+#include "message.h"
+#include "pcap.h"
+
+// messages kept from captures at most
+#define MAX_MESSAGES 4096
+
+// messages parsed per benchmark
+#define BENCH_MESSAGES 20000000
+
+/*
+ * Messages read from captures, each in a buffer of its own size.
+ */
+struct messages {
+    unsigned char *data[MAX_MESSAGES];
+    size_t length[MAX_MESSAGES];
+    int count;
+};
+
+
+double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/**
+ * pcap_udp_handler keeping a copy of every message.
+ **/
+static int keep_message(const unsigned char *payload, size_t length, void *arg) {
+    struct messages *messages = arg;
+    if (messages->count == MAX_MESSAGES) {
+        return -1;
+    }
+
+    unsigned char *data = malloc(length > 0 ? length : 1);
+    if (data == NULL) {
+        return -1;
+    }
+    memcpy(data, payload, length);
+
+    messages->data[messages->count] = data;
+    messages->length[messages->count] = length;
+    messages->count++;
+
+    return 0;
+}
+
+
+/**
+ * Name of record type, like CNAME.
+ **/
+static const char *type_name(uint16_t type) {
+    static char unknown[16];
+
+    switch (type) {
+        case DNS_TYPE_A: return "A";
+        case DNS_TYPE_NS: return "NS";
+        case DNS_TYPE_CNAME: return "CNAME";
+        case DNS_TYPE_SOA: return "SOA";
+        case DNS_TYPE_MX: return "MX";
+        case DNS_TYPE_TXT: return "TXT";
+        case DNS_TYPE_AAAA: return "AAAA";
+        case DNS_TYPE_OPT: return "OPT";
+    }
+
+    snprintf(unknown, sizeof(unknown), "TYPE%u", type);
+    return unknown;
+}
+
+
+/**
+ * Print rdata of a record, decoded for the types known.
+ **/
+static void print_rdata(const struct dns_record *record) {
+    char text[DNS_NAME_SIZE];
+    char rname[DNS_NAME_SIZE];
+
+    switch (record->type) {
+        case DNS_TYPE_A:
+        case DNS_TYPE_AAAA:
+            inet_ntop(record->type == DNS_TYPE_A ? AF_INET : AF_INET6, record->data.addr.data, text, sizeof(text));
+            printf("%s", text);
+            return;
+
+        case DNS_TYPE_CNAME:
+        case DNS_TYPE_NS:
+            dns_name_text(&record->data.target, text);
+            printf("%s.", text);
+            return;
+
+        case DNS_TYPE_MX:
+            dns_name_text(&record->data.mx.exchange, text);
+            printf("%u %s.", record->data.mx.preference, text);
+            return;
+
+        case DNS_TYPE_TXT: {
+            uint16_t offset = 0;
+            struct dns_span string;
+            while (dns_next_string(&record->data.txt, &offset, &string) == 1) {
+                printf("%s\"%.*s\"", string.data == record->data.txt.data + 1 ? "" : " ",
+                    string.length, string.data);
+            }
+            return;
+        }
+
+        case DNS_TYPE_SOA:
+            dns_name_text(&record->data.soa.mname, text);
+            dns_name_text(&record->data.soa.rname, rname);
+            printf("%s. %s. %u %u %u %u %u", text, rname, record->data.soa.serial, record->data.soa.refresh,
+                record->data.soa.retry, record->data.soa.expire, record->data.soa.minimum);
+            return;
+    }
+
+    printf("\\# %u", record->rdata.length);
+}
+
+
+/**
+ * Print a message the way dig does, every section decoded, then what
+ * resolve takes of it if a reply.
+ *
+ *  Returns
+ *      0 if decoded as a whole, -1 if malformed.
+ **/
+static int print_message(const unsigned char *msg, size_t length) {
+    static const char *sections[] = { "QUESTION", "ANSWER", "AUTHORITY", "ADDITIONAL" };
+
+    struct dns_parser parser;
+    if (dns_parser_init(&parser, msg, length) == -1) {
+        printf(";; bad message of %zu bytes\n\n", length);
+        return -1;
+    }
+
+    const struct dns_header *header = &parser.header;
+    printf(";; id %u, %s, flags 0x%04x, rcode %s, qd %u, an %u, ns %u, ar %u\n", header->id,
+        header->flags & 0x8000 ? "reply" : "query", header->flags, dns_rcode_name(header->flags & 0xf),
+        header->qdcount, header->ancount, header->nscount, header->arcount);
+
+    char text[DNS_NAME_SIZE];
+    char question_name[DNS_NAME_SIZE] = "";
+    uint16_t question_type = 0;
+
+    printf(";; %s\n", sections[DNS_SECTION_QUESTION]);
+    struct dns_question question;
+    int ret;
+    while ((ret = dns_next_question(&parser, &question)) == 1) {
+        dns_name_text(&question.name, text);
+        printf("%s.\t%u\t%s\n", text, question.class, type_name(question.type));
+
+        strcpy(question_name, text);
+        question_type = question.type;
+    }
+
+    int section = DNS_SECTION_QUESTION;
+    struct dns_record record;
+    while (ret != -1 && (ret = dns_next_record(&parser, &record)) == 1) {
+        if ((int)record.section != section) {
+            section = record.section;
+            printf(";; %s\n", sections[section]);
+        }
+
+        dns_name_text(&record.name, text);
+        printf("%s.\t%u\t%u\t%s\t", text, record.ttl, record.class, type_name(record.type));
+        print_rdata(&record);
+        printf("\n");
+    }
+
+    if (ret == -1) {
+        printf(";; malformed at offset %u\n\n", parser.offset);
+        return -1;
+    }
+
+    if (parser.offset != length) {
+        printf(";; %zu bytes left over\n\n", length - parser.offset);
+        return -1;
+    }
+
+    if (header->flags & 0x8000 && header->qdcount == 1) {
+        struct dns_answer answer;
+        if (dns_parse_answer(msg, length, question_name, question_type, &answer) == -1) {
+            printf(";; resolve refuses reply\n\n");
+            return -1;
+        }
+
+        printf(";; resolve takes %s ttl %u", dns_rcode_name(answer.rcode), answer.ttl);
+        int i;
+        for (i = 0; i < answer.count; i++) {
+            inet_ntop(question_type == DNS_TYPE_AAAA ? AF_INET6 : AF_INET, answer.addrs[i], text, sizeof(text));
+            printf(" %s", text);
+        }
+        printf("\n");
+    }
+
+    printf("\n");
+
+    return 0;
+}
+
+
+/**
+ * Decode every record of a message, as a zero copy walk costs.
+ *
+ *  Returns
+ *      Records decoded, -1 if malformed.
+ **/
+static int walk_message(const unsigned char *msg, size_t length) {
+    struct dns_parser parser;
+    if (dns_parser_init(&parser, msg, length) == -1) {
+        return -1;
+    }
+
+    struct dns_record record;
+    int records = 0;
+
+    int ret;
+    while ((ret = dns_next_record(&parser, &record)) == 1) {
+        records++;
+    }
+
+    return ret == -1 ? -1 : records;
+}
+
+
+int main(int argc, char *argv[]) {
+    static const char *defaults[] = {
+        "../../../pcap/dns-resolve.pcap",
+        "../../../pcap/dns-cname.pcap",
+    };
+
+    const char **paths = (const char **)argv + 1;
+    int npaths = argc - 1;
+    if (npaths == 0) {
+        paths = defaults;
+        npaths = sizeof(defaults) / sizeof(defaults[0]);
+    }
+
+    static struct messages messages;
+
+    int i;
+    for (i = 0; i < npaths; i++) {
+        if (pcap_read_udp(paths[i], DNS_PORT, keep_message, &messages) == -1) {
+            perror(paths[i]);
+            return -1;
+        }
+    }
+
+    if (messages.count == 0) {
+        fprintf(stderr, "No dns message found\n");
+        return -1;
+    }
+
+    // every message has to be decoded as a whole, up to its last byte
+    int malformed = 0;
+    for (i = 0; i < messages.count; i++) {
+        if (print_message(messages.data[i], messages.length[i]) == -1) {
+            malformed++;
+        }
+    }
+
+    if (malformed > 0) {
+        fprintf(stderr, "%d of %d messages not decoded\n", malformed, messages.count);
+        return -1;
+    }
+
+    long rounds = BENCH_MESSAGES / messages.count;
+    long total = rounds * messages.count;
+    volatile long sink = 0;
+
+    double start = monotonic_seconds();
+    long j;
+    for (j = 0; j < rounds; j++) {
+        for (i = 0; i < messages.count; i++) {
+            sink += walk_message(messages.data[i], messages.length[i]);
+        }
+    }
+    double elapsed = monotonic_seconds() - start;
+    printf("walk every record: %.0f messages/s, %.1fns per message\n", total / elapsed, elapsed * 1e9 / total);
+
+    // replies only, against their own question
+    char names[MAX_MESSAGES][DNS_NAME_SIZE];
+    uint16_t types[MAX_MESSAGES];
+    int replies = 0;
+    for (i = 0; i < messages.count; i++) {
+        struct dns_parser parser;
+        struct dns_question question;
+        dns_parser_init(&parser, messages.data[i], messages.length[i]);
+        if (!(parser.header.flags & 0x8000) || dns_next_question(&parser, &question) != 1) {
+            types[i] = 0;
+            continue;
+        }
+        dns_name_text(&question.name, names[i]);
+        types[i] = question.type;
+        replies++;
+    }
+
+    if (replies > 0) {
+        rounds = BENCH_MESSAGES / replies;
+        total = rounds * replies;
+
+        struct dns_answer answer;
+        start = monotonic_seconds();
+        for (j = 0; j < rounds; j++) {
+            for (i = 0; i < messages.count; i++) {
+                if (types[i] != 0) {
+                    sink += dns_parse_answer(messages.data[i], messages.length[i], names[i], types[i], &answer);
+                }
+            }
+        }
+        elapsed = monotonic_seconds() - start;
+        printf("parse answer: %.0f replies/s, %.1fns per reply\n", total / elapsed, elapsed * 1e9 / total);
+    }
+
+    for (i = 0; i < messages.count; i++) {
+        free(messages.data[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,396 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:08:52
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 08:04:19
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "dns.h"
+
+#define CACHE_MAGIC 0x444e5343
+#define CACHE_VERSION 1
+
+// slots of table, a power of 2; tmpfs backs only pages touched
+#define CACHE_SLOTS 65536
+
+// slots probed for a name, from its hash on; linear probing clusters,
+// so a narrower window evicts live entries at low load already
+#define CACHE_PROBES 16
+
+// ttls are capped, negative ones harder as RFC 2308 suggests
+#define CACHE_MAX_TTL 86400
+#define CACHE_MAX_NEGATIVE_TTL 10800
+
+// tries of a reader racing with writers, before taking it as a miss
+#define CACHE_READ_TRIES 4
+
+/*
+ * Slot of table. Guarded by a seqlock: writers make seq odd while
+ * writing, readers copy and retry if seq changed meanwhile. Slots are
+ * never emptied, expired ones are overwritten.
+ */
+struct cache_entry {
+    uint32_t seq;
+    uint32_t hash;
+
+    // wall clock seconds entry expires at, 0 for empty slot
+    int64_t expires;
+
+    uint16_t type;
+    uint8_t rcode;
+    uint8_t count;
+
+    // name in lower case
+    char name[DNS_NAME_SIZE];
+
+    unsigned char addrs[DNS_MAX_ADDRS][16];
+};
+
+/*
+ * Start of mapping, followed by slots.
+ */
+struct cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t entry_size;
+
+    struct cache_stats stats;
+
+    struct cache_entry entries[];
+};
+
+
+/**
+ * Wall clock in seconds, comparable among processes and reboots.
+ **/
+static int64_t now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec;
+}
+
+
+/**
+ * Lower case name without trailing dot, and its hash, FNV-1a mixed with
+ * type and finished by murmur3 finalizer, as names differing in a digit
+ * would crowd probe windows otherwise. Hash is never 0.
+ **/
+static uint32_t normalize(const char *name, uint16_t type, char *lower) {
+    uint32_t hash = 2166136261U ^ type;
+
+    size_t length;
+    for (length = 0; name[length] != '\0' && length < DNS_NAME_SIZE - 1; length++) {
+        lower[length] = tolower((unsigned char)name[length]);
+    }
+    if (length > 0 && lower[length - 1] == '.') {
+        length--;
+    }
+    lower[length] = '\0';
+
+    size_t i;
+    for (i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)lower[i]) * 16777619U;
+    }
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+
+    return hash == 0 ? 1 : hash;
+}
+
+
+/**
+ * Bump a shared counter.
+ **/
+static void count(uint64_t *counter) {
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * Open cache at path, creating it if missing. Creation is serialized by
+ * a file lock, so that racing processes agree on layout.
+ *
+ *  Arguments
+ *      cache: for storing mapping.
+ *
+ *      path: file of cache, on tmpfs best.
+ *
+ *  Returns
+ *      0 if success, -1 if error, errno is EINVAL if file is no cache of
+ *      this layout, EPERM if file is not owned by user or others may write
+ *      it, for answers in it are trusted.
+ **/
+int cache_open(struct dns_cache *cache, const char *path) {
+    cache->header = NULL;
+    cache->size = sizeof(struct cache_header) + (size_t)CACHE_SLOTS * sizeof(struct cache_entry);
+
+    // never through a symlink, planted maybe in a directory others write
+    int fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        return -1;
+    }
+
+    int ret = -1;
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        goto out;
+    }
+
+    if (!S_ISREG(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+        errno = EPERM;
+        goto out;
+    }
+
+    if (flock(fd, LOCK_EX) == -1) {
+        goto out;
+    }
+
+    // size again, now that no one else is creating it
+    if (fstat(fd, &st) == -1) {
+        goto out;
+    }
+
+    // new file, zero filled slots are empty
+    int created = st.st_size == 0;
+    if (created && ftruncate(fd, cache->size) == -1) {
+        goto out;
+    }
+
+    if (!created && (size_t)st.st_size != cache->size) {
+        errno = EINVAL;
+        goto out;
+    }
+
+    void *map = mmap(NULL, cache->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        goto out;
+    }
+    cache->header = map;
+
+    if (created) {
+        cache->header->version = CACHE_VERSION;
+        cache->header->slots = CACHE_SLOTS;
+        cache->header->entry_size = sizeof(struct cache_entry);
+        __atomic_store_n(&cache->header->magic, CACHE_MAGIC, __ATOMIC_RELEASE);
+    }
+
+    if (cache->header->magic != CACHE_MAGIC || cache->header->version != CACHE_VERSION
+            || cache->header->slots != CACHE_SLOTS || cache->header->entry_size != sizeof(struct cache_entry)) {
+        cache_close(cache);
+        errno = EINVAL;
+        goto out;
+    }
+
+    ret = 0;
+
+out:
+    // lock goes with the file descriptor, mapping stays
+    close(fd);
+
+    return ret;
+}
+
+
+/**
+ * Unmap cache.
+ **/
+void cache_close(struct dns_cache *cache) {
+    if (cache->header != NULL) {
+        munmap(cache->header, cache->size);
+        cache->header = NULL;
+    }
+}
+
+
+/**
+ * Look name up, answering from cache if there is a live entry. Ttl of
+ * answer is what is left of the cached one.
+ *
+ *  Arguments
+ *      cache: cache opened.
+ *
+ *      name: name asked for.
+ *
+ *      type: record type.
+ *
+ *      answer: for storing answer if found.
+ *
+ *  Returns
+ *      1 if found, 0 if not.
+ **/
+int cache_lookup(struct dns_cache *cache, const char *name, uint16_t type, struct dns_answer *answer) {
+    char lower[DNS_NAME_SIZE];
+    uint32_t hash = normalize(name, type, lower);
+    int64_t now = now_seconds();
+
+    int i;
+    for (i = 0; i < CACHE_PROBES; i++) {
+        struct cache_entry *entry = &cache->header->entries[(hash + i) & (CACHE_SLOTS - 1)];
+
+        int tries;
+        for (tries = 0; tries < CACHE_READ_TRIES; tries++) {
+            uint32_t seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+            if (seq & 1) {
+                continue;
+            }
+
+            // cheap fields first, the rest is copied for matching ones only
+            uint32_t entry_hash = entry->hash;
+            int64_t expires = entry->expires;
+            uint16_t entry_type = entry->type;
+
+            struct cache_entry copy;
+            int matched = entry_hash == hash && entry_type == type && expires > now;
+            if (matched) {
+                memcpy(&copy, entry, sizeof(copy));
+            }
+
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) != seq) {
+                continue;
+            }
+
+            // never written, name would be here if cached
+            if (expires == 0) {
+                count(&cache->header->stats.misses);
+                return 0;
+            }
+
+            if (!matched || strcmp(copy.name, lower) != 0) {
+                break;
+            }
+
+            bzero(answer, sizeof(*answer));
+            answer->rcode = copy.rcode;
+            answer->ttl = copy.expires - now;
+            answer->count = copy.count;
+            memcpy(answer->addrs, copy.addrs, copy.count * sizeof(copy.addrs[0]));
+
+            count(answer->count > 0 ? &cache->header->stats.hits : &cache->header->stats.negative_hits);
+            return 1;
+        }
+    }
+
+    count(&cache->header->stats.misses);
+
+    return 0;
+}
+
+
+/**
+ * Cache an answer for as long as its ttl says, capped. Positive answers
+ * and negative ones, NXDOMAIN or NODATA, are cached, failures and
+ * truncated answers are not.
+ *
+ * Slot taken is the one of the same name if any, else the first empty
+ * or expired one, else the one expiring first, which is evicted. Insert
+ * is dropped if another writer holds the slot.
+ **/
+void cache_store(struct dns_cache *cache, const char *name, uint16_t type, const struct dns_answer *answer) {
+    if (answer->truncated || answer->ttl == 0
+            || (answer->rcode != DNS_RCODE_NOERROR && answer->rcode != DNS_RCODE_NXDOMAIN)) {
+        return;
+    }
+
+    char lower[DNS_NAME_SIZE];
+    uint32_t hash = normalize(name, type, lower);
+    int64_t now = now_seconds();
+
+    uint32_t ttl = answer->ttl;
+    uint32_t max_ttl = answer->count > 0 ? CACHE_MAX_TTL : CACHE_MAX_NEGATIVE_TTL;
+    if (ttl > max_ttl) {
+        ttl = max_ttl;
+    }
+
+    // pick slot by racy reads, checked again once locked
+    struct cache_entry *victim = NULL;
+    int i;
+    for (i = 0; i < CACHE_PROBES; i++) {
+        struct cache_entry *entry = &cache->header->entries[(hash + i) & (CACHE_SLOTS - 1)];
+        int64_t expires = entry->expires;
+
+        if (entry->hash == hash && entry->type == type && strcmp(entry->name, lower) == 0) {
+            victim = entry;
+            break;
+        }
+
+        if (victim == NULL || (victim->expires > now && expires < victim->expires)) {
+            victim = entry;
+        }
+    }
+
+    uint32_t seq = __atomic_load_n(&victim->seq, __ATOMIC_RELAXED);
+    if ((seq & 1) || !__atomic_compare_exchange_n(&victim->seq, &seq, seq + 1, 0,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        count(&cache->header->stats.contended);
+        return;
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    int evicted = victim->expires > now && (victim->hash != hash || strcmp(victim->name, lower) != 0);
+
+    victim->hash = hash;
+    victim->type = type;
+    victim->rcode = answer->rcode;
+    victim->count = answer->count;
+    victim->expires = now + ttl;
+    strcpy(victim->name, lower);
+    memcpy(victim->addrs, answer->addrs, answer->count * sizeof(answer->addrs[0]));
+
+    __atomic_store_n(&victim->seq, seq + 2, __ATOMIC_RELEASE);
+
+    count(&cache->header->stats.inserts);
+    if (evicted) {
+        count(&cache->header->stats.evictions);
+    }
+}
+
+
+/**
+ * Read shared counters, and count live entries.
+ *
+ *  Arguments
+ *      cache: cache opened.
+ *
+ *      stats: for storing counters.
+ *
+ *      capacity: for storing slots of table.
+ *
+ *      used: for storing live entries.
+ **/
+void cache_read_stats(const struct dns_cache *cache, struct cache_stats *stats, int *capacity, int *used) {
+    const struct cache_stats *shared = &cache->header->stats;
+    stats->hits = __atomic_load_n(&shared->hits, __ATOMIC_RELAXED);
+    stats->negative_hits = __atomic_load_n(&shared->negative_hits, __ATOMIC_RELAXED);
+    stats->misses = __atomic_load_n(&shared->misses, __ATOMIC_RELAXED);
+    stats->inserts = __atomic_load_n(&shared->inserts, __ATOMIC_RELAXED);
+    stats->evictions = __atomic_load_n(&shared->evictions, __ATOMIC_RELAXED);
+    stats->contended = __atomic_load_n(&shared->contended, __ATOMIC_RELAXED);
+
+    int64_t now = now_seconds();
+    *capacity = CACHE_SLOTS;
+    *used = 0;
+
+    int i;
+    for (i = 0; i < CACHE_SLOTS; i++) {
+        if (cache->header->entries[i].expires > now) {
+            (*used)++;
+        }
+    }
+}
@@ -0,0 +1,46 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:08:52
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 08:04:19
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// shared by processes of a user on a host, gone with reboot; format of
+// path, from effective uid
+#define CACHE_DEFAULT_PATH "/dev/shm/resolve-cache-%u"
+
+/*
+ * Counters shared by every process using cache.
+ */
+struct cache_stats {
+    uint64_t hits;
+    uint64_t negative_hits;
+    uint64_t misses;
+    uint64_t inserts;
+
+    // live entries replaced for lack of room
+    uint64_t evictions;
+
+    // inserts racing with another writer, dropped
+    uint64_t contended;
+};
+
+struct cache_header;
+struct dns_answer;
+
+/*
+ * Cache mapped by a process.
+ */
+struct dns_cache {
+    struct cache_header *header;
+    size_t size;
+};
+
+int cache_open(struct dns_cache *cache, const char *path);
+void cache_close(struct dns_cache *cache);
+int cache_lookup(struct dns_cache *cache, const char *name, uint16_t type, struct dns_answer *answer);
+void cache_store(struct dns_cache *cache, const char *name, uint16_t type, const struct dns_answer *answer);
+void cache_read_stats(const struct dns_cache *cache, struct cache_stats *stats, int *capacity, int *used);
@@ -0,0 +1,246 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 05:31:27
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 07:52:08
+ */
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "dns.h"
+#include "message.h"
+
+// cnames followed at most
+#define DNS_MAX_CNAMES 8
+
+
+/**
+ * Build a query for a record of name, recursion desired, with an EDNS0
+ * record advertising DNS_MESSAGE_SIZE bytes of udp payload.
+ *
+ *  Arguments
+ *      buffer: for storing query.
+ *
+ *      size: bytes of buffer.
+ *
+ *      id: query id.
+ *
+ *      name: name in text form, trailing dot optional.
+ *
+ *      type: record type, DNS_TYPE_*.
+ *
+ *  Returns
+ *      Bytes of query if success, -1 if name is bad or buffer too small.
+ **/
+int dns_build_query(unsigned char *buffer, size_t size, uint16_t id, const char *name, uint16_t type) {
+    size_t name_length = strlen(name);
+    if (name_length > 0 && name[name_length - 1] == '.') {
+        name_length--;
+    }
+
+    // labels and lengths, root label, type, class and opt record
+    size_t query_size = DNS_HEADER_SIZE + name_length + 2 + 4 + 11;
+    if (name_length == 0 || name_length >= DNS_NAME_SIZE || query_size > size) {
+        return -1;
+    }
+
+    bzero(buffer, DNS_HEADER_SIZE);
+    buffer[0] = id >> 8;
+    buffer[1] = id;
+    buffer[2] = DNS_FLAG_RD >> 8;
+    buffer[5] = 1;
+    buffer[11] = 1;
+
+    // every label after its length
+    unsigned char *p = buffer + DNS_HEADER_SIZE;
+    size_t start = 0;
+    while (start < name_length) {
+        const char *dot = memchr(name + start, '.', name_length - start);
+        size_t label = dot == NULL ? name_length - start : (size_t)(dot - name) - start;
+        if (label == 0 || label > 63) {
+            return -1;
+        }
+
+        *p++ = label;
+        memcpy(p, name + start, label);
+        p += label;
+        start += label + 1;
+    }
+    *p++ = 0;
+
+    *p++ = type >> 8;
+    *p++ = type;
+    *p++ = 0;
+    *p++ = DNS_CLASS_IN;
+
+    // opt record: root name, type, udp payload size as class, no flags
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = DNS_TYPE_OPT;
+    *p++ = DNS_MESSAGE_SIZE >> 8;
+    *p++ = DNS_MESSAGE_SIZE & 0xff;
+    bzero(p, 6);
+    p += 6;
+
+    return p - buffer;
+}
+
+
+/**
+ * Parse a reply to a query of name and type: rcode, addresses of type
+ * the name resolves to through cnames if any, and how long all this
+ * may be cached.
+ *
+ * Replies not matching the question are refused, so that stray or
+ * forged replies with a guessed id are not taken.
+ *
+ *  Arguments
+ *      msg: reply.
+ *
+ *      length: bytes of reply.
+ *
+ *      name: name queried.
+ *
+ *      type: type queried.
+ *
+ *      answer: for storing what is found.
+ *
+ *  Returns
+ *      0 if success, -1 if malformed or not a reply to the question.
+ **/
+int dns_parse_answer(const unsigned char *msg, size_t length, const char *name, uint16_t type,
+        struct dns_answer *answer) {
+    bzero(answer, sizeof(*answer));
+
+    struct dns_parser parser;
+    if (dns_parser_init(&parser, msg, length) == -1) {
+        return -1;
+    }
+
+    if (!(parser.header.flags & DNS_FLAG_QR) || parser.header.qdcount != 1) {
+        return -1;
+    }
+
+    answer->rcode = parser.header.flags & 0xf;
+    answer->truncated = (parser.header.flags & DNS_FLAG_TC) != 0;
+
+    struct dns_question question;
+    if (dns_next_question(&parser, &question) != 1 || !dns_name_equal(&question.name, name)
+            || question.type != type || question.class != DNS_CLASS_IN) {
+        return -1;
+    }
+
+    // follow cnames from the name asked for, whatever order records are
+    // in, walking answer section again per hop; no record is copied
+    const struct dns_parser answers = parser;
+    struct dns_name target = question.name;
+    struct dns_record record;
+
+    uint32_t ttl = UINT32_MAX;
+    int hops;
+    for (hops = 0; hops <= DNS_MAX_CNAMES; hops++) {
+        int followed = 0;
+        int ret;
+
+        parser = answers;
+        while (!followed && (ret = dns_next_record(&parser, &record)) == 1
+                && record.section == DNS_SECTION_ANSWER) {
+            if (record.class != DNS_CLASS_IN || !dns_name_same(&record.name, &target)) {
+                continue;
+            }
+
+            if (record.type == DNS_TYPE_CNAME && type != DNS_TYPE_CNAME) {
+                target = record.data.target;
+                ttl = record.ttl < ttl ? record.ttl : ttl;
+                followed = 1;
+            } else if (record.type == type && (type == DNS_TYPE_A || type == DNS_TYPE_AAAA)) {
+                if (answer->count < DNS_MAX_ADDRS) {
+                    memcpy(answer->addrs[answer->count++], record.data.addr.data, record.data.addr.length);
+                }
+                ttl = record.ttl < ttl ? record.ttl : ttl;
+            }
+        }
+
+        if (ret == -1) {
+            return -1;
+        }
+
+        if (!followed) {
+            break;
+        }
+    }
+
+    // negative answers are cached as long as soa of authority section
+    // says, that of zone of name
+    if (answer->count == 0) {
+        ttl = 0;
+
+        int ret;
+        parser = answers;
+        while ((ret = dns_next_record(&parser, &record)) == 1 && record.section != DNS_SECTION_ADDITIONAL) {
+            if (record.section == DNS_SECTION_AUTHORITY && record.type == DNS_TYPE_SOA
+                    && dns_name_within(&target, &record.name)) {
+                uint32_t minimum = record.data.soa.minimum;
+                ttl = record.ttl < minimum ? record.ttl : minimum;
+                break;
+            }
+        }
+
+        if (ret == -1) {
+            return -1;
+        }
+    }
+
+    answer->ttl = ttl == UINT32_MAX ? 0 : ttl;
+
+    return 0;
+}
+
+
+/**
+ * Parse address like 127.0.0.1 or 127.0.0.1:5353, port 53 if not given.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int dns_parse_server(const char *spec, struct sockaddr_in *addr) {
+    char ip[INET_ADDRSTRLEN];
+    unsigned short port = DNS_PORT;
+
+    const char *colon = strchr(spec, ':');
+    size_t length = colon == NULL ? strlen(spec) : (size_t)(colon - spec);
+    if (length >= sizeof(ip)) {
+        return -1;
+    }
+    memcpy(ip, spec, length);
+    ip[length] = '\0';
+
+    if (colon != NULL && sscanf(colon + 1, "%hu", &port) != 1) {
+        return -1;
+    }
+
+    bzero(addr, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+
+    return inet_aton(ip, &addr->sin_addr) == 0 ? -1 : 0;
+}
+
+
+/**
+ * Name of rcode, like NXDOMAIN.
+ **/
+const char *dns_rcode_name(int rcode) {
+    static const char *names[] = {
+        "NOERROR", "FORMERR", "SERVFAIL", "NXDOMAIN", "NOTIMP", "REFUSED",
+    };
+
+    if (rcode >= 0 && rcode < (int)(sizeof(names) / sizeof(names[0]))) {
+        return names[rcode];
+    }
+
+    return "RCODE?";
+}
@@ -0,0 +1,73 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 05:31:27
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 06:47:33
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct sockaddr_in;
+
+#define DNS_PORT 53
+
+// bytes of a header
+#define DNS_HEADER_SIZE 12
+
+// bytes of a name in text form, dots included, at most
+#define DNS_NAME_SIZE 254
+
+// udp payload advertised by EDNS0, and size of receive buffers
+#define DNS_MESSAGE_SIZE 4096
+
+// addresses kept from an answer
+#define DNS_MAX_ADDRS 16
+
+// header flags
+#define DNS_FLAG_QR 0x8000
+#define DNS_OPCODE_MASK 0x7800
+#define DNS_FLAG_AA 0x0400
+#define DNS_FLAG_TC 0x0200
+#define DNS_FLAG_RD 0x0100
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_NS 2
+#define DNS_TYPE_CNAME 5
+#define DNS_TYPE_SOA 6
+#define DNS_TYPE_MX 15
+#define DNS_TYPE_TXT 16
+#define DNS_TYPE_AAAA 28
+#define DNS_TYPE_OPT 41
+
+#define DNS_CLASS_IN 1
+
+#define DNS_RCODE_NOERROR 0
+#define DNS_RCODE_FORMERR 1
+#define DNS_RCODE_SERVFAIL 2
+#define DNS_RCODE_NXDOMAIN 3
+#define DNS_RCODE_NOTIMP 4
+#define DNS_RCODE_REFUSED 5
+
+/*
+ * Addresses a name resolves to, following cnames.
+ */
+struct dns_answer {
+    int rcode;
+
+    // answer is truncated, tcp is needed for the rest
+    int truncated;
+
+    // seconds the answer may be cached, from soa if negative
+    uint32_t ttl;
+
+    // addresses of the type asked for, 4 or 16 bytes each
+    int count;
+    unsigned char addrs[DNS_MAX_ADDRS][16];
+};
+
+int dns_build_query(unsigned char *buffer, size_t size, uint16_t id, const char *name, uint16_t type);
+int dns_parse_answer(const unsigned char *msg, size_t length, const char *name, uint16_t type,
+        struct dns_answer *answer);
+int dns_parse_server(const char *spec, struct sockaddr_in *addr);
+const char *dns_rcode_name(int rcode);
@@ -0,0 +1,359 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:24:10
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 06:24:10
+ */
+
+/*
+ * Fuzz harness of the message parser. Built by make with address and
+ * undefined behavior sanitizers, it mutates seed messages itself: those
+ * of captures given, and a few crafted ones. With clang, libFuzzer may
+ * drive it instead:
+ *
+ *  clang -g -O1 -fsanitize=fuzzer,address -DLIBFUZZER fuzz.c dns.c message.c pcap.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dns.h"
+#include "message.h"
+#include "pcap.h"
+
+// seeds kept at most
+#define MAX_SEEDS 256
+
+// bytes of a mutated message at most
+#define MAX_INPUT_SIZE 4096
+
+// a broken invariant is reported as a crash, for the fuzzer to keep it
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "Check failed: %s\n", #cond); abort(); } } while (0)
+
+
+/**
+ * Check a name decoded: it converts to text of the length told, and
+ * compares equal to that text and to itself.
+ **/
+static void check_name(const struct dns_name *name) {
+    char text[DNS_NAME_SIZE];
+
+    int length = dns_name_text(name, text);
+    CHECK(length == name->length);
+    CHECK(length < DNS_NAME_SIZE);
+
+    // labels with null bytes are cut short in text form, and one ending
+    // with a dot byte reads as a trailing dot
+    if (strlen(text) == (size_t)length && (length == 0 || text[length - 1] != '.')) {
+        CHECK(dns_name_equal(name, text));
+    }
+    CHECK(dns_name_same(name, name));
+}
+
+
+/**
+ * Check a span lies within message.
+ **/
+static void check_span(const struct dns_span *span, const uint8_t *data, size_t size) {
+    CHECK(span->data >= data && span->data + span->length <= data + size);
+}
+
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    struct dns_parser parser;
+    if (dns_parser_init(&parser, data, size) == -1) {
+        return 0;
+    }
+
+    char question_name[DNS_NAME_SIZE] = "";
+    uint16_t question_type = 0;
+
+    struct dns_question question;
+    int ret;
+    while ((ret = dns_next_question(&parser, &question)) == 1) {
+        check_name(&question.name);
+        dns_name_text(&question.name, question_name);
+        question_type = question.type;
+    }
+
+    struct dns_record record;
+    struct dns_name previous = { NULL, 0, 0, 0 };
+    while (ret != -1 && (ret = dns_next_record(&parser, &record)) == 1) {
+        check_name(&record.name);
+        check_span(&record.rdata, data, size);
+
+        if (previous.msg != NULL) {
+            CHECK(dns_name_same(&record.name, &previous) == dns_name_same(&previous, &record.name));
+        }
+        previous = record.name;
+
+        switch (record.type) {
+            case DNS_TYPE_A:
+            case DNS_TYPE_AAAA:
+                check_span(&record.data.addr, data, size);
+                CHECK(record.data.addr.length == (record.type == DNS_TYPE_A ? 4 : 16));
+                break;
+
+            case DNS_TYPE_CNAME:
+            case DNS_TYPE_NS:
+                check_name(&record.data.target);
+                break;
+
+            case DNS_TYPE_MX:
+                check_name(&record.data.mx.exchange);
+                break;
+
+            case DNS_TYPE_TXT: {
+                uint16_t offset = 0;
+                struct dns_span string;
+                int strings;
+                while ((strings = dns_next_string(&record.data.txt, &offset, &string)) == 1) {
+                    check_span(&string, record.data.txt.data, record.data.txt.length);
+                }
+                CHECK(strings == 0);
+                break;
+            }
+
+            case DNS_TYPE_SOA:
+                check_name(&record.data.soa.mname);
+                check_name(&record.data.soa.rname);
+                break;
+        }
+    }
+
+    CHECK(parser.offset <= size);
+
+    if (question_type != 0) {
+        struct dns_answer answer;
+        if (dns_parse_answer(data, size, question_name, question_type, &answer) == 0) {
+            CHECK(answer.count <= DNS_MAX_ADDRS);
+        }
+    }
+
+    return 0;
+}
+
+
+#ifndef LIBFUZZER
+
+/*
+ * Seed messages, each in a buffer of its own size.
+ */
+struct seeds {
+    unsigned char *data[MAX_SEEDS];
+    size_t length[MAX_SEEDS];
+    int count;
+};
+
+/*
+ * Reply to example.com MX, with every type decoded and names compressed
+ * in several ways, pointers to pointers as well.
+ */
+static const unsigned char every_type[] = {
+    0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00,
+    // 12: example.com MX IN
+    7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0, 0x00, 0x0f, 0x00, 0x01,
+    // 29: example.com CNAME www.example.com, rdata at 41
+    0xc0, 0x0c, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x06,
+    3, 'w', 'w', 'w', 0xc0, 0x0c,
+    // 47: www.example.com A 10.0.0.1
+    0xc0, 0x29, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x04,
+    10, 0, 0, 1,
+    // 63: www.example.com AAAA 2001:db8::1
+    0xc0, 0x29, 0x00, 0x1c, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x10,
+    0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    // 91: example.com MX 10 mx.example.com
+    0xc0, 0x0c, 0x00, 0x0f, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x07,
+    0x00, 0x0a, 2, 'm', 'x', 0xc0, 0x0c,
+    // 110: example.com TXT "hello" "world"
+    0xc0, 0x0c, 0x00, 0x10, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x0c,
+    5, 'h', 'e', 'l', 'l', 'o', 5, 'w', 'o', 'r', 'l', 'd',
+    // 134: example.com TXT, no string at all
+    0xc0, 0x0c, 0x00, 0x10, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x00,
+    // 146: example.com SOA ns.example.com root.example.com 1 7200 900 1209600 300
+    0xc0, 0x0c, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x20,
+    2, 'n', 's', 0xc0, 0x0c, 4, 'r', 'o', 'o', 't', 0xc0, 0x0c,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x1c, 0x20, 0x00, 0x00, 0x03, 0x84,
+    0x00, 0x12, 0x75, 0x00, 0x00, 0x00, 0x01, 0x2c,
+};
+
+/*
+ * Question name pointing to itself.
+ */
+static const unsigned char self_pointer[] = {
+    0x00, 0x01, 0x81, 0x80, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+};
+
+/*
+ * Answer name looping through a label back to its own pointer.
+ */
+static const unsigned char label_loop[] = {
+    0x00, 0x01, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    1, 'a', 0, 0x00, 0x01, 0x00, 0x01,
+    // 19: a, then pointer back to 19
+    1, 'a', 0xc0, 0x13, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04,
+    10, 0, 0, 1,
+};
+
+
+/**
+ * Keep a copy of a seed.
+ **/
+static int keep_seed(const unsigned char *payload, size_t length, void *arg) {
+    struct seeds *seeds = arg;
+    if (seeds->count == MAX_SEEDS || length > MAX_INPUT_SIZE) {
+        return seeds->count == MAX_SEEDS ? -1 : 0;
+    }
+
+    seeds->data[seeds->count] = malloc(length > 0 ? length : 1);
+    memcpy(seeds->data[seeds->count], payload, length);
+    seeds->length[seeds->count] = length;
+    seeds->count++;
+
+    return 0;
+}
+
+
+/**
+ * Mutate a message in place, a few times over.
+ *
+ *  Returns
+ *      Bytes of message mutated.
+ **/
+static size_t mutate(unsigned char *buffer, size_t length) {
+    int mutations = 1 + rand() % 8;
+    while (mutations-- > 0) {
+        size_t pos = length > 0 ? rand() % length : 0;
+
+        switch (rand() % 7) {
+            case 0:
+                if (length > 0) {
+                    buffer[pos] ^= 1 << rand() % 8;
+                }
+                break;
+
+            case 1:
+                if (length > 0) {
+                    buffer[pos] = rand();
+                }
+                break;
+
+            // compression pointer to anywhere, mostly within message
+            case 2:
+                if (length > 1) {
+                    pos = pos < length - 1 ? pos : length - 2;
+                    uint16_t target = rand() % 8 == 0 ? rand() & 0x3fff : rand() % length;
+                    buffer[pos] = 0xc0 | target >> 8;
+                    buffer[pos + 1] = target;
+                }
+                break;
+
+            case 3:
+                length = pos;
+                break;
+
+            // counts of a section
+            case 4:
+                if (length >= DNS_HEADER_SIZE) {
+                    int field = 4 + 2 * (rand() % 4);
+                    buffer[field] = rand() % 4 == 0 ? rand() : 0;
+                    buffer[field + 1] = rand() % 8;
+                }
+                break;
+
+            // a chunk repeated further, as records are
+            case 5:
+                if (length > 0) {
+                    size_t chunk = 1 + rand() % 32;
+                    size_t from = rand() % length;
+                    if (from + chunk > length) {
+                        chunk = length - from;
+                    }
+                    if (length + chunk <= MAX_INPUT_SIZE) {
+                        memmove(buffer + pos + chunk, buffer + pos, length - pos);
+                        memmove(buffer + pos, buffer + from + (from >= pos ? chunk : 0), chunk);
+                        length += chunk;
+                    }
+                }
+                break;
+
+            // rdlength or a label length
+            case 6:
+                if (length > 0) {
+                    buffer[pos] = rand() % 64;
+                }
+                break;
+        }
+    }
+
+    return length;
+}
+
+
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    unsigned int seed = argc > 2 ? (unsigned int)atol(argv[2]) : (unsigned int)time(NULL);
+
+    static struct seeds seeds;
+    keep_seed(every_type, sizeof(every_type), &seeds);
+    keep_seed(self_pointer, sizeof(self_pointer), &seeds);
+    keep_seed(label_loop, sizeof(label_loop), &seeds);
+
+    int i;
+    for (i = 3; i < argc; i++) {
+        if (pcap_read_udp(argv[i], DNS_PORT, keep_seed, &seeds) == -1) {
+            perror(argv[i]);
+            return -1;
+        }
+    }
+
+    // seeds as they are first, crafted one decoded as a whole, loops refused
+    for (i = 0; i < seeds.count; i++) {
+        LLVMFuzzerTestOneInput(seeds.data[i], seeds.length[i]);
+    }
+
+    struct dns_parser parser;
+    struct dns_record record;
+    int records = 0;
+    int ret;
+    dns_parser_init(&parser, every_type, sizeof(every_type));
+    while ((ret = dns_next_record(&parser, &record)) == 1) {
+        records++;
+    }
+    CHECK(ret == 0 && records == 7 && parser.offset == sizeof(every_type));
+
+    dns_parser_init(&parser, self_pointer, sizeof(self_pointer));
+    CHECK(dns_next_record(&parser, &record) == -1);
+    dns_parser_init(&parser, label_loop, sizeof(label_loop));
+    CHECK(dns_next_record(&parser, &record) == -1);
+
+    srand(seed);
+    fprintf(stderr, "%ld iterations from %d seeds, random seed %u\n", iterations, seeds.count, seed);
+
+    static unsigned char buffer[MAX_INPUT_SIZE];
+    long j;
+    for (j = 0; j < iterations; j++) {
+        int which = rand() % seeds.count;
+        memcpy(buffer, seeds.data[which], seeds.length[which]);
+        size_t length = mutate(buffer, seeds.length[which]);
+
+        // a buffer of exact size, for reads past message to be caught
+        unsigned char *input = malloc(length > 0 ? length : 1);
+        memcpy(input, buffer, length);
+        LLVMFuzzerTestOneInput(input, length);
+        free(input);
+    }
+
+    fprintf(stderr, "%ld iterations done\n", iterations);
+
+    for (i = 0; i < seeds.count; i++) {
+        free(seeds.data[i]);
+    }
+
+    return 0;
+}
+
+#endif
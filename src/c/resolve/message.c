@@ -0,0 +1,534 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:24:10
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 07:52:08
+ */
+
+#include <string.h>
+
+#include "dns.h"
+#include "message.h"
+
+// bytes of a name in wire form, lengths and root label included, at most
+#define DNS_NAME_WIRE_SIZE 255
+
+
+/**
+ * Read a 16 bits big endian integer.
+ **/
+static uint16_t read16(const unsigned char *p) {
+    return p[0] << 8 | p[1];
+}
+
+
+/**
+ * Read a 32 bits big endian integer.
+ **/
+static uint32_t read32(const unsigned char *p) {
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+
+/**
+ * Check a possibly compressed name, without copying it.
+ *
+ * A compression pointer has to point before where labels were read from
+ * last, name start or target of previous pointer. Every jump goes back
+ * so no loop is possible, however the pointers are crafted, and walking
+ * a name takes no more than a pass over the message.
+ *
+ *  Arguments
+ *      msg: whole message, for compression pointers.
+ *
+ *      size: bytes of message.
+ *
+ *      offset: where name starts.
+ *
+ *      name: for storing name checked.
+ *
+ *      end: for storing offset right after name in place.
+ *
+ *  Returns
+ *      0 if success, -1 if out of bounds, looping or too long.
+ **/
+static int check_name(const unsigned char *msg, uint16_t size, uint16_t offset, struct dns_name *name,
+        uint16_t *end) {
+    uint16_t start = offset;
+    int jumped = 0;
+    int wire = 0;
+
+    name->msg = msg;
+    name->size = size;
+    name->offset = offset;
+
+    for (;;) {
+        if (offset >= size) {
+            return -1;
+        }
+
+        unsigned char label = msg[offset];
+        if ((label & 0xc0) == 0xc0) {
+            if (offset + 1 >= size) {
+                return -1;
+            }
+
+            uint16_t target = (label & 0x3f) << 8 | msg[offset + 1];
+            if (target >= start) {
+                return -1;
+            }
+
+            if (!jumped) {
+                *end = offset + 2;
+                jumped = 1;
+            }
+            offset = start = target;
+            continue;
+        }
+
+        // 0x40 and 0x80 are extended label types, long obsolete
+        if (label & 0xc0) {
+            return -1;
+        }
+
+        wire += 1 + label;
+        if (wire > DNS_NAME_WIRE_SIZE) {
+            return -1;
+        }
+
+        if (label == 0) {
+            break;
+        }
+
+        if (offset + 1 + label > size) {
+            return -1;
+        }
+        offset += 1 + label;
+    }
+
+    if (!jumped) {
+        *end = offset + 1;
+    }
+
+    // a dot instead of every length byte but the first, no root label
+    name->length = wire > 1 ? wire - 2 : 0;
+
+    return 0;
+}
+
+
+/**
+ * Move to next label of a name checked already, following pointers.
+ *
+ *  Returns
+ *      Pointer to length byte of label, NULL at root label.
+ **/
+static const unsigned char *next_label(const struct dns_name *name, uint16_t *offset) {
+    while ((name->msg[*offset] & 0xc0) == 0xc0) {
+        *offset = (name->msg[*offset] & 0x3f) << 8 | name->msg[*offset + 1];
+    }
+
+    const unsigned char *label = name->msg + *offset;
+    if (*label == 0) {
+        return NULL;
+    }
+
+    *offset += 1 + *label;
+
+    return label;
+}
+
+
+/**
+ * Compare bytes ignoring ascii case, as names are compared. Unlike
+ * strncasecmp, null bytes inside labels are compared as well.
+ **/
+static int same_bytes(const unsigned char *a, const unsigned char *b, size_t n) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        unsigned char x = a[i] >= 'A' && a[i] <= 'Z' ? a[i] | 0x20 : a[i];
+        unsigned char y = b[i] >= 'A' && b[i] <= 'Z' ? b[i] | 0x20 : b[i];
+        if (x != y) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * Start parsing a message, decoding its header.
+ *
+ *  Arguments
+ *      parser: parser to init.
+ *
+ *      msg: message, which has to outlive every span and name decoded.
+ *
+ *      size: bytes of message.
+ *
+ *  Returns
+ *      0 if success, -1 if too short or too long for a message.
+ **/
+int dns_parser_init(struct dns_parser *parser, const unsigned char *msg, size_t size) {
+    if (size < DNS_HEADER_SIZE || size > UINT16_MAX) {
+        return -1;
+    }
+
+    parser->msg = msg;
+    parser->size = size;
+    parser->offset = DNS_HEADER_SIZE;
+
+    parser->header.id = read16(msg);
+    parser->header.flags = read16(msg + 2);
+    parser->header.qdcount = read16(msg + 4);
+    parser->header.ancount = read16(msg + 6);
+    parser->header.nscount = read16(msg + 8);
+    parser->header.arcount = read16(msg + 10);
+
+    parser->section = DNS_SECTION_QUESTION;
+    parser->remaining = parser->header.qdcount;
+
+    return 0;
+}
+
+
+/**
+ * Decode next question.
+ *
+ *  Returns
+ *      1 if decoded, 0 if no question is left, -1 if malformed.
+ **/
+int dns_next_question(struct dns_parser *parser, struct dns_question *question) {
+    if (parser->section != DNS_SECTION_QUESTION || parser->remaining == 0) {
+        return 0;
+    }
+
+    uint16_t end;
+    if (check_name(parser->msg, parser->size, parser->offset, &question->name, &end) == -1
+            || end + 4 > parser->size) {
+        return -1;
+    }
+
+    question->type = read16(parser->msg + end);
+    question->class = read16(parser->msg + end + 2);
+
+    parser->offset = end + 4;
+    parser->remaining--;
+
+    return 1;
+}
+
+
+/**
+ * Check character strings of a TXT record fill rdata exactly.
+ **/
+static int check_strings(const struct dns_span *txt) {
+    uint16_t offset = 0;
+    struct dns_span string;
+
+    int ret;
+    while ((ret = dns_next_string(txt, &offset, &string)) == 1) {
+    }
+
+    return ret;
+}
+
+
+/**
+ * Decode rdata of known types, checking it fits rdlength exactly.
+ *
+ *  Returns
+ *      0 if success, -1 if malformed.
+ **/
+static int decode_rdata(const struct dns_parser *parser, struct dns_record *record) {
+    const unsigned char *msg = parser->msg;
+    uint16_t start = record->rdata.data - msg;
+    uint16_t stop = start + record->rdata.length;
+    uint16_t end;
+
+    switch (record->type) {
+        case DNS_TYPE_A:
+        case DNS_TYPE_AAAA:
+            if (record->rdata.length != (record->type == DNS_TYPE_A ? 4 : 16)) {
+                return -1;
+            }
+            record->data.addr = record->rdata;
+            return 0;
+
+        case DNS_TYPE_CNAME:
+        case DNS_TYPE_NS:
+            // names in rdata may point anywhere before, but end within it
+            if (check_name(msg, parser->size, start, &record->data.target, &end) == -1 || end != stop) {
+                return -1;
+            }
+            return 0;
+
+        case DNS_TYPE_MX:
+            if (record->rdata.length < 3) {
+                return -1;
+            }
+            record->data.mx.preference = read16(msg + start);
+            if (check_name(msg, parser->size, start + 2, &record->data.mx.exchange, &end) == -1 || end != stop) {
+                return -1;
+            }
+            return 0;
+
+        case DNS_TYPE_TXT:
+            record->data.txt = record->rdata;
+            return check_strings(&record->data.txt);
+
+        case DNS_TYPE_SOA:
+            if (check_name(msg, parser->size, start, &record->data.soa.mname, &end) == -1
+                    || check_name(msg, parser->size, end, &record->data.soa.rname, &end) == -1
+                    || end + 20 != stop) {
+                return -1;
+            }
+            record->data.soa.serial = read32(msg + end);
+            record->data.soa.refresh = read32(msg + end + 4);
+            record->data.soa.retry = read32(msg + end + 8);
+            record->data.soa.expire = read32(msg + end + 12);
+            record->data.soa.minimum = read32(msg + end + 16);
+            return 0;
+    }
+
+    // other types are left as rdata
+    return 0;
+}
+
+
+/**
+ * Decode next resource record, of answer, authority then additional
+ * section. Questions not decoded yet are skipped.
+ *
+ *  Returns
+ *      1 if decoded, 0 if no record is left, -1 if malformed.
+ **/
+int dns_next_record(struct dns_parser *parser, struct dns_record *record) {
+    if (parser->section == DNS_SECTION_QUESTION) {
+        struct dns_question question;
+
+        int ret;
+        while ((ret = dns_next_question(parser, &question)) == 1) {
+        }
+        if (ret == -1) {
+            return -1;
+        }
+    }
+
+    while (parser->remaining == 0) {
+        switch (parser->section) {
+            case DNS_SECTION_QUESTION:
+                parser->section = DNS_SECTION_ANSWER;
+                parser->remaining = parser->header.ancount;
+                break;
+
+            case DNS_SECTION_ANSWER:
+                parser->section = DNS_SECTION_AUTHORITY;
+                parser->remaining = parser->header.nscount;
+                break;
+
+            case DNS_SECTION_AUTHORITY:
+                parser->section = DNS_SECTION_ADDITIONAL;
+                parser->remaining = parser->header.arcount;
+                break;
+
+            case DNS_SECTION_ADDITIONAL:
+                return 0;
+        }
+    }
+
+    uint16_t end;
+    if (check_name(parser->msg, parser->size, parser->offset, &record->name, &end) == -1
+            || end + 10 > parser->size) {
+        return -1;
+    }
+
+    const unsigned char *p = parser->msg + end;
+    record->section = parser->section;
+    record->type = read16(p);
+    record->class = read16(p + 2);
+    record->ttl = read32(p + 4);
+    record->rdata.length = read16(p + 8);
+    record->rdata.data = p + 10;
+
+    if (end + 10 + record->rdata.length > parser->size || decode_rdata(parser, record) == -1) {
+        return -1;
+    }
+
+    parser->offset = end + 10 + record->rdata.length;
+    parser->remaining--;
+
+    return 1;
+}
+
+
+/**
+ * Decode next character string of a TXT record.
+ *
+ *  Arguments
+ *      txt: rdata of record.
+ *
+ *      offset: where string starts in rdata, 0 for the first one, moved
+ *          to next one.
+ *
+ *      string: for storing string, without its length byte.
+ *
+ *  Returns
+ *      1 if decoded, 0 if no string is left, -1 if malformed.
+ **/
+int dns_next_string(const struct dns_span *txt, uint16_t *offset, struct dns_span *string) {
+    if (*offset >= txt->length) {
+        return 0;
+    }
+
+    uint16_t length = txt->data[*offset];
+    if (*offset + 1 + length > txt->length) {
+        return -1;
+    }
+
+    string->data = txt->data + *offset + 1;
+    string->length = length;
+    *offset += 1 + length;
+
+    return 1;
+}
+
+
+/**
+ * Write a name in text form, without trailing dot, the only copy made.
+ *
+ *  Arguments
+ *      name: name decoded.
+ *
+ *      out: for storing name, DNS_NAME_SIZE bytes at least.
+ *
+ *  Returns
+ *      Bytes of name, `\0` excluded.
+ **/
+int dns_name_text(const struct dns_name *name, char *out) {
+    uint16_t offset = name->offset;
+    int written = 0;
+
+    const unsigned char *label;
+    while ((label = next_label(name, &offset)) != NULL) {
+        if (written > 0) {
+            out[written++] = '.';
+        }
+        memcpy(out + written, label + 1, *label);
+        written += *label;
+    }
+    out[written] = '\0';
+
+    return written;
+}
+
+
+/**
+ * Write a name in wire form, uncompressed, as it is in message.
+ *
+ *  Arguments
+ *      name: name decoded.
+ *
+ *      out: for storing name, 255 bytes at least.
+ *
+ *  Returns
+ *      Bytes of name, root label included.
+ **/
+int dns_name_wire(const struct dns_name *name, unsigned char *out) {
+    uint16_t offset = name->offset;
+    int written = 0;
+
+    const unsigned char *label;
+    while ((label = next_label(name, &offset)) != NULL) {
+        memcpy(out + written, label, 1 + *label);
+        written += 1 + *label;
+    }
+    out[written++] = 0;
+
+    return written;
+}
+
+
+/**
+ * Compare a name with one in text form, ignoring case and a trailing dot.
+ **/
+int dns_name_equal(const struct dns_name *name, const char *text) {
+    size_t length = strlen(text);
+    if (length > 0 && text[length - 1] == '.') {
+        length--;
+    }
+
+    if (length != name->length) {
+        return 0;
+    }
+
+    uint16_t offset = name->offset;
+    size_t pos = 0;
+
+    const unsigned char *label;
+    while ((label = next_label(name, &offset)) != NULL) {
+        if (pos > 0) {
+            if (text[pos] != '.') {
+                return 0;
+            }
+            pos++;
+        }
+
+        if (!same_bytes(label + 1, (const unsigned char *)text + pos, *label)) {
+            return 0;
+        }
+        pos += *label;
+    }
+
+    return 1;
+}
+
+
+/**
+ * Compare names ignoring case, label by label, wherever they are.
+ **/
+int dns_name_same(const struct dns_name *a, const struct dns_name *b) {
+    if (a->msg == b->msg && a->offset == b->offset) {
+        return 1;
+    }
+
+    if (a->length != b->length) {
+        return 0;
+    }
+
+    uint16_t offset_a = a->offset, offset_b = b->offset;
+    for (;;) {
+        const unsigned char *label_a = next_label(a, &offset_a);
+        const unsigned char *label_b = next_label(b, &offset_b);
+        if (label_a == NULL || label_b == NULL) {
+            return label_a == label_b;
+        }
+
+        // compressed the same way from here on, suffixes are the same
+        if (a->msg == b->msg && label_a == label_b) {
+            return 1;
+        }
+
+        if (*label_a != *label_b || !same_bytes(label_a + 1, label_b + 1, *label_a)) {
+            return 0;
+        }
+    }
+}
+
+
+/**
+ * Tell whether a name is zone itself or below it, ignoring case.
+ **/
+int dns_name_within(const struct dns_name *name, const struct dns_name *zone) {
+    struct dns_name suffix = *name;
+    while (suffix.length > zone->length) {
+        const unsigned char *label = next_label(&suffix, &suffix.offset);
+        if (label == NULL) {
+            return 0;
+        }
+        suffix.length = suffix.length > *label ? suffix.length - *label - 1 : 0;
+    }
+
+    return dns_name_same(&suffix, zone);
+}
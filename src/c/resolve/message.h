@@ -0,0 +1,124 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:24:10
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 07:52:08
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bytes in place, pointing into the message.
+ */
+struct dns_span {
+    const unsigned char *data;
+    uint16_t length;
+};
+
+/*
+ * A name in place, possibly compressed, checked as it is decoded.
+ */
+struct dns_name {
+    // whole message, for following compression pointers
+    const unsigned char *msg;
+    uint16_t size;
+
+    // where name starts
+    uint16_t offset;
+
+    // bytes of name in text form, without trailing dot
+    uint16_t length;
+};
+
+struct dns_header {
+    uint16_t id;
+    uint16_t flags;
+    uint16_t qdcount;
+    uint16_t ancount;
+    uint16_t nscount;
+    uint16_t arcount;
+};
+
+struct dns_question {
+    struct dns_name name;
+    uint16_t type;
+    uint16_t class;
+};
+
+/*
+ * Sections records come from.
+ */
+enum dns_section {
+    DNS_SECTION_QUESTION,
+    DNS_SECTION_ANSWER,
+    DNS_SECTION_AUTHORITY,
+    DNS_SECTION_ADDITIONAL,
+};
+
+/*
+ * A resource record, rdata decoded for the types known.
+ */
+struct dns_record {
+    enum dns_section section;
+
+    struct dns_name name;
+    uint16_t type;
+    uint16_t class;
+    uint32_t ttl;
+
+    // rdata as is, for every type
+    struct dns_span rdata;
+
+    union {
+        // A and AAAA, 4 and 16 bytes
+        struct dns_span addr;
+
+        // CNAME and NS
+        struct dns_name target;
+
+        struct {
+            uint16_t preference;
+            struct dns_name exchange;
+        } mx;
+
+        // character strings, see dns_next_string
+        struct dns_span txt;
+
+        struct {
+            struct dns_name mname;
+            struct dns_name rname;
+            uint32_t serial;
+            uint32_t refresh;
+            uint32_t retry;
+            uint32_t expire;
+            uint32_t minimum;
+        } soa;
+    } data;
+};
+
+/*
+ * Cursor walking a message section by section, nothing is allocated
+ * and nothing copied.
+ */
+struct dns_parser {
+    const unsigned char *msg;
+    uint16_t size;
+    uint16_t offset;
+
+    struct dns_header header;
+
+    // section of next record, and records left in it
+    enum dns_section section;
+    uint16_t remaining;
+};
+
+int dns_parser_init(struct dns_parser *parser, const unsigned char *msg, size_t size);
+int dns_next_question(struct dns_parser *parser, struct dns_question *question);
+int dns_next_record(struct dns_parser *parser, struct dns_record *record);
+int dns_next_string(const struct dns_span *txt, uint16_t *offset, struct dns_span *string);
+int dns_name_text(const struct dns_name *name, char *out);
+int dns_name_wire(const struct dns_name *name, unsigned char *out);
+int dns_name_equal(const struct dns_name *name, const char *text);
+int dns_name_same(const struct dns_name *a, const struct dns_name *b);
+int dns_name_within(const struct dns_name *name, const struct dns_name *zone);
@@ -0,0 +1,209 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:24:10
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 06:24:10
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pcap.h"
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+
+// bytes of a frame at most
+#define PCAP_MAX_SNAPLEN 262144
+
+// link types of captures taken by tcpdump
+#define LINKTYPE_ETHERNET 1
+#define LINKTYPE_RAW 101
+#define LINKTYPE_LINUX_SLL 113
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERTYPE_IPV6 0x86dd
+
+#define PROTO_UDP 17
+
+
+/**
+ * Read a 16 bits big endian integer.
+ **/
+static uint16_t read16(const unsigned char *p) {
+    return p[0] << 8 | p[1];
+}
+
+
+/**
+ * Read a 32 bits integer of file byte order.
+ **/
+static uint32_t read32(const unsigned char *p, int big_endian) {
+    if (big_endian) {
+        return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+    }
+
+    return (uint32_t)p[3] << 24 | p[2] << 16 | p[1] << 8 | p[0];
+}
+
+
+/**
+ * Find udp payload of an ip packet, fragments left alone.
+ *
+ *  Returns
+ *      Bytes of payload if udp from or to port, -1 otherwise.
+ **/
+static int udp_payload(const unsigned char *packet, size_t length, uint16_t port, const unsigned char **payload) {
+    size_t header;
+    if (length >= 20 && packet[0] >> 4 == 4) {
+        header = (packet[0] & 0xf) * 4;
+        if (header < 20 || packet[9] != PROTO_UDP || (read16(packet + 6) & 0x3fff) != 0) {
+            return -1;
+        }
+    } else if (length >= 40 && packet[0] >> 4 == 6) {
+        // extension headers are not walked
+        header = 40;
+        if (packet[6] != PROTO_UDP) {
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+
+    if (header + 8 > length) {
+        return -1;
+    }
+
+    const unsigned char *udp = packet + header;
+    if (read16(udp) != port && read16(udp + 2) != port) {
+        return -1;
+    }
+
+    size_t udp_length = read16(udp + 4);
+    if (udp_length < 8 || header + udp_length > length) {
+        return -1;
+    }
+
+    *payload = udp + 8;
+
+    return udp_length - 8;
+}
+
+
+/**
+ * Call handler for every udp payload from or to port of a capture, of
+ * ethernet, linux cooked or raw ip link type.
+ *
+ *  Arguments
+ *      path: capture file, pcap format.
+ *
+ *      port: udp port.
+ *
+ *      handler: handler of payloads, which are valid during the call only.
+ *
+ *      arg: passed to handler.
+ *
+ *  Returns
+ *      Payloads handled if success, -1 if error.
+ **/
+int pcap_read_udp(const char *path, uint16_t port, pcap_udp_handler handler, void *arg) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    unsigned char header[24];
+    if (fread(header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // written in byte order of capturing host
+    int big_endian;
+    if (read32(header, 0) == PCAP_MAGIC || read32(header, 0) == PCAP_MAGIC_NSEC) {
+        big_endian = 0;
+    } else if (read32(header, 1) == PCAP_MAGIC || read32(header, 1) == PCAP_MAGIC_NSEC) {
+        big_endian = 1;
+    } else {
+        fclose(file);
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint32_t snaplen = read32(header + 16, big_endian);
+    uint32_t linktype = read32(header + 20, big_endian);
+    if (linktype != LINKTYPE_ETHERNET && linktype != LINKTYPE_RAW && linktype != LINKTYPE_LINUX_SLL) {
+        fclose(file);
+        errno = EPROTONOSUPPORT;
+        return -1;
+    }
+
+    // some writers put 0 or bogus values as snaplen
+    uint32_t capacity = snaplen > 0 && snaplen < PCAP_MAX_SNAPLEN ? snaplen : PCAP_MAX_SNAPLEN;
+    unsigned char *frame = malloc(capacity);
+    if (frame == NULL) {
+        fclose(file);
+        return -1;
+    }
+
+    int handled = 0;
+    unsigned char record[16];
+    while (fread(record, sizeof(record), 1, file) == 1) {
+        uint32_t caplen = read32(record + 8, big_endian);
+        if (caplen > capacity || fread(frame, 1, caplen, file) != caplen) {
+            handled = -1;
+            errno = EINVAL;
+            break;
+        }
+
+        // link header, then ethertype of what follows
+        const unsigned char *packet = frame;
+        size_t length = caplen;
+        uint16_t ethertype = ETHERTYPE_IPV4;
+
+        if (linktype == LINKTYPE_ETHERNET) {
+            if (length < 14) {
+                continue;
+            }
+            ethertype = read16(packet + 12);
+            packet += 14;
+            length -= 14;
+
+            if (ethertype == ETHERTYPE_VLAN && length >= 4) {
+                ethertype = read16(packet + 2);
+                packet += 4;
+                length -= 4;
+            }
+        } else if (linktype == LINKTYPE_LINUX_SLL) {
+            if (length < 16) {
+                continue;
+            }
+            ethertype = read16(packet + 14);
+            packet += 16;
+            length -= 16;
+        }
+
+        if (ethertype != ETHERTYPE_IPV4 && ethertype != ETHERTYPE_IPV6) {
+            continue;
+        }
+
+        const unsigned char *payload;
+        int payload_length = udp_payload(packet, length, port, &payload);
+        if (payload_length == -1) {
+            continue;
+        }
+
+        handled++;
+        if (handler(payload, payload_length, arg) == -1) {
+            break;
+        }
+    }
+
+    free(frame);
+    fclose(file);
+
+    return handled;
+}
@@ -0,0 +1,19 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:24:10
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 06:24:10
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Handler called for every udp payload of a capture.
+ *
+ *  Returns
+ *      0 to go on, -1 to stop.
+ **/
+typedef int (*pcap_udp_handler)(const unsigned char *payload, size_t length, void *arg);
+
+int pcap_read_udp(const char *path, uint16_t port, pcap_udp_handler handler, void *arg);
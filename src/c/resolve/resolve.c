@@ -2,48 +2,61 @@
  * Author: fasion
  * Created time: 2021-04-19 10:42:59
  * Last Modified by: fasion
- * Last Modified time: 2021-04-19 13:10:07
+ * Last Modified time: 2026-10-20 10:55:37
  */
 
-#include <arpa/inet.h>
-#include <netdb.h>
 #include <stdio.h>
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "bad arguments");
+#include "argparse.h"
+#include "batch.h"
+#include "cache.h"
+
+/**
+ * Print statistics of cache shared by processes.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int print_cache_stats(const char *path) {
+    if (path == NULL) {
+        fprintf(stderr, "No cache given\n");
         return -1;
     }
 
-    char *name = argv[1];
-    printf("resolve domain name: %s\n", name);
+    struct dns_cache cache;
+    if (cache_open(&cache, path) == -1) {
+        perror("Fail to open cache");
+        return -1;
+    }
 
-    struct hostent *result = gethostbyname(name);
-    if (result == NULL) {
-        if (h_errno == HOST_NOT_FOUND) {
-            fprintf(stderr, "Hostname not found!\n");
-        }
+    struct cache_stats stats;
+    int capacity, used;
+    cache_read_stats(&cache, &stats, &capacity, &used);
+    cache_close(&cache);
 
-        if (h_errno == NO_DATA) {
-            fprintf(stderr, "No such record\n");
-        }
+    uint64_t lookups = stats.hits + stats.negative_hits + stats.misses;
+    printf("cache: %s\n", path);
+    printf("entries: %d live of %d slots\n", used, capacity);
+    printf("lookups: %lu, hits: %lu, negative hits: %lu, misses: %lu, hit ratio: %.1f%%\n", lookups,
+        stats.hits, stats.negative_hits, stats.misses,
+        lookups == 0 ? 0 : (stats.hits + stats.negative_hits) * 100.0 / lookups);
+    printf("inserts: %lu, evictions: %lu, contended: %lu\n", stats.inserts, stats.evictions, stats.contended);
 
-        if (h_errno == NO_RECOVERY) {
-            fprintf(stderr, "\n");
-        }
+    return 0;
+}
 
-        if (h_errno == TRY_AGAIN) {
-            fprintf(stderr, "Temporary error occurred, please try again!\n");
-        }
 
+int main(int argc, char *argv[]) {
+    const struct cmdline_arguments *arguments = parse_arguments(argc, argv);
+    if (arguments == NULL) {
+        fprintf(stderr, "bad arguments");
         return -1;
     }
 
-    int i = 0;
-    while (result->h_addr_list[i] != NULL) {
-        printf("IP: %s\n", inet_ntoa(*(struct in_addr *)result->h_addr_list[i]));
-        i++;
+    if (arguments->cache_stats) {
+        return print_cache_stats(arguments->cache);
     }
 
-    return 0;
+    // a name or many, asked for by our own queries, through cache
+    return resolve_batch(arguments);
 }
@@ -0,0 +1,460 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:47:33
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:49:26
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "dns.h"
+#include "message.h"
+#include "zone.h"
+
+// queries taken and replies sent per syscall at most
+#define BATCH_SIZE 64
+
+// udp payload of replies to queries without EDNS0
+#define DNS_UDP_SIZE 512
+
+// bytes of opt record of replies
+#define OPT_RECORD_SIZE 11
+
+// receive buffer of a socket, for bursts of queries
+#define SOCKET_BUFFER_SIZE (4 << 20)
+
+/*
+ * Worker answering queries of its own socket, of a SO_REUSEPORT group.
+ */
+struct worker {
+    pthread_t thread;
+    int sock;
+
+    // buffers of a batch
+    unsigned char (*queries)[DNS_MESSAGE_SIZE];
+    unsigned char (*replies)[DNS_MESSAGE_SIZE];
+
+    // progress, read by main thread while running
+    long queries_taken;
+    long rcodes[DNS_RCODE_REFUSED + 1];
+    long truncated;
+    long dropped;
+
+    int error;
+};
+
+static struct zone zone;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_interrupt(int signum) {
+    interrupted = 1;
+}
+
+
+/**
+ * Fetch monotonic time in seconds.
+ **/
+static double get_timestamp() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/**
+ * Write a 16 bits big endian integer.
+ **/
+static void write16(unsigned char *p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value;
+}
+
+
+/**
+ * Answer a query: header and question copied as they are, then records
+ * precomputed for name and type.
+ *
+ *  Arguments
+ *      worker: worker, for counting.
+ *
+ *      query: query received.
+ *
+ *      length: bytes of query.
+ *
+ *      reply: for storing reply, DNS_MESSAGE_SIZE bytes.
+ *
+ *  Returns
+ *      Bytes of reply, -1 if query is not to be answered at all.
+ **/
+static int answer_query(struct worker *worker, const unsigned char *query, size_t length, unsigned char *reply) {
+    struct dns_parser parser;
+
+    // replies are never answered, no loop between servers is possible
+    if (dns_parser_init(&parser, query, length) == -1 || parser.header.flags & DNS_FLAG_QR) {
+        return -1;
+    }
+
+    uint16_t flags = DNS_FLAG_QR | DNS_FLAG_AA | (parser.header.flags & (DNS_OPCODE_MASK | DNS_FLAG_RD));
+    uint16_t rcode = DNS_RCODE_NOERROR;
+
+    // question name is uncompressed, as owners of records point to it
+    struct dns_question question;
+    unsigned char key[256];
+    int key_length = 0;
+    if (parser.header.flags & DNS_OPCODE_MASK) {
+        rcode = DNS_RCODE_NOTIMP;
+    } else if (parser.header.qdcount != 1 || dns_next_question(&parser, &question) != 1
+            || (key_length = dns_name_wire(&question.name, key)) != parser.offset - 4 - DNS_HEADER_SIZE) {
+        rcode = DNS_RCODE_FORMERR;
+    } else if (question.class != DNS_CLASS_IN) {
+        rcode = DNS_RCODE_REFUSED;
+    }
+    size_t question_end = parser.offset;
+
+    // udp payload of reply, as EDNS0 of query says
+    size_t limit = DNS_UDP_SIZE;
+    int edns = 0;
+    if (rcode == DNS_RCODE_NOERROR && parser.header.arcount > 0) {
+        struct dns_record record;
+        int ret;
+        while ((ret = dns_next_record(&parser, &record)) == 1) {
+            if (record.section == DNS_SECTION_ADDITIONAL && record.type == DNS_TYPE_OPT) {
+                edns = 1;
+                limit = record.class > limit ? record.class : limit;
+                limit = limit < DNS_MESSAGE_SIZE ? limit : DNS_MESSAGE_SIZE;
+                break;
+            }
+        }
+
+        if (ret == -1) {
+            rcode = DNS_RCODE_FORMERR;
+        }
+    }
+
+    // header alone, for queries not understood
+    if (rcode != DNS_RCODE_NOERROR) {
+        memcpy(reply, query, DNS_HEADER_SIZE);
+        write16(reply + 2, flags | rcode);
+        bzero(reply + 4, 8);
+        worker->rcodes[rcode]++;
+        return DNS_HEADER_SIZE;
+    }
+
+    int i;
+    for (i = 0; i < key_length; i++) {
+        key[i] = key[i] >= 'A' && key[i] <= 'Z' ? key[i] | 0x20 : key[i];
+    }
+
+    memcpy(reply, query, question_end);
+    unsigned char *p = reply + question_end;
+    uint16_t ancount = 0, nscount = 0;
+
+    const struct zone_name *name = zone_find(&zone, key, key_length);
+    if (name != NULL) {
+        const struct zone_answer *answer = zone_answer(&zone, name, question.type);
+        if (question_end + answer->length + edns * OPT_RECORD_SIZE <= limit) {
+            memcpy(p, zone.blob + answer->offset, answer->length);
+            p += answer->length;
+            ancount = answer->ancount;
+            nscount = answer->nscount;
+            rcode = answer->rcode;
+        } else {
+            flags |= DNS_FLAG_TC;
+            worker->truncated++;
+        }
+    } else {
+        // soa of negative answer is owned by apex, within question name
+        int apex = zone_apex_offset(&zone, key, key_length);
+        if (apex == -1) {
+            rcode = DNS_RCODE_REFUSED;
+            flags &= ~DNS_FLAG_AA;
+        } else {
+            rcode = DNS_RCODE_NXDOMAIN;
+            if (question_end + 2 + zone.soa_length + edns * OPT_RECORD_SIZE <= limit) {
+                *p++ = 0xc0 | (DNS_HEADER_SIZE + apex) >> 8;
+                *p++ = (DNS_HEADER_SIZE + apex) & 0xff;
+                memcpy(p, zone.soa, zone.soa_length);
+                p += zone.soa_length;
+                nscount = 1;
+            } else {
+                flags |= DNS_FLAG_TC;
+                worker->truncated++;
+            }
+        }
+    }
+
+    // opt record: root name, type, udp payload size as class, no flags
+    if (edns) {
+        static const unsigned char opt[OPT_RECORD_SIZE] = {
+            0, 0, DNS_TYPE_OPT, DNS_MESSAGE_SIZE >> 8, DNS_MESSAGE_SIZE & 0xff, 0, 0, 0, 0, 0, 0,
+        };
+        memcpy(p, opt, sizeof(opt));
+        p += sizeof(opt);
+    }
+
+    write16(reply + 2, flags | rcode);
+    write16(reply + 4, 1);
+    write16(reply + 6, ancount);
+    write16(reply + 8, nscount);
+    write16(reply + 10, edns);
+
+    worker->rcodes[rcode]++;
+
+    return p - reply;
+}
+
+
+/**
+ * Worker routine: take a batch of queries, answer them all, send the
+ * replies as a batch, until interrupted.
+ **/
+static void *run_worker(void *arg) {
+    struct worker *worker = arg;
+
+    struct mmsghdr queries[BATCH_SIZE];
+    struct mmsghdr replies[BATCH_SIZE];
+    struct iovec query_iovs[BATCH_SIZE];
+    struct iovec reply_iovs[BATCH_SIZE];
+    struct sockaddr_in peers[BATCH_SIZE];
+
+    bzero(queries, sizeof(queries));
+    bzero(replies, sizeof(replies));
+
+    int i;
+    for (i = 0; i < BATCH_SIZE; i++) {
+        query_iovs[i].iov_base = worker->queries[i];
+        query_iovs[i].iov_len = DNS_MESSAGE_SIZE;
+        queries[i].msg_hdr.msg_iov = &query_iovs[i];
+        queries[i].msg_hdr.msg_iovlen = 1;
+        queries[i].msg_hdr.msg_name = &peers[i];
+    }
+
+    while (!interrupted) {
+        for (i = 0; i < BATCH_SIZE; i++) {
+            queries[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+        }
+
+        // blocks for the first one only, and for a while, to check interrupted
+        int n = recvmmsg(worker->sock, queries, BATCH_SIZE, MSG_WAITFORONE, NULL);
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            worker->error = errno;
+            break;
+        }
+
+        int m = 0;
+        for (i = 0; i < n; i++) {
+            int length = answer_query(worker, worker->queries[i], queries[i].msg_len, worker->replies[m]);
+            if (length == -1) {
+                worker->dropped++;
+                continue;
+            }
+
+            reply_iovs[m].iov_base = worker->replies[m];
+            reply_iovs[m].iov_len = length;
+            replies[m].msg_hdr.msg_iov = &reply_iovs[m];
+            replies[m].msg_hdr.msg_iovlen = 1;
+            replies[m].msg_hdr.msg_name = &peers[i];
+            replies[m].msg_hdr.msg_namelen = queries[i].msg_hdr.msg_namelen;
+            m++;
+        }
+        worker->queries_taken += n;
+
+        int sent = 0;
+        while (sent < m) {
+            int ret = sendmmsg(worker->sock, replies + sent, m - sent, 0);
+            if (ret == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                // a reply not sent is a query lost, as on a real network
+                worker->dropped += m - sent;
+                break;
+            }
+            sent += ret;
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Open socket of a worker, joined to SO_REUSEPORT group of address.
+ *
+ *  Returns
+ *      Socket if success, -1 if error.
+ **/
+static int open_socket(const struct sockaddr_in *addr) {
+    int s = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (s == -1) {
+        return -1;
+    }
+
+    int on = 1;
+    int size = SOCKET_BUFFER_SIZE;
+    struct timeval timeout = { 0, 100000 };
+    if (setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1
+            || setsockopt(s, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) == -1
+            || setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == -1
+            || bind(s, (const struct sockaddr *)addr, sizeof(*addr)) == -1) {
+        close(s);
+        return -1;
+    }
+
+    return s;
+}
+
+
+/**
+ * Sum progress of all workers.
+ **/
+static void collect_progress(const struct worker *workers, int n, long *queries, long *rcodes) {
+    *queries = 0;
+    bzero(rcodes, sizeof(workers->rcodes));
+
+    int i, j;
+    for (i = 0; i < n; i++) {
+        *queries += workers[i].queries_taken;
+        for (j = 0; j <= DNS_RCODE_REFUSED; j++) {
+            rcodes[j] += workers[i].rcodes[j];
+        }
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    const struct responder_arguments *arguments = parse_responder_arguments(argc, argv);
+    if (arguments == NULL) {
+        fprintf(stderr, "Bad command line options given\n");
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    if (dns_parse_server(arguments->listen, &addr) == -1) {
+        fprintf(stderr, "Bad listen address: %s\n", arguments->listen);
+        return -1;
+    }
+
+    double start = get_timestamp();
+    if (zone_load(&zone, arguments->zone) == -1) {
+        return -1;
+    }
+
+    printf("Zone %s loaded in %.3fs: %u names, %u answers, %zu bytes of records, %u slots\n",
+        arguments->zone, get_timestamp() - start, zone.count, zone.nanswers, zone.blob_size, zone.nslots);
+
+    int n = arguments->workers;
+    struct worker *workers = calloc(n, sizeof(*workers));
+    if (workers == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+
+    // every socket bound before any worker starts, so kernel spreads all
+    int i;
+    for (i = 0; i < n; i++) {
+        workers[i].sock = open_socket(&addr);
+        if (workers[i].sock == -1) {
+            perror("Fail to open socket");
+            return -1;
+        }
+
+        workers[i].queries = malloc(BATCH_SIZE * sizeof(*workers[i].queries));
+        workers[i].replies = malloc(BATCH_SIZE * sizeof(*workers[i].replies));
+        if (workers[i].queries == NULL || workers[i].replies == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return -1;
+        }
+    }
+
+    signal(SIGINT, handle_interrupt);
+    signal(SIGTERM, handle_interrupt);
+
+    for (i = 0; i < n; i++) {
+        if (pthread_create(&workers[i].thread, NULL, run_worker, &workers[i]) != 0) {
+            fprintf(stderr, "Fail to create thread\n");
+            interrupted = 1;
+            n = i;
+            break;
+        }
+    }
+
+    printf("Answering at %s with %d workers\n", arguments->listen, n);
+    fflush(stdout);
+
+    start = get_timestamp();
+    double last_ts = start;
+    long last_queries = 0;
+
+    // report every second until interrupted
+    while (!interrupted) {
+        struct timespec ts = { 0, 100000000 };
+        nanosleep(&ts, NULL);
+
+        double now = get_timestamp();
+        if (now - last_ts < 1) {
+            continue;
+        }
+
+        long queries;
+        long rcodes[DNS_RCODE_REFUSED + 1];
+        collect_progress(workers, n, &queries, rcodes);
+
+        if (!arguments->quiet && queries != last_queries) {
+            printf("[%7.1fs] %10.0f qps\n", now - start, (queries - last_queries) / (now - last_ts));
+            fflush(stdout);
+        }
+
+        last_ts = now;
+        last_queries = queries;
+    }
+
+    int ret = 0;
+    for (i = 0; i < n; i++) {
+        pthread_join(workers[i].thread, NULL);
+        if (workers[i].error != 0) {
+            fprintf(stderr, "Worker %d failed: %s\n", i, strerror(workers[i].error));
+            ret = -1;
+        }
+    }
+
+    long queries;
+    long rcodes[DNS_RCODE_REFUSED + 1];
+    collect_progress(workers, n, &queries, rcodes);
+
+    long truncated = 0, dropped = 0;
+    for (i = 0; i < n; i++) {
+        truncated += workers[i].truncated;
+        dropped += workers[i].dropped;
+        close(workers[i].sock);
+        free(workers[i].queries);
+        free(workers[i].replies);
+    }
+
+    printf("--- %ld queries in %.3fs: %ld answered, %ld nxdomain, %ld refused, %ld formerr, %ld notimp, "
+        "%ld truncated, %ld dropped ---\n", queries, get_timestamp() - start, rcodes[DNS_RCODE_NOERROR],
+        rcodes[DNS_RCODE_NXDOMAIN], rcodes[DNS_RCODE_REFUSED], rcodes[DNS_RCODE_FORMERR],
+        rcodes[DNS_RCODE_NOTIMP], truncated, dropped);
+
+    free(workers);
+    zone_free(&zone);
+
+    return ret;
+}
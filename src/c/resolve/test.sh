@@ -0,0 +1,205 @@
+#!/bin/sh
+
+# Author: fasion
+# Created time: 2026-10-20 07:31:26
+# Last Modified by: fasion
+# Last Modified time: 2026-10-20 10:55:37
+
+# resolve against responder, on loopback ports:
+#
+#   sh test.sh [PORT]
+#
+# responder answers a zone generated here, and a port nobody listens on
+# stands for a server that never replies.
+
+PORT=${1:-53535}
+DEAD_PORT=$((PORT + 1))
+
+DIR=$(mktemp -d)
+RESPONDER=
+
+cleanup() {
+    [ -n "$RESPONDER" ] && kill "$RESPONDER" 2>/dev/null
+    rm -rf "$DIR"
+}
+trap cleanup EXIT
+
+FAILED=0
+
+# check NAME EXPECTED: compare output of a case with lines expected
+check() {
+    if diff -u "$DIR/$1.expected" "$DIR/$1.out" > "$DIR/$1.diff"; then
+        echo "ok $1"
+    else
+        echo "FAILED $1"
+        cat "$DIR/$1.diff"
+        FAILED=1
+    fi
+}
+
+# run NAME [OPTION...]: resolve names of a case, lines sorted
+run() {
+    name=$1
+    shift
+    ./resolve -N -f - "$@" < "$DIR/$name.in" 2> "$DIR/$name.err" | sort > "$DIR/$name.out"
+}
+
+cat > "$DIR/test.zone" <<EOF
+\$ORIGIN test.
+\$TTL 300
+@       IN SOA ns admin 1 7200 900 1209600 60
+        IN NS ns
+ns      IN A 10.0.0.53
+www 600 IN A 10.0.0.1
+www     IN A 10.0.0.2
+www     IN AAAA 2001:db8::1
+alias   IN CNAME www
+alias2  IN CNAME alias
+Mixed   IN A 10.0.0.9
+dang    IN CNAME nothere
+dang2   IN CNAME dang
+empty   IN CNAME ns
+out     IN CNAME www.example.com.
+EOF
+
+i=1
+while [ $i -le 100 ]; do
+    echo "h$i A 10.1.$((i / 256)).$((i % 256))"
+    i=$((i + 1))
+done >> "$DIR/test.zone"
+
+./responder -q -j 1 -l "127.0.0.1:$PORT" "$DIR/test.zone" > "$DIR/responder.out" 2>&1 &
+RESPONDER=$!
+
+# wait for zone loaded and socket bound
+tries=0
+until grep -q "^Answering" "$DIR/responder.out"; do
+    tries=$((tries + 1))
+    if [ $tries -gt 50 ] || ! kill -0 "$RESPONDER" 2>/dev/null; then
+        echo "FAILED responder did not start"
+        cat "$DIR/responder.out"
+        exit 1
+    fi
+    sleep 0.1
+done
+
+# answers, cnames followed, case of names kept as asked
+cat > "$DIR/answers.in" <<EOF
+www.test
+alias.test
+alias2.test
+ns.test
+MIXED.test
+h1.test
+h100.test
+EOF
+cat > "$DIR/answers.expected" <<EOF
+MIXED.test NOERROR 300 10.0.0.9
+alias.test NOERROR 300 10.0.0.1 10.0.0.2
+alias2.test NOERROR 300 10.0.0.1 10.0.0.2
+h1.test NOERROR 300 10.1.0.1
+h100.test NOERROR 300 10.1.0.100
+ns.test NOERROR 300 10.0.0.53
+www.test NOERROR 300 10.0.0.1 10.0.0.2
+EOF
+run answers -s "127.0.0.1:$PORT"
+check answers
+
+# aaaa, and nodata of a name with no such records, negative ttl of soa
+cat > "$DIR/aaaa.in" <<EOF
+www.test
+ns.test
+EOF
+cat > "$DIR/aaaa.expected" <<EOF
+ns.test NOERROR 60
+www.test NOERROR 300 2001:db8::1
+EOF
+run aaaa -s "127.0.0.1:$PORT" -T AAAA
+check aaaa
+
+# names not in zone, within apex or not, one as long as names get: apex
+# of soa owner far into reply
+LABEL=aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa
+LONG=$LABEL.$LABEL.$LABEL.aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa.test
+cat > "$DIR/negative.in" <<EOF
+nothere.test
+deep.nothere.test
+www.example.com
+$LONG
+EOF
+cat > "$DIR/negative.expected" <<EOF
+$LONG NXDOMAIN 60
+deep.nothere.test NXDOMAIN 60
+nothere.test NXDOMAIN 60
+www.example.com REFUSED 0
+EOF
+run negative -s "127.0.0.1:$PORT"
+check negative
+
+# cnames to names within zone that have no records, or no such records,
+# and out of zone
+cat > "$DIR/cnames.in" <<EOF
+dang.test
+dang2.test
+out.test
+EOF
+cat > "$DIR/cnames.expected" <<EOF
+dang.test NXDOMAIN 60
+dang2.test NXDOMAIN 60
+out.test NOERROR 0
+EOF
+run cnames -s "127.0.0.1:$PORT"
+check cnames
+
+echo empty.test > "$DIR/nodata.in"
+echo "empty.test NOERROR 60" > "$DIR/nodata.expected"
+run nodata -s "127.0.0.1:$PORT" -T AAAA
+check nodata
+
+# no reply at all: every name retried, then timed out
+cat > "$DIR/timeout.in" <<EOF
+www.test
+h1.test
+h2.test
+EOF
+cat > "$DIR/timeout.expected" <<EOF
+h1.test TIMEOUT
+h2.test TIMEOUT
+www.test TIMEOUT
+EOF
+run timeout -s "127.0.0.1:$DEAD_PORT" -t 50 -r 2
+check timeout
+if ! grep -q "3 timed out, 0 from cache, 6 retries" "$DIR/timeout.err"; then
+    echo "FAILED timeout summary"
+    cat "$DIR/timeout.err"
+    FAILED=1
+fi
+
+# a single name, asked for twice through a cache of its own: the second
+# answer comes from cache, and a name not answered fails
+./resolve -C "$DIR/cache" -s "127.0.0.1:$PORT" www.test > /dev/null 2>&1
+./resolve -C "$DIR/cache" -s "127.0.0.1:$PORT" www.test > "$DIR/single.out" 2> "$DIR/single.err"
+echo "www.test NOERROR 300 10.0.0.1 10.0.0.2" > "$DIR/single.expected"
+check single
+if ! grep -q "1 from cache" "$DIR/single.err"; then
+    echo "FAILED single from cache"
+    cat "$DIR/single.err"
+    FAILED=1
+fi
+if ./resolve -N -s "127.0.0.1:$PORT" nothere.test > /dev/null 2>&1; then
+    echo "FAILED single nxdomain succeeded"
+    FAILED=1
+fi
+
+# many names in flight at once, every one answered
+i=1
+while [ $i -le 100 ]; do
+    echo "h$i.test"
+    i=$((i + 1))
+done > "$DIR/inflight.in"
+sed 's/$/ NOERROR/' "$DIR/inflight.in" | sort > "$DIR/inflight.expected"
+./resolve -N -f - -s "127.0.0.1:$PORT" -j 100 -S 4 < "$DIR/inflight.in" 2> /dev/null \
+    | cut -d ' ' -f 1,2 | sort > "$DIR/inflight.out"
+check inflight
+
+exit $FAILED
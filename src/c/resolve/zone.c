@@ -0,0 +1,1196 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:47:33
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 07:52:08
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "dns.h"
+#include "zone.h"
+
+// tokens of a line at most, txt strings included
+#define ZONE_MAX_TOKENS 64
+
+// bytes of rdata of a record at most
+#define ZONE_MAX_RDATA 4096
+
+// cnames followed within zone at most
+#define ZONE_MAX_CNAMES 8
+
+// names per bucket of perfect hash, on average
+#define ZONE_BUCKET_SIZE 4
+
+// seeds tried for a bucket at most, before slots are added
+#define ZONE_MAX_SEEDS (1 << 20)
+
+/*
+ * Growing bytes.
+ */
+struct buffer {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+};
+
+/*
+ * A record of zone file, owner and rdata in wire form in scratch buffer.
+ */
+struct zone_record {
+    uint32_t owner;
+    uint32_t owner_length;
+
+    uint16_t type;
+    uint32_t ttl;
+
+    uint32_t rdata;
+    uint32_t rdata_length;
+
+    // lowercase cname target, for following it
+    uint32_t target;
+    uint32_t target_length;
+};
+
+/*
+ * Everything read from zone file, before answers are precomputed.
+ */
+struct zone_source {
+    struct buffer scratch;
+
+    struct zone_record *records;
+    uint32_t count;
+    uint32_t capacity;
+
+    // types found in zone, for answers of cnames
+    uint16_t types[16];
+    int ntypes;
+
+    // state of parsing
+    unsigned char origin[256];
+    int origin_length;
+    uint32_t default_ttl;
+    uint32_t last_owner;
+    uint32_t last_owner_length;
+};
+
+
+/**
+ * Append bytes to buffer.
+ *
+ *  Returns
+ *      Offset of bytes in buffer if success, -1 if out of memory.
+ **/
+static long append(struct buffer *buffer, const void *data, size_t size) {
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity * 2 + size + 4096;
+        unsigned char *grown = realloc(buffer->data, capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    long offset = buffer->size;
+    memcpy(buffer->data + offset, data, size);
+    buffer->size += size;
+
+    return offset;
+}
+
+
+/**
+ * Write a 16 bits big endian integer.
+ **/
+static void write16(unsigned char *p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value;
+}
+
+
+/**
+ * Write a 32 bits big endian integer.
+ **/
+static void write32(unsigned char *p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+
+/**
+ * Hash a name in wire form, FNV-1a with a finalizer of murmur3.
+ **/
+static uint64_t hash_key(const unsigned char *key, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    size_t i;
+    for (i = 0; i < length; i++) {
+        hash = (hash ^ key[i]) * 1099511628211ULL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+
+/**
+ * Slot of a name hash under a bucket seed.
+ **/
+static uint32_t slot_of(uint64_t hash, uint32_t seed, uint32_t nslots) {
+    uint64_t x = hash ^ (seed * 0x9e3779b97f4a7c15ULL);
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 29;
+
+    return (x >> 32) * nslots >> 32;
+}
+
+
+/**
+ * Bucket of a name hash.
+ **/
+static uint32_t bucket_of(uint64_t hash, uint32_t nbuckets) {
+    return (uint32_t)hash * (uint64_t)nbuckets >> 32;
+}
+
+
+/**
+ * Convert a name of zone file to wire form, relative ones after origin.
+ *
+ *  Arguments
+ *      text: name, @ for origin.
+ *
+ *      origin: origin in wire form, may be of length 0 if not known yet.
+ *
+ *      out: for storing name, 256 bytes at least.
+ *
+ *      lower: lowercase name as well.
+ *
+ *  Returns
+ *      Bytes of name in wire form if success, -1 if bad.
+ **/
+static int name_to_wire(const char *text, const unsigned char *origin, int origin_length,
+        unsigned char *out, int lower) {
+    if (strcmp(text, "@") == 0) {
+        if (origin_length == 0) {
+            return -1;
+        }
+        memcpy(out, origin, origin_length);
+        return origin_length;
+    }
+
+    size_t length = strlen(text);
+    int absolute = length > 0 && text[length - 1] == '.';
+    if (absolute) {
+        length--;
+    }
+
+    int written = 0;
+    size_t start = 0;
+    while (start < length) {
+        const char *dot = memchr(text + start, '.', length - start);
+        size_t label = dot == NULL ? length - start : (size_t)(dot - text) - start;
+        if (label == 0 || label > 63 || written + 1 + label > 254) {
+            return -1;
+        }
+
+        out[written++] = label;
+        size_t i;
+        for (i = 0; i < label; i++) {
+            out[written++] = lower ? tolower((unsigned char)text[start + i]) : text[start + i];
+        }
+        start += label + 1;
+    }
+
+    if (absolute) {
+        out[written++] = 0;
+        return written;
+    }
+
+    if (origin_length == 0 || written + origin_length > 255) {
+        return -1;
+    }
+    memcpy(out + written, origin, origin_length);
+
+    return written + origin_length;
+}
+
+
+/**
+ * Split a line into tokens in place, quoted strings as one token.
+ *
+ *  Returns
+ *      Tokens found, -1 if too many or a quote is left open.
+ **/
+static int split_line(char *line, char **tokens, int max) {
+    int count = 0;
+    char *p = line;
+
+    for (;;) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+            p++;
+        }
+        if (*p == '\0') {
+            return count;
+        }
+        if (count == max) {
+            return -1;
+        }
+
+        if (*p == '"') {
+            // quotes kept at start, for txt strings to be told from others
+            tokens[count++] = p;
+            char *out = ++p;
+            while (*p != '"') {
+                if (*p == '\0') {
+                    return -1;
+                }
+                if (*p == '\\' && p[1] != '\0') {
+                    p++;
+                }
+                *out++ = *p++;
+            }
+            *out = '\0';
+            p++;
+            continue;
+        }
+
+        tokens[count++] = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+            p++;
+        }
+        if (*p != '\0') {
+            *p++ = '\0';
+        }
+    }
+}
+
+
+/**
+ * Read a logical line: comments cut, lines joined within parentheses.
+ *
+ *  Returns
+ *      Bytes of line if success, -1 at end of file.
+ **/
+static ssize_t read_line(FILE *file, char **line, size_t *size, int *lineno) {
+    char *part = NULL;
+    size_t part_size = 0;
+    size_t length = 0;
+    int depth = 0;
+
+    do {
+        ssize_t read = getline(&part, &part_size, file);
+        if (read == -1) {
+            free(part);
+            return length > 0 ? (ssize_t)length : -1;
+        }
+        (*lineno)++;
+
+        // comment and parentheses outside quotes only
+        int quoted = 0;
+        ssize_t i;
+        for (i = 0; i < read; i++) {
+            if (part[i] == '"' && (i == 0 || part[i - 1] != '\\')) {
+                quoted = !quoted;
+            } else if (!quoted && part[i] == ';') {
+                part[i] = '\n';
+                read = i + 1;
+                break;
+            } else if (!quoted && (part[i] == '(' || part[i] == ')')) {
+                depth += part[i] == '(' ? 1 : -1;
+                part[i] = ' ';
+            }
+        }
+
+        if (length + read + 1 > *size) {
+            char *grown = realloc(*line, length + read + 1);
+            if (grown == NULL) {
+                free(part);
+                return -1;
+            }
+            *line = grown;
+            *size = length + read + 1;
+        }
+        memcpy(*line + length, part, read);
+        length += read;
+        (*line)[length] = '\0';
+    } while (depth > 0);
+
+    free(part);
+
+    return length;
+}
+
+
+/**
+ * Parse record type, like CNAME.
+ *
+ *  Returns
+ *      DNS_TYPE_* if known, 0 otherwise.
+ **/
+static uint16_t parse_type(const char *token) {
+    static const struct {
+        const char *name;
+        uint16_t type;
+    } types[] = {
+        { "A", DNS_TYPE_A },
+        { "NS", DNS_TYPE_NS },
+        { "CNAME", DNS_TYPE_CNAME },
+        { "SOA", DNS_TYPE_SOA },
+        { "MX", DNS_TYPE_MX },
+        { "TXT", DNS_TYPE_TXT },
+        { "AAAA", DNS_TYPE_AAAA },
+    };
+
+    unsigned int i;
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (strcasecmp(token, types[i].name) == 0) {
+            return types[i].type;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Parse an unsigned 32 bits integer, decimal digits only.
+ *
+ *  Returns
+ *      0 if success, -1 if not a number.
+ **/
+static int parse_u32(const char *token, uint32_t *value) {
+    if (*token == '\0' || *token == '"') {
+        return -1;
+    }
+
+    char *end;
+    unsigned long parsed = strtoul(token, &end, 10);
+    if (*end != '\0' || !isdigit((unsigned char)*token) || parsed > UINT32_MAX) {
+        return -1;
+    }
+    *value = parsed;
+
+    return 0;
+}
+
+
+/**
+ * Build rdata of a record in wire form, names uncompressed.
+ *
+ *  Returns
+ *      Bytes of rdata if success, -1 if bad.
+ **/
+static int build_rdata(struct zone_source *source, uint16_t type, char **tokens, int count, unsigned char *out) {
+    int length, n;
+    uint32_t values[5];
+
+    switch (type) {
+        case DNS_TYPE_A:
+            return count == 1 && inet_pton(AF_INET, tokens[0], out) == 1 ? 4 : -1;
+
+        case DNS_TYPE_AAAA:
+            return count == 1 && inet_pton(AF_INET6, tokens[0], out) == 1 ? 16 : -1;
+
+        case DNS_TYPE_CNAME:
+        case DNS_TYPE_NS:
+            return count == 1 ? name_to_wire(tokens[0], source->origin, source->origin_length, out, 0) : -1;
+
+        case DNS_TYPE_MX:
+            if (count != 2 || parse_u32(tokens[0], &values[0]) == -1 || values[0] > UINT16_MAX) {
+                return -1;
+            }
+            write16(out, values[0]);
+            length = name_to_wire(tokens[1], source->origin, source->origin_length, out + 2, 0);
+            return length == -1 ? -1 : 2 + length;
+
+        case DNS_TYPE_TXT:
+            length = 0;
+            for (n = 0; n < count; n++) {
+                const char *string = tokens[n][0] == '"' ? tokens[n] + 1 : tokens[n];
+                size_t size = strlen(string);
+                if (size > 255 || length + 1 + size > ZONE_MAX_RDATA) {
+                    return -1;
+                }
+                out[length++] = size;
+                memcpy(out + length, string, size);
+                length += size;
+            }
+            return count > 0 ? length : -1;
+
+        case DNS_TYPE_SOA:
+            if (count != 7) {
+                return -1;
+            }
+            length = name_to_wire(tokens[0], source->origin, source->origin_length, out, 0);
+            n = length == -1 ? -1 : name_to_wire(tokens[1], source->origin, source->origin_length, out + length, 0);
+            if (n == -1) {
+                return -1;
+            }
+            length += n;
+            for (n = 0; n < 5; n++) {
+                if (parse_u32(tokens[2 + n], &values[n]) == -1) {
+                    return -1;
+                }
+                write32(out + length + 4 * n, values[n]);
+            }
+            return length + 20;
+    }
+
+    return -1;
+}
+
+
+/**
+ * Parse a logical line of zone file: a directive or a record.
+ *
+ *  Returns
+ *      0 if success, -1 if bad, with a reason.
+ **/
+static int parse_line(struct zone_source *source, char *line, const char **reason) {
+    char *tokens[ZONE_MAX_TOKENS];
+    int blank_owner = line[0] == ' ' || line[0] == '\t';
+
+    int count = split_line(line, tokens, ZONE_MAX_TOKENS);
+    if (count == -1) {
+        *reason = "too many tokens or quote left open";
+        return -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    unsigned char wire[256];
+    int i = 0;
+
+    if (strcasecmp(tokens[0], "$ORIGIN") == 0) {
+        int length = count == 2 ? name_to_wire(tokens[1], source->origin, source->origin_length, wire, 1) : -1;
+        if (length == -1) {
+            *reason = "bad origin";
+            return -1;
+        }
+        memcpy(source->origin, wire, length);
+        source->origin_length = length;
+        return 0;
+    }
+
+    if (strcasecmp(tokens[0], "$TTL") == 0) {
+        if (count != 2 || parse_u32(tokens[1], &source->default_ttl) == -1) {
+            *reason = "bad default ttl";
+            return -1;
+        }
+        return 0;
+    }
+
+    if (tokens[0][0] == '$') {
+        *reason = "unsupported directive";
+        return -1;
+    }
+
+    // owner, or that of previous record if line starts blank
+    struct zone_record record;
+    bzero(&record, sizeof(record));
+
+    if (blank_owner) {
+        if (source->last_owner_length == 0) {
+            *reason = "no previous owner";
+            return -1;
+        }
+        record.owner = source->last_owner;
+        record.owner_length = source->last_owner_length;
+    } else {
+        int length = name_to_wire(tokens[i++], source->origin, source->origin_length, wire, 1);
+        long offset = length == -1 ? -1 : append(&source->scratch, wire, length);
+        if (offset == -1) {
+            *reason = "bad owner";
+            return -1;
+        }
+        record.owner = offset;
+        record.owner_length = length;
+    }
+
+    // ttl and class, both optional, in either order
+    record.ttl = source->default_ttl;
+    int k;
+    for (k = 0; k < 2 && i < count; k++) {
+        if (parse_u32(tokens[i], &record.ttl) == 0) {
+            i++;
+        } else if (strcasecmp(tokens[i], "IN") == 0) {
+            i++;
+        }
+    }
+
+    if (i == count || (record.type = parse_type(tokens[i++])) == 0) {
+        *reason = "unsupported type or class";
+        return -1;
+    }
+
+    unsigned char rdata[ZONE_MAX_RDATA];
+    int length = build_rdata(source, record.type, tokens + i, count - i, rdata);
+    long offset = length == -1 ? -1 : append(&source->scratch, rdata, length);
+    if (offset == -1) {
+        *reason = "bad rdata";
+        return -1;
+    }
+    record.rdata = offset;
+    record.rdata_length = length;
+
+    // lowercase target of cname, for looking it up in zone
+    if (record.type == DNS_TYPE_CNAME) {
+        int j;
+        for (j = 0; j < length; j++) {
+            wire[j] = tolower(rdata[j]);
+        }
+        offset = append(&source->scratch, wire, length);
+        if (offset == -1) {
+            *reason = "out of memory";
+            return -1;
+        }
+        record.target = offset;
+        record.target_length = length;
+    }
+
+    if (source->count == source->capacity) {
+        uint32_t capacity = source->capacity * 2 + 1024;
+        struct zone_record *records = realloc(source->records, capacity * sizeof(*records));
+        if (records == NULL) {
+            *reason = "out of memory";
+            return -1;
+        }
+        source->records = records;
+        source->capacity = capacity;
+    }
+    source->records[source->count++] = record;
+
+    source->last_owner = record.owner;
+    source->last_owner_length = record.owner_length;
+
+    for (k = 0; k < source->ntypes && source->types[k] != record.type; k++) {
+    }
+    if (k == source->ntypes) {
+        source->types[source->ntypes++] = record.type;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Check whether records are of the same owner.
+ **/
+static int same_owner(const struct zone_source *source, const struct zone_record *a, const struct zone_record *b) {
+    return a->owner_length == b->owner_length
+        && memcmp(source->scratch.data + a->owner, source->scratch.data + b->owner, a->owner_length) == 0;
+}
+
+
+/**
+ * qsort_r comparator of records by owner, then type, then file order.
+ **/
+static int compare_records(const void *a, const void *b, void *arg) {
+    const struct zone_record *x = a, *y = b;
+    const unsigned char *scratch = arg;
+
+    if (x->owner_length != y->owner_length) {
+        return x->owner_length < y->owner_length ? -1 : 1;
+    }
+
+    int diff = memcmp(scratch + x->owner, scratch + y->owner, x->owner_length);
+    if (diff != 0) {
+        return diff;
+    }
+
+    if (x->type != y->type) {
+        return x->type < y->type ? -1 : 1;
+    }
+
+    return x < y ? -1 : x > y;
+}
+
+
+/**
+ * Find first record of owner among records sorted.
+ *
+ *  Returns
+ *      Position of first record if found, -1 otherwise.
+ **/
+static long find_owner(const struct zone_source *source, const unsigned char *owner, uint32_t length) {
+    long low = 0, high = source->count;
+    while (low < high) {
+        long middle = (low + high) / 2;
+        const struct zone_record *record = &source->records[middle];
+
+        int diff = record->owner_length != length ? (record->owner_length < length ? -1 : 1)
+            : memcmp(source->scratch.data + record->owner, owner, length);
+        if (diff < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low < (long)source->count && source->records[low].owner_length == length
+            && memcmp(source->scratch.data + source->records[low].owner, owner, length) == 0) {
+        return low;
+    }
+
+    return -1;
+}
+
+
+/**
+ * Find offset of apex within a name in wire form, on a label boundary.
+ *
+ *  Returns
+ *      Offset if name is apex or below, -1 otherwise.
+ **/
+int zone_apex_offset(const struct zone *zone, const unsigned char *key, size_t length) {
+    size_t offset = 0;
+    while (offset < length) {
+        if (length - offset == (size_t)zone->apex_length && memcmp(key + offset, zone->apex, length - offset) == 0) {
+            return offset;
+        }
+        if (key[offset] == 0) {
+            break;
+        }
+        offset += 1 + key[offset];
+    }
+
+    return -1;
+}
+
+
+/**
+ * Encode type, class, ttl and rdlength of a record.
+ **/
+static void encode_fixed(unsigned char *fixed, const struct zone_record *record, uint32_t ttl) {
+    write16(fixed, record->type);
+    write16(fixed + 2, DNS_CLASS_IN);
+    write32(fixed + 4, ttl);
+    write16(fixed + 8, record->rdata_length);
+}
+
+
+/**
+ * Write a record after its owner, which is already written.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int write_record(struct buffer *blob, const struct zone_source *source, const struct zone_record *record) {
+    unsigned char fixed[10];
+    encode_fixed(fixed, record, record->ttl);
+
+    if (append(blob, fixed, sizeof(fixed)) == -1
+            || append(blob, source->scratch.data + record->rdata, record->rdata_length) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Find first record of a type among records of an owner.
+ *
+ *  Returns
+ *      Record if found, NULL otherwise.
+ **/
+static const struct zone_record *find_type(const struct zone_source *source, long first, uint16_t type) {
+    long i;
+    for (i = first; i < source->count && same_owner(source, &source->records[first], &source->records[i]); i++) {
+        if (source->records[i].type == type) {
+            return &source->records[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Write owner of soa: a pointer to apex within a name of reply, or apex
+ * itself when no name of reply ends with it.
+ *
+ *  Arguments
+ *      offset: reply offset of apex, -1 if none.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int append_apex(const struct zone *zone, struct buffer *blob, long offset) {
+    if (offset == -1) {
+        return append(blob, zone->apex, zone->apex_length) == -1 ? -1 : 0;
+    }
+
+    unsigned char pointer[2] = { 0xc0 | offset >> 8, offset & 0xff };
+    return append(blob, pointer, sizeof(pointer)) == -1 ? -1 : 0;
+}
+
+
+/**
+ * Precompute answer of a name to a type, following cnames within zone.
+ * Offsets of reply are known in advance: question name at 12, answer
+ * section right after question, so owners are pointers.
+ *
+ *  Arguments
+ *      zone: zone built, for apex and soa.
+ *
+ *      source: records sorted.
+ *
+ *      first: position of first record of name.
+ *
+ *      type: type asked for, 0 for one without records.
+ *
+ *      answer: for storing answer, records appended to blob.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int build_answer(struct zone *zone, struct buffer *blob, const struct zone_source *source,
+        long first, uint16_t type, struct zone_answer *answer) {
+    const struct zone_record *name = &source->records[first];
+    const unsigned char *key = source->scratch.data + name->owner;
+
+    bzero(answer, sizeof(answer[0]));
+    answer->type = type;
+    answer->rcode = DNS_RCODE_NOERROR;
+    answer->offset = blob->size;
+
+    // reply offset of owner, and of next record
+    size_t owner = DNS_HEADER_SIZE;
+    size_t position = DNS_HEADER_SIZE + name->owner_length + 4;
+
+    // name whose records are looked for, in wire form
+    const unsigned char *current = key;
+    size_t current_length = name->owner_length;
+
+    long at = first;
+    int hops;
+    for (hops = 0; hops <= ZONE_MAX_CNAMES; hops++) {
+        unsigned char pointer[2] = { 0xc0 | owner >> 8, owner & 0xff };
+
+        // no data, or no name for a target within zone: soa, owner of which is apex within name
+        if (at == -1 || type == 0 || find_type(source, at, type) == NULL) {
+            const struct zone_record *cname = at == -1 ? NULL : find_type(source, at, DNS_TYPE_CNAME);
+            if (cname == NULL || type == DNS_TYPE_CNAME) {
+                int apex = zone_apex_offset(zone, current, current_length);
+                if (at == -1 && apex == -1) {
+                    // target out of zone, left to resolver
+                    break;
+                }
+                if (at == -1) {
+                    answer->rcode = DNS_RCODE_NXDOMAIN;
+                }
+                if (append_apex(zone, blob, apex == -1 ? -1 : (long)(owner + apex)) == -1
+                        || append(blob, zone->soa, zone->soa_length) == -1) {
+                    return -1;
+                }
+                answer->nscount = 1;
+                break;
+            }
+
+            if (append(blob, pointer, sizeof(pointer)) == -1 || write_record(blob, source, cname) == -1) {
+                return -1;
+            }
+            answer->ancount++;
+
+            // owner of records of target is rdata of cname, if pointer reaches it
+            owner = position + 2 + 10;
+            position += 2 + 10 + cname->rdata_length;
+            if (owner + cname->target_length > 0x3fff) {
+                break;
+            }
+
+            current = source->scratch.data + cname->target;
+            current_length = cname->target_length;
+            at = find_owner(source, current, current_length);
+            continue;
+        }
+
+        long i;
+        for (i = at; i < source->count && same_owner(source, &source->records[at], &source->records[i]); i++) {
+            const struct zone_record *record = &source->records[i];
+            if (record->type != type) {
+                continue;
+            }
+
+            if (append(blob, pointer, sizeof(pointer)) == -1 || write_record(blob, source, record) == -1) {
+                return -1;
+            }
+            answer->ancount++;
+            position += 2 + 10 + record->rdata_length;
+        }
+        break;
+    }
+
+    answer->length = blob->size - answer->offset;
+
+    return 0;
+}
+
+
+/**
+ * Index names by a perfect hash, hash and displace: buckets are placed
+ * biggest first, each trying seeds until its names all land on free
+ * slots.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory or no seed found.
+ **/
+static int build_index(struct zone *zone) {
+    uint32_t n = zone->count;
+    zone->nbuckets = n / ZONE_BUCKET_SIZE + 1;
+
+    uint64_t *hashes = malloc(n * sizeof(*hashes) + 1);
+    uint32_t *order = malloc(n * sizeof(*order) + 1);
+    uint32_t *starts = calloc(zone->nbuckets + 2, sizeof(*starts));
+    uint32_t *buckets = malloc(zone->nbuckets * sizeof(*buckets));
+    zone->seeds = calloc(zone->nbuckets, sizeof(*zone->seeds));
+    if (hashes == NULL || order == NULL || starts == NULL || buckets == NULL || zone->seeds == NULL) {
+        free(hashes);
+        free(order);
+        free(starts);
+        free(buckets);
+        return -1;
+    }
+
+    // names grouped by bucket, by counting
+    uint32_t i;
+    for (i = 0; i < n; i++) {
+        const struct zone_name *name = &zone->names[i];
+        hashes[i] = hash_key(zone->blob + name->key, name->key_length);
+        starts[bucket_of(hashes[i], zone->nbuckets) + 2]++;
+    }
+    for (i = 0; i < zone->nbuckets; i++) {
+        starts[i + 2] += starts[i + 1];
+    }
+    for (i = 0; i < n; i++) {
+        order[starts[bucket_of(hashes[i], zone->nbuckets) + 1]++] = i;
+    }
+
+    // buckets biggest first, sizes are small so by counting again
+    uint32_t max_size = 0;
+    for (i = 0; i < zone->nbuckets; i++) {
+        uint32_t size = starts[i + 1] - starts[i];
+        max_size = size > max_size ? size : max_size;
+    }
+    uint32_t placed = 0;
+    int64_t size;
+    for (size = max_size; size > 0; size--) {
+        for (i = 0; i < zone->nbuckets; i++) {
+            if (starts[i + 1] - starts[i] == size) {
+                buckets[placed++] = i;
+            }
+        }
+    }
+
+    // slots added as long as some bucket finds no seed, rarely if ever
+    int ret = -1;
+    zone->nslots = n + n / 8 + 1;
+    while (ret == -1) {
+        free(zone->slots);
+        zone->slots = malloc(zone->nslots * sizeof(*zone->slots));
+        if (zone->slots == NULL) {
+            break;
+        }
+        memset(zone->slots, 0xff, zone->nslots * sizeof(*zone->slots));
+
+        uint32_t b;
+        for (b = 0; b < placed; b++) {
+            uint32_t bucket = buckets[b];
+            uint32_t count = starts[bucket + 1] - starts[bucket];
+            const uint32_t *members = order + starts[bucket];
+
+            uint32_t seed;
+            for (seed = 1; seed < ZONE_MAX_SEEDS; seed++) {
+                uint32_t k;
+                for (k = 0; k < count; k++) {
+                    uint32_t slot = slot_of(hashes[members[k]], seed, zone->nslots);
+                    if (zone->slots[slot] != UINT32_MAX) {
+                        break;
+                    }
+                    // taken for now, released if another member collides
+                    zone->slots[slot] = members[k];
+                }
+                if (k == count) {
+                    break;
+                }
+
+                while (k-- > 0) {
+                    zone->slots[slot_of(hashes[members[k]], seed, zone->nslots)] = UINT32_MAX;
+                }
+            }
+
+            if (seed == ZONE_MAX_SEEDS) {
+                break;
+            }
+            zone->seeds[bucket] = seed;
+        }
+
+        if (b == placed) {
+            ret = 0;
+        } else {
+            zone->nslots += n / 8 + 1;
+        }
+    }
+
+    free(hashes);
+    free(order);
+    free(starts);
+    free(buckets);
+
+    return ret;
+}
+
+
+/**
+ * Build names, answers and index of zone from records read.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int build_zone(struct zone *zone, struct zone_source *source) {
+    qsort_r(source->records, source->count, sizeof(*source->records), compare_records, source->scratch.data);
+
+    uint32_t i;
+    uint32_t names = 0;
+    for (i = 0; i < source->count; i++) {
+        names += i == 0 || !same_owner(source, &source->records[i - 1], &source->records[i]);
+    }
+
+    zone->names = calloc(names, sizeof(*zone->names));
+    if (zone->names == NULL) {
+        return -1;
+    }
+
+    struct buffer blob = { NULL, 0, 0 };
+    uint32_t capacity = 0;
+
+    for (i = 0; i < source->count; ) {
+        const struct zone_record *first = &source->records[i];
+
+        // records of owner, and types of answers: its own, those of whole
+        // zone if a cname, and any other
+        uint16_t types[16 + 1];
+        int ntypes = 0;
+        int has_cname = 0;
+        uint32_t j;
+        for (j = i; j < source->count && same_owner(source, first, &source->records[j]); j++) {
+            uint16_t type = source->records[j].type;
+            has_cname |= type == DNS_TYPE_CNAME;
+            if (ntypes == 0 || types[ntypes - 1] != type) {
+                types[ntypes++] = type;
+            }
+        }
+        if (has_cname) {
+            memcpy(types, source->types, source->ntypes * sizeof(types[0]));
+            ntypes = source->ntypes;
+        }
+        types[ntypes++] = 0;
+
+        struct zone_name *name = &zone->names[zone->count++];
+        long key = append(&blob, source->scratch.data + first->owner, first->owner_length);
+        if (key == -1) {
+            free(blob.data);
+            return -1;
+        }
+        name->key = key;
+        name->key_length = first->owner_length;
+        name->first_answer = zone->nanswers;
+        name->answers = ntypes;
+
+        if (zone->nanswers + ntypes > capacity) {
+            capacity = capacity * 2 + ntypes + 1024;
+            struct zone_answer *answers = realloc(zone->answers, capacity * sizeof(*answers));
+            if (answers == NULL) {
+                free(blob.data);
+                return -1;
+            }
+            zone->answers = answers;
+        }
+
+        int k;
+        for (k = 0; k < ntypes; k++) {
+            if (build_answer(zone, &blob, source, i, types[k], &zone->answers[zone->nanswers++]) == -1) {
+                free(blob.data);
+                return -1;
+            }
+        }
+
+        i = j;
+    }
+
+    zone->blob = blob.data;
+    zone->blob_size = blob.size;
+
+    return build_index(zone);
+}
+
+
+/**
+ * Load a zone file and precompute every answer. The file is in master
+ * file format, with A, AAAA, CNAME, NS, MX, TXT and SOA records, $ORIGIN
+ * and $TTL directives; the first soa gives apex.
+ *
+ *  Arguments
+ *      zone: for storing zone.
+ *
+ *      path: zone file.
+ *
+ *  Returns
+ *      0 if success, -1 if error, reported on stderr.
+ **/
+int zone_load(struct zone *zone, const char *path) {
+    bzero(zone, sizeof(*zone));
+
+    FILE *file = fopen(path, "re");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    struct zone_source source;
+    bzero(&source, sizeof(source));
+    source.default_ttl = 3600;
+
+    char *line = NULL;
+    size_t size = 0;
+    int lineno = 0;
+    int ret = 0;
+
+    int start = 1;
+    while (read_line(file, &line, &size, &lineno) != -1) {
+        const char *reason;
+        if (parse_line(&source, line, &reason) == -1) {
+            fprintf(stderr, "%s:%d: %s\n", path, start, reason);
+            ret = -1;
+            break;
+        }
+        start = lineno + 1;
+    }
+    free(line);
+    fclose(file);
+
+    // apex and soa after its owner, from the first soa
+    uint32_t i;
+    for (i = 0; ret == 0 && i < source.count && source.records[i].type != DNS_TYPE_SOA; i++) {
+    }
+    if (ret == 0 && i == source.count) {
+        fprintf(stderr, "%s: no SOA record\n", path);
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        const struct zone_record *soa = &source.records[i];
+        zone->apex_length = soa->owner_length;
+        memcpy(zone->apex, source.scratch.data + soa->owner, soa->owner_length);
+
+        // negative answers live as long as minimum of soa says
+        const unsigned char *rdata = source.scratch.data + soa->rdata;
+        uint32_t minimum = (uint32_t)rdata[soa->rdata_length - 4] << 24 | rdata[soa->rdata_length - 3] << 16
+            | rdata[soa->rdata_length - 2] << 8 | rdata[soa->rdata_length - 1];
+        if (soa->rdata_length + 10 > sizeof(zone->soa)) {
+            fprintf(stderr, "%s: SOA record too long\n", path);
+            ret = -1;
+        } else {
+            encode_fixed(zone->soa, soa, soa->ttl < minimum ? soa->ttl : minimum);
+            memcpy(zone->soa + 10, rdata, soa->rdata_length);
+            zone->soa_length = 10 + soa->rdata_length;
+        }
+    }
+
+    if (ret == 0 && build_zone(zone, &source) == -1) {
+        fprintf(stderr, "%s: %s\n", path, strerror(ENOMEM));
+        ret = -1;
+    }
+
+    free(source.scratch.data);
+    free(source.records);
+
+    if (ret == -1) {
+        zone_free(zone);
+    }
+
+    return ret;
+}
+
+
+/**
+ * Free everything of zone.
+ **/
+void zone_free(struct zone *zone) {
+    free(zone->names);
+    free(zone->answers);
+    free(zone->blob);
+    free(zone->seeds);
+    free(zone->slots);
+    bzero(zone, sizeof(*zone));
+}
+
+
+/**
+ * Find a name, by a single probe of index.
+ *
+ *  Arguments
+ *      zone: zone loaded.
+ *
+ *      key: lowercase name in wire form.
+ *
+ *      length: bytes of name.
+ *
+ *  Returns
+ *      Pointer to name if found, NULL otherwise.
+ **/
+const struct zone_name *zone_find(const struct zone *zone, const unsigned char *key, size_t length) {
+    if (zone->count == 0) {
+        return NULL;
+    }
+
+    uint64_t hash = hash_key(key, length);
+    uint32_t seed = zone->seeds[bucket_of(hash, zone->nbuckets)];
+    uint32_t index = zone->slots[slot_of(hash, seed, zone->nslots)];
+    if (index == UINT32_MAX) {
+        return NULL;
+    }
+
+    const struct zone_name *name = &zone->names[index];
+    if (name->key_length != length || memcmp(zone->blob + name->key, key, length) != 0) {
+        return NULL;
+    }
+
+    return name;
+}
+
+
+/**
+ * Find answer of name to a type, the one for any other type if not listed.
+ **/
+const struct zone_answer *zone_answer(const struct zone *zone, const struct zone_name *name, uint16_t type) {
+    const struct zone_answer *answers = &zone->answers[name->first_answer];
+
+    uint32_t i;
+    for (i = 0; i + 1 < name->answers; i++) {
+        if (answers[i].type == type) {
+            return &answers[i];
+        }
+    }
+
+    return &answers[name->answers - 1];
+}
@@ -0,0 +1,78 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 06:47:33
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 06:47:33
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Answer to a type of query for a name, precomputed in wire form: every
+ * record after question, owners compressed against question name, which
+ * starts at offset 12 of reply as queries put it.
+ */
+struct zone_answer {
+    // type asked for, 0 for any type not listed
+    uint16_t type;
+    uint16_t rcode;
+
+    uint16_t ancount;
+    uint16_t nscount;
+
+    // records in blob
+    uint32_t offset;
+    uint32_t length;
+};
+
+/*
+ * A name of zone, with its answers.
+ */
+struct zone_name {
+    // lowercase name in wire form, in blob
+    uint32_t key;
+    uint32_t key_length;
+
+    // answers of name, the one for any other type last
+    uint32_t first_answer;
+    uint32_t answers;
+};
+
+/*
+ * Names of a zone, indexed by a perfect hash: name hashes to a bucket,
+ * and seed of bucket to a slot taken by that name alone. Unknown names
+ * land on some slot too, so key is compared still.
+ */
+struct zone {
+    // wire form of apex
+    unsigned char apex[256];
+    int apex_length;
+
+    // soa record after its owner, for negative answers of any name
+    unsigned char soa[512];
+    int soa_length;
+
+    struct zone_name *names;
+    uint32_t count;
+
+    struct zone_answer *answers;
+    uint32_t nanswers;
+
+    // keys and records
+    unsigned char *blob;
+    size_t blob_size;
+
+    uint32_t *seeds;
+    uint32_t nbuckets;
+
+    // name of each slot
+    uint32_t *slots;
+    uint32_t nslots;
+};
+
+int zone_load(struct zone *zone, const char *path);
+void zone_free(struct zone *zone);
+const struct zone_name *zone_find(const struct zone *zone, const unsigned char *key, size_t length);
+const struct zone_answer *zone_answer(const struct zone *zone, const struct zone_name *name, uint16_t type);
+int zone_apex_offset(const struct zone *zone, const unsigned char *key, size_t length);
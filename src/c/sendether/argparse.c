@@ -2,10 +2,11 @@
  * Author: fasion
  * Created time: 2020-10-27 20:22:53
  * Last Modified by: fasion
- * Last Modified time: 2021-01-13 17:10:10
+ * Last Modified time: 2026-10-20 09:49:05
  */
 
 #include <argp.h>
+#include <stdio.h>
 
 #include "argparse.h"
 
@@ -35,6 +36,99 @@ static error_t opt_handler(int key, char *arg, struct argp_state *state) {
             arguments->to = arg;
             break;
 
+        case 'n':
+            if (sscanf(arg, "%ld", &arguments->count) != 1 || arguments->count < 0) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'b':
+            if (sscanf(arg, "%d", &arguments->batch) != 1 || arguments->batch < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'r':
+            arguments->ring = 1;
+            break;
+
+        case 'q':
+            arguments->qdisc_bypass = 1;
+            break;
+
+        case 'x':
+            arguments->xdp = 1;
+            break;
+
+        case 'g':
+            arguments->generate = 1;
+            break;
+
+        case 'j':
+            if (sscanf(arg, "%d", &arguments->threads) != 1 || arguments->threads < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'R':
+            if (sscanf(arg, "%ld", &arguments->rate) != 1 || arguments->rate < 0) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'B':
+            if (sscanf(arg, "%d", &arguments->burst) != 1 || arguments->burst < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 's':
+            if (sscanf(arg, "%d", &arguments->size) != 1 || arguments->size < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'f':
+            if (arguments->nfields == MAX_GENERATOR_FIELDS) {
+                argp_error(state, "too many fields, at most %d", MAX_GENERATOR_FIELDS);
+            }
+            arguments->fields[arguments->nfields++] = arg;
+            break;
+
+        case 'p':
+            arguments->payloads = arg;
+            break;
+
+        case 'l':
+            arguments->length_prefixed = 1;
+            break;
+
+        case 'G':
+            arguments->gso = 1;
+            break;
+
+        case 'S':
+            arguments->saddr = arg;
+            break;
+
+        case 'D':
+            arguments->daddr = arg;
+            break;
+
+        case 'E':
+            arguments->rtt = 1;
+            break;
+
+        case 'A':
+            arguments->arp = arg;
+            break;
+
+        case 'P':
+            if (sscanf(arg, "%hu", &arguments->port) != 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
         default:
             return ARGP_ERR_UNKNOWN;
     }
@@ -56,7 +150,23 @@ static error_t opt_handler(int key, char *arg, struct argp_state *state) {
  **/
 const struct cmdline_arguments *parse_arguments(int argc, char *argv[]) {
     // docs for program and options
-    static char const doc[] = "send_ether: send data through ethernet frame";
+    static char const doc[] = "send_ether: send data through ethernet frame\v"
+        "Generator mode (-g) sends frames built from a template with several "
+        "threads. Fields varied per frame are given by -f: dst:COUNT and "
+        "src:COUNT cycle the low 32 bits of a mac address through COUNT "
+        "values, type:COUNT cycles ether type, seq:OFFSET stores a 32 bits "
+        "frame sequence at OFFSET of payload.\n\n"
+        "Payload mode (-p) sends a frame for each payload read from a file "
+        "or stdin, batch frames per sendmmsg call, count times over.\n\n"
+        "GSO mode (-G) sends udp datagrams over ipv4 as super-frames of up to "
+        "64KB, cut into datagrams fitting mtu by kernel or driver. Payload "
+        "is otherwise limited by mtu of iface.\n\n"
+        "RTT mode (-E) sends probes to a reflector, which echoes frames of "
+        "the same type, and reports a histogram of round trip times. Probes "
+        "go at -R per second, or one after another without a rate.\n\n"
+        "ARP mode (-A) sends requests for every host of a subnet in batches "
+        "and prints the ip to mac map of replies, collected meanwhile through "
+        "a BPF filter. Destination is broadcast unless -t is given.";
     static char const args_doc[] = "";
 
     // command line options
@@ -73,6 +183,69 @@ const struct cmdline_arguments *parse_arguments(int argc, char *argv[]) {
         // Option -d --data: data to send, optional since default value is set
         {"data", 'd', "DATA", 0, "data to send"},
 
+        // Option -n --count: frames to send
+        {"count", 'n', "COUNT", 0, "frames to send, rate is reported if more than one; "
+            "0 for endless in generator mode; passes over payloads in payload mode"},
+
+        // Option -b --batch: frames handed to kernel at once
+        {"batch", 'b', "FRAMES", 0, "frames handed to kernel at once with --ring, --xdp or --payloads"},
+
+        // Option -r --ring: send through PACKET_TX_RING
+        {"ring", 'r', 0, 0, "send through mmap'd PACKET_TX_RING"},
+
+        // Option -q --qdisc-bypass: skip qdisc layer
+        {"qdisc-bypass", 'q', 0, 0, "hand frames to driver directly, bypassing qdisc"},
+
+        // Option -x --xdp: send through AF_XDP socket
+        {"xdp", 'x', 0, 0, "send through AF_XDP socket, zero copy if driver supports it; "
+            "generator threads take iface queues of their index"},
+
+        // Option -g --generate: generator mode
+        {"generate", 'g', 0, 0, "generate frames from template until count or interrupted"},
+
+        // Option -j --threads: sender threads of generator
+        {"threads", 'j', "THREADS", 0, "sender threads of generator, each with its own socket"},
+
+        // Option -R --rate: frames per second of generator
+        {"rate", 'R', "FPS", 0, "frames per second of generator, 0 for unlimited"},
+
+        // Option -B --burst: frames sent back to back
+        {"burst", 'B', "FRAMES", 0, "frames sent back to back by generator"},
+
+        // Option -s --size: payload size
+        {"size", 's', "BYTES", 0, "payload size, data is repeated to fill it; "
+            "udp payload per super-frame in gso mode"},
+
+        // Option -f --field: field varied per frame
+        {"field", 'f', "FIELD", 0, "field varied per frame by generator, repeatable"},
+
+        // Option -p --payloads: file of payloads
+        {"payloads", 'p', "FILE", 0, "send a frame for each payload in FILE, - for stdin"},
+
+        // Option -l --length-prefixed: payload format
+        {"length-prefixed", 'l', 0, 0, "payloads are prefixed with 16 bits big endian length, "
+            "instead of newline delimited"},
+
+        // Option -G --gso: gso mode
+        {"gso", 'G', 0, 0, "send udp datagrams as gso super-frames through PACKET_VNET_HDR"},
+
+        // Option -E --rtt: rtt mode
+        {"rtt", 'E', 0, 0, "measure round trip time to a reflector at destination mac address"},
+
+        // Option -A --arp: arp scan mode
+        {"arp", 'A', "SUBNET", 0, "map ip addresses of SUBNET to mac addresses by arp, "
+            "COUNT rounds asking silent hosts again"},
+
+        // Option -S --saddr: source ip address
+        {"saddr", 'S', "IP", 0, "source ip address of gso datagrams and arp requests, "
+            "address of iface for arp if not given"},
+
+        // Option -D --daddr: destination ip address
+        {"daddr", 'D', "IP", 0, "destination ip address of gso datagrams"},
+
+        // Option -P --port: udp port
+        {"port", 'P', "PORT", 0, "source and destination udp port of gso datagrams"},
+
         { 0 }
     };
 
@@ -95,6 +268,101 @@ const struct cmdline_arguments *parse_arguments(int argc, char *argv[]) {
         // default data, 46 bytes string of 'a'
         // since for ethernet frame data is 46 bytes at least
         .data = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+        .count = 0,
+        .batch = 256,
+        .ring = 0,
+        .xdp = 0,
+        .qdisc_bypass = 0,
+        .generate = 0,
+        .threads = 1,
+        .rate = 0,
+        .burst = 1,
+        .size = 0,
+        .nfields = 0,
+        .payloads = NULL,
+        .length_prefixed = 0,
+        .gso = 0,
+        .saddr = "0.0.0.0",
+        .daddr = "255.255.255.255",
+        // discard service
+        .port = 9,
+        .rtt = 0,
+        .arp = NULL,
+    };
+
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    return &arguments;
+}
+
+
+/**
+ * opt_handler function for GNU argp, of reflector.
+ **/
+static error_t reflector_opt_handler(int key, char *arg, struct argp_state *state) {
+    struct reflector_arguments *arguments = state->input;
+
+    switch(key) {
+        case 'i':
+            arguments->iface = arg;
+            break;
+
+        case 'T':
+            if (sscanf(arg, "%hx", &arguments->type) != 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Parse command line arguments of reflector given by argc, argv.
+ *
+ *  Arguments
+ *      argc: the same with main function.
+ *
+ *      argv: the same with main function.
+ *
+ *  Returns
+ *      Pointer to struct arguments if success, NULL if error.
+ **/
+const struct reflector_arguments *parse_reflector_arguments(int argc, char *argv[]) {
+    static char const doc[] = "reflector: send ethernet frames of a type back to their source\v"
+        "Frames addressed to iface, broadcast or multicast are sent back "
+        "unchanged but for addresses, for sendether --rtt to measure round "
+        "trip time.";
+    static char const args_doc[] = "";
+
+    static struct argp_option const options[] = {
+        // Option -i --iface: name of iface to reflect on
+        {"iface", 'i', "IFACE", 0, "name of iface to reflect on"},
+
+        // Option -T --type: ether type
+        {"type", 'T', "TYPE", 0, "ether type to reflect, in hex"},
+
+        { 0 }
+    };
+
+    static const struct argp argp = {
+        options,
+        reflector_opt_handler,
+        args_doc,
+        doc,
+        0,
+        0,
+        0,
+    };
+
+    static struct reflector_arguments arguments = {
+        .iface = NULL,
+        // the same default with sendether
+        .type = 0x0900,
     };
 
     argp_parse(&argp, argc, argv, 0, 0, &arguments);
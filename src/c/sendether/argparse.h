@@ -2,9 +2,11 @@
  * Author: fasion
  * Created time: 2020-10-27 20:28:34
  * Last Modified by: fasion
- * Last Modified time: 2021-01-13 17:13:59
+ * Last Modified time: 2026-10-20 09:49:05
  */
 
+#define MAX_GENERATOR_FIELDS 8
+
 /**
  * struct for storing command line arguments.
  **/
@@ -20,6 +22,72 @@ struct cmdline_arguments {
 
     // data to send
     const char *data;
+
+    // frames to send, 0 for endless in generator mode
+    long count;
+
+    // frames handed to kernel at once in bulk mode
+    int batch;
+
+    // send through mmap'd PACKET_TX_RING
+    int ring;
+
+    // send through AF_XDP socket
+    int xdp;
+
+    // bypass qdisc layer of iface
+    int qdisc_bypass;
+
+    // generator mode
+    int generate;
+
+    // sender threads of generator
+    int threads;
+
+    // frames per second of generator, for all threads, 0 for unlimited
+    long rate;
+
+    // frames sent back to back by generator
+    int burst;
+
+    // payload size, data is repeated to fill it, 0 for length of data
+    int size;
+
+    // fields varied per frame by generator
+    const char *fields[MAX_GENERATOR_FIELDS];
+    int nfields;
+
+    // file of payloads to send, "-" for stdin
+    const char *payloads;
+
+    // payloads are prefixed with 16 bits big endian length, not newline delimited
+    int length_prefixed;
+
+    // send udp datagrams as gso super-frames
+    int gso;
+
+    // ip addresses and udp port of gso datagrams
+    const char *saddr;
+    const char *daddr;
+    unsigned short port;
+
+    // measure round trip time to a reflector
+    int rtt;
+
+    // subnet to scan by arp, like 192.168.1.0/24
+    const char *arp;
+};
+
+/**
+ * struct for storing command line arguments of reflector.
+ **/
+struct reflector_arguments {
+    // name of iface to reflect on
+    const char *iface;
+
+    // ether type to reflect
+    unsigned short type;
 };
 
 const struct cmdline_arguments *parse_arguments(int argc, char *argv[]);
+const struct reflector_arguments *parse_reflector_arguments(int argc, char *argv[]);
@@ -0,0 +1,501 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 05:02:44
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 08:41:06
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "arp.h"
+#include "argparse.h"
+#include "link.h"
+#include "sendether.h"
+
+// ethernet frames are padded to 60 bytes, fcs excluded
+#define ARP_FRAME_SIZE 60
+
+// bytes of a reply kept, headers and arp payload
+#define ARP_SNAP_SIZE 42
+
+// replies received per system call
+#define ARP_RECV_BATCH 64
+
+// a round ends once no reply comes for so long
+#define ARP_QUIET_MS 100
+
+// socket buffer for bursts of replies
+#define ARP_RCVBUF_SIZE (4 << 20)
+
+/*
+ * ARP over ethernet for ipv4, packed for unaligned ip addresses.
+ */
+struct __attribute__((__packed__)) arp_frame {
+    unsigned char dst_addr[6];
+    unsigned char src_addr[6];
+    unsigned short type;
+
+    unsigned short htype;
+    unsigned short ptype;
+    unsigned char hlen;
+    unsigned char plen;
+    unsigned short op;
+    unsigned char sha[6];
+    uint32_t spa;
+    unsigned char tha[6];
+    uint32_t tpa;
+
+    unsigned char padding[ARP_FRAME_SIZE - ARP_SNAP_SIZE];
+};
+
+/*
+ * Host answered, ip in host byte order.
+ */
+struct arp_entry {
+    uint32_t ip;
+    unsigned char mac[6];
+    int used;
+
+    // replies with a different mac, like an address conflict
+    int conflicts;
+};
+
+/*
+ * Open addressing table of hosts answered, keyed by ip.
+ */
+struct arp_table {
+    struct arp_entry *entries;
+    uint32_t mask;
+    int count;
+};
+
+
+/**
+ * Parse subnet like 192.168.1.0/22.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int parse_subnet(const char *cidr, uint32_t *network, uint32_t *netmask) {
+    char address[INET_ADDRSTRLEN];
+    int prefix = 32;
+
+    const char *slash = strchr(cidr, '/');
+    size_t length = slash == NULL ? strlen(cidr) : (size_t)(slash - cidr);
+    if (length >= sizeof(address)) {
+        return -1;
+    }
+    memcpy(address, cidr, length);
+    address[length] = '\0';
+
+    if (slash != NULL && (sscanf(slash + 1, "%d", &prefix) != 1 || prefix < 0 || prefix > 32)) {
+        return -1;
+    }
+
+    struct in_addr addr;
+    if (inet_aton(address, &addr) == 0) {
+        return -1;
+    }
+
+    *netmask = prefix == 0 ? 0 : 0xffffffffU << (32 - prefix);
+    *network = ntohl(addr.s_addr) & *netmask;
+
+    return 0;
+}
+
+
+/**
+ * Slot of ip in table, either holding it or empty.
+ **/
+static struct arp_entry *locate(const struct arp_table *table, uint32_t ip) {
+    // fibonacci hashing spreads consecutive addresses
+    uint32_t i = (ip * 2654435761U) & table->mask;
+    while (table->entries[i].used && table->entries[i].ip != ip) {
+        i = (i + 1) & table->mask;
+    }
+
+    return &table->entries[i];
+}
+
+
+/**
+ * Record a reply, counting a conflict if ip answered with another mac.
+ **/
+static void record_reply(struct arp_table *table, uint32_t ip, const unsigned char *mac) {
+    struct arp_entry *entry = locate(table, ip);
+    if (!entry->used) {
+        entry->used = 1;
+        entry->ip = ip;
+        memcpy(entry->mac, mac, 6);
+        table->count++;
+    } else if (memcmp(entry->mac, mac, 6) != 0) {
+        entry->conflicts++;
+    }
+}
+
+
+/**
+ * Open a socket receiving arp replies from hosts of subnet only, on the
+ * same iface. A classic BPF filter drops everything else in kernel, so
+ * requests sent and unrelated traffic never wake us up.
+ *
+ *  Returns
+ *      Socket if success, -1 if error.
+ **/
+static int open_reply_socket(const char *iface, uint32_t network, uint32_t netmask) {
+    int r = socket(PF_PACKET, SOCK_RAW | SOCK_CLOEXEC, htons(ETH_P_ARP));
+    if (r == -1) {
+        return -1;
+    }
+
+    struct sock_filter code[] = {
+        // ether type
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_ARP, 0, 6),
+
+        // operation
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 2, 0, 4),
+
+        // sender ip within subnet
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 28),
+        BPF_STMT(BPF_ALU | BPF_AND | BPF_K, netmask),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, network, 0, 1),
+
+        BPF_STMT(BPF_RET | BPF_K, ARP_SNAP_SIZE),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct sock_fprog prog = { sizeof(code) / sizeof(code[0]), code };
+
+    int size = ARP_RCVBUF_SIZE;
+    if (setsockopt(r, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) == -1
+            || setsockopt(r, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) == -1
+            || bind_iface_type(r, iface, ETH_P_ARP) == -1) {
+        int saved = errno;
+        close(r);
+        errno = saved;
+        return -1;
+    }
+
+    // frames queued before the filter is attached may be anything
+    char buffer[ARP_SNAP_SIZE];
+    while (recv(r, buffer, sizeof(buffer), MSG_DONTWAIT) >= 0) {
+    }
+
+    return r;
+}
+
+
+/**
+ * Receive replies queued, without waiting.
+ *
+ *  Returns
+ *      Replies received if success, -1 if error.
+ **/
+static int collect_replies(int r, struct arp_table *table) {
+    static unsigned char buffers[ARP_RECV_BATCH][ARP_SNAP_SIZE];
+    struct iovec iovs[ARP_RECV_BATCH];
+    struct mmsghdr msgs[ARP_RECV_BATCH];
+
+    int total = 0;
+    for (;;) {
+        int i;
+        for (i = 0; i < ARP_RECV_BATCH; i++) {
+            iovs[i].iov_base = buffers[i];
+            iovs[i].iov_len = ARP_SNAP_SIZE;
+
+            bzero(&msgs[i], sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int n = recvmmsg(r, msgs, ARP_RECV_BATCH, MSG_DONTWAIT, NULL);
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EINTR) {
+                return total;
+            }
+            return -1;
+        }
+
+        for (i = 0; i < n; i++) {
+            if (msgs[i].msg_len < ARP_SNAP_SIZE) {
+                continue;
+            }
+
+            const struct arp_frame *frame = (const struct arp_frame *)buffers[i];
+            record_reply(table, ntohl(frame->spa), frame->sha);
+        }
+
+        total += n;
+        if (n < ARP_RECV_BATCH) {
+            return total;
+        }
+    }
+}
+
+
+/**
+ * Build an arp request asking for ip.
+ **/
+static void build_request(struct arp_frame *frame, const unsigned char *fr, const unsigned char *to,
+        struct in_addr saddr, uint32_t ip) {
+    bzero(frame, sizeof(*frame));
+
+    memcpy(frame->dst_addr, to, 6);
+    memcpy(frame->src_addr, fr, 6);
+    frame->type = htons(ETH_P_ARP);
+
+    frame->htype = htons(1);
+    frame->ptype = htons(ETH_P_IP);
+    frame->hlen = 6;
+    frame->plen = 4;
+    frame->op = htons(1);
+    memcpy(frame->sha, fr, 6);
+    frame->spa = saddr.s_addr;
+    frame->tpa = htonl(ip);
+}
+
+
+/**
+ * Send requests for hosts not answered yet, batched per sendmmsg call,
+ * collecting replies between batches.
+ *
+ *  Returns
+ *      Requests sent if success, -1 if error.
+ **/
+static long send_requests(int s, int r, struct arp_table *table, struct arp_frame *frames, long nhosts,
+        uint32_t first, int batch, struct mmsghdr *msgs, struct iovec *iovs) {
+    long sent = 0;
+    long next = 0;
+
+    while (next < nhosts) {
+        // hosts answered in an earlier round are skipped
+        int n = 0;
+        for (; next < nhosts && n < batch; next++) {
+            if (locate(table, first + next)->used) {
+                continue;
+            }
+
+            iovs[n].iov_base = &frames[next];
+            iovs[n].iov_len = sizeof(frames[next]);
+            n++;
+        }
+
+        int done = 0;
+        while (done < n) {
+            int ret = sendmmsg(s, msgs + done, n - done, 0);
+            if (ret == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                // iface queue full, retried once it drains
+                if (errno == ENOBUFS && wait_for_room(s) == 0) {
+                    continue;
+                }
+                return -1;
+            }
+            done += ret;
+        }
+        sent += n;
+
+        if (collect_replies(r, table) == -1) {
+            return -1;
+        }
+    }
+
+    return sent;
+}
+
+
+/**
+ * Wait for replies until every host answered, or none came for a while.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int wait_replies(int r, struct arp_table *table, long nhosts) {
+    while (table->count < nhosts) {
+        struct pollfd pfd = { r, POLLIN, 0 };
+        int ready = poll(&pfd, 1, ARP_QUIET_MS);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        if (ready == 0) {
+            break;
+        }
+
+        if (collect_replies(r, table) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * qsort comparator of entries, used ones first by ip.
+ **/
+static int compare_entries(const void *a, const void *b) {
+    const struct arp_entry *x = a, *y = b;
+    if (x->used != y->used) {
+        return y->used - x->used;
+    }
+
+    return x->ip < y->ip ? -1 : x->ip > y->ip;
+}
+
+
+/**
+ * Map ip addresses of a subnet to mac addresses: arp requests for every
+ * host are blasted through one packet socket in batches, while replies
+ * are collected as they come into a table keyed by ip.
+ *
+ * Sender ip is the one given, or the first ipv4 address of iface if it
+ * is 0.0.0.0. Every round after the first asks hosts silent so far
+ * again.
+ *
+ *  Arguments
+ *      s: packet socket bound to iface.
+ *
+ *      arguments: command line arguments, see argparse.h.
+ *
+ *      fr: source mac address.
+ *
+ *      to: destination mac address, broadcast normally.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int scan_arp(int s, const struct cmdline_arguments *arguments, const unsigned char *fr, const unsigned char *to) {
+    uint32_t network, netmask;
+    if (parse_subnet(arguments->arp, &network, &netmask) == -1) {
+        fprintf(stderr, "Bad subnet given %s\n", arguments->arp);
+        return -1;
+    }
+
+    // table and frames are sized by subnet
+    if (~netmask > 0xffff) {
+        fprintf(stderr, "Subnet %s too large, /16 at most\n", arguments->arp);
+        return -1;
+    }
+
+    struct in_addr saddr;
+    if (inet_aton(arguments->saddr, &saddr) == 0) {
+        fprintf(stderr, "Bad ip address given\n");
+        return -1;
+    }
+
+    // probes from 0.0.0.0 are answered as well, if iface has no address
+    if (saddr.s_addr == INADDR_ANY) {
+        fetch_iface_addr(s, arguments->iface, &saddr);
+    }
+
+    // network and broadcast addresses are skipped but for /31 and /32
+    uint32_t first = network;
+    long nhosts = (long)(~netmask) + 1;
+    if (nhosts > 2) {
+        first++;
+        nhosts -= 2;
+    }
+
+    struct arp_table table;
+    uint32_t capacity = 16;
+    while (capacity < nhosts * 2) {
+        capacity *= 2;
+    }
+    table.entries = calloc(capacity, sizeof(*table.entries));
+    table.mask = capacity - 1;
+    table.count = 0;
+
+    int batch = arguments->batch > UIO_MAXIOV ? UIO_MAXIOV : arguments->batch;
+    struct arp_frame *frames = malloc(nhosts * sizeof(*frames));
+    struct mmsghdr *msgs = calloc(batch, sizeof(*msgs));
+    struct iovec *iovs = calloc(batch, sizeof(*iovs));
+    if (table.entries == NULL || frames == NULL || msgs == NULL || iovs == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        free(table.entries);
+        free(frames);
+        free(msgs);
+        free(iovs);
+        return -1;
+    }
+
+    int i;
+    for (i = 0; i < batch; i++) {
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    long j;
+    for (j = 0; j < nhosts; j++) {
+        build_request(&frames[j], fr, to, saddr, first + j);
+    }
+
+    int ret = 0;
+    int r = open_reply_socket(arguments->iface, network, netmask);
+    if (r == -1) {
+        perror("Fail to open socket for replies");
+        ret = -1;
+        goto out;
+    }
+
+    double start = get_timestamp();
+
+    long rounds = arguments->count == 0 ? 1 : arguments->count;
+    long sent = 0;
+    long round;
+    for (round = 0; round < rounds && table.count < nhosts; round++) {
+        long n = send_requests(s, r, &table, frames, nhosts, first, batch, msgs, iovs);
+        if (n == -1 || wait_replies(r, &table, nhosts) == -1) {
+            perror("Fail to scan");
+            ret = -1;
+            break;
+        }
+        sent += n;
+    }
+
+    double elapsed = get_timestamp() - start;
+    close(r);
+
+    qsort(table.entries, capacity, sizeof(*table.entries), compare_entries);
+    for (j = 0; j < table.count; j++) {
+        const struct arp_entry *entry = &table.entries[j];
+        struct in_addr addr = { htonl(entry->ip) };
+
+        printf("%-15s %02x:%02x:%02x:%02x:%02x:%02x", inet_ntoa(addr), entry->mac[0], entry->mac[1],
+            entry->mac[2], entry->mac[3], entry->mac[4], entry->mac[5]);
+        if (entry->conflicts > 0) {
+            printf(" %d conflicting replies", entry->conflicts);
+        }
+        printf("\n");
+    }
+
+    printf("--- %d of %ld hosts answered %ld requests in %.3fs ---\n", table.count, nhosts, sent, elapsed);
+
+out:
+    free(table.entries);
+    free(frames);
+    free(msgs);
+    free(iovs);
+
+    return ret;
+}
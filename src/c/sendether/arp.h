@@ -0,0 +1,10 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 05:02:44
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 05:02:44
+ */
+
+struct cmdline_arguments;
+
+int scan_arp(int s, const struct cmdline_arguments *arguments, const unsigned char *fr, const unsigned char *to);
@@ -0,0 +1,147 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 02:52:10
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 08:27:51
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/if_packet.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#include "link.h"
+#include "sendether.h"
+
+
+/**
+ * Bind socket with given iface.
+ *
+ *  Arguments
+ *      s: given socket.
+ *
+ *      iface: name of given iface.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int bind_iface(int s, const char *iface) {
+    return bind_iface_type(s, iface, 0);
+}
+
+
+/**
+ * Bind socket with given iface, receiving frames of given ether type.
+ *
+ *  Arguments
+ *      s: given socket.
+ *
+ *      iface: name of given iface.
+ *
+ *      type: ether type to receive, 0 for none.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int bind_iface_type(int s, const char *iface, unsigned short type) {
+    // fetch iface index
+    int if_index = fetch_iface_index(s, iface);
+    if (if_index == -1) {
+        return -1;
+    }
+
+    // fill iface index to struct sockaddr_ll for binding
+    struct sockaddr_ll sll;
+    bzero(&sll, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_ifindex = if_index;
+    sll.sll_protocol = htons(type);
+    sll.sll_pkttype = PACKET_HOST;
+
+    // call bind system call to bind socket with iface
+    if(bind(s, (struct sockaddr *)&sll, sizeof(sll)) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Pack ethernet frame
+ *
+ *  Arguments:
+ *      fr: source mac address
+ *
+ *      to: destination mac address
+ *
+ *      type: ether type
+ *
+ *      data: data for sending
+ *
+ *      data_length: length of data
+ *
+ *      frame: frame to pack
+ *
+ *  Returns:
+ *      Frame size
+ **/
+int pack_ether_frame(const unsigned char *fr, const unsigned char *to, short type,
+        const char *data, int data_length, struct ethernet_frame *frame) {
+    // fill destination MAC address
+    memcpy(frame->dst_addr, to, 6);
+
+    // fill source MAC address
+    memcpy(frame->src_addr, fr, 6);
+
+    // fill type
+    frame->type = htons(type);
+
+    // truncate if data is to long for buffer, callers check against mtu
+    if (data_length > MAX_FRAME_DATA_SIZE) {
+        data_length = MAX_FRAME_DATA_SIZE;
+    }
+
+    // fill data
+    memcpy(frame->data, data, data_length);
+
+    return FRAME_HEADER_SIZE + data_length;
+}
+
+
+/**
+ * Fetch monotonic time in seconds.
+ **/
+double get_timestamp() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+/**
+ * Wait for room to send again after ENOBUFS: until socket is writable,
+ * then a little longer, for a full iface queue leaves socket writable
+ * still, and retrying at once would only spin.
+ *
+ *  Arguments
+ *      s: socket sending failed on.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int wait_for_room(int s) {
+    struct pollfd pfd = { s, POLLOUT, 0 };
+    if (poll(&pfd, 1, 100) == -1 && errno != EINTR) {
+        return -1;
+    }
+
+    struct timespec pause = { 0, 50000 };
+    nanosleep(&pause, NULL);
+
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 02:14:26
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 08:27:51
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/if_packet.h>
+#include <linux/virtio_net.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "argparse.h"
+#include "checksum.h"
+#include "gso.h"
+#include "sendether.h"
+
+// udp segmentation, missing from older headers
+#ifndef VIRTIO_NET_HDR_GSO_UDP_L4
+#define VIRTIO_NET_HDR_GSO_UDP_L4 5
+#endif
+
+#define IP_HEADER_SIZE 20
+#define UDP_HEADER_SIZE 8
+#define HEADERS_SIZE (FRAME_HEADER_SIZE + IP_HEADER_SIZE + UDP_HEADER_SIZE)
+
+// udp payload of an ip packet of 64KB
+#define MAX_GSO_PAYLOAD_SIZE (65535 - IP_HEADER_SIZE - UDP_HEADER_SIZE)
+
+/*
+ * Super-frame handed to kernel: virtio net header telling how to segment,
+ * then headers and payload of a single udp datagram.
+ */
+struct __attribute__((__packed__)) gso_frame {
+    struct virtio_net_hdr vnet;
+
+    unsigned char dst_addr[6];
+    unsigned char src_addr[6];
+    unsigned short type;
+
+    struct iphdr ip;
+    struct udphdr udp;
+
+    unsigned char data[MAX_GSO_PAYLOAD_SIZE];
+};
+
+
+/**
+ * Build a super-frame of a udp datagram carrying size bytes of payload,
+ * to be cut by kernel into datagrams of segment_size bytes of payload.
+ *
+ * Ip checksum is complete, udp checksum is left for kernel to finish for
+ * every segment, holding the pseudo header sum only.
+ *
+ *  Returns
+ *      Bytes of super-frame, virtio net header included.
+ **/
+static int build_gso_frame(struct gso_frame *frame, const struct cmdline_arguments *arguments,
+        const unsigned char *fr, const unsigned char *to, struct in_addr saddr, struct in_addr daddr,
+        int size, int segment_size) {
+    bzero(frame, HEADERS_SIZE + sizeof(frame->vnet));
+
+    frame->vnet.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+    frame->vnet.gso_type = size > segment_size ? VIRTIO_NET_HDR_GSO_UDP_L4 : VIRTIO_NET_HDR_GSO_NONE;
+    frame->vnet.hdr_len = HEADERS_SIZE;
+    frame->vnet.gso_size = segment_size;
+    frame->vnet.csum_start = FRAME_HEADER_SIZE + IP_HEADER_SIZE;
+    frame->vnet.csum_offset = offsetof(struct udphdr, check);
+
+    memcpy(frame->dst_addr, to, 6);
+    memcpy(frame->src_addr, fr, 6);
+    frame->type = htons(0x0800);
+
+    int udp_len = UDP_HEADER_SIZE + size;
+
+    frame->ip.version = 4;
+    frame->ip.ihl = IP_HEADER_SIZE / 4;
+    frame->ip.tot_len = htons(IP_HEADER_SIZE + udp_len);
+    frame->ip.ttl = 64;
+    frame->ip.protocol = IPPROTO_UDP;
+    frame->ip.saddr = saddr.s_addr;
+    frame->ip.daddr = daddr.s_addr;
+    frame->ip.check = inet_checksum(&frame->ip, IP_HEADER_SIZE);
+
+    frame->udp.source = htons(arguments->port);
+    frame->udp.dest = htons(arguments->port);
+    frame->udp.len = htons(udp_len);
+
+    // pseudo header, kernel adds header and payload of every segment
+    uint16_t pseudo[] = { htons(IPPROTO_UDP), htons(udp_len) };
+    uint32_t sum = checksum_partial(&frame->ip.saddr, 8, 0);
+    frame->udp.check = ~checksum_fold(checksum_partial(pseudo, sizeof(pseudo), sum));
+
+    // repeat data to fill payload
+    int data_length = strlen(arguments->data);
+    int i;
+    for (i = 0; i < size; i++) {
+        frame->data[i] = arguments->data[i % data_length];
+    }
+
+    return sizeof(frame->vnet) + HEADERS_SIZE + size;
+}
+
+
+/**
+ * Send udp datagrams over ipv4 as gso super-frames through a packet
+ * socket with PACKET_VNET_HDR. Kernel, or the driver if it offloads
+ * segmentation, cuts each super-frame into datagrams fitting mtu, so a
+ * single call sends up to 64KB of payload.
+ *
+ *  Arguments
+ *      s: packet socket bound to iface.
+ *
+ *      arguments: command line arguments, see argparse.h.
+ *
+ *      fr: source mac address.
+ *
+ *      to: destination mac address.
+ *
+ *      mtu: mtu of iface.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int send_gso_frames(int s, const struct cmdline_arguments *arguments, const unsigned char *fr,
+        const unsigned char *to, int mtu) {
+    struct in_addr saddr, daddr;
+    if (inet_aton(arguments->saddr, &saddr) == 0 || inet_aton(arguments->daddr, &daddr) == 0) {
+        fprintf(stderr, "Bad ip address given\n");
+        return -1;
+    }
+
+    int size = arguments->size == 0 ? MAX_GSO_PAYLOAD_SIZE : arguments->size;
+    int segment_size = mtu - IP_HEADER_SIZE - UDP_HEADER_SIZE;
+    if (size > MAX_GSO_PAYLOAD_SIZE || segment_size <= 0 || strlen(arguments->data) == 0) {
+        fprintf(stderr, "Bad payload size, at most %d bytes\n", MAX_GSO_PAYLOAD_SIZE);
+        return -1;
+    }
+
+    int on = 1;
+    if (setsockopt(s, SOL_PACKET, PACKET_VNET_HDR, &on, sizeof(on)) == -1) {
+        perror("Fail to enable vnet header");
+        return -1;
+    }
+
+    struct gso_frame *frame = malloc(sizeof(*frame));
+    if (frame == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+
+    int frame_size = build_gso_frame(frame, arguments, fr, to, saddr, daddr, size, segment_size);
+    int segments = (size + segment_size - 1) / segment_size;
+
+    long count = arguments->count == 0 ? 1 : arguments->count;
+    double start = get_timestamp();
+
+    long sent;
+    for (sent = 0; sent < count; sent++) {
+        if (sendto(s, frame, frame_size, 0, NULL, 0) == -1) {
+            // iface queue full, retried once it drains
+            if (errno == ENOBUFS && wait_for_room(s) == 0) {
+                sent--;
+                continue;
+            }
+
+            perror("Fail to send gso frame");
+            free(frame);
+            return -1;
+        }
+    }
+
+    double elapsed = get_timestamp() - start;
+    long long bytes = (long long)sent * size;
+    printf("%ld super-frames of %d bytes sent as %ld datagrams of %d bytes at most, in %.3fs, "
+        "%.0f datagrams/s, %.1f Mbps of payload\n", sent, size, sent * segments, segment_size,
+        elapsed, sent * segments / elapsed, bytes * 8 / elapsed / 1e6);
+
+    free(frame);
+
+    return 0;
+}
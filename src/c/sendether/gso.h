@@ -0,0 +1,11 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 02:14:26
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 02:14:26
+ */
+
+struct cmdline_arguments;
+
+int send_gso_frames(int s, const struct cmdline_arguments *arguments, const unsigned char *fr,
+        const unsigned char *to, int mtu);
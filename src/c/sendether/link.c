@@ -2,10 +2,11 @@
  * Author: fasion
  * Created time: 2021-01-13 15:45:07
  * Last Modified by: fasion
- * Last Modified time: 2021-02-18 15:22:32
+ * Last Modified time: 2026-10-20 05:02:44
  */
 
 #include <net/if.h>
+#include <netinet/in.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/ioctl.h>
@@ -85,3 +86,54 @@ int fetch_iface_index(int s, const char *iface) {
 
     return ifr.ifr_ifindex;
 }
+
+
+/**
+ *  Fetch mtu of given iface, bytes of frame payload at most.
+ *
+ *  Arguments
+ *      s: socket for ioctl.
+ *
+ *      iface: name of given iface.
+ *
+ *  Returns
+ *      Mtu if success, -1 if error.
+ **/
+int fetch_iface_mtu(int s, const char *iface) {
+    struct ifreq ifr;
+    strncpy(ifr.ifr_name, iface, 15);
+
+    if (ioctl(s, SIOCGIFMTU, &ifr) == -1) {
+        return -1;
+    }
+
+    return ifr.ifr_mtu;
+}
+
+
+/**
+ *  Fetch ipv4 address of given iface, the primary one if many.
+ *
+ *  Arguments
+ *      s: socket for ioctl.
+ *
+ *      iface: name of given iface.
+ *
+ *      addr: for storing address.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int fetch_iface_addr(int s, const char *iface, struct in_addr *addr) {
+    struct ifreq ifr;
+    strncpy(ifr.ifr_name, iface, 15);
+    ifr.ifr_addr.sa_family = AF_INET;
+
+    if (ioctl(s, SIOCGIFADDR, &ifr) == -1) {
+        return -1;
+    }
+
+    *addr = ((struct sockaddr_in *)&ifr.ifr_addr)->sin_addr;
+
+    return 0;
+}
@@ -2,9 +2,13 @@
  * Author: fasion
  * Created time: 2021-01-13 15:45:17
  * Last Modified by: fasion
- * Last Modified time: 2021-02-18 15:22:10
+ * Last Modified time: 2026-10-20 05:02:44
  */
 
+#include <netinet/in.h>
+
 int mac_aton(const char *a, unsigned char *n);
 int fetch_iface_mac(int s, const char *iface, unsigned char *mac);
 int fetch_iface_index(int s, const char *iface);
+int fetch_iface_mtu(int s, const char *iface);
+int fetch_iface_addr(int s, const char *iface, struct in_addr *addr);
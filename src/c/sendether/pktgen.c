@@ -0,0 +1,620 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 22:40:18
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:37:42
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/if_packet.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "link.h"
+#include "pktgen.h"
+#include "sendether.h"
+#include "txring.h"
+#include "xsk.h"
+
+// fields varied per frame, at most
+#define MAX_FIELDS 8
+
+// sleep for waits longer than this, spin for shorter ones, in nanoseconds
+#define SPIN_THRESHOLD 50000
+
+#define NSEC_PER_SEC 1000000000LL
+
+enum field_kind {
+    // cycle through count values from the one in template
+    FIELD_CYCLE,
+
+    // frame sequence, unique over all threads
+    FIELD_SEQUENCE,
+};
+
+/*
+ * A field of template varied per frame, stored big endian.
+ */
+struct field_op {
+    enum field_kind kind;
+    int offset;
+    int width;
+
+    // value in template, and values to cycle through
+    uint32_t start;
+    uint32_t count;
+};
+
+/*
+ * Compiled frame template: bytes of the first frame, plus fields to store
+ * on top of a copy of it.
+ */
+struct frame_template {
+    unsigned char frame[FRAME_HEADER_SIZE + MAX_FRAME_DATA_SIZE];
+    int size;
+
+    struct field_op fields[MAX_FIELDS];
+    int nfields;
+};
+
+/*
+ * Sender thread, with its own socket.
+ */
+struct sender {
+    pthread_t thread;
+    int index;
+
+    const struct cmdline_arguments *arguments;
+    const struct frame_template *template;
+
+    // frames to send, 0 for endless
+    long frames;
+
+    // frames per second for this thread, 0 for unlimited
+    double rate;
+
+    // progress, read by main thread while running
+    long sent;
+
+    // lateness of bursts against schedule, in nanoseconds
+    long bursts;
+    double lateness_sum;
+    double lateness_sq_sum;
+    double lateness_max;
+
+    int error;
+
+    // thread joined by main thread
+    int joined;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_interrupt(int signum) {
+    interrupted = 1;
+}
+
+
+/**
+ * Read a big endian value of width bytes.
+ **/
+static uint32_t load_be(const unsigned char *p, int width) {
+    uint32_t value = 0;
+
+    int i;
+    for (i = 0; i < width; i++) {
+        value = (value << 8) | p[i];
+    }
+
+    return value;
+}
+
+
+/**
+ * Store a big endian value of width bytes.
+ **/
+static inline void store_be(unsigned char *p, int width, uint32_t value) {
+    if (width == 4) {
+        uint32_t be = htonl(value);
+        memcpy(p, &be, 4);
+    } else {
+        uint16_t be = htons(value);
+        memcpy(p, &be, 2);
+    }
+}
+
+
+/**
+ * Add a field described by spec to template.
+ *
+ * Spec is one of
+ *      dst:COUNT   cycle low 32 bits of destination mac through COUNT values
+ *      src:COUNT   cycle low 32 bits of source mac through COUNT values
+ *      type:COUNT  cycle ether type through COUNT values
+ *      seq:OFFSET  32 bits frame sequence at OFFSET of payload
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int compile_field(struct frame_template *template, const char *spec) {
+    if (template->nfields == MAX_FIELDS) {
+        fprintf(stderr, "Too many fields, at most %d\n", MAX_FIELDS);
+        return -1;
+    }
+
+    char name[8];
+    unsigned long value;
+    char tail;
+    if (sscanf(spec, "%7[a-z]:%lu%c", name, &value, &tail) != 2) {
+        fprintf(stderr, "Bad field given %s\n", spec);
+        return -1;
+    }
+
+    struct field_op *field = &template->fields[template->nfields];
+    field->kind = FIELD_CYCLE;
+    field->count = value;
+
+    if (strcmp(name, "dst") == 0) {
+        field->offset = 2;
+        field->width = 4;
+    } else if (strcmp(name, "src") == 0) {
+        field->offset = 8;
+        field->width = 4;
+    } else if (strcmp(name, "type") == 0) {
+        field->offset = 12;
+        field->width = 2;
+    } else if (strcmp(name, "seq") == 0) {
+        // checked before adding, or a huge offset wraps to a negative one
+        if (template->size < FRAME_HEADER_SIZE + 4 || value > (unsigned long)template->size - FRAME_HEADER_SIZE - 4) {
+            fprintf(stderr, "Field out of frame %s\n", spec);
+            return -1;
+        }
+        field->kind = FIELD_SEQUENCE;
+        field->offset = FRAME_HEADER_SIZE + value;
+        field->width = 4;
+        field->count = 0;
+    } else {
+        fprintf(stderr, "Bad field given %s\n", spec);
+        return -1;
+    }
+
+    if (field->kind == FIELD_CYCLE && (value < 1 || value > UINT32_MAX)) {
+        fprintf(stderr, "Bad field given %s\n", spec);
+        return -1;
+    }
+
+    if (field->offset + field->width > template->size) {
+        fprintf(stderr, "Field out of frame %s\n", spec);
+        return -1;
+    }
+
+    field->start = load_be(template->frame + field->offset, field->width);
+    template->nfields++;
+
+    return 0;
+}
+
+
+/**
+ * Compile template from command line arguments: addresses, type, payload
+ * repeated up to given size, and fields varied per frame. Payload is
+ * limited by mtu.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int compile_template(struct frame_template *template, const struct cmdline_arguments *arguments,
+        const unsigned char *fr, const unsigned char *to, int mtu) {
+    bzero(template, sizeof(*template));
+
+    int data_length = strlen(arguments->data);
+    int size = arguments->size == 0 ? data_length : arguments->size;
+    if (size > mtu || data_length == 0) {
+        fprintf(stderr, "Bad payload size, at most %d bytes by mtu of %s\n", mtu, arguments->iface);
+        return -1;
+    }
+
+    // header, then data repeated to fill payload in place
+    struct ethernet_frame *frame = (struct ethernet_frame *)template->frame;
+    template->size = pack_ether_frame(fr, to, arguments->type, "", 0, frame) + size;
+
+    int i;
+    for (i = 0; i < size; i++) {
+        frame->data[i] = arguments->data[i % data_length];
+    }
+
+    for (i = 0; i < arguments->nfields; i++) {
+        if (compile_field(template, arguments->fields[i]) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Render the n-th frame of a sender from template, a copy plus a store
+ * per field.
+ **/
+static inline void render_frame(const struct frame_template *template, unsigned char *buffer,
+        uint64_t n, int index, int threads) {
+    memcpy(buffer, template->frame, template->size);
+
+    int i;
+    for (i = 0; i < template->nfields; i++) {
+        const struct field_op *field = &template->fields[i];
+
+        uint32_t value;
+        if (field->kind == FIELD_SEQUENCE) {
+            value = n * threads + index;
+        } else {
+            value = field->start + n % field->count;
+        }
+
+        store_be(buffer + field->offset, field->width, value);
+    }
+}
+
+
+/**
+ * Fetch monotonic time in nanoseconds.
+ **/
+static int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+
+/**
+ * Wait until given monotonic time, sleeping most of the way and spinning
+ * the rest for precision.
+ **/
+static void wait_until(int64_t due) {
+    int64_t now = monotonic_ns();
+
+    if (due - now > SPIN_THRESHOLD) {
+        int64_t wake = due - SPIN_THRESHOLD;
+        struct timespec ts = { wake / NSEC_PER_SEC, wake % NSEC_PER_SEC };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+
+    while (monotonic_ns() < due);
+}
+
+
+/**
+ * Open a packet socket bound to iface, as main does.
+ *
+ *  Returns
+ *      Socket if success, -1 if error.
+ **/
+static int open_sender_socket(const struct cmdline_arguments *arguments) {
+    int s = socket(PF_PACKET, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (s == -1) {
+        return -1;
+    }
+
+    if (bind_iface(s, arguments->iface) == -1) {
+        close(s);
+        return -1;
+    }
+
+    if (arguments->qdisc_bypass) {
+        int on = 1;
+        if (setsockopt(s, SOL_PACKET, PACKET_QDISC_BYPASS, &on, sizeof(on)) == -1) {
+            close(s);
+            return -1;
+        }
+    }
+
+    return s;
+}
+
+
+/**
+ * Sender thread: sends bursts of frames on schedule, or as fast as possible
+ * without a rate, through tx ring, AF_XDP socket or sendto.
+ **/
+static void *run_sender(void *arg) {
+    struct sender *sender = arg;
+    const struct cmdline_arguments *arguments = sender->arguments;
+    const struct frame_template *template = sender->template;
+
+    int s = open_sender_socket(arguments);
+    if (s == -1) {
+        sender->error = errno;
+        return NULL;
+    }
+
+    struct tx_ring ring;
+    unsigned int frame_size = tx_ring_frame_size(template->size);
+    if (arguments->ring && tx_ring_setup(&ring, s, frame_size, TX_RING_SIZE / frame_size) == -1) {
+        sender->error = errno;
+        tx_ring_close(&ring);
+        close(s);
+        return NULL;
+    }
+
+    // each thread takes the iface queue of its index
+    struct xsk_socket xsk;
+    int if_index = arguments->xdp ? fetch_iface_index(s, arguments->iface) : 0;
+    if (if_index == -1) {
+        sender->error = ENODEV;
+        if (arguments->ring) {
+            tx_ring_close(&ring);
+        }
+        close(s);
+        return NULL;
+    }
+    if (arguments->xdp && xsk_setup(&xsk, if_index, sender->index, XSK_FRAME_SIZE, XSK_FRAMES) == -1) {
+        sender->error = errno;
+        xsk_close(&xsk);
+        close(s);
+        return NULL;
+    }
+
+    // wake up from sleeps on time, default slack is as long as spinning
+    prctl(PR_SET_TIMERSLACK, 1);
+
+    // frame rendered for sendto, on heap and just as long as template, for
+    // stacks of threads are small
+    unsigned char *buffer = NULL;
+    if (!arguments->ring && !arguments->xdp && (buffer = malloc(template->size)) == NULL) {
+        sender->error = ENOMEM;
+        close(s);
+        return NULL;
+    }
+
+    int burst = arguments->burst;
+    int64_t burst_interval = sender->rate > 0 ? burst * NSEC_PER_SEC / sender->rate : 0;
+    int64_t start = monotonic_ns();
+
+    uint64_t n = 0;
+    long k;
+    for (k = 0; !interrupted && (sender->frames == 0 || (long)n < sender->frames); k++) {
+        // keep schedule of bursts, and how late each one starts
+        if (burst_interval > 0) {
+            int64_t due = start + k * burst_interval;
+            wait_until(due);
+
+            double lateness = monotonic_ns() - due;
+            sender->bursts++;
+            sender->lateness_sum += lateness;
+            sender->lateness_sq_sum += lateness * lateness;
+            if (lateness > sender->lateness_max) {
+                sender->lateness_max = lateness;
+            }
+        }
+
+        int i;
+        for (i = 0; i < burst && (sender->frames == 0 || (long)n < sender->frames); i++, n++) {
+            if (arguments->ring) {
+                size_t room;
+                unsigned char *data = tx_ring_next(&ring, &room);
+                if (data == NULL) {
+                    sender->error = errno;
+                    break;
+                }
+
+                render_frame(template, data, n, sender->index, arguments->threads);
+                tx_ring_commit(&ring, template->size);
+
+                if (ring.pending >= (unsigned int)arguments->batch) {
+                    tx_ring_kick(&ring);
+                }
+            } else if (arguments->xdp) {
+                size_t room;
+                unsigned char *data = xsk_next(&xsk, &room);
+                if (data == NULL) {
+                    sender->error = errno;
+                    break;
+                }
+
+                render_frame(template, data, n, sender->index, arguments->threads);
+                xsk_commit(&xsk, template->size);
+
+                if (xsk.pending >= (unsigned int)arguments->batch && xsk_kick(&xsk) == -1) {
+                    sender->error = errno;
+                    break;
+                }
+            } else {
+                render_frame(template, buffer, n, sender->index, arguments->threads);
+                if (sendto(s, buffer, template->size, 0, NULL, 0) == -1 && errno != ENOBUFS) {
+                    sender->error = errno;
+                    break;
+                }
+            }
+        }
+
+        if (sender->error != 0) {
+            break;
+        }
+
+        // a burst leaves at once
+        if (burst_interval > 0) {
+            if (arguments->ring) {
+                tx_ring_kick(&ring);
+            } else if (arguments->xdp) {
+                xsk_kick(&xsk);
+            }
+        }
+
+        __atomic_store_n(&sender->sent, n, __ATOMIC_RELAXED);
+    }
+
+    if (arguments->ring) {
+        tx_ring_drain(&ring);
+        tx_ring_close(&ring);
+    } else if (arguments->xdp) {
+        xsk_drain(&xsk);
+        xsk_close(&xsk);
+    }
+    free(buffer);
+    close(s);
+
+    __atomic_store_n(&sender->sent, n, __ATOMIC_RELAXED);
+
+    return NULL;
+}
+
+
+/**
+ * Sum frames sent by all senders so far.
+ **/
+static long total_sent(struct sender *senders, int threads) {
+    long sent = 0;
+
+    int i;
+    for (i = 0; i < threads; i++) {
+        sent += __atomic_load_n(&senders[i].sent, __ATOMIC_RELAXED);
+    }
+
+    return sent;
+}
+
+
+/**
+ * Generate frames from a template with several sender threads, at a given
+ * rate and burst pattern or as fast as possible, reporting every second.
+ *
+ *  Arguments
+ *      arguments: command line arguments, see argparse.h.
+ *
+ *      fr: source mac address.
+ *
+ *      to: destination mac address.
+ *
+ *      mtu: mtu of iface.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int generate_frames(const struct cmdline_arguments *arguments, const unsigned char *fr, const unsigned char *to,
+        int mtu) {
+    static struct frame_template template;
+    if (compile_template(&template, arguments, fr, to, mtu) == -1) {
+        return -1;
+    }
+
+    if (arguments->xdp && template.size > XSK_FRAME_SIZE) {
+        fprintf(stderr, "Frames of %d bytes do not fit AF_XDP frames of %d\n", template.size, XSK_FRAME_SIZE);
+        return -1;
+    }
+
+    int threads = arguments->threads;
+    struct sender *senders = calloc(threads, sizeof(*senders));
+    if (senders == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+
+    signal(SIGINT, handle_interrupt);
+
+    printf("Generating %d byte frames on %s with %d threads", template.size, arguments->iface, threads);
+    if (arguments->rate > 0) {
+        printf(", %ld fps in bursts of %d", arguments->rate, arguments->burst);
+    }
+    printf("\n");
+
+    double start = get_timestamp();
+
+    int i;
+    for (i = 0; i < threads; i++) {
+        struct sender *sender = &senders[i];
+        sender->index = i;
+        sender->arguments = arguments;
+        sender->template = &template;
+        sender->frames = arguments->count / threads + (i < arguments->count % threads);
+        sender->rate = (double)arguments->rate / threads;
+
+        if (pthread_create(&sender->thread, NULL, run_sender, sender) != 0) {
+            fprintf(stderr, "Fail to create thread\n");
+            interrupted = 1;
+            threads = i;
+            break;
+        }
+    }
+
+    // report progress every second, until all senders finish
+    long last_sent = 0;
+    double last_ts = start;
+    for (;;) {
+        int running = 0;
+        for (i = 0; i < threads; i++) {
+            if (!senders[i].joined) {
+                senders[i].joined = pthread_tryjoin_np(senders[i].thread, NULL) == 0;
+                running += !senders[i].joined;
+            }
+        }
+        if (running == 0) {
+            break;
+        }
+
+        struct timespec ts = { 0, 100000000 };
+        nanosleep(&ts, NULL);
+
+        double now = get_timestamp();
+        if (now - last_ts < 1) {
+            continue;
+        }
+
+        long sent = total_sent(senders, threads);
+        double pps = (sent - last_sent) / (now - last_ts);
+        printf("[%7.1fs] %10.0f fps %10.1f Mbps\n", now - start, pps, pps * template.size * 8 / 1e6);
+        fflush(stdout);
+
+        last_sent = sent;
+        last_ts = now;
+    }
+
+    double elapsed = get_timestamp() - start;
+
+    int ret = 0;
+    long sent = 0;
+    long bursts = 0;
+    double lateness_sum = 0, lateness_sq_sum = 0, lateness_max = 0;
+    for (i = 0; i < threads; i++) {
+        struct sender *sender = &senders[i];
+        if (sender->error != 0) {
+            fprintf(stderr, "Thread %d failed: %s\n", i, strerror(sender->error));
+            ret = -1;
+        }
+
+        sent += sender->sent;
+        bursts += sender->bursts;
+        lateness_sum += sender->lateness_sum;
+        lateness_sq_sum += sender->lateness_sq_sum;
+        if (sender->lateness_max > lateness_max) {
+            lateness_max = sender->lateness_max;
+        }
+    }
+
+    printf("--- %ld frames of %d bytes sent in %.3fs, %.0f fps, %.1f Mbps ---\n", sent, template.size,
+        elapsed, sent / elapsed, sent * template.size * 8 / elapsed / 1e6);
+
+    if (bursts > 0) {
+        double mean = lateness_sum / bursts;
+        double stddev = sqrt(fmax(lateness_sq_sum / bursts - mean * mean, 0));
+        printf("burst jitter mean/stddev/max = %.3f/%.3f/%.3f us over %ld bursts\n",
+            mean / 1e3, stddev / 1e3, lateness_max / 1e3, bursts);
+    }
+
+    free(senders);
+
+    return ret;
+}
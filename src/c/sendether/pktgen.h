@@ -0,0 +1,11 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 22:40:18
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 02:08:02
+ */
+
+struct cmdline_arguments;
+
+int generate_frames(const struct cmdline_arguments *arguments, const unsigned char *fr, const unsigned char *to,
+        int mtu);
@@ -0,0 +1,180 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 03:27:33
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 09:49:05
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <linux/if_packet.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "link.h"
+#include "sendether.h"
+
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING 23
+#endif
+
+// frames received and sent back per system call
+#define REFLECT_BATCH_SIZE 64
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_interrupt(int signum) {
+    interrupted = 1;
+}
+
+
+/**
+ * Send frames received back to their source, in batches, until
+ * interrupted.
+ *
+ *  Arguments
+ *      s: packet socket bound to iface and ether type.
+ *
+ *      mac: mac address of iface, source of frames sent back.
+ *
+ *  Returns
+ *      Frames reflected.
+ **/
+static long reflect_frames(int s, const unsigned char *mac) {
+    // frames are received into and sent back from the same buffers
+    static unsigned char buffers[REFLECT_BATCH_SIZE][FRAME_HEADER_SIZE + MAX_FRAME_DATA_SIZE];
+    struct sockaddr_ll addrs[REFLECT_BATCH_SIZE];
+    struct iovec iovs[REFLECT_BATCH_SIZE];
+    struct mmsghdr rx_msgs[REFLECT_BATCH_SIZE];
+    struct mmsghdr tx_msgs[REFLECT_BATCH_SIZE];
+
+    int i;
+    for (i = 0; i < REFLECT_BATCH_SIZE; i++) {
+        iovs[i].iov_base = buffers[i];
+        iovs[i].iov_len = sizeof(buffers[i]);
+
+        bzero(&rx_msgs[i], sizeof(rx_msgs[i]));
+        rx_msgs[i].msg_hdr.msg_name = &addrs[i];
+        rx_msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        rx_msgs[i].msg_hdr.msg_iov = &iovs[i];
+        rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    long reflected = 0;
+    while (!interrupted) {
+        struct pollfd pfd = { s, POLLIN, 0 };
+        if (poll(&pfd, 1, 1000) == -1 && errno != EINTR) {
+            perror("Fail to poll");
+            break;
+        }
+
+        for (i = 0; i < REFLECT_BATCH_SIZE; i++) {
+            rx_msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        }
+
+        int n = recvmmsg(s, rx_msgs, REFLECT_BATCH_SIZE, MSG_DONTWAIT, NULL);
+        if (n == -1) {
+            if (errno != EAGAIN && errno != EINTR) {
+                perror("Fail to receive frames");
+                break;
+            }
+            continue;
+        }
+
+        // swap addresses in place, skipping frames for other hosts
+        int m = 0;
+        for (i = 0; i < n; i++) {
+            int bytes = rx_msgs[i].msg_len;
+            if (addrs[i].sll_pkttype == PACKET_OTHERHOST || bytes < FRAME_HEADER_SIZE) {
+                continue;
+            }
+
+            struct ethernet_frame *frame = (struct ethernet_frame *)buffers[i];
+            memcpy(frame->dst_addr, frame->src_addr, 6);
+            memcpy(frame->src_addr, mac, 6);
+
+            bzero(&tx_msgs[m], sizeof(tx_msgs[m]));
+            tx_msgs[m].msg_hdr.msg_iov = &iovs[i];
+            tx_msgs[m].msg_hdr.msg_iovlen = 1;
+            iovs[i].iov_len = bytes;
+            m++;
+        }
+
+        int sent = 0;
+        while (sent < m) {
+            int done = sendmmsg(s, tx_msgs + sent, m - sent, 0);
+            if (done == -1) {
+                if (errno != EINTR && errno != ENOBUFS) {
+                    perror("Fail to send frames");
+                }
+                break;
+            }
+            sent += done;
+        }
+        reflected += sent;
+
+        // restore buffers for receiving
+        for (i = 0; i < n; i++) {
+            iovs[i].iov_len = sizeof(buffers[i]);
+        }
+    }
+
+    return reflected;
+}
+
+
+int main(int argc, char *argv[]) {
+    const struct reflector_arguments *arguments = parse_reflector_arguments(argc, argv);
+    if (arguments == NULL) {
+        fprintf(stderr, "Bad command line options given\n");
+        return -1;
+    }
+
+    if (arguments->iface == NULL) {
+        fprintf(stderr, "No iface given\n");
+        return -1;
+    }
+
+    int s = socket(PF_PACKET, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (s == -1) {
+        perror("Fail to create socket");
+        return -1;
+    }
+
+    unsigned char mac[6];
+    if (fetch_iface_mac(s, arguments->iface, mac) == -1) {
+        perror("Fail to fetch mac of iface");
+        return -1;
+    }
+
+    // frames sent back are not received again
+    int on = 1;
+    if (setsockopt(s, SOL_PACKET, PACKET_IGNORE_OUTGOING, &on, sizeof(on)) == -1) {
+        perror("Fail to ignore outgoing frames");
+        return -1;
+    }
+
+    if (bind_iface_type(s, arguments->iface, arguments->type) == -1) {
+        perror("Fail to bind socket with iface");
+        return -1;
+    }
+
+    signal(SIGINT, handle_interrupt);
+    signal(SIGTERM, handle_interrupt);
+
+    printf("Reflecting frames of type %04x on %s\n", arguments->type, arguments->iface);
+    fflush(stdout);
+
+    long reflected = reflect_frames(s, mac);
+
+    printf("--- %ld frames reflected ---\n", reflected);
+    close(s);
+
+    return 0;
+}
@@ -0,0 +1,356 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 23:32:47
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:12:40
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "replay.h"
+#include "sendether.h"
+
+#define READ_CHUNK_SIZE (1 << 20)
+
+/*
+ * Frames packed back to back in a single buffer.
+ */
+struct frame_set {
+    unsigned char *buffer;
+    size_t size;
+    size_t capacity;
+
+    // offset and size of each frame
+    size_t *offsets;
+    int *sizes;
+    long count;
+    long capacity_frames;
+};
+
+
+/**
+ * Read the whole file, or stdin if path is "-".
+ *
+ *  Arguments
+ *      path: file to read.
+ *
+ *      size: for storing bytes read.
+ *
+ *  Returns
+ *      Buffer holding file content if success, to be freed by caller,
+ *      NULL if error.
+ **/
+static unsigned char *read_input(const char *path, size_t *size) {
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    unsigned char *buffer = NULL;
+    size_t capacity = 0;
+    *size = 0;
+
+    for (;;) {
+        if (capacity - *size < READ_CHUNK_SIZE) {
+            capacity = capacity * 2 + READ_CHUNK_SIZE;
+
+            unsigned char *grown = realloc(buffer, capacity);
+            if (grown == NULL) {
+                break;
+            }
+            buffer = grown;
+        }
+
+        ssize_t bytes = read(fd, buffer + *size, capacity - *size);
+        if (bytes == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            if (bytes == 0) {
+                if (fd != STDIN_FILENO) {
+                    close(fd);
+                }
+                return buffer;
+            }
+            break;
+        }
+
+        *size += bytes;
+    }
+
+    int saved = errno;
+    free(buffer);
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    errno = saved;
+
+    return NULL;
+}
+
+
+/**
+ * Pack a payload into a frame appended to frame set.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int add_frame(struct frame_set *set, const unsigned char *fr, const unsigned char *to,
+        short type, const unsigned char *payload, size_t length) {
+    if (set->count == set->capacity_frames) {
+        long capacity = set->capacity_frames * 2 + 1024;
+
+        size_t *offsets = realloc(set->offsets, capacity * sizeof(*offsets));
+        if (offsets == NULL) {
+            return -1;
+        }
+        set->offsets = offsets;
+
+        int *sizes = realloc(set->sizes, capacity * sizeof(*sizes));
+        if (sizes == NULL) {
+            return -1;
+        }
+        set->sizes = sizes;
+
+        set->capacity_frames = capacity;
+    }
+
+    if (set->capacity - set->size < FRAME_HEADER_SIZE + length) {
+        size_t capacity = set->capacity * 2 + READ_CHUNK_SIZE;
+
+        unsigned char *buffer = realloc(set->buffer, capacity);
+        if (buffer == NULL) {
+            return -1;
+        }
+        set->buffer = buffer;
+        set->capacity = capacity;
+    }
+
+    int frame_size = pack_ether_frame(fr, to, type, (const char *)payload, length,
+        (struct ethernet_frame *)(set->buffer + set->size));
+
+    set->offsets[set->count] = set->size;
+    set->sizes[set->count] = frame_size;
+    set->count++;
+    set->size += frame_size;
+
+    return 0;
+}
+
+
+/**
+ * Split input into payloads and pack a frame for each.
+ *
+ * Newline delimited payloads are lines without line feed, empty lines
+ * are skipped. Length prefixed payloads are a 16 bits big endian length
+ * followed by as many bytes. Payloads longer than mtu are refused.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int pack_payloads(struct frame_set *set, const unsigned char *input, size_t size,
+        const struct cmdline_arguments *arguments, const unsigned char *fr, const unsigned char *to, int mtu) {
+    // records of input, empty lines included, for telling which is bad
+    long record = 0;
+
+    size_t pos = 0;
+    while (pos < size) {
+        const unsigned char *payload;
+        size_t length;
+
+        record++;
+
+        if (arguments->length_prefixed) {
+            if (size - pos < 2) {
+                fprintf(stderr, "Truncated length prefix at byte %zu\n", pos);
+                return -1;
+            }
+
+            length = (input[pos] << 8) | input[pos + 1];
+            pos += 2;
+
+            if (size - pos < length) {
+                fprintf(stderr, "Truncated payload at byte %zu\n", pos);
+                return -1;
+            }
+
+            payload = input + pos;
+            pos += length;
+        } else {
+            const unsigned char *end = memchr(input + pos, '\n', size - pos);
+            length = end == NULL ? size - pos : (size_t)(end - input) - pos;
+
+            payload = input + pos;
+            pos += length + 1;
+
+            if (length == 0) {
+                continue;
+            }
+        }
+
+        if (length > (size_t)mtu) {
+            fprintf(stderr, "Payload %ld too long, %zu bytes while mtu of %s is %d\n",
+                record, length, arguments->iface, mtu);
+            return -1;
+        }
+
+        if (add_frame(set, fr, to, arguments->type, payload, length) == -1) {
+            fprintf(stderr, "Out of memory\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Send every frame of set once, batch frames per sendmmsg call.
+ *
+ *  Arguments
+ *      frames: frames sent, added to, those before an error included.
+ *
+ *      bytes: bytes of frames sent, added to likewise.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int send_frame_set(int s, const struct frame_set *set, struct mmsghdr *msgs, struct iovec *iovs, int batch,
+        long *frames, long long *bytes) {
+    long sent = 0;
+    while (sent < set->count) {
+        int n = set->count - sent < batch ? set->count - sent : batch;
+
+        int i;
+        for (i = 0; i < n; i++) {
+            iovs[i].iov_base = set->buffer + set->offsets[sent + i];
+            iovs[i].iov_len = set->sizes[sent + i];
+        }
+
+        int done = sendmmsg(s, msgs, n, 0);
+        if (done == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // iface queue full, retried once it drains
+            if (errno == ENOBUFS && wait_for_room(s) == 0) {
+                continue;
+            }
+            return -1;
+        }
+
+        // a short count leaves the rest for next call
+        for (i = 0; i < done; i++) {
+            *bytes += set->sizes[sent + i];
+        }
+        *frames += done;
+        sent += done;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Send payloads read from a file or stdin, a frame for each payload,
+ * with few sendmmsg calls.
+ *
+ * Input is read and packed into frames at first, so that the frame set
+ * can be replayed count times at full speed.
+ *
+ *  Arguments
+ *      s: packet socket bound to iface.
+ *
+ *      arguments: command line arguments, see argparse.h.
+ *
+ *      fr: source mac address.
+ *
+ *      to: destination mac address.
+ *
+ *      mtu: mtu of iface.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int replay_payloads(int s, const struct cmdline_arguments *arguments, const unsigned char *fr, const unsigned char *to,
+        int mtu) {
+    size_t size;
+    unsigned char *input = read_input(arguments->payloads, &size);
+    if (input == NULL) {
+        perror("Fail to read payloads");
+        return -1;
+    }
+
+    struct frame_set set;
+    bzero(&set, sizeof(set));
+
+    int ret = pack_payloads(&set, input, size, arguments, fr, to, mtu);
+    free(input);
+    if (ret == -1) {
+        goto out;
+    }
+
+    if (set.count == 0) {
+        fprintf(stderr, "No payload given\n");
+        ret = -1;
+        goto out;
+    }
+
+    int batch = arguments->batch > UIO_MAXIOV ? UIO_MAXIOV : arguments->batch;
+
+    // message headers point to iovecs once for all, frames are filled per call
+    struct mmsghdr *msgs = calloc(batch, sizeof(*msgs));
+    struct iovec *iovs = calloc(batch, sizeof(*iovs));
+    if (msgs == NULL || iovs == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        free(msgs);
+        free(iovs);
+        ret = -1;
+        goto out;
+    }
+
+    int i;
+    for (i = 0; i < batch; i++) {
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    long rounds = arguments->count == 0 ? 1 : arguments->count;
+    double start = get_timestamp();
+
+    long sent = 0;
+    long long bytes = 0;
+    long round;
+    for (round = 0; round < rounds; round++) {
+        if (send_frame_set(s, &set, msgs, iovs, batch, &sent, &bytes) == -1) {
+            perror("Fail to send ethernet frames");
+            ret = -1;
+            break;
+        }
+    }
+
+    double elapsed = get_timestamp() - start;
+    printf("%ld frames, %lld bytes sent in %.3fs, %.0f fps, %.1f Mbps\n", sent, bytes,
+        elapsed, sent / elapsed, bytes * 8 / elapsed / 1e6);
+
+    free(msgs);
+    free(iovs);
+
+out:
+    free(set.buffer);
+    free(set.offsets);
+    free(set.sizes);
+
+    return ret;
+}
@@ -0,0 +1,11 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 23:32:47
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 02:09:30
+ */
+
+struct cmdline_arguments;
+
+int replay_payloads(int s, const struct cmdline_arguments *arguments, const unsigned char *fr, const unsigned char *to,
+        int mtu);
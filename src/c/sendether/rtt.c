@@ -0,0 +1,562 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 03:04:51
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:36:18
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/if_packet.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+
+// after time.h, for struct timespec
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+#include "argparse.h"
+#include "hdr.h"
+#include "rtt.h"
+#include "sendether.h"
+
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING 23
+#endif
+
+#define RTT_MAGIC 0x52545431
+
+#define NSEC_PER_SEC 1000000000LL
+
+// probes tracked at once, older ones are given up
+#define RTT_WINDOW 65536
+
+// time to wait for a reply
+#define RTT_TIMEOUT NSEC_PER_SEC
+
+// highest rtt recorded, in nanoseconds
+#define RTT_HIGHEST (10 * NSEC_PER_SEC)
+
+#define CONTROL_SIZE 256
+
+/*
+ * Probe carried at the start of payload, reflected back unchanged.
+ */
+struct __attribute__((__packed__)) rtt_probe {
+    uint32_t magic;
+    uint32_t seq;
+
+    // wall clock sending time taken by user space, nanoseconds
+    uint64_t tx_ns;
+};
+
+/*
+ * Timestamps of a probe, 0 if not taken.
+ */
+struct rtt_slot {
+    uint32_t seq;
+    int sent;
+    int answered;
+
+    int64_t tx_user;
+    int64_t tx_kernel;
+    int64_t tx_hardware;
+
+    int64_t rx_user;
+    int64_t rx_kernel;
+    int64_t rx_hardware;
+};
+
+enum rtt_source {
+    SOURCE_HARDWARE,
+    SOURCE_KERNEL,
+    SOURCE_USER,
+    SOURCE_COUNT,
+};
+
+static const char *source_names[SOURCE_COUNT] = { "hardware", "kernel", "user" };
+
+/*
+ * State of a measurement.
+ */
+struct rtt_state {
+    struct rtt_slot *slots;
+
+    // probe frame, packed once and stamped per probe
+    struct ethernet_frame *frame;
+    int frame_size;
+
+    // reflected frames, at most header plus mtu
+    unsigned char *buffer;
+    int buffer_size;
+
+    struct hdr_histogram histogram;
+    long sources[SOURCE_COUNT];
+
+    long sent;
+    long received;
+
+    // probes answered but waiting for their transmit timestamp
+    long pending;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_interrupt(int signum) {
+    interrupted = 1;
+}
+
+
+/**
+ * Fetch current time of given clock in nanoseconds.
+ **/
+static int64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+
+/**
+ * Convert a timespec of struct scm_timestamping to nanoseconds.
+ **/
+static int64_t timespec_ns(const struct timespec *ts) {
+    return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+
+/**
+ * Ask driver to stamp all frames in hardware.
+ *
+ *  Returns
+ *      0 if success, -1 if driver does not support it.
+ **/
+static int enable_hardware_timestamps(int s, const char *iface) {
+    struct hwtstamp_config config = {
+        .flags = 0,
+        .tx_type = HWTSTAMP_TX_ON,
+        .rx_filter = HWTSTAMP_FILTER_ALL,
+    };
+
+    struct ifreq ifr;
+    bzero(&ifr, sizeof(ifr));
+    strncpy(ifr.ifr_name, iface, IFNAMSIZ - 1);
+    ifr.ifr_data = (void *)&config;
+
+    return ioctl(s, SIOCSHWTSTAMP, &ifr);
+}
+
+
+/**
+ * Ask kernel for transmit and receive timestamps, taken in hardware and
+ * software. Transmit timestamps are queued to error queue, numbered in
+ * sending order.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int enable_timestamps(int s) {
+    int flags = SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_TX_SOFTWARE
+        | SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RX_SOFTWARE
+        | SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_SOFTWARE
+        | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+
+    return setsockopt(s, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags));
+}
+
+
+/**
+ * Fetch software and hardware timestamps from control messages.
+ **/
+static void parse_timestamps(struct msghdr *msg, int64_t *software, int64_t *hardware, uint32_t *id) {
+    *software = 0;
+    *hardware = 0;
+
+    struct cmsghdr *cmsg;
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            // software in the first slot, raw hardware in the third
+            struct scm_timestamping tss;
+            memcpy(&tss, CMSG_DATA(cmsg), sizeof(tss));
+            *software = timespec_ns(&tss.ts[0]);
+            *hardware = timespec_ns(&tss.ts[2]);
+        } else if (cmsg->cmsg_level == SOL_PACKET && cmsg->cmsg_type == PACKET_TX_TIMESTAMP && id != NULL) {
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_errno == ENOMSG && err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+                *id = err.ee_data;
+            }
+        }
+    }
+}
+
+
+/**
+ * Record rtt of an answered probe, from the best pair of timestamps both
+ * ends have: hardware, kernel, or user space.
+ **/
+static void record_rtt(struct rtt_state *state, struct rtt_slot *slot) {
+    int64_t rtt;
+    enum rtt_source source;
+
+    if (slot->tx_hardware != 0 && slot->rx_hardware != 0) {
+        rtt = slot->rx_hardware - slot->tx_hardware;
+        source = SOURCE_HARDWARE;
+    } else if (slot->tx_kernel != 0 && slot->rx_kernel != 0) {
+        rtt = slot->rx_kernel - slot->tx_kernel;
+        source = SOURCE_KERNEL;
+    } else {
+        rtt = slot->rx_user - slot->tx_user;
+        source = SOURCE_USER;
+    }
+
+    hdr_record(&state->histogram, rtt < 0 ? 0 : rtt);
+    state->sources[source]++;
+}
+
+
+/**
+ * Read transmit timestamps from error queue.
+ **/
+static void read_tx_timestamps(int s, struct rtt_state *state) {
+    for (;;) {
+        char control[CONTROL_SIZE];
+        struct msghdr msg = {
+            .msg_control = control,
+            .msg_controllen = sizeof(control),
+        };
+
+        if (recvmsg(s, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+            return;
+        }
+
+        int64_t software, hardware;
+        uint32_t id = UINT32_MAX;
+        parse_timestamps(&msg, &software, &hardware, &id);
+        if (id == UINT32_MAX) {
+            continue;
+        }
+
+        // every send is a probe, so timestamp ids are sequence numbers
+        struct rtt_slot *slot = &state->slots[id % RTT_WINDOW];
+        if (slot->seq != id || !slot->sent) {
+            continue;
+        }
+
+        slot->tx_kernel = software;
+        slot->tx_hardware = hardware;
+
+        if (slot->answered) {
+            record_rtt(state, slot);
+            state->pending--;
+        }
+    }
+}
+
+
+/**
+ * Read reflected probes and match them with probes sent.
+ *
+ *  Returns
+ *      Sequence number of the last probe answered, -1 if none.
+ **/
+static long read_replies(int s, struct rtt_state *state) {
+    long last = -1;
+
+    for (;;) {
+        unsigned char *buffer = state->buffer;
+        char control[CONTROL_SIZE];
+        struct iovec iov = { buffer, state->buffer_size };
+        struct msghdr msg = {
+            .msg_iov = &iov,
+            .msg_iovlen = 1,
+            .msg_control = control,
+            .msg_controllen = sizeof(control),
+        };
+
+        ssize_t bytes = recvmsg(s, &msg, MSG_DONTWAIT);
+        if (bytes == -1) {
+            return last;
+        }
+
+        int64_t rx_user = clock_ns(CLOCK_REALTIME);
+        if (bytes < FRAME_HEADER_SIZE + (ssize_t)sizeof(struct rtt_probe)) {
+            continue;
+        }
+
+        struct rtt_probe probe;
+        memcpy(&probe, buffer + FRAME_HEADER_SIZE, sizeof(probe));
+        if (ntohl(probe.magic) != RTT_MAGIC) {
+            continue;
+        }
+
+        uint32_t seq = ntohl(probe.seq);
+        struct rtt_slot *slot = &state->slots[seq % RTT_WINDOW];
+        if (slot->seq != seq || !slot->sent || slot->answered) {
+            continue;
+        }
+
+        slot->answered = 1;
+        slot->rx_user = rx_user;
+        parse_timestamps(&msg, &slot->rx_kernel, &slot->rx_hardware, NULL);
+        state->received++;
+        last = seq;
+
+        // transmit timestamp is usually read by now, unless kernel takes none
+        if (slot->tx_kernel != 0 || slot->tx_hardware != 0) {
+            record_rtt(state, slot);
+        } else {
+            state->pending++;
+        }
+    }
+}
+
+
+/**
+ * Send probe of given sequence number.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int send_probe(int s, struct rtt_state *state, uint32_t seq) {
+    struct rtt_slot *slot = &state->slots[seq % RTT_WINDOW];
+
+    // probe of the same slot long ago, still waiting for transmit timestamp
+    if (slot->sent && slot->answered && slot->tx_kernel == 0 && slot->tx_hardware == 0) {
+        record_rtt(state, slot);
+        state->pending--;
+    }
+
+    bzero(slot, sizeof(*slot));
+    slot->seq = seq;
+    slot->tx_user = clock_ns(CLOCK_REALTIME);
+
+    struct rtt_probe probe = {
+        .magic = htonl(RTT_MAGIC),
+        .seq = htonl(seq),
+        .tx_ns = slot->tx_user,
+    };
+    memcpy(state->frame->data, &probe, sizeof(probe));
+
+    if (sendto(s, state->frame, state->frame_size, 0, NULL, 0) == -1) {
+        return -1;
+    }
+
+    slot->sent = 1;
+    state->sent++;
+
+    return 0;
+}
+
+
+/**
+ * Print percentiles and a histogram of rtt, with buckets doubling from
+ * the lowest one.
+ **/
+static void print_histogram(const struct rtt_state *state) {
+    const struct hdr_histogram *h = &state->histogram;
+    if (h->total_count == 0) {
+        return;
+    }
+
+    printf("rtt min/avg/p50/p90/p99/p99.9/max = %.3f/%.3f/%.3f/%.3f/%.3f/%.3f/%.3f us\n",
+        h->min / 1e3, hdr_mean(h) / 1e3, hdr_percentile(h, 50) / 1e3, hdr_percentile(h, 90) / 1e3,
+        hdr_percentile(h, 99) / 1e3, hdr_percentile(h, 99.9) / 1e3, h->max / 1e3);
+
+    printf("timestamps:");
+    int i;
+    for (i = 0; i < SOURCE_COUNT; i++) {
+        printf(" %ld %s", state->sources[i], source_names[i]);
+    }
+    printf("\n");
+
+    // bucket bounds in nanoseconds, a power of 2 times 1us
+    int64_t low = 1000;
+    while (low * 2 <= h->min) {
+        low *= 2;
+    }
+
+    for (; low <= h->max; low *= 2) {
+        int64_t high = low * 2;
+        int64_t count = hdr_count_between(h, low == 1000 && h->min < low ? 0 : low, high);
+
+        int bar = h->total_count == 0 ? 0 : count * 50 / h->total_count;
+        printf("  [%8.1f, %8.1f) us %10ld ", low / 1e3, high / 1e3, (long)count);
+        for (i = 0; i < bar; i++) {
+            putchar('#');
+        }
+        printf("\n");
+    }
+}
+
+
+/**
+ * Measure round trip time to a reflector, which sends frames of our
+ * ether type back with addresses swapped.
+ *
+ * Probes carry a sequence number and a user space sending time. Kernel
+ * and, if driver supports it, hardware timestamps of sending and
+ * receiving are preferred when both ends have them. Without a rate, a
+ * probe is sent as soon as the previous one is answered or timed out.
+ *
+ *  Arguments
+ *      s: packet socket bound to iface.
+ *
+ *      arguments: command line arguments, see argparse.h.
+ *
+ *      fr: source mac address.
+ *
+ *      to: mac address of reflector.
+ *
+ *      mtu: mtu of iface.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int measure_rtt(int s, const struct cmdline_arguments *arguments, const unsigned char *fr,
+        const unsigned char *to, int mtu) {
+    int size = arguments->size == 0 ? 46 : arguments->size;
+    if (size < (int)sizeof(struct rtt_probe) || size > mtu) {
+        fprintf(stderr, "Bad payload size, %d to %d bytes\n", (int)sizeof(struct rtt_probe), mtu);
+        return -1;
+    }
+
+    // receive reflected frames of our type, but not our own probes
+    if (bind_iface_type(s, arguments->iface, arguments->type) == -1) {
+        perror("Fail to bind socket with iface");
+        return -1;
+    }
+
+    int on = 1;
+    if (setsockopt(s, SOL_PACKET, PACKET_IGNORE_OUTGOING, &on, sizeof(on)) == -1) {
+        perror("Fail to ignore outgoing frames");
+        return -1;
+    }
+
+    int hardware = enable_hardware_timestamps(s, arguments->iface) == 0;
+    if (enable_timestamps(s) == -1) {
+        perror("Fail to enable timestamps");
+    }
+
+    struct rtt_state state;
+    bzero(&state, sizeof(state));
+    state.slots = calloc(RTT_WINDOW, sizeof(*state.slots));
+    state.frame = malloc(FRAME_HEADER_SIZE + size);
+    state.buffer_size = FRAME_HEADER_SIZE + mtu;
+    state.buffer = malloc(state.buffer_size);
+    if (state.slots == NULL || state.frame == NULL || state.buffer == NULL
+            || hdr_init(&state.histogram, RTT_HIGHEST) == -1) {
+        fprintf(stderr, "Out of memory\n");
+        free(state.slots);
+        free(state.frame);
+        free(state.buffer);
+        return -1;
+    }
+
+    // header, then data repeated to fill payload in place
+    state.frame_size = pack_ether_frame(fr, to, arguments->type, "", 0, state.frame) + size;
+    int i;
+    int data_length = strlen(arguments->data);
+    for (i = 0; i < size; i++) {
+        state.frame->data[i] = data_length == 0 ? 0 : arguments->data[i % data_length];
+    }
+
+    signal(SIGINT, handle_interrupt);
+
+    printf("RTT over %s, %d bytes payload, %s timestamps enabled\n", arguments->iface, size,
+        hardware ? "hardware and kernel" : "kernel");
+
+    int64_t interval = arguments->rate > 0 ? NSEC_PER_SEC / arguments->rate : 0;
+    int64_t start = clock_ns(CLOCK_MONOTONIC);
+    int64_t next_send = start;
+    int64_t last_send = start;
+    long last_answered = -1;
+
+    int ret = 0;
+    uint32_t seq = 0;
+    while (!interrupted) {
+        int64_t now = clock_ns(CLOCK_MONOTONIC);
+        int more = arguments->count == 0 || (long)seq < arguments->count;
+
+        // ping pong without rate, the next probe goes once the last one is done
+        int due = more && now >= next_send;
+        if (interval == 0 && seq > 0 && last_answered != (long)seq - 1 && now - last_send < RTT_TIMEOUT) {
+            due = 0;
+        }
+
+        if (due) {
+            if (send_probe(s, &state, seq) == -1 && errno != ENOBUFS) {
+                perror("Fail to send probe");
+                ret = -1;
+                break;
+            }
+
+            seq++;
+            last_send = now;
+            next_send = interval == 0 ? now : start + seq * interval;
+
+            read_tx_timestamps(s, &state);
+            continue;
+        }
+
+        // all sent, wait for the last replies
+        if (!more && (state.received == state.sent || now - last_send >= RTT_TIMEOUT)) {
+            break;
+        }
+
+        int64_t wait = more ? next_send - now : RTT_TIMEOUT - (now - last_send);
+        if (interval == 0 && more) {
+            wait = RTT_TIMEOUT - (now - last_send);
+        }
+        if (wait < 0) {
+            wait = 0;
+        }
+
+        struct timespec timeout = { wait / NSEC_PER_SEC, wait % NSEC_PER_SEC };
+        struct pollfd pfd = { s, POLLIN, 0 };
+        if (ppoll(&pfd, 1, &timeout, NULL) == -1 && errno != EINTR) {
+            perror("Fail to poll");
+            ret = -1;
+            break;
+        }
+
+        read_tx_timestamps(s, &state);
+        long answered = read_replies(s, &state);
+        if (answered != -1) {
+            last_answered = answered;
+        }
+    }
+
+    // answered probes never given a transmit timestamp fall back to user time
+    read_tx_timestamps(s, &state);
+    for (i = 0; i < RTT_WINDOW && state.pending > 0; i++) {
+        struct rtt_slot *slot = &state.slots[i];
+        if (slot->sent && slot->answered && slot->tx_kernel == 0 && slot->tx_hardware == 0) {
+            record_rtt(&state, slot);
+            state.pending--;
+        }
+    }
+
+    double elapsed = (clock_ns(CLOCK_MONOTONIC) - start) / 1e9;
+    printf("--- %ld probes sent, %ld answered, %.1f%% lost, in %.3fs ---\n", state.sent, state.received,
+        state.sent == 0 ? 0 : (state.sent - state.received) * 100.0 / state.sent, elapsed);
+    print_histogram(&state);
+
+    hdr_free(&state.histogram);
+    free(state.slots);
+    free(state.frame);
+    free(state.buffer);
+
+    return ret;
+}
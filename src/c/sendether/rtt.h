@@ -0,0 +1,11 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 03:04:51
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 03:04:51
+ */
+
+struct cmdline_arguments;
+
+int measure_rtt(int s, const struct cmdline_arguments *arguments, const unsigned char *fr,
+        const unsigned char *to, int mtu);
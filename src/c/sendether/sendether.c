@@ -2,149 +2,196 @@
  * Author: fasion
  * Created time: 2020-10-27 19:52:25
  * Last Modified by: fasion
- * Last Modified time: 2021-02-18 15:22:27
+ * Last Modified time: 2026-10-20 10:37:42
  */
 
 #include <arpa/inet.h>
+#include <errno.h>
 #include <linux/if_packet.h>
 #include <net/if.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 
 #include "argparse.h"
+#include "arp.h"
+#include "gso.h"
 #include "link.h"
-
-#define FRAME_HEADER_SIZE 14
-#define MAX_FRAME_DATA_SIZE 1500
+#include "pktgen.h"
+#include "replay.h"
+#include "rtt.h"
+#include "sendether.h"
+#include "txring.h"
+#include "xsk.h"
 
 
 /**
- * Bind socket with given iface.
+ *  Send data through given iface by ethernet protocol, using raw socket.
  *
  *  Arguments
- *      s: given socket.
+ *      s: socket for sending.
  *
- *      iface: name of given iface.
+ *      iface: name of iface for sending.
+ *
+ *      to: destination MAC address, in binary format.
+ *
+ *      type: protocol type.
+ *
+ *      data: data to send, ends with '\0'.
  *
  *  Returns
  *      0 if success, -1 if error.
  **/
-int bind_iface(int s, const char *iface) {
-    // fetch iface index
-    int if_index = fetch_iface_index(s, iface);
-    if (if_index == -1) {
+int send_ether_frame(int s, const unsigned char *fr, const unsigned char *to,
+        short type, const char *data) {
+    // construct ethernet frame, just as long as data
+    int data_length = strlen(data);
+    struct ethernet_frame *frame = malloc(FRAME_HEADER_SIZE + data_length);
+    if (frame == NULL) {
         return -1;
     }
 
-    // fill iface index to struct sockaddr_ll for binding
-    struct sockaddr_ll sll;
-    bzero(&sll, sizeof(sll));
-    sll.sll_family = AF_PACKET;
-    sll.sll_ifindex = if_index;
-    sll.sll_pkttype = PACKET_HOST;
+    // pack frame
+    int frame_size = pack_ether_frame(fr, to, type, data, data_length, frame);
 
-    // call bind system call to bind socket with iface
-    if(bind(s, (struct sockaddr *)&sll, sizeof(sll)) == -1) {
-        return -1;
-    }
+    // send the frame
+    int ret = sendto(s, frame, frame_size, 0, NULL, 0) == -1 ? -1 : 0;
+    free(frame);
 
-    return 0;
+    return ret;
 }
 
 
 /**
- * struct for an ethernet frame
+ * Send a packed frame many times, a sendto call for each.
+ *
+ *  Returns
+ *      Frames sent if success, -1 if error.
  **/
-struct __attribute__((__packed__)) ethernet_frame {
-    // destination MAC address, 6 bytes
-    unsigned char dst_addr[6];
-
-    // source MAC address, 6 bytes
-    unsigned char src_addr[6];
-
-    // type, in network byte order
-    unsigned short type;
+long send_frames_loop(int s, const struct ethernet_frame *frame, int frame_size, long count) {
+    long sent;
+    for (sent = 0; sent < count; sent++) {
+        if (sendto(s, frame, frame_size, 0, NULL, 0) == -1) {
+            return -1;
+        }
+    }
 
-    // data
-    unsigned char data[MAX_FRAME_DATA_SIZE];
-};
+    return sent;
+}
 
 
 /**
- * Pack ethernet frame
- *
- *  Arguments:
- *      fr: source mac address
+ * Send a packed frame many times through a PACKET_TX_RING, copying it into
+ * ring frames and asking kernel to send once per batch.
  *
- *      to: destination mac address
+ *  Arguments
+ *      s: packet socket bound to iface.
  *
- *      type: ether type
+ *      frame: packed frame.
  *
- *      data: data for sending
+ *      frame_size: size of packed frame.
  *
- *      data_length: length of data
+ *      count: times to send.
  *
- *      frame: frame to pack
+ *      batch: frames filled before each kick.
  *
- *  Returns:
- *      Frame size
+ *  Returns
+ *      Frames sent if success, -1 if error.
  **/
-int pack_ether_frame(const unsigned char *fr, const unsigned char *to, short type,
-        const char *data, int data_length, struct ethernet_frame *frame) {
-    // fill destination MAC address
-    memcpy(frame->dst_addr, to, 6);
-
-    // fill source MAC address
-    memcpy(frame->src_addr, fr, 6);
-
-    // fill type
-    frame->type = htons(type);
+long send_frames_ring(int s, const struct ethernet_frame *frame, int frame_size, long count, int batch) {
+    struct tx_ring ring;
+    unsigned int ring_frame_size = tx_ring_frame_size(frame_size);
+    if (tx_ring_setup(&ring, s, ring_frame_size, TX_RING_SIZE / ring_frame_size) == -1) {
+        tx_ring_close(&ring);
+        return -1;
+    }
 
-    // truncate if data is to long
-    if (data_length > MAX_FRAME_DATA_SIZE) {
-        data_length = MAX_FRAME_DATA_SIZE;
+    long sent;
+    for (sent = 0; sent < count; sent++) {
+        size_t room;
+        unsigned char *data = tx_ring_next(&ring, &room);
+        if (data == NULL) {
+            tx_ring_close(&ring);
+            return -1;
+        }
+
+        memcpy(data, frame, frame_size);
+        if (tx_ring_commit(&ring, frame_size) == -1) {
+            fprintf(stderr, "Frame refused by kernel\n");
+        }
+
+        if (ring.pending >= (unsigned int)batch && tx_ring_kick(&ring) == -1) {
+            tx_ring_close(&ring);
+            return -1;
+        }
     }
 
-    // fill data
-    memcpy(frame->data, data, data_length);
+    // wait for the last frames to leave before unmapping
+    int ret = tx_ring_drain(&ring);
+    tx_ring_close(&ring);
 
-    return FRAME_HEADER_SIZE + data_length;
+    return ret == -1 ? -1 : sent;
 }
 
 
 /**
- *  Send data through given iface by ethernet protocol, using raw socket.
+ * Send a packed frame many times through an AF_XDP socket on the first
+ * queue of iface, copying it into umem frames and kicking once per batch.
  *
  *  Arguments
- *      s: socket for sending.
+ *      if_index: index of iface.
  *
- *      iface: name of iface for sending.
+ *      frame: packed frame.
  *
- *      to: destination MAC address, in binary format.
+ *      frame_size: size of packed frame.
  *
- *      type: protocol type.
+ *      count: times to send.
  *
- *      data: data to send, ends with '\0'.
+ *      batch: frames filled before each kick.
  *
  *  Returns
- *      0 if success, -1 if error.
+ *      Frames sent if success, -1 if error.
  **/
-int send_ether_frame(int s, const unsigned char *fr, const unsigned char *to,
-        short type, const char *data) {
-    // construct ethernet frame, which can be 1514 bytes at most
-    struct ethernet_frame frame;
-
-    // pack frame
-    int frame_size = pack_ether_frame(fr, to, type, data, strlen(data), &frame);
+long send_frames_xdp(int if_index, const struct ethernet_frame *frame, int frame_size, long count, int batch) {
+    // umem frames are a page at most, jumbo frames do not fit
+    if (frame_size > XSK_FRAME_SIZE) {
+        errno = EMSGSIZE;
+        return -1;
+    }
 
-    // send the frame
-    if (sendto(s, &frame, frame_size, 0, NULL, 0) == -1) {
+    struct xsk_socket xsk;
+    if (xsk_setup(&xsk, if_index, 0, XSK_FRAME_SIZE, XSK_FRAMES) == -1) {
+        xsk_close(&xsk);
         return -1;
     }
 
-    return 0;
+    printf("AF_XDP socket bound in %s mode\n", xsk.zerocopy ? "zero copy" : "copy");
+
+    long sent;
+    for (sent = 0; sent < count; sent++) {
+        size_t room;
+        unsigned char *data = xsk_next(&xsk, &room);
+        if (data == NULL) {
+            xsk_close(&xsk);
+            return -1;
+        }
+
+        memcpy(data, frame, frame_size);
+        xsk_commit(&xsk, frame_size);
+
+        if (xsk.pending >= (unsigned int)batch && xsk_kick(&xsk) == -1) {
+            xsk_close(&xsk);
+            return -1;
+        }
+    }
+
+    // wait for the last frames to leave before unmapping
+    int ret = xsk_drain(&xsk);
+    xsk_close(&xsk);
+
+    return ret == -1 ? -1 : sent;
 }
 
 
@@ -161,19 +208,26 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "No iface given\n");
         return -1;
     }
-    if (arguments->to == NULL) {
+
+    // arp requests are broadcast unless told otherwise
+    const char *to_addr = arguments->to;
+    if (to_addr == NULL && arguments->arp != NULL) {
+        to_addr = "ff:ff:ff:ff:ff:ff";
+    }
+
+    if (to_addr == NULL) {
         fprintf(stderr, "No destination mac address given\n");
         return -1;
     }
-    if (strlen(arguments->to) < 17) {
-        fprintf(stderr, "Bad destination mac address given %s\n", arguments->to);
+    if (strlen(to_addr) < 17) {
+        fprintf(stderr, "Bad destination mac address given %s\n", to_addr);
         return -1;
     }
 
     // convert destinaction MAC address to binary format
     unsigned char to[6];
-    if (mac_aton(arguments->to, to) != 0) {
-        fprintf(stderr, "Bad destination mac address given %s\n", arguments->to);
+    if (mac_aton(to_addr, to) != 0) {
+        fprintf(stderr, "Bad destination mac address given %s\n", to_addr);
         return -1;
     }
 
@@ -197,11 +251,95 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
+    // hand frames to driver directly
+    if (arguments->qdisc_bypass) {
+        int on = 1;
+        if (setsockopt(s, SOL_PACKET, PACKET_QDISC_BYPASS, &on, sizeof(on)) == -1) {
+            perror("Fail to bypass qdisc");
+            return -1;
+        }
+    }
+
+    // payload of a frame is limited by mtu, jumbo frames included
+    int mtu = fetch_iface_mtu(s, arguments->iface);
+    if (mtu == -1) {
+        perror("Fail to fetch mtu of iface");
+        return -1;
+    }
+
+    if (arguments->arp != NULL) {
+        return scan_arp(s, arguments, fr, to);
+    }
+
+    if (arguments->rtt) {
+        return measure_rtt(s, arguments, fr, to, mtu);
+    }
+
+    if (arguments->gso) {
+        return send_gso_frames(s, arguments, fr, to, mtu);
+    }
+
+    if (arguments->generate) {
+        return generate_frames(arguments, fr, to, mtu);
+    }
+
+    if (arguments->payloads != NULL) {
+        return replay_payloads(s, arguments, fr, to, mtu);
+    }
+
+    int data_length = strlen(arguments->data);
+    if (data_length > mtu) {
+        fprintf(stderr, "Data of %d bytes exceeds mtu %d of %s\n", data_length, mtu, arguments->iface);
+        return -1;
+    }
+
     // send data
-    if (send_ether_frame(s, fr, to, arguments->type, arguments->data) == -1) {
-        perror("Fail to send ethernet frame");
+    long count = arguments->count == 0 ? 1 : arguments->count;
+    if (count == 1 && !arguments->ring && !arguments->xdp) {
+        if (send_ether_frame(s, fr, to, arguments->type, arguments->data) == -1) {
+            perror("Fail to send ethernet frame");
+            return -1;
+        }
+
+        return 0;
+    }
+
+    // bulk mode, the same frame many times
+    int if_index = arguments->xdp ? fetch_iface_index(s, arguments->iface) : 0;
+    if (if_index == -1) {
+        fprintf(stderr, "No such iface %s\n", arguments->iface);
+        return -1;
+    }
+
+    struct ethernet_frame *frame = malloc(FRAME_HEADER_SIZE + data_length);
+    if (frame == NULL) {
+        fprintf(stderr, "Out of memory\n");
         return -1;
     }
 
+    int frame_size = pack_ether_frame(fr, to, arguments->type, arguments->data, data_length, frame);
+
+    double start = get_timestamp();
+
+    long sent;
+    if (arguments->xdp) {
+        sent = send_frames_xdp(if_index, frame, frame_size, count, arguments->batch);
+    } else if (arguments->ring) {
+        sent = send_frames_ring(s, frame, frame_size, count, arguments->batch);
+    } else {
+        sent = send_frames_loop(s, frame, frame_size, count);
+    }
+
+    free(frame);
+
+    if (sent == -1) {
+        perror("Fail to send ethernet frames");
+        return -1;
+    }
+
+    double elapsed = get_timestamp() - start;
+    printf("%ld frames of %d bytes sent in %.3fs, %.0f fps, %.1f Mbps\n", sent, frame_size,
+        elapsed, sent / elapsed, sent * frame_size * 8 / elapsed / 1e6);
+
     return 0;
 }
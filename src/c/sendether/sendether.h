@@ -0,0 +1,42 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 22:31:40
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 10:37:42
+ */
+
+#define FRAME_HEADER_SIZE 14
+
+// payload is limited by mtu of iface, buffers are big enough for gso frames
+#define MAX_FRAME_DATA_SIZE (65535 - FRAME_HEADER_SIZE)
+
+// tx ring of 8MB, split into frames big enough for frames of iface
+#define TX_RING_SIZE (8 << 20)
+
+// umem frames of AF_XDP socket, power of 2 from 2048 to page size
+#define XSK_FRAME_SIZE 2048
+#define XSK_FRAMES 4096
+
+/**
+ * struct for an ethernet frame
+ **/
+struct __attribute__((__packed__)) ethernet_frame {
+    // destination MAC address, 6 bytes
+    unsigned char dst_addr[6];
+
+    // source MAC address, 6 bytes
+    unsigned char src_addr[6];
+
+    // type, in network byte order
+    unsigned short type;
+
+    // data, up to MAX_FRAME_DATA_SIZE bytes, sized by whoever allocates
+    unsigned char data[];
+};
+
+int bind_iface(int s, const char *iface);
+int bind_iface_type(int s, const char *iface, unsigned short type);
+int pack_ether_frame(const unsigned char *fr, const unsigned char *to, short type,
+        const char *data, int data_length, struct ethernet_frame *frame);
+double get_timestamp();
+int wait_for_room(int s);
@@ -0,0 +1,211 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 21:48:05
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 02:05:12
+ */
+
+#include <errno.h>
+#include <linux/if_packet.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "txring.h"
+
+// offset of frame data in a ring frame, without PACKET_TX_HAS_OFF
+#define TX_DATA_OFFSET (TPACKET2_HDRLEN - sizeof(struct sockaddr_ll))
+
+
+/**
+ * Fetch header of the i-th frame of ring.
+ **/
+static inline struct tpacket2_hdr *frame_header(const struct tx_ring *ring, unsigned int i) {
+    return (struct tpacket2_hdr *)(ring->map + (size_t)i * ring->frame_size);
+}
+
+
+/**
+ * Size of ring frames holding frames of given bytes: a power of 2, 2048
+ * at least, header included.
+ **/
+unsigned int tx_ring_frame_size(size_t frame_bytes) {
+    unsigned int frame_size = 2048;
+    while (frame_size < TX_DATA_OFFSET + frame_bytes) {
+        frame_size <<= 1;
+    }
+
+    return frame_size;
+}
+
+
+/**
+ * Set up a TPACKET_V2 transmit ring on a packet socket and map it.
+ *
+ *  Arguments
+ *      ring: ring to set up.
+ *
+ *      sock: packet socket, to be bound to an iface before sending.
+ *
+ *      frame_size: bytes per frame, header included; power of 2, see
+ *          tx_ring_frame_size.
+ *
+ *      frame_nr: number of frames.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int tx_ring_setup(struct tx_ring *ring, int sock, unsigned int frame_size, unsigned int frame_nr) {
+    bzero(ring, sizeof(*ring));
+    ring->sock = sock;
+
+    int version = TPACKET_V2;
+    if (setsockopt(sock, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) == -1) {
+        return -1;
+    }
+
+    // a block holds whole frames, use one page per block unless frames are larger
+    unsigned int block_size = getpagesize();
+    if (block_size < frame_size) {
+        block_size = frame_size;
+    }
+    unsigned int frames_per_block = block_size / frame_size;
+    if (frames_per_block == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct tpacket_req req = {
+        .tp_block_size = block_size,
+        .tp_block_nr = (frame_nr + frames_per_block - 1) / frames_per_block,
+        .tp_frame_size = frame_size,
+    };
+    req.tp_frame_nr = req.tp_block_nr * frames_per_block;
+
+    if (setsockopt(sock, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) == -1) {
+        return -1;
+    }
+
+    ring->map_size = (size_t)req.tp_block_size * req.tp_block_nr;
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, sock, 0);
+    if (ring->map == MAP_FAILED) {
+        ring->map = NULL;
+        return -1;
+    }
+
+    ring->frame_size = frame_size;
+    ring->frame_nr = req.tp_frame_nr;
+
+    return 0;
+}
+
+
+/**
+ * Fetch data area of next frame to fill, waiting for kernel to release it
+ * if the ring is full.
+ *
+ *  Arguments
+ *      ring: ring.
+ *
+ *      room: for storing bytes available in frame.
+ *
+ *  Returns
+ *      Pointer to frame data if success, NULL if error.
+ **/
+unsigned char *tx_ring_next(struct tx_ring *ring, size_t *room) {
+    struct tpacket2_hdr *hdr = frame_header(ring, ring->head);
+
+    while (__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)) {
+        // frames filled but not handed to kernel yet, kick them first
+        if (ring->pending > 0 && tx_ring_kick(ring) == -1) {
+            return NULL;
+        }
+
+        struct pollfd pfd = { .fd = ring->sock, .events = POLLOUT };
+        if (poll(&pfd, 1, -1) == -1 && errno != EINTR) {
+            return NULL;
+        }
+    }
+
+    *room = ring->frame_size - TX_DATA_OFFSET;
+    return (unsigned char *)hdr + TX_DATA_OFFSET;
+}
+
+
+/**
+ * Hand frame filled after tx_ring_next over to kernel, it is sent with the
+ * next kick.
+ *
+ *  Arguments
+ *      ring: ring.
+ *
+ *      length: bytes of frame data.
+ *
+ *  Returns
+ *      0 if success, -1 if the previous use of this frame was refused.
+ **/
+int tx_ring_commit(struct tx_ring *ring, size_t length) {
+    struct tpacket2_hdr *hdr = frame_header(ring, ring->head);
+    int refused = hdr->tp_status == TP_STATUS_WRONG_FORMAT;
+
+    hdr->tp_len = length;
+    __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+    ring->head = ring->head + 1 == ring->frame_nr ? 0 : ring->head + 1;
+    ring->pending++;
+
+    return refused ? -1 : 0;
+}
+
+
+/**
+ * Ask kernel to send all frames committed, without waiting for them.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int tx_ring_kick(struct tx_ring *ring) {
+    ring->pending = 0;
+
+    if (send(ring->sock, NULL, 0, MSG_DONTWAIT) == -1 && errno != EAGAIN && errno != ENOBUFS) {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Kick and wait until kernel has sent every frame of ring.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int tx_ring_drain(struct tx_ring *ring) {
+    if (tx_ring_kick(ring) == -1) {
+        return -1;
+    }
+
+    unsigned int i;
+    for (i = 0; i < ring->frame_nr; i++) {
+        struct tpacket2_hdr *hdr = frame_header(ring, i);
+        while (__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)) {
+            // blocking send returns once kernel went through the ring
+            if (send(ring->sock, NULL, 0, 0) == -1 && errno != EAGAIN && errno != ENOBUFS) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+void tx_ring_close(struct tx_ring *ring) {
+    if (ring->map != NULL) {
+        munmap(ring->map, ring->map_size);
+        ring->map = NULL;
+    }
+}
@@ -0,0 +1,35 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 21:48:05
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 02:05:12
+ */
+
+#include <stddef.h>
+
+/**
+ * struct for a PACKET_TX_RING mapped into user space.
+ **/
+struct tx_ring {
+    int sock;
+
+    // mapped area, frame_nr frames of frame_size bytes
+    unsigned char *map;
+    size_t map_size;
+    unsigned int frame_size;
+    unsigned int frame_nr;
+
+    // next frame to fill
+    unsigned int head;
+
+    // frames filled since last kick
+    unsigned int pending;
+};
+
+unsigned int tx_ring_frame_size(size_t frame_bytes);
+int tx_ring_setup(struct tx_ring *ring, int sock, unsigned int frame_size, unsigned int frame_nr);
+unsigned char *tx_ring_next(struct tx_ring *ring, size_t *room);
+int tx_ring_commit(struct tx_ring *ring, size_t length);
+int tx_ring_kick(struct tx_ring *ring);
+int tx_ring_drain(struct tx_ring *ring);
+void tx_ring_close(struct tx_ring *ring);
@@ -0,0 +1,328 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 01:02:37
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 01:02:37
+ */
+
+#include <errno.h>
+#include <linux/if_xdp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "xsk.h"
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+
+/**
+ * Map a ring of n entries of given size, at page offset pgoff.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int map_ring(struct xsk_ring *ring, int fd, const struct xdp_ring_offset *off,
+        unsigned int n, size_t entry_size, off_t pgoff) {
+    ring->map_size = off->desc + n * entry_size;
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, pgoff);
+    if (ring->map == MAP_FAILED) {
+        ring->map = NULL;
+        return -1;
+    }
+
+    unsigned char *base = ring->map;
+    ring->producer = (uint32_t *)(base + off->producer);
+    ring->consumer = (uint32_t *)(base + off->consumer);
+    ring->flags = (uint32_t *)(base + off->flags);
+    ring->descs = base + off->desc;
+    ring->mask = n - 1;
+
+    return 0;
+}
+
+
+/**
+ * Unmap a ring if mapped.
+ **/
+static void unmap_ring(struct xsk_ring *ring) {
+    if (ring->map != NULL) {
+        munmap(ring->map, ring->map_size);
+        ring->map = NULL;
+    }
+}
+
+
+/**
+ * Give frames sent by kernel back to free stack.
+ **/
+static void reclaim_frames(struct xsk_socket *xsk) {
+    struct xsk_ring *cq = &xsk->completion;
+
+    uint32_t head = *cq->consumer;
+    uint32_t tail = __atomic_load_n(cq->producer, __ATOMIC_ACQUIRE);
+
+    const uint64_t *addrs = cq->descs;
+    for (; head != tail; head++) {
+        xsk->free_frames[xsk->nfree++] = addrs[head & cq->mask];
+        xsk->outstanding--;
+    }
+
+    __atomic_store_n(cq->consumer, head, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * Bind socket to a queue of iface, zero copy if driver supports it,
+ * copy mode otherwise.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+static int bind_queue(struct xsk_socket *xsk, int if_index, int queue) {
+    struct sockaddr_xdp sxdp;
+    bzero(&sxdp, sizeof(sxdp));
+    sxdp.sxdp_family = AF_XDP;
+    sxdp.sxdp_ifindex = if_index;
+    sxdp.sxdp_queue_id = queue;
+    sxdp.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+
+    if (bind(xsk->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) == 0) {
+        xsk->zerocopy = 1;
+        return 0;
+    }
+
+    sxdp.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+    if (bind(xsk->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) == 0) {
+        xsk->zerocopy = 0;
+        return 0;
+    }
+
+    return -1;
+}
+
+
+/**
+ * Set up an AF_XDP socket for sending through a queue of iface.
+ *
+ * Frames are built in place in umem, described to kernel by tx ring and
+ * given back by completion ring. Fill ring is required by kernel for
+ * binding, though unused while only sending.
+ *
+ *  Arguments
+ *      xsk: socket to set up.
+ *
+ *      if_index: index of iface.
+ *
+ *      queue: queue of iface to bind with.
+ *
+ *      frame_size: bytes per umem frame, power of 2 from 2048 to page
+ *          size.
+ *
+ *      frame_nr: number of frames, power of 2.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int xsk_setup(struct xsk_socket *xsk, int if_index, int queue, unsigned int frame_size, unsigned int frame_nr) {
+    bzero(xsk, sizeof(*xsk));
+    xsk->frame_size = frame_size;
+    xsk->frame_nr = frame_nr;
+
+    xsk->fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (xsk->fd == -1) {
+        return -1;
+    }
+
+    xsk->umem_size = (size_t)frame_size * frame_nr;
+    xsk->umem = mmap(NULL, xsk->umem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (xsk->umem == MAP_FAILED) {
+        xsk->umem = NULL;
+        return -1;
+    }
+
+    xsk->free_frames = malloc(frame_nr * sizeof(*xsk->free_frames));
+    if (xsk->free_frames == NULL) {
+        return -1;
+    }
+
+    unsigned int i;
+    for (i = 0; i < frame_nr; i++) {
+        xsk->free_frames[i] = (uint64_t)(frame_nr - 1 - i) * frame_size;
+    }
+    xsk->nfree = frame_nr;
+
+    struct xdp_umem_reg reg = {
+        .addr = (uint64_t)(uintptr_t)xsk->umem,
+        .len = xsk->umem_size,
+        .chunk_size = frame_size,
+        .headroom = 0,
+    };
+    if (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) == -1) {
+        return -1;
+    }
+
+    // every frame fits in tx ring as well as completion ring
+    if (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_FILL_RING, &frame_nr, sizeof(frame_nr)) == -1
+            || setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &frame_nr, sizeof(frame_nr)) == -1
+            || setsockopt(xsk->fd, SOL_XDP, XDP_TX_RING, &frame_nr, sizeof(frame_nr)) == -1) {
+        return -1;
+    }
+
+    struct xdp_mmap_offsets off;
+    socklen_t optlen = sizeof(off);
+    if (getsockopt(xsk->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) == -1) {
+        return -1;
+    }
+
+    if (map_ring(&xsk->tx, xsk->fd, &off.tx, frame_nr, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING) == -1
+            || map_ring(&xsk->completion, xsk->fd, &off.cr, frame_nr, sizeof(uint64_t),
+                XDP_UMEM_PGOFF_COMPLETION_RING) == -1
+            || map_ring(&xsk->fill, xsk->fd, &off.fr, frame_nr, sizeof(uint64_t),
+                XDP_UMEM_PGOFF_FILL_RING) == -1) {
+        return -1;
+    }
+
+    if (bind_queue(xsk, if_index, queue) == -1) {
+        return -1;
+    }
+
+    xsk->tx_head = *xsk->tx.producer;
+
+    return 0;
+}
+
+
+/**
+ * Fetch next free umem frame for filling, reclaiming sent frames and
+ * waiting for kernel if none is free.
+ *
+ *  Arguments
+ *      xsk: socket.
+ *
+ *      room: for storing bytes available in frame.
+ *
+ *  Returns
+ *      Pointer to frame data if success, NULL if error.
+ **/
+unsigned char *xsk_next(struct xsk_socket *xsk, size_t *room) {
+    while (xsk->nfree == 0) {
+        // frames filled but not handed to kernel yet, kick them first
+        if (xsk_kick(xsk) == -1) {
+            return NULL;
+        }
+
+        if (xsk->nfree > 0) {
+            break;
+        }
+
+        struct pollfd pfd = { .fd = xsk->fd, .events = POLLOUT };
+        if (poll(&pfd, 1, 1) == -1 && errno != EINTR) {
+            return NULL;
+        }
+        reclaim_frames(xsk);
+    }
+
+    *room = xsk->frame_size;
+    return xsk->umem + xsk->free_frames[xsk->nfree - 1];
+}
+
+
+/**
+ * Describe frame filled after xsk_next in tx ring, it is sent with the
+ * next kick.
+ **/
+void xsk_commit(struct xsk_socket *xsk, size_t length) {
+    struct xdp_desc *desc = &((struct xdp_desc *)xsk->tx.descs)[xsk->tx_head & xsk->tx.mask];
+    desc->addr = xsk->free_frames[--xsk->nfree];
+    desc->len = length;
+    desc->options = 0;
+
+    xsk->tx_head++;
+    xsk->pending++;
+    xsk->outstanding++;
+}
+
+
+/**
+ * Publish committed descriptors and wake kernel up if it asks to, then
+ * reclaim frames already sent.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int xsk_kick(struct xsk_socket *xsk) {
+    if (xsk->pending > 0) {
+        __atomic_store_n(xsk->tx.producer, xsk->tx_head, __ATOMIC_RELEASE);
+        xsk->pending = 0;
+    }
+
+    // copy mode sends from within this call, zero copy driver may be busy anyway
+    if (xsk->outstanding > 0 && (!xsk->zerocopy
+            || __atomic_load_n(xsk->tx.flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP)) {
+        if (sendto(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) == -1
+                && errno != EAGAIN && errno != EBUSY && errno != ENOBUFS && errno != ENETDOWN) {
+            return -1;
+        }
+    }
+
+    reclaim_frames(xsk);
+
+    return 0;
+}
+
+
+/**
+ * Kick and wait until every frame handed over is sent.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int xsk_drain(struct xsk_socket *xsk) {
+    while (xsk->outstanding > 0) {
+        if (xsk_kick(xsk) == -1) {
+            return -1;
+        }
+
+        if (xsk->outstanding > 0) {
+            struct pollfd pfd = { .fd = xsk->fd, .events = POLLOUT };
+            if (poll(&pfd, 1, 1) == -1 && errno != EINTR) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Unmap rings and umem and close socket, after a failed setup as well.
+ **/
+void xsk_close(struct xsk_socket *xsk) {
+    unmap_ring(&xsk->tx);
+    unmap_ring(&xsk->completion);
+    unmap_ring(&xsk->fill);
+
+    if (xsk->fd != -1) {
+        close(xsk->fd);
+        xsk->fd = -1;
+    }
+
+    if (xsk->umem != NULL) {
+        munmap(xsk->umem, xsk->umem_size);
+        xsk->umem = NULL;
+    }
+
+    free(xsk->free_frames);
+    xsk->free_frames = NULL;
+}
@@ -0,0 +1,61 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 01:02:37
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 01:02:37
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * struct for a ring shared with kernel, producer and consumer are
+ * free-running indexes.
+ **/
+struct xsk_ring {
+    void *map;
+    size_t map_size;
+
+    uint32_t *producer;
+    uint32_t *consumer;
+    uint32_t *flags;
+    void *descs;
+    uint32_t mask;
+};
+
+/**
+ * struct for an AF_XDP socket used for sending, with its own umem.
+ **/
+struct xsk_socket {
+    int fd;
+
+    // umem, frame_nr frames of frame_size bytes
+    unsigned char *umem;
+    size_t umem_size;
+    unsigned int frame_size;
+    unsigned int frame_nr;
+
+    struct xsk_ring tx;
+    struct xsk_ring completion;
+    struct xsk_ring fill;
+
+    // frames owned by user space, as a stack of umem offsets
+    uint64_t *free_frames;
+    unsigned int nfree;
+
+    // next tx descriptor, published with the next kick
+    uint32_t tx_head;
+    unsigned int pending;
+
+    // frames handed over but not completed yet
+    unsigned int outstanding;
+
+    int zerocopy;
+};
+
+int xsk_setup(struct xsk_socket *xsk, int if_index, int queue, unsigned int frame_size, unsigned int frame_nr);
+unsigned char *xsk_next(struct xsk_socket *xsk, size_t *room);
+void xsk_commit(struct xsk_socket *xsk, size_t length);
+int xsk_kick(struct xsk_socket *xsk);
+int xsk_drain(struct xsk_socket *xsk);
+void xsk_close(struct xsk_socket *xsk);
@@ -0,0 +1,191 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 03:52:16
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 09:38:21
+ */
+
+#include <argp.h>
+#include <stdio.h>
+
+#include "argparse.h"
+
+
+/**
+ * opt_handler function for GNU argp.
+ **/
+static error_t opt_handler(int key, char *arg, struct argp_state *state) {
+    struct cmdline_arguments *arguments = state->input;
+
+    switch(key) {
+        case 'w':
+            arguments->watch = 1;
+            break;
+
+        case ARGP_KEY_ARGS:
+            // take all the rest as ifaces
+            arguments->ifaces = state->argv + state->next;
+            arguments->nifaces = state->argc - state->next;
+            state->next = state->argc;
+            break;
+
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Parse command line arguments given by argc, argv.
+ *
+ *  Arguments
+ *      argc: the same with main function.
+ *
+ *      argv: the same with main function.
+ *
+ *  Returns
+ *      Pointer to struct arguments if success, NULL if error.
+ **/
+const struct cmdline_arguments *parse_arguments(int argc, char *argv[]) {
+    // docs for program and options
+    static char const doc[] = "showmac: show mac address of ifaces\v"
+        "Ifaces are fetched from kernel by rtnetlink, all of them by a "
+        "single dump if none is given, listing index, name, mac, mtu and "
+        "flags. With --watch, link events keep the table current and every "
+        "change is printed: + for added, ~ for changed, - for removed.";
+    static char const args_doc[] = "[IFACE...]";
+
+    // command line options
+    static struct argp_option const options[] = {
+        // Option -w --watch: follow link events
+        {"watch", 'w', 0, 0, "keep listening to link events and print changes"},
+
+        { 0 }
+    };
+
+    static const struct argp argp = {
+        options,
+        opt_handler,
+        args_doc,
+        doc,
+        0,
+        0,
+        0,
+    };
+
+    // for storing results
+    static struct cmdline_arguments arguments = {
+        .ifaces = NULL,
+        .nifaces = 0,
+        .watch = 0,
+    };
+
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    return &arguments;
+}
+
+
+/**
+ * opt_handler function for GNU argp, of ifstat.
+ **/
+static error_t ifstat_opt_handler(int key, char *arg, struct argp_state *state) {
+    struct ifstat_arguments *arguments = state->input;
+
+    switch(key) {
+        case 'I':
+            if (sscanf(arg, "%d", &arguments->interval) != 1 || arguments->interval < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'c':
+            if (sscanf(arg, "%ld", &arguments->count) != 1 || arguments->count < 0) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
+        case 'b':
+            arguments->binary = 1;
+            break;
+
+        case 'a':
+            arguments->all = 1;
+            break;
+
+        case ARGP_KEY_ARGS:
+            // take all the rest as ifaces
+            arguments->ifaces = state->argv + state->next;
+            arguments->nifaces = state->argc - state->next;
+            state->next = state->argc;
+            break;
+
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Parse command line arguments of ifstat given by argc, argv.
+ *
+ *  Arguments
+ *      argc: the same with main function.
+ *
+ *      argv: the same with main function.
+ *
+ *  Returns
+ *      Pointer to struct arguments if success, NULL if error.
+ **/
+const struct ifstat_arguments *parse_ifstat_arguments(int argc, char *argv[]) {
+    static char const doc[] = "ifstat: sample counters of ifaces and print rates\v"
+        "Counters of all ifaces are sampled by a single RTM_GETSTATS dump "
+        "per interval. A line is printed per busy iface per sample: seconds "
+        "since start, iface, then per second rx and tx packets, bits, "
+        "errors and drops. Binary output is a struct stats_record per iface "
+        "per sample instead, see stats.h.";
+    static char const args_doc[] = "[IFACE...]";
+
+    static struct argp_option const options[] = {
+        // Option -I --interval: milliseconds between samples
+        {"interval", 'I', "MS", 0, "milliseconds between samples"},
+
+        // Option -c --count: samples to take
+        {"count", 'c', "COUNT", 0, "stop after COUNT samples, 0 for endless"},
+
+        // Option -b --binary: binary output
+        {"binary", 'b', 0, 0, "write binary records instead of lines"},
+
+        // Option -a --all: idle ifaces as well
+        {"all", 'a', 0, 0, "print idle ifaces as well"},
+
+        { 0 }
+    };
+
+    static const struct argp argp = {
+        options,
+        ifstat_opt_handler,
+        args_doc,
+        doc,
+        0,
+        0,
+        0,
+    };
+
+    static struct ifstat_arguments arguments = {
+        .ifaces = NULL,
+        .nifaces = 0,
+        .interval = 1000,
+        .count = 0,
+        .binary = 0,
+        .all = 0,
+    };
+
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    return &arguments;
+}
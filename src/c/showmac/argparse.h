@@ -0,0 +1,42 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 03:52:16
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 09:38:21
+ */
+
+/**
+ * struct for storing command line arguments.
+ **/
+struct cmdline_arguments {
+    // ifaces given, all ifaces are listed if none
+    char **ifaces;
+    int nifaces;
+
+    // keep listening to link events after listing
+    int watch;
+};
+
+/**
+ * struct for storing command line arguments of ifstat.
+ **/
+struct ifstat_arguments {
+    // ifaces given, all ifaces are sampled if none
+    char **ifaces;
+    int nifaces;
+
+    // interval between samples, in milliseconds
+    int interval;
+
+    // samples to take, 0 for endless
+    long count;
+
+    // write struct stats_record instead of lines
+    int binary;
+
+    // print idle ifaces as well
+    int all;
+};
+
+const struct cmdline_arguments *parse_arguments(int argc, char *argv[]);
+const struct ifstat_arguments *parse_ifstat_arguments(int argc, char *argv[]);
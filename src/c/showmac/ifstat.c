@@ -0,0 +1,261 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 04:31:08
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 09:38:21
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "linktable.h"
+#include "netlink.h"
+#include "stats.h"
+
+// stdout buffer, a sample of thousands of ifaces is written at once
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_interrupt(int signum) {
+    interrupted = 1;
+}
+
+
+/**
+ * qsort comparator of ifaces by index.
+ **/
+static int compare_index(const void *a, const void *b) {
+    return ((const struct iface_stats *)a)->index - ((const struct iface_stats *)b)->index;
+}
+
+
+/**
+ * Sort ifaces of sample by index, unless dumped in order already as
+ * recent kernels do.
+ **/
+static void sort_sample(struct stats_sample *sample) {
+    int i;
+    for (i = 1; i < sample->count; i++) {
+        if (sample->ifaces[i - 1].index > sample->ifaces[i].index) {
+            qsort(sample->ifaces, sample->count, sizeof(*sample->ifaces), compare_index);
+            return;
+        }
+    }
+}
+
+
+/**
+ * Find name of iface, dumping links again once per sample if unknown.
+ *
+ *  Returns
+ *      Name of iface, "?" if unknown.
+ **/
+static const char *iface_name(struct link_table *links, int fd, int index, int *reloaded) {
+    const struct link_info *link = link_table_find(links, index);
+    if (link == NULL && !*reloaded) {
+        *reloaded = 1;
+        link_table_dump(links, fd);
+        link = link_table_find(links, index);
+    }
+
+    return link == NULL ? "?" : link->name;
+}
+
+
+/**
+ * Check whether iface is one of those given, any iface if none is given.
+ **/
+static int is_wanted(const struct ifstat_arguments *arguments, const char *name) {
+    if (arguments->nifaces == 0) {
+        return 1;
+    }
+
+    int i;
+    for (i = 0; i < arguments->nifaces; i++) {
+        if (strcmp(arguments->ifaces[i], name) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Write rates of ifaces between two samples, walking both in index
+ * order. Ifaces missing from either sample are skipped.
+ *
+ *  Returns
+ *      Ifaces written.
+ **/
+static int write_rates(const struct ifstat_arguments *arguments, const struct stats_sample *prev,
+        const struct stats_sample *cur, uint64_t start, struct link_table *links, int fd) {
+    uint64_t elapsed = cur->timestamp - prev->timestamp;
+    double seconds = elapsed / 1e9;
+    double since = (cur->timestamp - start) / 1e9;
+    int reloaded = 0;
+    int written = 0;
+
+    int i, j = 0;
+    for (i = 0; i < cur->count; i++) {
+        const struct iface_stats *now = &cur->ifaces[i];
+        while (j < prev->count && prev->ifaces[j].index < now->index) {
+            j++;
+        }
+        if (j == prev->count || prev->ifaces[j].index != now->index) {
+            continue;
+        }
+        const struct iface_stats *before = &prev->ifaces[j];
+
+        // counters never go back, but for a driver resetting them
+        uint64_t deltas[IFACE_COUNTERS];
+        uint64_t any = 0;
+        int k;
+        for (k = 0; k < IFACE_COUNTERS; k++) {
+            deltas[k] = now->counters[k] >= before->counters[k] ? now->counters[k] - before->counters[k] : 0;
+            any |= deltas[k];
+        }
+
+        if (!any && !arguments->all) {
+            continue;
+        }
+
+        // names are looked up for filtering and lines only
+        const char *name = NULL;
+        if (arguments->nifaces > 0 || !arguments->binary) {
+            name = iface_name(links, fd, now->index, &reloaded);
+            if (!is_wanted(arguments, name)) {
+                continue;
+            }
+        }
+
+        if (arguments->binary) {
+            struct stats_record record;
+            record.timestamp = cur->timestamp;
+            record.index = now->index;
+            record.elapsed = elapsed;
+            record.reserved = 0;
+            memcpy(record.deltas, deltas, sizeof(deltas));
+            fwrite(&record, sizeof(record), 1, stdout);
+        } else {
+            // integer rates, formatting doubles costs most of the time
+            uint64_t rates[IFACE_COUNTERS];
+            for (k = 0; k < IFACE_COUNTERS; k++) {
+                rates[k] = deltas[k] / seconds;
+            }
+
+            printf("%.3f %s %lu %lu %lu %lu %lu %lu %lu %lu\n", since, name,
+                rates[RX_PACKETS], rates[TX_PACKETS], rates[RX_BYTES] * 8, rates[TX_BYTES] * 8,
+                rates[RX_ERRORS], rates[TX_ERRORS], rates[RX_DROPPED], rates[TX_DROPPED]);
+        }
+        written++;
+    }
+
+    return written;
+}
+
+
+int main(int argc, char *argv[]) {
+    const struct ifstat_arguments *arguments = parse_ifstat_arguments(argc, argv);
+    if (arguments == NULL) {
+        fprintf(stderr, "Bad command line options given\n");
+        return -1;
+    }
+
+    int fd = nl_open(0);
+    if (fd == -1) {
+        perror("Fail to create socket");
+        return -1;
+    }
+
+    // names are not part of statistics, they come from a link dump
+    struct link_table links;
+    link_table_init(&links);
+    if (link_table_dump(&links, fd) == -1) {
+        perror("Fail to dump ifaces");
+        return -1;
+    }
+
+    // two samples swapped every interval, allocated once for all
+    struct stats_sample samples[2];
+    stats_sample_init(&samples[0]);
+    stats_sample_init(&samples[1]);
+
+    struct stats_sample *prev = &samples[0];
+    struct stats_sample *cur = &samples[1];
+
+    if (stats_sample_dump(prev, fd) == -1) {
+        perror("Fail to dump statistics");
+        return -1;
+    }
+    sort_sample(prev);
+
+    setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+    if (!arguments->binary) {
+        printf("TIME IFACE RX_PPS TX_PPS RX_BPS TX_BPS RX_ERR TX_ERR RX_DROP TX_DROP\n");
+    }
+
+    signal(SIGINT, handle_interrupt);
+    signal(SIGTERM, handle_interrupt);
+
+    uint64_t start = prev->timestamp;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    int ret = 0;
+    long samples_taken = 0;
+    while (!interrupted && (arguments->count == 0 || samples_taken < arguments->count)) {
+        // absolute deadlines, time spent sampling does not add up
+        next.tv_nsec += (long)arguments->interval * 1000000;
+        next.tv_sec += next.tv_nsec / 1000000000;
+        next.tv_nsec %= 1000000000;
+        if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) != 0) {
+            continue;
+        }
+
+        if (stats_sample_dump(cur, fd) == -1) {
+            perror("Fail to dump statistics");
+            ret = -1;
+            break;
+        }
+        sort_sample(cur);
+
+        write_rates(arguments, prev, cur, start, &links, fd);
+        fflush(stdout);
+        samples_taken++;
+
+        struct stats_sample *swap = prev;
+        prev = cur;
+        cur = swap;
+    }
+
+    fflush(stdout);
+
+    // cost of sampling, for sizing interval against iface count
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double wall = now.tv_sec + now.tv_nsec / 1e9 - start / 1e9;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+        + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+
+    fprintf(stderr, "--- %ld samples of %d ifaces in %.3fs, %.1f%% of a cpu ---\n",
+        samples_taken, prev->count, wall, cpu * 100 / wall);
+
+    stats_sample_free(&samples[0]);
+    stats_sample_free(&samples[1]);
+    link_table_free(&links);
+    close(fd);
+
+    return ret;
+}
@@ -0,0 +1,323 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 03:52:16
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 03:52:16
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "linktable.h"
+#include "netlink.h"
+
+// kernel leaves statistics out of link messages, most of their bytes
+#ifndef RTEXT_FILTER_SKIP_STATS
+#define RTEXT_FILTER_SKIP_STATS (1 << 3)
+#endif
+
+/*
+ * RTM_GETLINK request, with room for extension mask and iface name.
+ */
+struct link_request {
+    struct nlmsghdr nlh;
+    struct ifinfomsg ifi;
+    unsigned char attrs[RTA_SPACE(sizeof(unsigned int)) + RTA_SPACE(IF_NAMESIZE)];
+};
+
+
+/**
+ * Init an empty table.
+ **/
+void link_table_init(struct link_table *table) {
+    bzero(table, sizeof(*table));
+}
+
+
+/**
+ * Free ifaces of table, leaving it empty.
+ **/
+void link_table_free(struct link_table *table) {
+    free(table->links);
+    link_table_init(table);
+}
+
+
+/**
+ * Locate index in table.
+ *
+ *  Returns
+ *      Position of iface if found, position to insert it at otherwise.
+ **/
+static int locate(const struct link_table *table, int index) {
+    int low = 0, high = table->count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (table->links[middle].index < index) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+
+/**
+ * Find iface by index.
+ *
+ *  Returns
+ *      Pointer to iface if found, NULL otherwise.
+ **/
+struct link_info *link_table_find(const struct link_table *table, int index) {
+    int pos = locate(table, index);
+    if (pos < table->count && table->links[pos].index == index) {
+        return &table->links[pos];
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Find iface by name, going through the whole table.
+ *
+ *  Returns
+ *      Pointer to iface if found, NULL otherwise.
+ **/
+struct link_info *link_table_find_name(const struct link_table *table, const char *name) {
+    int i;
+    for (i = 0; i < table->count; i++) {
+        if (strcmp(table->links[i].name, name) == 0) {
+            return &table->links[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Insert or replace iface, keeping table sorted.
+ *
+ *  Returns
+ *      LINK_ADDED, LINK_UPDATED or LINK_UNCHANGED if success, -1 if out
+ *      of memory.
+ **/
+static int store(struct link_table *table, const struct link_info *link) {
+    int pos = locate(table, link->index);
+    if (pos < table->count && table->links[pos].index == link->index) {
+        if (memcmp(&table->links[pos], link, sizeof(*link)) == 0) {
+            return LINK_UNCHANGED;
+        }
+
+        table->links[pos] = *link;
+        return LINK_UPDATED;
+    }
+
+    if (table->count == table->capacity) {
+        int capacity = table->capacity * 2 + 64;
+
+        struct link_info *links = realloc(table->links, capacity * sizeof(*links));
+        if (links == NULL) {
+            return -1;
+        }
+        table->links = links;
+        table->capacity = capacity;
+    }
+
+    // dumps come in index order, so this moves nothing but for events
+    memmove(&table->links[pos + 1], &table->links[pos], (table->count - pos) * sizeof(*link));
+    table->links[pos] = *link;
+    table->count++;
+
+    return LINK_ADDED;
+}
+
+
+/**
+ * Remove iface of index from table.
+ *
+ *  Returns
+ *      LINK_REMOVED if found, LINK_UNCHANGED otherwise.
+ **/
+static int discard(struct link_table *table, int index, struct link_info *link) {
+    int pos = locate(table, index);
+    if (pos == table->count || table->links[pos].index != index) {
+        return LINK_UNCHANGED;
+    }
+
+    *link = table->links[pos];
+    memmove(&table->links[pos], &table->links[pos + 1], (table->count - pos - 1) * sizeof(*link));
+    table->count--;
+
+    return LINK_REMOVED;
+}
+
+
+/**
+ * Decode a RTM_NEWLINK or RTM_DELLINK message.
+ *
+ *  Returns
+ *      0 if success, -1 if malformed.
+ **/
+static int decode_link(const struct nlmsghdr *nlh, struct link_info *link) {
+    if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg))) {
+        return -1;
+    }
+
+    const struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+
+    const struct rtattr *attrs[IFLA_MAX + 1];
+    if (nl_parse_attrs(attrs, IFLA_MAX, IFLA_RTA(ifi), IFLA_PAYLOAD(nlh)) == -1) {
+        return -1;
+    }
+
+    // compared as a whole, no garbage in padding or unused bytes
+    bzero(link, sizeof(*link));
+    link->index = ifi->ifi_index;
+    link->flags = ifi->ifi_flags;
+
+    if (attrs[IFLA_IFNAME] != NULL) {
+        int length = RTA_PAYLOAD(attrs[IFLA_IFNAME]);
+        if (length > IF_NAMESIZE) {
+            length = IF_NAMESIZE;
+        }
+        strncpy(link->name, RTA_DATA(attrs[IFLA_IFNAME]), length);
+        link->name[IF_NAMESIZE - 1] = '\0';
+    }
+
+    if (attrs[IFLA_ADDRESS] != NULL) {
+        link->addr_len = RTA_PAYLOAD(attrs[IFLA_ADDRESS]);
+        if (link->addr_len > LINK_ADDR_SIZE) {
+            link->addr_len = LINK_ADDR_SIZE;
+        }
+        memcpy(link->addr, RTA_DATA(attrs[IFLA_ADDRESS]), link->addr_len);
+    }
+
+    if (attrs[IFLA_MTU] != NULL && RTA_PAYLOAD(attrs[IFLA_MTU]) >= sizeof(unsigned int)) {
+        link->mtu = *(const unsigned int *)RTA_DATA(attrs[IFLA_MTU]);
+    }
+
+    return 0;
+}
+
+
+/**
+ * Apply a link message to table, a dump entry or an event.
+ *
+ *  Arguments
+ *      table: table to update.
+ *
+ *      nlh: RTM_NEWLINK or RTM_DELLINK message, others are ignored.
+ *
+ *      link: for storing iface added, updated or removed, may be NULL.
+ *
+ *  Returns
+ *      What is changed, see enum link_change, -1 if error.
+ **/
+int link_table_apply(struct link_table *table, const struct nlmsghdr *nlh, struct link_info *link) {
+    if (nlh->nlmsg_type != RTM_NEWLINK && nlh->nlmsg_type != RTM_DELLINK) {
+        return LINK_UNCHANGED;
+    }
+
+    struct link_info decoded;
+    if (decode_link(nlh, &decoded) == -1) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    int change;
+    if (nlh->nlmsg_type == RTM_NEWLINK) {
+        change = store(table, &decoded);
+        if (change == -1) {
+            errno = ENOMEM;
+            return -1;
+        }
+        if (link != NULL) {
+            *link = decoded;
+        }
+    } else {
+        struct link_info removed;
+        change = discard(table, decoded.index, &removed);
+        if (link != NULL) {
+            *link = change == LINK_REMOVED ? removed : decoded;
+        }
+    }
+
+    return change;
+}
+
+
+/**
+ * nl_handler storing every iface of a dump.
+ **/
+static int handle_link(const struct nlmsghdr *nlh, void *arg) {
+    return link_table_apply(arg, nlh, NULL) == -1 ? -1 : 0;
+}
+
+
+/**
+ * Build a RTM_GETLINK request, without statistics.
+ **/
+static void build_request(struct link_request *req, unsigned short flags) {
+    bzero(req, sizeof(*req));
+    req->nlh.nlmsg_len = NLMSG_LENGTH(sizeof(req->ifi));
+    req->nlh.nlmsg_type = RTM_GETLINK;
+    req->nlh.nlmsg_flags = NLM_F_REQUEST | flags;
+    req->ifi.ifi_family = AF_UNSPEC;
+
+    struct rtattr *rta = (struct rtattr *)((unsigned char *)&req->nlh + NLMSG_ALIGN(req->nlh.nlmsg_len));
+    rta->rta_type = IFLA_EXT_MASK;
+    rta->rta_len = RTA_LENGTH(sizeof(unsigned int));
+    *(unsigned int *)RTA_DATA(rta) = RTEXT_FILTER_SKIP_STATS;
+    req->nlh.nlmsg_len = NLMSG_ALIGN(req->nlh.nlmsg_len) + RTA_ALIGN(rta->rta_len);
+}
+
+
+/**
+ * Fill table with every iface, by a single RTM_GETLINK dump, instead of
+ * ioctls per iface per field. Ifaces already in table are updated.
+ *
+ *  Arguments
+ *      table: table to fill.
+ *
+ *      fd: rtnetlink socket, see nl_open.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int link_table_dump(struct link_table *table, int fd) {
+    struct link_request req;
+    build_request(&req, NLM_F_DUMP);
+
+    return nl_dump(fd, &req.nlh, handle_link, table);
+}
+
+
+/**
+ * Fetch a single iface by name into table.
+ *
+ *  Returns
+ *      0 if success, -1 if error, errno is ENODEV if no such iface.
+ **/
+int link_table_fetch(struct link_table *table, int fd, const char *name) {
+    if (strlen(name) >= IF_NAMESIZE) {
+        errno = ENODEV;
+        return -1;
+    }
+
+    struct link_request req;
+    build_request(&req, 0);
+
+    struct rtattr *rta = (struct rtattr *)((unsigned char *)&req.nlh + req.nlh.nlmsg_len);
+    rta->rta_type = IFLA_IFNAME;
+    rta->rta_len = RTA_LENGTH(strlen(name) + 1);
+    strcpy(RTA_DATA(rta), name);
+    req.nlh.nlmsg_len += RTA_ALIGN(rta->rta_len);
+
+    return nl_dump(fd, &req.nlh, handle_link, table);
+}
@@ -0,0 +1,55 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 03:52:16
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 03:52:16
+ */
+
+#include <net/if.h>
+#include <linux/netlink.h>
+
+// bytes of hardware address kept, infiniband ones are the longest
+#define LINK_ADDR_SIZE 20
+
+/*
+ * What is known of an iface.
+ */
+struct link_info {
+    int index;
+    char name[IF_NAMESIZE];
+
+    unsigned char addr[LINK_ADDR_SIZE];
+    int addr_len;
+
+    unsigned int mtu;
+
+    // IFF_* flags
+    unsigned int flags;
+};
+
+/*
+ * Ifaces sorted by index, for binary search.
+ */
+struct link_table {
+    struct link_info *links;
+    int count;
+    int capacity;
+};
+
+/*
+ * What applying a message did to table.
+ */
+enum link_change {
+    LINK_UNCHANGED,
+    LINK_ADDED,
+    LINK_UPDATED,
+    LINK_REMOVED,
+};
+
+void link_table_init(struct link_table *table);
+void link_table_free(struct link_table *table);
+int link_table_dump(struct link_table *table, int fd);
+int link_table_fetch(struct link_table *table, int fd, const char *name);
+int link_table_apply(struct link_table *table, const struct nlmsghdr *nlh, struct link_info *link);
+struct link_info *link_table_find(const struct link_table *table, int index);
+struct link_info *link_table_find_name(const struct link_table *table, const char *name);
@@ -0,0 +1,178 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 03:52:16
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 03:52:16
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "netlink.h"
+
+// socket buffer, so that event bursts or big dumps are not dropped
+#define NL_SOCKET_BUFFER_SIZE (4 << 20)
+
+
+/**
+ * Open a rtnetlink socket, subscribed to multicast groups if any.
+ *
+ *  Arguments
+ *      groups: RTMGRP_* bits to subscribe, 0 for requests only.
+ *
+ *  Returns
+ *      Socket if success, -1 if error.
+ **/
+int nl_open(unsigned int groups) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd == -1) {
+        return -1;
+    }
+
+    // failing is fine, default size works but for big bursts
+    int size = NL_SOCKET_BUFFER_SIZE;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    // kernel checks dump requests strictly and skips unasked attributes
+    int on = 1;
+    setsockopt(fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &on, sizeof(on));
+
+    struct sockaddr_nl addr;
+    bzero(&addr, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = groups;
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    return fd;
+}
+
+
+/**
+ * Send a request to kernel, with a fresh sequence number.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int nl_send(int fd, struct nlmsghdr *nlh) {
+    static unsigned int seq = 0;
+    nlh->nlmsg_seq = ++seq;
+    nlh->nlmsg_pid = 0;
+
+    struct sockaddr_nl addr;
+    bzero(&addr, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+
+    ssize_t bytes;
+    do {
+        bytes = sendto(fd, nlh, nlh->nlmsg_len, 0, (struct sockaddr *)&addr, sizeof(addr));
+    } while (bytes == -1 && errno == EINTR);
+
+    return bytes == -1 ? -1 : 0;
+}
+
+
+/**
+ * Send a dump request and call handler for every message of the reply,
+ * until kernel says done. A whole dump takes a single request, kernel
+ * packs as many messages as fit into every read.
+ *
+ *  Arguments
+ *      fd: rtnetlink socket, not subscribed to any group.
+ *
+ *      nlh: request, NLM_F_DUMP set.
+ *
+ *      handler: called for every message but control ones.
+ *
+ *      arg: passed to handler.
+ *
+ *  Returns
+ *      0 if success, -1 if error, with errno set by kernel if refused.
+ **/
+int nl_dump(int fd, struct nlmsghdr *nlh, nl_handler handler, void *arg) {
+    if (nl_send(fd, nlh) == -1) {
+        return -1;
+    }
+
+    unsigned int seq = nlh->nlmsg_seq;
+
+    // aligned for message headers, reused by every call
+    static unsigned char buffer[NL_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+    for (;;) {
+        ssize_t bytes = recv(fd, buffer, sizeof(buffer), 0);
+        if (bytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        int length = bytes;
+        const struct nlmsghdr *msg;
+        for (msg = (const struct nlmsghdr *)buffer; NLMSG_OK(msg, length); msg = NLMSG_NEXT(msg, length)) {
+            // left over from an earlier request
+            if (msg->nlmsg_seq != seq) {
+                continue;
+            }
+
+            if (msg->nlmsg_type == NLMSG_DONE) {
+                return 0;
+            }
+
+            if (msg->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr *err = NLMSG_DATA(msg);
+                if (err->error == 0) {
+                    return 0;
+                }
+                errno = -err->error;
+                return -1;
+            }
+
+            if (handler(msg, arg) == -1) {
+                return -1;
+            }
+        }
+
+        // reply in a single message, not a multipart dump
+        if ((nlh->nlmsg_flags & NLM_F_DUMP) != NLM_F_DUMP) {
+            return 0;
+        }
+    }
+}
+
+
+/**
+ * Index attributes by type, later ones win.
+ *
+ *  Arguments
+ *      attrs: for storing attributes, max + 1 entries, NULL if missing.
+ *
+ *      max: greatest attribute type wanted.
+ *
+ *      rta: first attribute.
+ *
+ *      length: bytes of attributes.
+ *
+ *  Returns
+ *      0 if success, -1 if attributes are truncated.
+ **/
+int nl_parse_attrs(const struct rtattr **attrs, int max, const struct rtattr *rta, int length) {
+    memset(attrs, 0, sizeof(*attrs) * (max + 1));
+
+    for (; RTA_OK(rta, length); rta = RTA_NEXT(rta, length)) {
+        unsigned short type = rta->rta_type & NLA_TYPE_MASK;
+        if (type <= max) {
+            attrs[type] = rta;
+        }
+    }
+
+    return length == 0 ? 0 : -1;
+}
@@ -0,0 +1,23 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 03:52:16
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 03:52:16
+ */
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+// bytes of receive buffer, large enough for a multipart dump message
+#define NL_BUFFER_SIZE (64 << 10)
+
+/*
+ * Handler called for every message of a dump, returns 0 to go on, -1 to
+ * abort.
+ */
+typedef int (*nl_handler)(const struct nlmsghdr *nlh, void *arg);
+
+int nl_open(unsigned int groups);
+int nl_send(int fd, struct nlmsghdr *nlh);
+int nl_dump(int fd, struct nlmsghdr *nlh, nl_handler handler, void *arg);
+int nl_parse_attrs(const struct rtattr **attrs, int max, const struct rtattr *rta, int length);
@@ -2,60 +2,284 @@
  * Author: fasion
  * Created time: 2020-10-27 19:40:17
  * Last Modified by: fasion
- * Last Modified time: 2020-10-30 10:52:08
+ * Last Modified time: 2026-10-20 03:52:16
  */
 
+#include <errno.h>
 #include <net/if.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <unistd.h>
+
+#include "argparse.h"
+#include "linktable.h"
+#include "netlink.h"
+
+// missing from net/if.h, which clashes with linux/if.h
+#ifndef IFF_LOWER_UP
+#define IFF_LOWER_UP (1 << 16)
+#endif
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_interrupt(int signum) {
+    interrupted = 1;
+}
+
 
 /**
  *  Convert binary MAC address to readable format.
  *
  *  Arguments
- *      n: binary format, must be 6 bytes.
+ *      n: binary format.
+ *
+ *      len: bytes of binary format, at most LINK_ADDR_SIZE.
+ *
+ *      a: buffer for readable format, 3 * LINK_ADDR_SIZE bytes at least
+ *          (`\0` included).
+ **/
+void mac_ntoa(const unsigned char *n, int len, char *a) {
+    // no address at all, like tunnels
+    if (len == 0) {
+        strcpy(a, "-");
+        return;
+    }
+
+    // traverse bytes one by one
+    int i;
+    for (i = 0; i < len; i++) {
+        sprintf(a + i * 3, "%02x:", n[i]);
+    }
+
+    // no colon after the last byte
+    a[len * 3 - 1] = '\0';
+}
+
+
+/**
+ * Convert iface flags to readable format, like UP,BROADCAST,RUNNING.
+ *
+ *  Arguments
+ *      flags: IFF_* flags.
+ *
+ *      a: buffer for readable format, 128 bytes at least.
+ **/
+static void flags_ntoa(unsigned int flags, char *a) {
+    static const struct {
+        unsigned int flag;
+        const char *name;
+    } names[] = {
+        { IFF_UP, "UP" },
+        { IFF_BROADCAST, "BROADCAST" },
+        { IFF_LOOPBACK, "LOOPBACK" },
+        { IFF_POINTOPOINT, "POINTOPOINT" },
+        { IFF_RUNNING, "RUNNING" },
+        { IFF_NOARP, "NOARP" },
+        { IFF_PROMISC, "PROMISC" },
+        { IFF_ALLMULTI, "ALLMULTI" },
+        { IFF_MULTICAST, "MULTICAST" },
+        { IFF_LOWER_UP, "LOWER_UP" },
+    };
+
+    a[0] = '\0';
+
+    unsigned int i;
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (flags & names[i].flag) {
+            if (a[0] != '\0') {
+                strcat(a, ",");
+            }
+            strcat(a, names[i].name);
+        }
+    }
+}
+
+
+/**
+ * Print an iface as a table row, after a mark if any.
+ **/
+static void print_link(const char *mark, const struct link_info *link) {
+    char mac[3 * LINK_ADDR_SIZE];
+    mac_ntoa(link->addr, link->addr_len, mac);
+
+    char flags[128];
+    flags_ntoa(link->flags, flags);
+
+    printf("%s%-7d %-16s %-18s %-6u %s\n", mark, link->index, link->name, mac, link->mtu, flags);
+}
+
+
+/**
+ * Check whether iface is one of those given, any iface if none is given.
+ **/
+static int is_wanted(const struct cmdline_arguments *arguments, const char *name) {
+    if (arguments->nifaces == 0) {
+        return 1;
+    }
+
+    int i;
+    for (i = 0; i < arguments->nifaces; i++) {
+        if (strcmp(arguments->ifaces[i], name) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Keep table current by link events and print every change of ifaces
+ * wanted, until interrupted.
+ *
+ * Event socket is subscribed before table is dumped, so no change is
+ * missed in between; events already seen by dump change nothing. If
+ * kernel drops events as socket buffer overflows, table is dumped again.
  *
- *      a: buffer for readable format, 18 bytes at least(`\0` included).
+ *  Returns
+ *      0 if success, -1 if error.
  **/
-void mac_ntoa(unsigned char *n, char *a) {
-    // traverse 6 bytes one by one
-    sprintf(a, "%02x:%02x:%02x:%02x:%02x:%02x", n[0], n[1], n[2], n[3], n[4], n[5]);
+static int watch_links(const struct cmdline_arguments *arguments, struct link_table *table, int events, int fd) {
+    static unsigned char buffer[NL_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+    signal(SIGINT, handle_interrupt);
+    signal(SIGTERM, handle_interrupt);
+
+    fflush(stdout);
+
+    while (!interrupted) {
+        // signals restart recv, poll wakes up to check them
+        struct pollfd pfd = { events, POLLIN, 0 };
+        int ready = poll(&pfd, 1, 1000);
+        if (ready == -1 && errno != EINTR) {
+            perror("Fail to poll");
+            return -1;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+
+        ssize_t bytes = recv(events, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (bytes == -1) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+
+            if (errno == ENOBUFS) {
+                link_table_free(table);
+                if (link_table_dump(table, fd) == -1) {
+                    perror("Fail to dump ifaces");
+                    return -1;
+                }
+
+                printf("--- events lost, %d ifaces reloaded ---\n", table->count);
+                fflush(stdout);
+                continue;
+            }
+
+            perror("Fail to receive link events");
+            return -1;
+        }
+
+        int length = bytes;
+        const struct nlmsghdr *nlh;
+        for (nlh = (const struct nlmsghdr *)buffer; NLMSG_OK(nlh, length); nlh = NLMSG_NEXT(nlh, length)) {
+            struct link_info link;
+            int change = link_table_apply(table, nlh, &link);
+            if (change == -1) {
+                perror("Fail to apply link event");
+                continue;
+            }
+
+            if (change == LINK_UNCHANGED || !is_wanted(arguments, link.name)) {
+                continue;
+            }
+
+            print_link(change == LINK_ADDED ? "+ " : change == LINK_UPDATED ? "~ " : "- ", &link);
+        }
+
+        fflush(stdout);
+    }
+
+    return 0;
 }
 
 
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "no iface given\n");
+    const struct cmdline_arguments *arguments = parse_arguments(argc, argv);
+    if (arguments == NULL) {
+        fprintf(stderr, "Bad command line options given\n");
         return 1;
     }
 
-    // create a socket, any type is ok
-    int s = socket(AF_INET, SOCK_STREAM, 0);
-    if (-1 == s) {
+    // subscribe before dumping, for watching
+    int events = -1;
+    if (arguments->watch) {
+        events = nl_open(RTMGRP_LINK);
+        if (events == -1) {
+            perror("Fail to subscribe link events");
+            return 2;
+        }
+    }
+
+    int fd = nl_open(0);
+    if (fd == -1) {
         perror("Fail to create socket");
         return 2;
     }
 
-    // fill iface name to struct ifreq
-    struct ifreq ifr;
-    strncpy(ifr.ifr_name, argv[1], 15);
+    struct link_table table;
+    link_table_init(&table);
 
-    // call ioctl to get hardware address
-    int ret = ioctl(s, SIOCGIFHWADDR, &ifr);
-    if (-1 == ret) {
+    // a single iface is asked for alone, more take a dump of all
+    int ret;
+    if (arguments->nifaces == 1 && !arguments->watch) {
+        ret = link_table_fetch(&table, fd, arguments->ifaces[0]);
+    } else {
+        ret = link_table_dump(&table, fd);
+    }
+
+    if (ret == -1) {
         perror("Fail to get mac address");
         return 3;
     }
 
-    // convert to readable format
-    char mac[18];
-    mac_ntoa((unsigned char *)ifr.ifr_hwaddr.sa_data, mac);
+    if (arguments->nifaces == 0) {
+        printf("%s%-7s %-16s %-18s %-6s %s\n", arguments->watch ? "  " : "", "INDEX", "IFACE", "MAC", "MTU", "FLAGS");
 
-    // output result
-    printf("IFace: %s\n", ifr.ifr_name);
-    printf("MAC: %s\n", mac);
+        int i;
+        for (i = 0; i < table.count; i++) {
+            print_link(arguments->watch ? "  " : "", &table.links[i]);
+        }
+    } else {
+        int i;
+        for (i = 0; i < arguments->nifaces; i++) {
+            const struct link_info *link = link_table_find_name(&table, arguments->ifaces[i]);
+            if (link == NULL) {
+                fprintf(stderr, "Fail to get mac address of %s: %s\n", arguments->ifaces[i], strerror(ENODEV));
+                return 3;
+            }
 
-    return 0;
+            // convert to readable format
+            char mac[3 * LINK_ADDR_SIZE];
+            mac_ntoa(link->addr, link->addr_len, mac);
+
+            // output result
+            printf("IFace: %s\n", link->name);
+            printf("MAC: %s\n", mac);
+        }
+    }
+
+    if (arguments->watch) {
+        ret = watch_links(arguments, &table, events, fd);
+        close(events);
+    }
+
+    close(fd);
+    link_table_free(&table);
+
+    return ret == -1 ? 3 : 0;
 }
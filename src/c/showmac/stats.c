@@ -0,0 +1,121 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 04:31:08
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 04:31:08
+ */
+
+#include <errno.h>
+#include <linux/if_link.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#include "netlink.h"
+#include "stats.h"
+
+/*
+ * RTM_GETSTATS request.
+ */
+struct stats_request {
+    struct nlmsghdr nlh;
+    struct if_stats_msg ifsm;
+};
+
+
+/**
+ * Init an empty sample.
+ **/
+void stats_sample_init(struct stats_sample *sample) {
+    bzero(sample, sizeof(*sample));
+}
+
+
+/**
+ * Free ifaces of sample, leaving it empty.
+ **/
+void stats_sample_free(struct stats_sample *sample) {
+    free(sample->ifaces);
+    stats_sample_init(sample);
+}
+
+
+/**
+ * nl_handler appending counters of an iface to sample.
+ **/
+static int handle_stats(const struct nlmsghdr *nlh, void *arg) {
+    struct stats_sample *sample = arg;
+
+    if (nlh->nlmsg_type != RTM_NEWSTATS || nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct if_stats_msg))) {
+        return 0;
+    }
+
+    const struct if_stats_msg *ifsm = NLMSG_DATA(nlh);
+    const struct rtattr *rta = (const struct rtattr *)((const unsigned char *)ifsm + NLMSG_ALIGN(sizeof(*ifsm)));
+    int length = nlh->nlmsg_len - NLMSG_LENGTH(NLMSG_ALIGN(sizeof(*ifsm)));
+
+    const struct rtattr *attrs[IFLA_STATS_MAX + 1];
+    if (nl_parse_attrs(attrs, IFLA_STATS_MAX, rta, length) == -1) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    rta = attrs[IFLA_STATS_LINK_64];
+    if (rta == NULL || RTA_PAYLOAD(rta) < sizeof(((struct iface_stats *)0)->counters)) {
+        return 0;
+    }
+
+    // grows while ifaces are added only, samples after reuse the space
+    if (sample->count == sample->capacity) {
+        int capacity = sample->capacity * 2 + 256;
+
+        struct iface_stats *ifaces = realloc(sample->ifaces, capacity * sizeof(*ifaces));
+        if (ifaces == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        sample->ifaces = ifaces;
+        sample->capacity = capacity;
+    }
+
+    struct iface_stats *iface = &sample->ifaces[sample->count++];
+    iface->index = ifsm->ifindex;
+    memcpy(iface->counters, RTA_DATA(rta), sizeof(iface->counters));
+
+    return 0;
+}
+
+
+/**
+ * Sample counters of every iface by a single RTM_GETSTATS dump, asking
+ * for 64 bits link statistics only.
+ *
+ *  Arguments
+ *      sample: for storing counters, ones stored before are replaced.
+ *
+ *      fd: rtnetlink socket, see nl_open.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int stats_sample_dump(struct stats_sample *sample, int fd) {
+    struct stats_request req;
+    bzero(&req, sizeof(req));
+    req.nlh.nlmsg_len = sizeof(req);
+    req.nlh.nlmsg_type = RTM_GETSTATS;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.ifsm.family = AF_UNSPEC;
+    req.ifsm.filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+
+    sample->count = 0;
+    if (nl_dump(fd, &req.nlh, handle_stats, sample) == -1) {
+        return -1;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    sample->timestamp = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-20 04:31:08
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-20 04:31:08
+ */
+
+#include <stdint.h>
+
+/*
+ * Counters sampled, the first fields of struct rtnl_link_stats64 in the
+ * same order.
+ */
+enum iface_counter {
+    RX_PACKETS,
+    TX_PACKETS,
+    RX_BYTES,
+    TX_BYTES,
+    RX_ERRORS,
+    TX_ERRORS,
+    RX_DROPPED,
+    TX_DROPPED,
+    IFACE_COUNTERS,
+};
+
+/*
+ * Counters of an iface.
+ */
+struct iface_stats {
+    int index;
+    uint64_t counters[IFACE_COUNTERS];
+};
+
+/*
+ * Counters of every iface at a time, sorted by index as dumped.
+ */
+struct stats_sample {
+    struct iface_stats *ifaces;
+    int count;
+    int capacity;
+
+    // monotonic time the dump completed, in nanoseconds
+    uint64_t timestamp;
+};
+
+/*
+ * Record of binary output, 88 bytes in host byte order: counter deltas
+ * of an iface over elapsed nanoseconds, ending at timestamp.
+ */
+struct stats_record {
+    uint64_t timestamp;
+    uint64_t elapsed;
+    uint32_t index;
+    uint32_t reserved;
+    uint64_t deltas[IFACE_COUNTERS];
+};
+
+void stats_sample_init(struct stats_sample *sample);
+void stats_sample_free(struct stats_sample *sample);
+int stats_sample_dump(struct stats_sample *sample, int fd);
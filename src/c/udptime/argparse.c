@@ -97,6 +97,16 @@ static error_t client_opt_handler(int key, char *arg, struct argp_state *state)
             }
             break;
 
+        case 'P':
+            arguments->precise = 1;
+            break;
+
+        case 'c':
+            if (sscanf(arg, "%d", &arguments->count) != 1 || arguments->count < 1) {
+                return ARGP_ERR_UNKNOWN;
+            }
+            break;
+
         default:
             return ARGP_ERR_UNKNOWN;
     }
@@ -132,6 +142,12 @@ const struct client_cmdline_arguments *parse_client_arguments(int argc, char *ar
         // Option -p --port: server port
         {"server-port", 'p', "SERVER_PORT", 0, "listen port"},
 
+        // Option -P --precise: query nanosecond timestamps, estimate clock offset
+        {"precise", 'P', 0, 0, "query precise time and estimate clock offset"},
+
+        // Option -c --count: number of precise time samples
+        {"count", 'c', "COUNT", 0, "number of precise time samples"},
+
         { 0 }
     };
 
@@ -150,6 +166,8 @@ const struct client_cmdline_arguments *parse_client_arguments(int argc, char *ar
         .server_ip = "127.0.0.1",
         .server_port = 9999,
         .time_format = "%Y-%m-%d %H:%M:%S",
+        .precise = 0,
+        .count = 8,
     };
 
     argp_parse(&argp, argc, argv, 0, 0, &arguments);
@@ -24,6 +24,12 @@ struct client_cmdline_arguments {
 
     // time format
     char *time_format;
+
+    // query precise time instead of formatted time
+    int precise;
+
+    // number of precise time samples
+    int count;
 };
 
 const struct server_cmdline_arguments *parse_server_arguments(int argc, char *argv[]);
@@ -0,0 +1,130 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 12:10:09
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 12:10:09
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "timefmt.h"
+
+#define ITERATIONS 2000000
+
+// formats to benchmark, the first one is client's default
+static const char *formats[] = {
+    "%Y-%m-%d %H:%M:%S",
+    "%F %T",
+    "%a, %d %b %Y %H:%M:%S",
+    "%c",
+    "%I:%M:%S %p on %A, %B %e",
+    "%j %y %C %u %w %k %l %%",
+    "%Y-%m-%dT%H:%M:%S%z",
+    NULL,
+};
+
+
+/**
+ * Fetch monotonic time in seconds.
+ **/
+double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/**
+ * Check compiled program gives the same result as strftime, for a series
+ * of times spread over a few years.
+ *
+ *  Returns
+ *      0 if all results match, -1 otherwise.
+ **/
+int verify(const char *format, const struct timefmt_program *program) {
+    time_t ts = time(NULL);
+
+    int i;
+    for (i = 0; i < 10000; i++, ts += 7919 * 13) {
+        struct tm tm;
+        localtime_r(&ts, &tm);
+
+        char expected[MAX_DATA_SIZE];
+        char result[MAX_DATA_SIZE];
+        size_t expected_len = strftime(expected, sizeof(expected), format, &tm);
+        size_t result_len = timefmt_render(program, result, sizeof(result), &tm);
+
+        if (expected_len != result_len || memcmp(expected, result, expected_len) != 0) {
+            fprintf(stderr, "Mismatch for \"%s\": expected \"%s\", got \"%s\"\n", format, expected, result);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[]) {
+    struct timefmt_cache *cache = timefmt_cache_new(16);
+    if (cache == NULL) {
+        fprintf(stderr, "Failed to create format cache\n");
+        return -1;
+    }
+
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+
+    printf("%-28s %12s %12s %12s %8s\n", "format", "strftime", "compiled", "cached", "speedup");
+
+    int failed = 0;
+
+    const char **format;
+    for (format = formats; *format != NULL; format++) {
+        const struct timefmt_program *program = timefmt_cache_get(cache, *format);
+        if (program == NULL) {
+            fprintf(stderr, "Failed to compile \"%s\"\n", *format);
+            return -1;
+        }
+
+        if (verify(*format, program) == -1) {
+            failed = 1;
+            continue;
+        }
+
+        char buffer[MAX_DATA_SIZE];
+
+        // sink keeps compiler from dropping rendering
+        volatile size_t sink = 0;
+
+        double start = monotonic_seconds();
+        int i;
+        for (i = 0; i < ITERATIONS; i++) {
+            sink += strftime(buffer, sizeof(buffer), *format, &tm);
+        }
+        double libc_ns = (monotonic_seconds() - start) * 1e9 / ITERATIONS;
+
+        // render only
+        start = monotonic_seconds();
+        for (i = 0; i < ITERATIONS; i++) {
+            sink += timefmt_render(program, buffer, sizeof(buffer), &tm);
+        }
+        double compiled_ns = (monotonic_seconds() - start) * 1e9 / ITERATIONS;
+
+        // look up cache each time, as server does
+        start = monotonic_seconds();
+        for (i = 0; i < ITERATIONS; i++) {
+            program = timefmt_cache_get(cache, *format);
+            sink += timefmt_render(program, buffer, sizeof(buffer), &tm);
+        }
+        double cached_ns = (monotonic_seconds() - start) * 1e9 / ITERATIONS;
+
+        printf("%-28s %10.1fns %10.1fns %10.1fns %7.2fx\n", *format, libc_ns, compiled_ns, cached_ns,
+            libc_ns / cached_ns);
+    }
+
+    return failed ? -1 : 0;
+}
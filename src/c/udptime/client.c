@@ -2,16 +2,201 @@
  * Author: fasion
  * Created time: 2021-02-23 19:35:34
  * Last Modified by: fasion
- * Last Modified time: 2022-02-28 09:48:43
+ * Last Modified time: 2026-10-19 10:05:31
  */
 
 #include <arpa/inet.h>
+#include <endian.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 
 #include "argparse.h"
 #include "common.h"
+#include "timestamp.h"
+
+#define PRECISE_TIMEOUT_SEC 1
+
+
+/**
+ * Query formatted time from server.
+ *
+ *  Arguments
+ *      s: client socket.
+ *
+ *      server_addr: server address.
+ *
+ *      time_format: time format, see strftime.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int query_time(int s, const struct sockaddr_in *server_addr, const char *time_format) {
+    // build request message
+    struct time_request request;
+    bzero(&request, sizeof(request));
+
+    int format_bytes = stpncpy(request.format, time_format, MAX_FORMAT_SIZE-1) - request.format + 1;
+    request.bytes = htonl(format_bytes);
+    int request_len = sizeof(request.bytes) + format_bytes;
+
+    // send request
+    if (sendto(s, &request, request_len, 0, (struct sockaddr *)server_addr, sizeof(*server_addr)) == -1) {
+        perror("Failed to send request");
+        return -1;
+    }
+
+    // receive reply
+    struct time_reply reply;
+    if (recvfrom(s, &reply, sizeof(reply), 0, NULL, NULL) == -1) {
+        perror("Failed to receive reply");
+        return -1;
+    }
+
+    // print reply
+    printf("Receive %d bytes\n", ntohl(reply.bytes));
+
+    // print time data
+    if (reply.bytes > 0) {
+        reply.time[MAX_DATA_SIZE-1] = '\0';
+        printf("%s\n", reply.time);
+    }
+
+    return 0;
+}
+
+
+/**
+ * Take one precise time sample, NTP style.
+ *
+ *  Arguments
+ *      s: client socket, with receive timestamps enabled.
+ *
+ *      server_addr: server address.
+ *
+ *      offset: for storing server clock offset relative to local clock, in ns.
+ *
+ *      delay: for storing round trip delay, server processing excluded, in ns.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int sample_precise_time(int s, const struct sockaddr_in *server_addr, int64_t *offset, int64_t *delay) {
+    // build request message, stamped with local transmit time (t1)
+    struct precise_time_request request;
+    request.mark = htonl(PRECISE_MARK);
+
+    int64_t t1 = realtime_ns();
+    request.origin_ts = htobe64(t1);
+
+    // send request
+    if (sendto(s, &request, sizeof(request), 0, (struct sockaddr *)server_addr, sizeof(*server_addr)) == -1) {
+        perror("Failed to send request");
+        return -1;
+    }
+
+    // receive replies until the one matching our request, or timeout
+    for (;;) {
+        struct precise_time_reply reply;
+        int64_t t4;
+        ssize_t bytes = recv_with_timestamp(s, &reply, sizeof(reply), NULL, &t4);
+        if (bytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                fprintf(stderr, "Request timeout\n");
+            } else {
+                perror("Failed to receive reply");
+            }
+
+            return -1;
+        }
+
+        // drop stale or foreign replies
+        if (bytes != sizeof(reply) || ntohl(reply.mark) != PRECISE_MARK) {
+            continue;
+        }
+        if (be64toh(reply.origin_ts) != t1) {
+            continue;
+        }
+
+        int64_t t2 = be64toh(reply.receive_ts);
+        int64_t t3 = be64toh(reply.transmit_ts);
+
+        *offset = ((t2 - t1) + (t3 - t4)) / 2;
+        *delay = (t4 - t1) - (t3 - t2);
+
+        return 0;
+    }
+}
+
+
+/**
+ * Query precise time several times and estimate clock offset.
+ *
+ * Sample with the lowest delay is taken as the best estimation, since it
+ * suffers least from queueing asymmetry.
+ *
+ *  Arguments
+ *      s: client socket.
+ *
+ *      server_addr: server address.
+ *
+ *      count: number of samples.
+ *
+ *  Returns
+ *      0 if success, -1 if all samples failed.
+ **/
+int query_precise_time(int s, const struct sockaddr_in *server_addr, int count) {
+    // kernel receive timestamps for replies
+    if (enable_rx_timestamps(s) == -1) {
+        perror("Failed to enable receive timestamps");
+    }
+
+    // do not wait forever for lost replies
+    struct timeval tv;
+    tv.tv_sec = PRECISE_TIMEOUT_SEC;
+    tv.tv_usec = 0;
+    if (setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == -1) {
+        perror("Failed to set receive timeout");
+        return -1;
+    }
+
+    int valid = 0;
+    int64_t best_offset = 0;
+    int64_t best_delay = 0;
+
+    int i;
+    for (i = 0; i < count; i++) {
+        int64_t offset, delay;
+        if (sample_precise_time(s, server_addr, &offset, &delay) == -1) {
+            continue;
+        }
+
+        printf("sample=%-3d offset=%+12.6fms delay=%10.6fms\n", i + 1, offset / 1e6, delay / 1e6);
+
+        if (valid == 0 || delay < best_delay) {
+            best_offset = offset;
+            best_delay = delay;
+        }
+        valid++;
+    }
+
+    if (valid == 0) {
+        fprintf(stderr, "No valid sample\n");
+        return -1;
+    }
+
+    printf("best       offset=%+12.6fms delay=%10.6fms (%d/%d samples)\n",
+        best_offset / 1e6, best_delay / 1e6, valid, count);
+
+    return 0;
+}
+
 
 int main(int argc, char *argv[]) {
     // parse cmdline arguments
@@ -47,35 +232,9 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
-    // build request message
-    struct time_request request;
-    bzero(&request);
-
-    int format_bytes = stpncpy(request.format, arguments->time_format, MAX_FORMAT_SIZE-1) - request.format + 1;
-    request.bytes = htonl(format_bytes);
-    int request_len = sizeof(request.bytes) + format_bytes;
-
-    // send request
-    if (sendto(s, &request, request_len, 0, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
-        perror("Failed to send request");
-        return -1;
+    if (arguments->precise) {
+        return query_precise_time(s, &server_addr, arguments->count);
     }
 
-    // receive reply
-    struct time_reply reply;
-    if (recvfrom(s, &reply, sizeof(reply), 0, NULL, NULL) == -1) {
-        perror("Failed to receive reply");
-        return -1;
-    }
-
-    // print reply
-    printf("Receive %d bytes\n", ntohl(reply.bytes));
-
-    // print time data
-    if (reply.bytes > 0) {
-        reply.time[MAX_DATA_SIZE-1] = '\0';
-        printf("%s\n", reply.time);
-    }
-
-    return 0;
+    return query_time(s, &server_addr, arguments->time_format);
 }
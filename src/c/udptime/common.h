@@ -25,3 +25,37 @@ struct __attribute__((__packed__)) time_reply {
     uint32_t bytes;
     char time[MAX_DATA_SIZE];
 };
+
+/*
+ * value of bytes field marking a precise time request or reply.
+ */
+#define PRECISE_MARK 0xffffffff
+
+/*
+ * struct for precise time request, timestamps are nanoseconds since the
+ * epoch, in network byte order.
+ */
+struct __attribute__((__packed__)) precise_time_request {
+    // always PRECISE_MARK
+    uint32_t mark;
+
+    // client transmit timestamp
+    uint64_t origin_ts;
+};
+
+/*
+ * struct for precise time reply, NTP style.
+ */
+struct __attribute__((__packed__)) precise_time_reply {
+    // always PRECISE_MARK
+    uint32_t mark;
+
+    // client transmit timestamp, copied from request
+    uint64_t origin_ts;
+
+    // server receive timestamp, taken by kernel
+    uint64_t receive_ts;
+
+    // server transmit timestamp
+    uint64_t transmit_ts;
+};
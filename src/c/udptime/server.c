@@ -2,19 +2,153 @@
  * Author: fasion
  * Created time: 2021-02-23 16:11:52
  * Last Modified by: fasion
- * Last Modified time: 2021-03-17 13:29:56
+ * Last Modified time: 2026-10-19 11:58:40
  */
 
 #include <arpa/inet.h>
+#include <endian.h>
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "argparse.h"
 #include "common.h"
+#include "timefmt.h"
+#include "timestamp.h"
+
+// number of compiled time formats cached
+#define FORMAT_CACHE_SIZE 64
+
+/*
+ * buffer for storing any kind of request.
+ */
+union request_buffer {
+    struct time_request time;
+    struct precise_time_request precise;
+};
+
+
+/**
+ * Reply a precise time request.
+ *
+ *  Arguments
+ *      s: server socket.
+ *
+ *      request: the precise time request.
+ *
+ *      receive_ts: kernel receive timestamp of request.
+ *
+ *      peer_addr: client address.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int process_precise_request(int s, const struct precise_time_request *request,
+        int64_t receive_ts, const struct sockaddr_in *peer_addr) {
+    struct precise_time_reply reply;
+    reply.mark = htonl(PRECISE_MARK);
+    reply.origin_ts = request->origin_ts;
+    reply.receive_ts = htobe64(receive_ts);
+
+    // take transmit timestamp as late as possible
+    reply.transmit_ts = htobe64(realtime_ns());
+
+    // send reply back to client
+    if (sendto(s, &reply, sizeof(reply), 0, (struct sockaddr *)peer_addr, sizeof(*peer_addr)) == -1) {
+        perror("Failed to send");
+        return -1;
+    }
+
+    // print request after reply is sent, not to delay it
+    printf("%s:%d precise request\n", inet_ntoa(peer_addr->sin_addr), ntohs(peer_addr->sin_port));
+
+    return 0;
+}
+
+
+/**
+ * Fetch current local time, converted only once per second.
+ *
+ *  Returns
+ *      Pointer to broken-down local time if success, NULL if error.
+ **/
+const struct tm *fetch_local_time() {
+    static time_t cached_ts = -1;
+    static struct tm cached_time;
+
+    // fetch current time
+    time_t now;
+    time(&now);
+
+    // convert timestamp to localtime
+    if (now != cached_ts) {
+        if (localtime_r(&now, &cached_time) == NULL) {
+            return NULL;
+        }
+
+        cached_ts = now;
+    }
+
+    return &cached_time;
+}
+
+
+/**
+ * Reply a time request with time formatted as requested.
+ *
+ *  Arguments
+ *      s: server socket.
+ *
+ *      request: the time request.
+ *
+ *      peer_addr: client address.
+ *
+ *      cache: cache of compiled time formats.
+ *
+ *  Returns
+ *      0 if success, -1 if error.
+ **/
+int process_time_request(int s, struct time_request *request, const struct sockaddr_in *peer_addr,
+        struct timefmt_cache *cache) {
+    // print request
+    request->format[MAX_FORMAT_SIZE - 1] = '\0';
+    printf("%s:%d request with format: %s\n", inet_ntoa(peer_addr->sin_addr), ntohs(peer_addr->sin_port), request->format);
+
+    // buffer for storing reply
+    struct time_reply reply;
+    bzero(&reply, sizeof(reply));
+
+    // fetch current local time
+    const struct tm *local_time = fetch_local_time();
+    if (local_time == NULL) {
+        perror("fetch local time");
+        return -1;
+    }
+
+    // format time with compiled program, or strftime if it cannot be compiled
+    size_t data_bytes;
+    const struct timefmt_program *program = timefmt_cache_get(cache, request->format);
+    if (program != NULL) {
+        data_bytes = timefmt_render(program, reply.time, MAX_DATA_SIZE-1, local_time) + 1;
+    } else {
+        data_bytes = strftime(reply.time, MAX_DATA_SIZE-1, request->format, local_time) + 1;
+    }
+    reply.bytes = htonl(data_bytes);
+    int reply_len = sizeof(reply.bytes) + data_bytes;
+
+    // send reply back to client
+    if (sendto(s, &reply, reply_len, 0, (struct sockaddr *)peer_addr, sizeof(*peer_addr)) == -1) {
+        perror("Failed to send");
+        return -1;
+    }
+
+    return 0;
+}
+
 
 int main(int argc, char *argv[]) {
     // parse cmdline arguments
@@ -31,6 +165,18 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
+    // cache of compiled time formats
+    struct timefmt_cache *cache = timefmt_cache_new(FORMAT_CACHE_SIZE);
+    if (cache == NULL) {
+        fprintf(stderr, "Failed to create format cache\n");
+        goto error_exit;
+    }
+
+    // kernel receive timestamps for precise requests
+    if (enable_rx_timestamps(s) == -1) {
+        perror("Failed to enable receive timestamps");
+    }
+
     // server bind address
     struct sockaddr_in bind_addr;
     bzero(&bind_addr, sizeof(bind_addr));
@@ -42,20 +188,20 @@ int main(int argc, char *argv[]) {
     // bind socket with given port
     if (bind(s, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) == -1) {
         perror("Failed to bind address");
-        return -1;
+        goto error_exit;
     }
 
     // loop to process requests forever
     for (;;) {
         // buffer for storing a request
-        struct time_request request;
+        union request_buffer request;
 
         // buffer for storing peer address
         struct sockaddr_in peer_addr;
-        int addr_len = sizeof(peer_addr);
 
-        // receive request from client
-        int bytes = recvfrom(s, &request, sizeof(request), 0, (struct sockaddr *)&peer_addr, &addr_len);
+        // receive request from client, together with its receive timestamp
+        int64_t receive_ts;
+        int bytes = recv_with_timestamp(s, &request, sizeof(request), &peer_addr, &receive_ts);
         if (bytes == -1) {
             if (errno == EINTR) {
                 continue;
@@ -63,37 +209,27 @@ int main(int argc, char *argv[]) {
 
             perror("Failed to receive data");
 
-            return -1;
+            goto error_exit;
         }
 
-        // print request
-        request.format[MAX_FORMAT_SIZE - 1] = '\0';
-        printf("%s:%d request with format: %s\n", inet_ntoa(peer_addr.sin_addr), ntohs(peer_addr.sin_port), request.format);
-
-        // buffer for storing reply
-        struct time_reply reply;
-        bzero(&reply);
+        // too short to tell request kind
+        if (bytes < sizeof(uint32_t)) {
+            continue;
+        }
 
-        // fetch current time
-        time_t now;
-        time(&now);
+        int ret;
+        if (ntohl(request.time.bytes) == PRECISE_MARK) {
+            if (bytes < sizeof(request.precise)) {
+                continue;
+            }
 
-        // convert timestamp to localtime
-        struct tm *local_time = localtime(&now);
-        if (local_time == NULL) {
-            perror("fetch local time");
-            return -1;
+            ret = process_precise_request(s, &request.precise, receive_ts, &peer_addr);
+        } else {
+            ret = process_time_request(s, &request.time, &peer_addr, cache);
         }
 
-        // format time
-        size_t data_bytes = strftime(reply.time, MAX_DATA_SIZE-1, request.format, local_time) + 1;
-        reply.bytes = htonl(data_bytes);
-        int reply_len = sizeof(reply.bytes) + data_bytes;
-
-        // send reply back to client
-        if (sendto(s, &reply, reply_len, 0, (struct sockaddr *)&peer_addr, sizeof(peer_addr)) == -1) {
-            perror("Failed to send");
-            return -1;
+        if (ret == -1) {
+            goto error_exit;
         }
     }
 
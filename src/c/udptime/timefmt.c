@@ -0,0 +1,983 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 10:31:02
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 11:47:25
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timefmt.h"
+
+// max size of literal pool, offsets are 16 bits
+#define MAX_PROGRAM_POOL_SIZE 65535
+
+// buffer size for conversions falling back to strftime
+#define FALLBACK_BUFFER_SIZE 1024
+
+// longest output of a number or a name
+#define MAX_NUMBER_LENGTH 11
+#define MAX_NAME_LENGTH 9
+
+/*
+ * kinds of program operations.
+ */
+enum timefmt_op_kind {
+    // copy literal bytes from pool
+    OP_LITERAL,
+
+    // decimal number of a struct tm field, read directly at offset plus bias
+    OP_FIELD,
+
+    // decimal number computed from struct tm, see enum timefmt_field
+    OP_NUMBER,
+
+    // day or month name, C locale
+    OP_NAME,
+
+    // conversion not compiled, given to strftime as is
+    OP_STRFTIME,
+};
+
+/*
+ * computed fields used by OP_NUMBER and OP_NAME.
+ */
+enum timefmt_field {
+    FIELD_YEAR,
+    FIELD_YEAR2,
+    FIELD_CENTURY,
+    FIELD_HOUR12,
+    FIELD_WDAY1,
+
+    FIELD_WDAY_ABBR,
+    FIELD_WDAY_FULL,
+    FIELD_MONTH_ABBR,
+    FIELD_MONTH_FULL,
+    FIELD_AMPM,
+};
+
+/*
+ * one program operation, 10 bytes.
+ */
+struct timefmt_op {
+    // see enum timefmt_op_kind
+    unsigned char kind;
+
+    // see enum timefmt_field
+    unsigned char field;
+
+    // minimal width of numbers, 0 for natural width
+    unsigned char width;
+
+    // padding char of numbers, '0' or ' '
+    char pad;
+
+    // added to OP_FIELD value
+    signed char bias;
+
+    // literal bytes or strftime spec in pool, or struct tm offset for OP_FIELD
+    unsigned short offset;
+    unsigned short length;
+};
+
+/*
+ * compiled time format: operation list followed by literal pool.
+ */
+struct timefmt_program {
+    int nops;
+
+    // longest possible output, SIZE_MAX if unbounded
+    size_t max_length;
+
+    struct timefmt_op *ops;
+    char *pool;
+};
+
+/*
+ * name with precomputed length.
+ */
+struct timefmt_name {
+    const char *name;
+    unsigned char length;
+};
+
+#define NAME(s) { s, sizeof(s) - 1 }
+
+static const struct timefmt_name wday_abbr_names[] = {
+    NAME("Sun"), NAME("Mon"), NAME("Tue"), NAME("Wed"), NAME("Thu"), NAME("Fri"), NAME("Sat"),
+};
+
+static const struct timefmt_name wday_full_names[] = {
+    NAME("Sunday"), NAME("Monday"), NAME("Tuesday"), NAME("Wednesday"),
+    NAME("Thursday"), NAME("Friday"), NAME("Saturday"),
+};
+
+static const struct timefmt_name month_abbr_names[] = {
+    NAME("Jan"), NAME("Feb"), NAME("Mar"), NAME("Apr"), NAME("May"), NAME("Jun"),
+    NAME("Jul"), NAME("Aug"), NAME("Sep"), NAME("Oct"), NAME("Nov"), NAME("Dec"),
+};
+
+static const struct timefmt_name month_full_names[] = {
+    NAME("January"), NAME("February"), NAME("March"), NAME("April"), NAME("May"), NAME("June"),
+    NAME("July"), NAME("August"), NAME("September"), NAME("October"), NAME("November"), NAME("December"),
+};
+
+static const struct timefmt_name ampm_names[] = {
+    NAME("AM"), NAME("PM"),
+};
+
+// printed by strftime for out of range fields
+static const struct timefmt_name unknown_name = NAME("?");
+
+/*
+ * state used while compiling a program.
+ */
+struct timefmt_compiler {
+    int nops;
+    int ops_capacity;
+    struct timefmt_op *ops;
+
+    int pool_len;
+    int pool_capacity;
+    char *pool;
+};
+
+
+/**
+ * Append an operation to program being compiled.
+ *
+ *  Returns
+ *      Pointer to appended operation if success, NULL if out of memory.
+ **/
+static struct timefmt_op *emit_op(struct timefmt_compiler *compiler, int kind) {
+    // grow operation list if needed
+    if (compiler->nops == compiler->ops_capacity) {
+        int capacity = compiler->ops_capacity * 2;
+        struct timefmt_op *ops = realloc(compiler->ops, capacity * sizeof(*ops));
+        if (ops == NULL) {
+            return NULL;
+        }
+
+        compiler->ops = ops;
+        compiler->ops_capacity = capacity;
+    }
+
+    struct timefmt_op *op = &compiler->ops[compiler->nops++];
+    bzero(op, sizeof(*op));
+    op->kind = kind;
+
+    return op;
+}
+
+
+/**
+ * Make room for given bytes in pool.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory or pool grows beyond 16 bits offsets.
+ **/
+static int reserve_pool(struct timefmt_compiler *compiler, int bytes) {
+    int required = compiler->pool_len + bytes;
+    if (required > MAX_PROGRAM_POOL_SIZE) {
+        return -1;
+    }
+
+    if (required <= compiler->pool_capacity) {
+        return 0;
+    }
+
+    int capacity = compiler->pool_capacity * 2;
+    if (capacity < required) {
+        capacity = required;
+    }
+
+    char *pool = realloc(compiler->pool, capacity);
+    if (pool == NULL) {
+        return -1;
+    }
+
+    compiler->pool = pool;
+    compiler->pool_capacity = capacity;
+
+    return 0;
+}
+
+
+/**
+ * Append literal bytes, merging with previous literal if adjacent.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int emit_literal(struct timefmt_compiler *compiler, const char *data, int length) {
+    if (reserve_pool(compiler, length) == -1) {
+        return -1;
+    }
+
+    // previous operation, if any
+    struct timefmt_op *last = compiler->nops == 0 ? NULL : &compiler->ops[compiler->nops - 1];
+
+    // copy data to pool
+    memcpy(compiler->pool + compiler->pool_len, data, length);
+
+    if (last != NULL && last->kind == OP_LITERAL && last->offset + last->length == compiler->pool_len) {
+        last->length += length;
+    } else {
+        struct timefmt_op *op = emit_op(compiler, OP_LITERAL);
+        if (op == NULL) {
+            return -1;
+        }
+
+        op->offset = compiler->pool_len;
+        op->length = length;
+    }
+
+    compiler->pool_len += length;
+
+    return 0;
+}
+
+
+/**
+ * Append a numeric field read directly from struct tm.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int emit_field(struct timefmt_compiler *compiler, size_t tm_offset, int bias, int width, char pad) {
+    struct timefmt_op *op = emit_op(compiler, OP_FIELD);
+    if (op == NULL) {
+        return -1;
+    }
+
+    op->offset = tm_offset;
+    op->bias = bias;
+    op->width = width;
+    op->pad = pad;
+
+    return 0;
+}
+
+
+/**
+ * Append a computed numeric field.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int emit_number(struct timefmt_compiler *compiler, int field, int width, char pad) {
+    struct timefmt_op *op = emit_op(compiler, OP_NUMBER);
+    if (op == NULL) {
+        return -1;
+    }
+
+    op->field = field;
+    op->width = width;
+    op->pad = pad;
+
+    return 0;
+}
+
+
+/**
+ * Append a name field.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int emit_name(struct timefmt_compiler *compiler, int field) {
+    struct timefmt_op *op = emit_op(compiler, OP_NAME);
+    if (op == NULL) {
+        return -1;
+    }
+
+    op->field = field;
+
+    return 0;
+}
+
+
+/**
+ * Append a conversion left to strftime, spec is stored in pool with '\0'.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int emit_strftime(struct timefmt_compiler *compiler, const char *spec, int length) {
+    if (reserve_pool(compiler, length + 1) == -1) {
+        return -1;
+    }
+
+    struct timefmt_op *op = emit_op(compiler, OP_STRFTIME);
+    if (op == NULL) {
+        return -1;
+    }
+
+    op->offset = compiler->pool_len;
+    op->length = length;
+
+    memcpy(compiler->pool + compiler->pool_len, spec, length);
+    compiler->pool[compiler->pool_len + length] = '\0';
+    compiler->pool_len += length + 1;
+
+    return 0;
+}
+
+
+static int compile_format(struct timefmt_compiler *compiler, const char *format);
+
+
+/**
+ * Compile one conversion, spec is a plain "%c" without flags or width.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int compile_conversion(struct timefmt_compiler *compiler, char conversion, const char *spec, int length) {
+    switch (conversion) {
+        case 'm': return emit_field(compiler, offsetof(struct tm, tm_mon), 1, 2, '0');
+        case 'd': return emit_field(compiler, offsetof(struct tm, tm_mday), 0, 2, '0');
+        case 'e': return emit_field(compiler, offsetof(struct tm, tm_mday), 0, 2, ' ');
+        case 'j': return emit_field(compiler, offsetof(struct tm, tm_yday), 1, 3, '0');
+        case 'H': return emit_field(compiler, offsetof(struct tm, tm_hour), 0, 2, '0');
+        case 'k': return emit_field(compiler, offsetof(struct tm, tm_hour), 0, 2, ' ');
+        case 'M': return emit_field(compiler, offsetof(struct tm, tm_min), 0, 2, '0');
+        case 'S': return emit_field(compiler, offsetof(struct tm, tm_sec), 0, 2, '0');
+        case 'w': return emit_field(compiler, offsetof(struct tm, tm_wday), 0, 1, '0');
+
+        case 'Y': return emit_number(compiler, FIELD_YEAR, 0, '0');
+        case 'y': return emit_number(compiler, FIELD_YEAR2, 2, '0');
+        case 'C': return emit_number(compiler, FIELD_CENTURY, 2, '0');
+        case 'I': return emit_number(compiler, FIELD_HOUR12, 2, '0');
+        case 'l': return emit_number(compiler, FIELD_HOUR12, 2, ' ');
+        case 'u': return emit_number(compiler, FIELD_WDAY1, 1, '0');
+
+        case 'a': return emit_name(compiler, FIELD_WDAY_ABBR);
+        case 'A': return emit_name(compiler, FIELD_WDAY_FULL);
+        case 'b': return emit_name(compiler, FIELD_MONTH_ABBR);
+        case 'h': return emit_name(compiler, FIELD_MONTH_ABBR);
+        case 'B': return emit_name(compiler, FIELD_MONTH_FULL);
+        case 'p': return emit_name(compiler, FIELD_AMPM);
+
+        case 'n': return emit_literal(compiler, "\n", 1);
+        case 't': return emit_literal(compiler, "\t", 1);
+        case '%': return emit_literal(compiler, "%", 1);
+
+        // composite conversions, as defined by C locale
+        case 'c': return compile_format(compiler, "%a %b %e %H:%M:%S %Y");
+        case 'D': return compile_format(compiler, "%m/%d/%y");
+        case 'x': return compile_format(compiler, "%m/%d/%y");
+        case 'F': return compile_format(compiler, "%Y-%m-%d");
+        case 'T': return compile_format(compiler, "%H:%M:%S");
+        case 'X': return compile_format(compiler, "%H:%M:%S");
+        case 'R': return compile_format(compiler, "%H:%M");
+        case 'r': return compile_format(compiler, "%I:%M:%S %p");
+
+        // time zone, week numbers, epoch and so on
+        default: return emit_strftime(compiler, spec, length);
+    }
+}
+
+
+/**
+ * Compile given format, appending operations to compiler.
+ *
+ *  Returns
+ *      0 if success, -1 if out of memory.
+ **/
+static int compile_format(struct timefmt_compiler *compiler, const char *format) {
+    const char *p = format;
+
+    while (*p != '\0') {
+        // literal span up to next conversion
+        const char *percent = strchr(p, '%');
+        if (percent == NULL) {
+            return emit_literal(compiler, p, strlen(p));
+        }
+
+        if (percent > p && emit_literal(compiler, p, percent - p) == -1) {
+            return -1;
+        }
+
+        // skip glibc flags, width and E/O modifiers
+        const char *q = percent + 1;
+        q += strspn(q, "_-0^#");
+        q += strspn(q, "0123456789");
+        q += strspn(q, "EO");
+
+        // dangling '%' at the end of format
+        if (*q == '\0') {
+            return emit_strftime(compiler, percent, q - percent);
+        }
+
+        int length = q + 1 - percent;
+
+        int ret;
+        if (length == 2) {
+            ret = compile_conversion(compiler, *q, percent, length);
+        } else {
+            // decorated conversions are rare, leave them to strftime
+            ret = emit_strftime(compiler, percent, length);
+        }
+
+        if (ret == -1) {
+            return -1;
+        }
+
+        p = q + 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Calculate longest possible output of given operations.
+ *
+ *  Returns
+ *      Longest output length, SIZE_MAX if unbounded.
+ **/
+static size_t max_length(const struct timefmt_op *ops, int nops) {
+    size_t length = 0;
+
+    int i;
+    for (i = 0; i < nops; i++) {
+        switch (ops[i].kind) {
+            case OP_LITERAL:
+                length += ops[i].length;
+                break;
+
+            case OP_FIELD:
+            case OP_NUMBER:
+                length += ops[i].width > MAX_NUMBER_LENGTH ? ops[i].width : MAX_NUMBER_LENGTH;
+                break;
+
+            case OP_NAME:
+                length += MAX_NAME_LENGTH;
+                break;
+
+            case OP_STRFTIME:
+                return SIZE_MAX;
+        }
+    }
+
+    return length;
+}
+
+
+/**
+ * Compile time format into a program, see strftime for format.
+ *
+ * Names are rendered as in C locale, which is what the server runs in.
+ *
+ *  Arguments
+ *      format: time format.
+ *
+ *  Returns
+ *      Compiled program if success, NULL if error or format is too long.
+ **/
+struct timefmt_program *timefmt_compile(const char *format) {
+    struct timefmt_compiler compiler;
+    compiler.nops = 0;
+    compiler.ops_capacity = 16;
+    compiler.ops = malloc(compiler.ops_capacity * sizeof(*compiler.ops));
+    compiler.pool_len = 0;
+    compiler.pool_capacity = 64;
+    compiler.pool = malloc(compiler.pool_capacity);
+
+    struct timefmt_program *program = NULL;
+    if (compiler.ops == NULL || compiler.pool == NULL) {
+        goto cleanup;
+    }
+
+    if (compile_format(&compiler, format) == -1) {
+        goto cleanup;
+    }
+
+    // pack header, operations and pool into one compact block
+    size_t ops_size = compiler.nops * sizeof(*compiler.ops);
+    program = malloc(sizeof(*program) + ops_size + compiler.pool_len);
+    if (program == NULL) {
+        goto cleanup;
+    }
+
+    program->nops = compiler.nops;
+    program->max_length = max_length(compiler.ops, compiler.nops);
+    program->ops = (struct timefmt_op *)(program + 1);
+    program->pool = (char *)program->ops + ops_size;
+    memcpy(program->ops, compiler.ops, ops_size);
+    memcpy(program->pool, compiler.pool, compiler.pool_len);
+
+cleanup:
+
+    free(compiler.ops);
+    free(compiler.pool);
+
+    return program;
+}
+
+
+/**
+ * Free a compiled program.
+ **/
+void timefmt_free(struct timefmt_program *program) {
+    free(program);
+}
+
+
+/**
+ * Fetch value of a numeric field.
+ **/
+static inline int field_value(const struct tm *tm, int field) {
+    switch (field) {
+        case FIELD_YEAR: return tm->tm_year + 1900;
+        case FIELD_YEAR2: return ((tm->tm_year + 1900) % 100 + 100) % 100;
+        case FIELD_CENTURY: return (tm->tm_year + 1900) / 100;
+        case FIELD_HOUR12: return tm->tm_hour % 12 == 0 ? 12 : tm->tm_hour % 12;
+        case FIELD_WDAY1: return tm->tm_wday == 0 ? 7 : tm->tm_wday;
+        default: return 0;
+    }
+}
+
+
+/**
+ * Fetch name of a name field.
+ **/
+static inline const struct timefmt_name *field_name(const struct tm *tm, int field) {
+    switch (field) {
+        case FIELD_WDAY_ABBR:
+            if (tm->tm_wday >= 0 && tm->tm_wday < 7) {
+                return &wday_abbr_names[tm->tm_wday];
+            }
+            break;
+
+        case FIELD_WDAY_FULL:
+            if (tm->tm_wday >= 0 && tm->tm_wday < 7) {
+                return &wday_full_names[tm->tm_wday];
+            }
+            break;
+
+        case FIELD_MONTH_ABBR:
+            if (tm->tm_mon >= 0 && tm->tm_mon < 12) {
+                return &month_abbr_names[tm->tm_mon];
+            }
+            break;
+
+        case FIELD_MONTH_FULL:
+            if (tm->tm_mon >= 0 && tm->tm_mon < 12) {
+                return &month_full_names[tm->tm_mon];
+            }
+            break;
+
+        case FIELD_AMPM:
+            return &ampm_names[tm->tm_hour >= 12];
+    }
+
+    return &unknown_name;
+}
+
+
+/**
+ * Write a decimal number padded to width.
+ *
+ *  Returns
+ *      Pointer after written digits if success, NULL if buffer is too small.
+ **/
+static inline __attribute__((always_inline)) char *put_number(char *p, char *end, int value,
+        int width, char pad, int checked) {
+    // fast path for the common two digits fields
+    if (width == 2 && value >= 0 && value < 100) {
+        if (checked && end - p < 2) {
+            return NULL;
+        }
+
+        p[0] = value < 10 ? pad : '0' + value / 10;
+        p[1] = '0' + value % 10;
+
+        return p + 2;
+    }
+
+    // digits in reversed order
+    char digits[16];
+    int ndigits = 0;
+
+    unsigned int magnitude = value < 0 ? -(unsigned int)value : (unsigned int)value;
+    do {
+        digits[ndigits++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    int negative = value < 0;
+    int padding = width - ndigits - negative;
+    if (padding < 0) {
+        padding = 0;
+    }
+
+    if (checked && end - p < negative + padding + ndigits) {
+        return NULL;
+    }
+
+    // zero padding goes after the sign, space padding before it
+    if (pad == ' ') {
+        memset(p, ' ', padding);
+        p += padding;
+    }
+    if (negative) {
+        *p++ = '-';
+    }
+    if (pad == '0') {
+        memset(p, '0', padding);
+        p += padding;
+    }
+
+    while (ndigits > 0) {
+        *p++ = digits[--ndigits];
+    }
+
+    return p;
+}
+
+
+/**
+ * Run program operations, bounds are checked only if checked is set.
+ *
+ *  Returns
+ *      Pointer after output if success, NULL if buffer is too small.
+ **/
+static inline __attribute__((always_inline)) char *render_ops(const struct timefmt_program *program,
+        char *p, char *end, const struct tm *tm, int checked) {
+    const struct timefmt_op *op = program->ops;
+    const struct timefmt_op *ops_end = op + program->nops;
+
+    for (; op < ops_end; op++) {
+        switch (op->kind) {
+            case OP_LITERAL:
+                if (checked && end - p < op->length) {
+                    return NULL;
+                }
+
+                // separators are mostly a byte or two, not worth a memcpy call
+                if (op->length <= 4) {
+                    const char *literal = program->pool + op->offset;
+                    int i;
+                    for (i = 0; i < op->length; i++) {
+                        p[i] = literal[i];
+                    }
+                } else {
+                    memcpy(p, program->pool + op->offset, op->length);
+                }
+                p += op->length;
+                break;
+
+            case OP_FIELD: {
+                int value = *(const int *)((const char *)tm + op->offset) + op->bias;
+                p = put_number(p, end, value, op->width, op->pad, checked);
+                if (checked && p == NULL) {
+                    return NULL;
+                }
+                break;
+            }
+
+            case OP_NUMBER:
+                p = put_number(p, end, field_value(tm, op->field), op->width, op->pad, checked);
+                if (checked && p == NULL) {
+                    return NULL;
+                }
+                break;
+
+            case OP_NAME: {
+                const struct timefmt_name *name = field_name(tm, op->field);
+                if (checked && end - p < name->length) {
+                    return NULL;
+                }
+
+                memcpy(p, name->name, name->length);
+                p += name->length;
+                break;
+            }
+
+            case OP_STRFTIME: {
+                char converted[FALLBACK_BUFFER_SIZE];
+                size_t length = strftime(converted, sizeof(converted), program->pool + op->offset, tm);
+                if ((size_t)(end - p) < length) {
+                    return NULL;
+                }
+
+                memcpy(p, converted, length);
+                p += length;
+                break;
+            }
+        }
+    }
+
+    return p;
+}
+
+
+/**
+ * Render time with compiled program, like strftime.
+ *
+ *  Arguments
+ *      program: compiled program.
+ *
+ *      buffer: buffer for storing result.
+ *
+ *      size: size of buffer, '\0' included.
+ *
+ *      tm: broken-down time.
+ *
+ *  Returns
+ *      Bytes written, '\0' excluded, 0 if buffer is too small.
+ **/
+size_t timefmt_render(const struct timefmt_program *program, char *buffer, size_t size,
+        const struct tm *tm) {
+    if (size == 0) {
+        return 0;
+    }
+
+    // leave room for '\0'
+    char *end = buffer + size - 1;
+
+    // skip bounds checking if even the longest output fits
+    char *p;
+    if (program->max_length < size) {
+        p = render_ops(program, buffer, end, tm, 0);
+    } else {
+        p = render_ops(program, buffer, end, tm, 1);
+    }
+
+    if (p == NULL) {
+        return 0;
+    }
+
+    *p = '\0';
+
+    return p - buffer;
+}
+
+
+/*
+ * entry of program cache.
+ */
+struct timefmt_entry {
+    // hash of format
+    uint64_t hash;
+
+    // format, owned by entry
+    char *format;
+
+    // compiled program, owned by entry
+    struct timefmt_program *program;
+
+    // neighbours in LRU list, -1 for none
+    int prev;
+    int next;
+
+    // next entry in the same hash bucket, -1 for none
+    int chain;
+};
+
+/*
+ * LRU cache of compiled programs.
+ */
+struct timefmt_cache {
+    int capacity;
+    int size;
+
+    // most and least recently used entries
+    int head;
+    int tail;
+
+    // hash buckets, number of buckets is a power of 2
+    int bucket_mask;
+    int *buckets;
+
+    struct timefmt_entry *entries;
+};
+
+
+/**
+ * FNV-1a hash of a string.
+ **/
+static uint64_t hash_format(const char *format) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    const unsigned char *p;
+    for (p = (const unsigned char *)format; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+
+/**
+ * Create an empty program cache.
+ *
+ *  Arguments
+ *      capacity: max number of programs cached.
+ *
+ *  Returns
+ *      Cache if success, NULL if error.
+ **/
+struct timefmt_cache *timefmt_cache_new(int capacity) {
+    if (capacity < 1) {
+        return NULL;
+    }
+
+    // at least twice as many buckets as entries
+    int nbuckets = 1;
+    while (nbuckets < capacity * 2) {
+        nbuckets <<= 1;
+    }
+
+    struct timefmt_cache *cache = malloc(sizeof(*cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    cache->capacity = capacity;
+    cache->size = 0;
+    cache->head = -1;
+    cache->tail = -1;
+    cache->bucket_mask = nbuckets - 1;
+    cache->buckets = malloc(nbuckets * sizeof(*cache->buckets));
+    cache->entries = malloc(capacity * sizeof(*cache->entries));
+    if (cache->buckets == NULL || cache->entries == NULL) {
+        free(cache->buckets);
+        free(cache->entries);
+        free(cache);
+        return NULL;
+    }
+
+    memset(cache->buckets, -1, nbuckets * sizeof(*cache->buckets));
+
+    return cache;
+}
+
+
+/**
+ * Unlink an entry from LRU list.
+ **/
+static void lru_unlink(struct timefmt_cache *cache, int index) {
+    struct timefmt_entry *entry = &cache->entries[index];
+
+    if (entry->prev == -1) {
+        cache->head = entry->next;
+    } else {
+        cache->entries[entry->prev].next = entry->next;
+    }
+
+    if (entry->next == -1) {
+        cache->tail = entry->prev;
+    } else {
+        cache->entries[entry->next].prev = entry->prev;
+    }
+}
+
+
+/**
+ * Link an entry to the head of LRU list.
+ **/
+static void lru_push_front(struct timefmt_cache *cache, int index) {
+    struct timefmt_entry *entry = &cache->entries[index];
+
+    entry->prev = -1;
+    entry->next = cache->head;
+
+    if (cache->head == -1) {
+        cache->tail = index;
+    } else {
+        cache->entries[cache->head].prev = index;
+    }
+
+    cache->head = index;
+}
+
+
+/**
+ * Remove an entry from its hash bucket.
+ **/
+static void bucket_remove(struct timefmt_cache *cache, int index) {
+    int *link = &cache->buckets[cache->entries[index].hash & cache->bucket_mask];
+
+    while (*link != index) {
+        link = &cache->entries[*link].chain;
+    }
+
+    *link = cache->entries[index].chain;
+}
+
+
+/**
+ * Fetch compiled program of given format, compile it if not cached.
+ *
+ *  Arguments
+ *      cache: program cache.
+ *
+ *      format: time format.
+ *
+ *  Returns
+ *      Compiled program if success, NULL if format cannot be compiled.
+ *      The program stays valid until a later call evicts it.
+ **/
+const struct timefmt_program *timefmt_cache_get(struct timefmt_cache *cache, const char *format) {
+    uint64_t hash = hash_format(format);
+    int *bucket = &cache->buckets[hash & cache->bucket_mask];
+
+    // look for format in bucket
+    int index;
+    for (index = *bucket; index != -1; index = cache->entries[index].chain) {
+        struct timefmt_entry *entry = &cache->entries[index];
+        if (entry->hash == hash && strcmp(entry->format, format) == 0) {
+            // hit, mark as most recently used
+            if (cache->head != index) {
+                lru_unlink(cache, index);
+                lru_push_front(cache, index);
+            }
+
+            return entry->program;
+        }
+    }
+
+    // miss, compile it
+    struct timefmt_program *program = timefmt_compile(format);
+    if (program == NULL) {
+        return NULL;
+    }
+
+    char *format_copy = strdup(format);
+    if (format_copy == NULL) {
+        timefmt_free(program);
+        return NULL;
+    }
+
+    if (cache->size < cache->capacity) {
+        // take a free entry
+        index = cache->size++;
+    } else {
+        // evict least recently used entry
+        index = cache->tail;
+        lru_unlink(cache, index);
+        bucket_remove(cache, index);
+
+        free(cache->entries[index].format);
+        timefmt_free(cache->entries[index].program);
+    }
+
+    struct timefmt_entry *entry = &cache->entries[index];
+    entry->hash = hash;
+    entry->format = format_copy;
+    entry->program = program;
+
+    entry->chain = *bucket;
+    *bucket = index;
+
+    lru_push_front(cache, index);
+
+    return program;
+}
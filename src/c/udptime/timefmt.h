@@ -0,0 +1,27 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 10:31:02
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 10:31:02
+ */
+
+#include <stddef.h>
+#include <time.h>
+
+/*
+ * compiled time format program, see timefmt_compile.
+ */
+struct timefmt_program;
+
+/*
+ * LRU cache of compiled programs, keyed by format hash.
+ */
+struct timefmt_cache;
+
+struct timefmt_program *timefmt_compile(const char *format);
+void timefmt_free(struct timefmt_program *program);
+size_t timefmt_render(const struct timefmt_program *program, char *buffer, size_t size,
+        const struct tm *tm);
+
+struct timefmt_cache *timefmt_cache_new(int capacity);
+const struct timefmt_program *timefmt_cache_get(struct timefmt_cache *cache, const char *format);
@@ -0,0 +1,130 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 09:12:40
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 09:12:40
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+// after time.h, for struct timespec
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+#include "timestamp.h"
+
+
+/**
+ * Fetch current wall clock time.
+ *
+ *  Returns
+ *      Nanoseconds since the epoch.
+ **/
+int64_t realtime_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+
+/**
+ * Ask kernel to stamp every received datagram with its arrival time.
+ *
+ * SO_TIMESTAMPING is preferred, SO_TIMESTAMPNS is used as a fallback for
+ * kernels or sockets refusing the former.
+ *
+ *  Arguments
+ *      s: given socket.
+ *
+ *  Returns
+ *      0 if success, -1 if neither option is supported.
+ **/
+int enable_rx_timestamps(int s) {
+    // software receive timestamps, reported through SCM_TIMESTAMPING
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        return 0;
+    }
+
+    // nanosecond timestamps, reported through SCM_TIMESTAMPNS
+    int on = 1;
+    if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0) {
+        return 0;
+    }
+
+    return -1;
+}
+
+
+/**
+ * Receive a datagram together with its kernel receive timestamp.
+ *
+ *  Arguments
+ *      s: given socket, see enable_rx_timestamps.
+ *
+ *      buffer: buffer for storing datagram.
+ *
+ *      size: size of buffer.
+ *
+ *      peer_addr: buffer for storing peer address, optional.
+ *
+ *      ts: for storing receive timestamp in nanoseconds since the epoch;
+ *          falls back to current time if kernel gives no timestamp.
+ *
+ *  Returns
+ *      Bytes received if success, -1 if error.
+ **/
+ssize_t recv_with_timestamp(int s, void *buffer, size_t size,
+        struct sockaddr_in *peer_addr, int64_t *ts) {
+    struct iovec iov = {
+        .iov_base = buffer,
+        .iov_len = size,
+    };
+
+    // control buffer, big enough for struct scm_timestamping
+    char control[CMSG_SPACE(sizeof(struct scm_timestamping))];
+
+    struct msghdr msg;
+    bzero(&msg, sizeof(msg));
+    msg.msg_name = peer_addr;
+    msg.msg_namelen = peer_addr == NULL ? 0 : sizeof(*peer_addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t bytes = recvmsg(s, &msg, 0);
+    if (bytes == -1) {
+        return -1;
+    }
+
+    // look for timestamp in control messages
+    *ts = 0;
+    struct cmsghdr *cmsg;
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+
+        // software timestamp lives in the first slot
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            struct scm_timestamping tss;
+            memcpy(&tss, CMSG_DATA(cmsg), sizeof(tss));
+            *ts = tss.ts[0].tv_sec * NSEC_PER_SEC + tss.ts[0].tv_nsec;
+        } else if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec tv;
+            memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+            *ts = tv.tv_sec * NSEC_PER_SEC + tv.tv_nsec;
+        }
+    }
+
+    // no timestamp given, take it now
+    if (*ts == 0) {
+        *ts = realtime_ns();
+    }
+
+    return bytes;
+}
@@ -0,0 +1,17 @@
+/*
+ * Author: fasion
+ * Created time: 2026-10-19 09:12:40
+ * Last Modified by: fasion
+ * Last Modified time: 2026-10-19 09:12:40
+ */
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define NSEC_PER_SEC 1000000000LL
+
+int64_t realtime_ns();
+int enable_rx_timestamps(int s);
+ssize_t recv_with_timestamp(int s, void *buffer, size_t size,
+        struct sockaddr_in *peer_addr, int64_t *ts);